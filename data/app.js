@@ -59,22 +59,12 @@ function addLog(text, cls) {
 // ---------------------------------------------------------------------------
 // Saved-command matching
 // ---------------------------------------------------------------------------
-function matchSaved(protocol, value, bits) {
-  var proto = (protocol || '').toUpperCase();
-  var val = (value || '').toUpperCase();
-  var b = parseInt(bits, 10) || 0;
-  var exact = null, likely = null;
-
-  for (var i = 0, len = savedIndex.length; i < len; i++) {
-    var s = savedIndex[i];
-    if (s._uProto === proto && s._uVal === val) {
-      if (s._iBits === b) { exact = s; break; }
-      if (!likely) likely = s;
-    }
-  }
-  return exact ? { match: 'exact', item: exact }
-       : likely ? { match: 'likely', item: likely }
-       : { match: 'unknown', item: null };
+// The device labels each capture with the saved code it matches:
+// data.match is "exact", "likely" (bits differ) or "unknown", data.saved
+// the matching code's { index, id, name }.
+function savedMatch(data) {
+  var m = data.match || 'unknown';
+  return { match: m, item: m !== 'unknown' ? data.saved : null };
 }
 
 function matchClass(m) {
@@ -93,12 +83,7 @@ function matchLabel(m, human) {
 // Render stored-commands list
 // ---------------------------------------------------------------------------
 function renderSavedList(items) {
-  savedIndex = (items || []).map(function (it) {
-    it._uProto = (it.protocol || '').toUpperCase();
-    it._uVal = (it.value || '').toUpperCase();
-    it._iBits = parseInt(it.bits, 10) || 0;
-    return it;
-  });
+  savedIndex = items || [];
   var el = document.getElementById('saved-list');
   var h = '';
   if (!savedIndex || !savedIndex.length) {
@@ -110,17 +95,18 @@ function renderSavedList(items) {
       var protocol = it.protocol || 'UNKNOWN';
       var value = it.value || '0';
       var bits = it.bits || 32;
-      var sendUrl = (protocol.toUpperCase() === 'NEC')
-        ? ('/send?type=nec&data=' + encodeURIComponent(value) + '&length=' + encodeURIComponent(bits))
+      var sendUrl = (protocol.toUpperCase() !== 'UNKNOWN')
+        ? ('/send?type=' + encodeURIComponent(protocol.toLowerCase()) + '&data=' + encodeURIComponent(value) + '&length=' + encodeURIComponent(bits))
         : '';
 
       h += '<div class="saved-item" data-index="' + esc(idx) + '" data-protocol="' + esc(protocol) + '" data-value="' + esc(value) + '" data-bits="' + esc(bits) + '">';
       h += '<span class="saved-name">' + esc(name) + '</span>';
       h += sendUrl
         ? ' <a href="' + sendUrl + '" class="btn btn-send" title="Send">Send</a>'
-        : ' <span class="saved-na">(NEC only)</span>';
-      h += ' <a href="#" class="btn btn-rename" data-index="' + esc(idx) + '" title="Rename">Edit</a>';
-      h += ' <a href="#" class="btn btn-delete" data-index="' + esc(idx) + '" title="Delete">Del</a>';
+        : ' <span class="saved-na">(not sendable)</span>';
+      // Edits target the stable id, so they stay correct if the list changed meanwhile
+      h += ' <a href="#" class="btn btn-rename" data-id="' + esc(it.id) + '" title="Rename">Edit</a>';
+      h += ' <a href="#" class="btn btn-delete" data-id="' + esc(it.id) + '" title="Delete">Del</a>';
       h += '<span class="saved-meta">' + esc(protocol) + ' 0x' + esc(value) + ' ' + esc(bits) + 'b</span>';
       h += '</div>';
     });
@@ -175,7 +161,7 @@ function setLast(data) {
 
   // Log the received IR event with matching
   if (data.protocol || data.human) {
-    var m = matchSaved(data.protocol, data.value, data.bits);
+    var m = savedMatch(data);
     var label = 'RX: ' + matchLabel(m, data.human);
     addLog(label, matchClass(m));
   }
@@ -219,6 +205,8 @@ function connectWs() {
             value: d.value,
             bits: d.bits
           });
+        } else if (d.event === 'job') {
+          if (d.state === 'dropped') addLog('TX job ' + d.id + ' dropped', 'log-failed');
         } else if (d.ok && (d.msg || d.name)) {
           showModal(d.name || d.msg);
           addLog('TX ack: ' + (d.name || d.msg), 'log-send');
@@ -255,11 +243,11 @@ document.addEventListener('click', function (e) {
     addLog('TX: Sending ' + name + '…', 'log-send');
 
     if (ws && ws.readyState === WebSocket.OPEN) {
-      var m = u.match(/\/send\?type=nec&data=([0-9A-Fa-f]+)&length=(\d+)/);
+      var m = u.match(/\/send\?type=([0-9A-Za-z_]+)&data=([0-9A-Fa-f]+)&length=(\d+)/);
       if (m) {
         ws.send(JSON.stringify({
-          cmd: 'send', type: 'nec', data: m[1],
-          length: parseInt(m[2], 10), name: name
+          cmd: 'send', type: m[1], data: m[2],
+          length: parseInt(m[3], 10), name: name
         }));
         return;
       }
@@ -279,13 +267,13 @@ document.addEventListener('click', function (e) {
   // ---- Delete ----
   if (t.classList.contains('btn-delete')) {
     e.preventDefault();
-    var idx = t.getAttribute('data-index');
+    var id = t.getAttribute('data-id');
     if (!confirm('Remove this stored code?')) return;
-    fetch('/saved/delete?index=' + idx, { method: 'POST' })
+    fetch('/saved/delete?id=' + id, { method: 'POST' })
       .then(function (r) { return r.json(); })
       .then(function (d) {
         if (d.ok) {
-          addLog('Deleted stored code #' + idx, 'log-unknown');
+          addLog('Deleted stored code id ' + id, 'log-unknown');
           refreshStoredList();
         }
       });
@@ -295,13 +283,13 @@ document.addEventListener('click', function (e) {
   // ---- Rename ----
   if (t.classList.contains('btn-rename')) {
     e.preventDefault();
-    var idx2 = t.getAttribute('data-index');
+    var id2 = t.getAttribute('data-id');
     var row2 = t.closest('.saved-item');
     var cur = (row2 && row2.querySelector('.saved-name'))
       ? row2.querySelector('.saved-name').textContent : '';
     var next = prompt('Rename saved code:', cur);
     if (next === null) return;
-    fetch('/saved/rename?index=' + idx2 + '&name=' + encodeURIComponent(next), { method: 'POST' })
+    fetch('/saved/rename?id=' + id2 + '&name=' + encodeURIComponent(next), { method: 'POST' })
       .then(function (r) { return r.json(); })
       .then(function (d) {
         if (d.ok) refreshStoredList();
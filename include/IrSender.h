@@ -2,47 +2,339 @@
 #define IR_SENDER_H
 
 #include <Arduino.h>
+#include <IRremoteESP8266.h>
 #include <IRsend.h>
-#include <mutex>
+#include <atomic>
+#include "ir_protocol_timing.h"
+#include "worker_task.h"
+
+// Default number of jobs IrSender can hold while another one is transmitting.
+// Overridden by -DIR_SEND_QUEUE_DEPTH from .env via scripts/pio_env_flags.py.
+#ifndef IR_SEND_QUEUE_DEPTH
+#define IR_SEND_QUEUE_DEPTH 8
+#endif
+
+// Cap on the repeats a job can collect by merging resubmissions of its code
+// (0 disables coalescing). Overridden by -DIR_SEND_COALESCE_MAX from .env.
+#ifndef IR_SEND_COALESCE_MAX
+#define IR_SEND_COALESCE_MAX 20
+#endif
+
+// Priority of the optional transmit task (Arduino loop() runs at 1).
+#ifndef IR_TX_TASK_PRIORITY
+#define IR_TX_TASK_PRIORITY 5
+#endif
 
 class IrSender {
 public:
+    // Hard upper bound for the configurable queue depth (static storage, no heap).
+    static const size_t kMaxQueueDepth = 32;
+    // Sequence jobs: at most this many steps each, and this many queued or
+    // transmitting at once (static storage, no heap).
+    static const size_t kMaxSequenceSteps = 16;
+    static const size_t kSequenceSlots = 2;
+    // Raw jobs: at most this many mark/space timings each, and this many
+    // queued or transmitting at once (static storage, no heap).
+    static const size_t kMaxRawTimings = 512;
+    static const size_t kRawSlots = 2;
+    // Upper bound for the repeat count of a job; job tickets carry it in 16 bits.
+    static const int kMaxRepeat = 0xFFFF;
+    // Upper bound for a sequence step's post-delay, in milliseconds.
+    static const uint16_t kMaxPostDelayMs = 10000;
+    // Spacing between frames of protocols without an entry in the timing
+    // table (see ir_protocol_timing.h), in milliseconds.
+    static const unsigned long kFrameGapMs = 50;
+
+    // What queue() does when the queue already holds `depth` jobs.
+    enum class OverflowPolicy {
+        Reject,          // refuse the new job
+        DropOldest,      // discard the oldest pending job to make room
+        ReplaceSameCode, // update a pending job with the same code in place; otherwise reject
+    };
+
+    // What queue() did with a submission.
+    enum class Admission : uint8_t {
+        Accepted,         // queued as a new job
+        Coalesced,        // repeats merged into the newest job with the same code
+        Replaced,         // updated a pending job with the same code (ReplaceSameCode)
+        RejectedFull,     // queue (or sequence/raw storage) full
+        RejectedInvalid,  // invalid arguments
+    };
+
+    // Result of queue()/queueSequence()/queueRaw(): the admission and the id
+    // of the job that will carry the submission (0 when rejected). Converts
+    // to true when the submission was taken.
+    struct Submission {
+        Admission admission;
+        uint32_t jobId;
+        explicit operator bool() const { return jobId != 0; }
+    };
+
+    // Lifecycle of a job, reported by jobStatus().
+    enum class JobState : uint8_t {
+        Unknown,       // no such id, or its record was recycled
+        Queued,
+        Transmitting,  // first frame sent
+        Done,
+        Dropped,       // evicted (DropOldest), not sendable, or cut short by stopTask()
+    };
+
+    // Timestamps are millis(); 0 until the state is reached.
+    struct JobStatus {
+        uint32_t id;
+        JobState state;
+        uint32_t queuedMs;
+        uint32_t startedMs;
+        uint32_t finishedMs;
+    };
+
+    // Status of the most recent jobs is kept for lookup by id (power of two).
+    static const size_t kStatusSlots = 64;
+
+    // One step of a sequence job: a code, its repeat count, and how long to
+    // stay silent after its last frame before the next step starts.
+    struct SequenceStep {
+        decode_type_t protocol;
+        uint64_t value;
+        uint16_t bits;
+        uint8_t repeat;        // >= 1
+        uint16_t postDelayMs;  // <= kMaxPostDelayMs
+    };
+
     // Pass the global IRsend object by reference
-    IrSender(IRsend& irsend);
+    IrSender(IRsend& irsend, size_t depth = IR_SEND_QUEUE_DEPTH,
+             OverflowPolicy policy = OverflowPolicy::Reject,
+             uint16_t coalesceLimit = IR_SEND_COALESCE_MAX);
+
+    // Queue an IR send command (thread-safe, lock-free, non-blocking).
+    // Any number of tasks may call this concurrently; only loop() consumes.
+    // Jobs are transmitted in FIFO order; each job sends all of its repeats
+    // before the next one starts. Rejected (false) on a repeat outside
+    // 1..kMaxRepeat, or when the queue is full under OverflowPolicy::Reject.
+    // The first frame goes through IRsend::send(), which dispatches on
+    // protocol; repeats follow the protocol's timing (frame period, minimum
+    // gap, and NEC-style repeat codes instead of full frames where the
+    // protocol uses them).
+    // Coalescing: if the same (protocol, value, bits) is the newest job - the
+    // last pending one, or the one transmitting with nothing pending (until
+    // one frame slot after its last frame) - the repeats are merged into it,
+    // up to the coalesce limit, instead of queueing a new job. A held button
+    // or a retrying client then gives continuous output without restarts.
+    Submission queue(decode_type_t protocol, uint64_t value, uint16_t bits, int repeat);
+
+    // Shorthand for queue(NEC, value, length, repeat).
+    Submission queue(uint32_t value, uint16_t length, int repeat);
+
+    // Queue an ordered list of codes as one job: the steps go out back to back
+    // with no other job in between. The steps are copied. Rejected if count
+    // or a step is invalid, all sequence slots are busy, or the queue is
+    // full. Sequences are never merged under ReplaceSameCode.
+    Submission queueSequence(const SequenceStep* steps, size_t count);
+
+    // Queue a frame given as mark/space timings in microseconds (starting
+    // with a mark), sent with IRsend::sendRaw() at carrierKHz: a code
+    // pre-encoded once by the caller, or captured timings of a protocol
+    // IRsend cannot encode. `protocol` only selects the frame timing (UNKNOWN
+    // for the default gap); repeats of a RepeatBurst protocol are sent as
+    // repeat codes. The timings are copied. Rejected if an argument is
+    // invalid, all raw slots are busy, or the queue is full. Raw jobs are
+    // never coalesced.
+    Submission queueRaw(decode_type_t protocol, const uint16_t* timings, size_t count,
+                        uint16_t carrierKHz, int repeat);
+
+    // Look up a job by id (any task). Returns false (state Unknown) once the
+    // id is older than the last kStatusSlots jobs.
+    bool jobStatus(uint32_t id, JobStatus& out) const;
+
+    // Id of the most recently queued job (0 = none yet).
+    uint32_t lastJobId() const { return _nextJobId.load(std::memory_order_acquire) - 1; }
 
-    // Queue an IR send command (thread-safe, non-blocking)
-    // Overwrites any pending command. If a command is currently sending,
-    // the new command will start as soon as possible (next loop iteration),
-    // interrupting the current sequence.
-    void queue(uint32_t value, uint16_t length, int repeat);
+    // Bumped on every job state change; poll it to find out when to look
+    // at jobStatus() again.
+    uint32_t statusVersion() const { return _statusVersion.load(std::memory_order_acquire); }
 
-    // Call this in the main loop to process the queue
+    static const char* admissionName(Admission admission);
+    static const char* jobStateName(JobState state);
+
+    // Call this in the main loop to process the queue. When idle this costs a
+    // single atomic load. Does nothing while the transmit task is running.
     void loop();
 
-    // Check if currently busy sending
+    // Task mode: transmit from a dedicated task that sleeps until queue()
+    // notifies it and spaces frames with delayUntil instead of polling
+    // millis() from loop(). Returns false if the task could not be created
+    // (the sender then keeps working from loop()).
+    bool startTask(int priority = IR_TX_TASK_PRIORITY, uint32_t stackBytes = 4096);
+
+    // Leave task mode after the current frame (the rest of the active job is
+    // dropped); pending jobs go back to loop().
+    void stopTask();
+
+    bool isTaskMode() const { return _taskMode.load(std::memory_order_acquire); }
+
+    // Check if currently busy sending (including the frame slot after a job's
+    // last frame in which a resubmitted code is still merged into it)
     bool isActive() const;
 
     // Check if a job is currently queued and waiting to be processed by loop()
     bool isJobPending() const;
 
+    // Number of jobs waiting behind the active one.
+    size_t pendingJobs() const;
+
+    // Configured queue depth (clamped to 1..kMaxQueueDepth).
+    size_t depth() const { return _depth; }
+
+    OverflowPolicy overflowPolicy() const { return _policy; }
+
+    uint16_t coalesceLimit() const { return _coalesceLimit; }
+
+    // Submissions that became a new job vs. ones merged into an existing job
+    // (coalesced, or replaced under ReplaceSameCode).
+    uint32_t freshJobs() const { return _freshJobs.load(std::memory_order_relaxed); }
+    uint32_t coalescedJobs() const { return _coalescedJobs.load(std::memory_order_relaxed); }
+
 private:
+    struct Job {
+        decode_type_t protocol;
+        uint64_t value;
+        uint16_t bits;
+        int repeats;
+        uint32_t id;
+    };
+
+    // Storage for a queued sequence. A ring job with protocol kSequenceJob
+    // carries the slot index as its value; the producer that claims `inUse`
+    // fills the steps before publishing the job, the consumer (or a
+    // DropOldest eviction) clears it when done.
+    struct SequenceSlot {
+        std::atomic<bool> inUse;
+        size_t count;
+        SequenceStep steps[kMaxSequenceSteps];
+    };
+
+    static const decode_type_t kSequenceJob = (decode_type_t)-2;
+
+    // Storage for a queued raw frame, claimed and released like SequenceSlot;
+    // a ring job with protocol kRawJob carries the slot index as its value.
+    struct RawSlot {
+        std::atomic<bool> inUse;
+        decode_type_t protocol;  // selects the frame timing
+        uint16_t carrierKHz;
+        size_t count;
+        uint16_t timings[kMaxRawTimings];
+    };
+
+    static const decode_type_t kRawJob = (decode_type_t)-3;
+
+    // One fixed-size job record. `seq` follows Vyukov's bounded-queue scheme:
+    // pos = free for the producer claiming pos, pos + 1 = published for the
+    // consumer. `ticket` packs (pos & 0xFFFF) << 16 | repeats so a producer can
+    // update a published job in place; the consumer swaps it to 0 on claim.
+    // The 64-bit value is split in two words so every field stays a native
+    // 32-bit atomic on the ESP32-C3; `code` packs protocol << 16 | bits.
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        std::atomic<uint32_t> id;
+        std::atomic<uint32_t> valueLo;
+        std::atomic<uint32_t> valueHi;
+        std::atomic<uint32_t> code;
+        std::atomic<uint32_t> ticket;
+    };
+
+    // Ring is twice the maximum depth so dequeuers that are mid-release never
+    // make a reserved enqueue find its slot still occupied.
+    static const uint32_t kRingSize = 2 * kMaxQueueDepth;
+    static const uint32_t kRingMask = kRingSize - 1;
+
+    bool reserve();
+    void enqueue(const Job& job);
+    bool dequeue(Job& out);
+    bool updatePending(const Job& job, uint32_t first, bool add, uint32_t& id);
+    bool extendActive(const Job& job, uint32_t& id);
+    bool coalesce(const Job& job, uint32_t& id);
+    void openExtension();
+    uint32_t takeExtension(bool close);
+    void addRepeats(uint32_t extra);
+    bool submit(Job& job);
+    void releaseJob(const Job& job);
+    void startJob(const Job& job);
+    void loadStep();
+    void finishJob(JobState state = JobState::Done);
+    void newStatus(uint32_t id);
+    void setStatus(uint32_t id, JobState state);
+    bool transmitNext(bool inTask);
+    uint32_t clockMs(bool inTask) const;
+    bool frameDue(uint32_t now) const;
+    bool emitFrame(const Job& job, bool repeatFrame);
+    void waitForFrameSlot();
+    static void taskEntry(void* self);
+    void taskLoop();
+
     IRsend& _irsend;
+    const size_t _depth;
+    const OverflowPolicy _policy;
+    const uint16_t _coalesceLimit;
+
+    // Shared state (lock-free): ring of job records
+    Slot _slots[kRingSize];
+    std::atomic<uint32_t> _head;
+    std::atomic<uint32_t> _tail;
+    std::atomic<uint32_t> _count;  // reserved + published jobs, bounded by _depth
+    SequenceSlot _sequences[kSequenceSlots];
+    RawSlot _raws[kRawSlots];
+
+    // Active-job extension for coalescing: bit 31 = open, bits 16-30 =
+    // generation, bits 0-15 = repeats added by queue() not yet taken by the
+    // consumer. The _ext* fields hold the active job's code while open.
+    std::atomic<uint32_t> _extension;
+    std::atomic<uint32_t> _extValueLo;
+    std::atomic<uint32_t> _extValueHi;
+    std::atomic<uint32_t> _extCode;
+    std::atomic<uint32_t> _extJobId;
+
+    // Job status records, indexed by id % kStatusSlots. `id` is written last
+    // (and cleared first) when a record is recycled, so readers can detect a
+    // record that changed hands while they read it.
+    struct StatusRecord {
+        std::atomic<uint32_t> id;
+        std::atomic<uint8_t> state;
+        std::atomic<uint32_t> queuedMs;
+        std::atomic<uint32_t> startedMs;
+        std::atomic<uint32_t> finishedMs;
+    };
+    StatusRecord _status[kStatusSlots];
+    std::atomic<uint32_t> _nextJobId;
+    std::atomic<uint32_t> _statusVersion;
 
-    mutable std::mutex _mutex;
+    std::atomic<uint32_t> _freshJobs;
+    std::atomic<uint32_t> _coalescedJobs;
 
-    // Shared state (protected by mutex)
-    uint32_t _pendingValue;
-    uint16_t _pendingLength;
-    int _pendingRepeats;
-    bool _jobPending;
+    WorkerTask _task;
+    std::atomic<bool> _taskMode;
 
-    // Internal state (only accessed by loop)
-    uint32_t _currentValue;
-    uint16_t _currentLength;
+    // Internal state (only accessed by loop, or by the task in task mode)
+    Job _current;                  // the job, or the current step of a sequence
+    uint32_t _currentJobId;        // 0 once the active job's final state is recorded
+    bool _currentStarted;          // a frame of the active job has been sent
+    SequenceSlot* _sequence;       // non-null while a sequence job is active
+    RawSlot* _raw;                 // non-null while a raw job is active
+    size_t _step;
+    uint16_t _currentPostDelayMs;
+    bool _extensionOpen;
+    const IrProtocolTiming* _currentTiming;
     int _currentRepeatsLeft;
-    unsigned long _lastSendTime;
-    bool _active;
-    bool _startImmediate;
+    // Previous frame: when it started and ended, its frame period, the
+    // silence required after it, and whether IRsend already padded it to
+    // the frame period. Times are millis() in loop() mode, task clock
+    // otherwise.
+    uint32_t _lastFrameStart;
+    uint32_t _lastFrameEnd;
+    const IrProtocolTiming* _lastTiming;
+    uint32_t _lastGapMs;
+    bool _lastFramePadded;
+    std::atomic<bool> _active;
+    bool _hasSent;
 };
 
 #endif
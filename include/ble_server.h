@@ -20,6 +20,11 @@
 #define BLE_USE_PASSKEY           0
 #endif
 
+// Send Command: write {BLE_SEND_SEQUENCE_PREFIX, N} to run saved sequence N.
+#define BLE_SEND_SEQUENCE_PREFIX  0xFF
+// Send Command: write {BLE_SEND_ID_PREFIX, lo, hi} to send the saved code with that stable id.
+#define BLE_SEND_ID_PREFIX        0xFE
+
 #define BLE_SCHEDULE_CMD_NAME_MAX 32   // max length of scheduled command name
 // Max delay_seconds so that delay_seconds * 1000 fits in uint32_t (avoids overflow).
 #define BLE_SCHEDULE_DELAY_SEC_MAX  (4294967u)  // UINT32_MAX / 1000
@@ -11,8 +11,19 @@ bool isHexValue(const char* s);
 // Truncates to 32 bits for compatibility with IR code representation.
 String uint64ToHex(uint64_t val);
 
+// Converts a uint64_t to zero-padded uppercase hex wide enough for `bits`:
+// 8 characters up to 32 bits (same as uint64ToHex), up to 16 beyond that.
+String uint64ToHexBits(uint64_t val, uint16_t bits);
+
 // Robustly parses a hex string into a uint32_t.
 // Returns false if the string is not valid hex, exceeds 32 bits, or contains trailing garbage.
 bool parseHex32(const char* s, uint32_t& out_value);
 
+// Same as parseHex32 for values up to 64 bits (at most 16 significant digits).
+bool parseHex64(const char* s, uint64_t& out_value);
+
+// Same for values up to 128 bits (at most 32 significant digits), split into
+// the upper and lower 64 bits.
+bool parseHex128(const char* s, uint64_t& out_hi, uint64_t& out_lo);
+
 #endif // HEX_UTILS_H
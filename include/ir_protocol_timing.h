@@ -0,0 +1,36 @@
+#ifndef IR_PROTOCOL_TIMING_H
+#define IR_PROTOCOL_TIMING_H
+
+#include <stdint.h>
+#include <IRremoteESP8266.h>
+
+// How a protocol repeats a held button.
+enum class IrRepeatStyle : uint8_t {
+    FullFrame,    // every repeat resends the whole frame
+    RepeatBurst,  // repeats are a short header + stop mark (NEC-style repeat code)
+};
+
+// Frame cadence for one protocol, taken from the protocol specs (and the
+// constants IRremoteESP8266 uses for its own repeats).
+struct IrProtocolTiming {
+    uint16_t framePeriodMs;  // start-to-start spacing of consecutive frames; 0 = none
+    uint16_t minGapMs;       // minimum silence from the end of a frame to the next one
+    // IRsend::send() ends each full frame with the protocol's gap, padded so
+    // the frame lasts framePeriodMs; minGapMs then applies only to frames we
+    // time ourselves (repeat bursts, raw timings).
+    bool sendPadsFrame;
+    IrRepeatStyle repeatStyle;
+    // Shape of the repeat burst (RepeatBurst only), in microseconds.
+    uint16_t burstHeaderMarkUs;
+    uint16_t burstHeaderSpaceUs;
+    uint16_t burstStopMarkUs;
+};
+
+// Carrier frequency used for repeat bursts.
+static const uint32_t kIrRepeatBurstCarrierHz = 38000;
+
+// Timing for `protocol`. Protocols without a table entry get a plain 50 ms
+// gap between full frames.
+const IrProtocolTiming& irProtocolTiming(decode_type_t protocol);
+
+#endif // IR_PROTOCOL_TIMING_H
@@ -0,0 +1,36 @@
+#ifndef IR_RAW_ENCODER_H
+#define IR_RAW_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <IRremoteESP8266.h>
+
+// Mark/space shape of a pulse-distance protocol, as IRsend::sendGeneric()
+// emits it for that protocol (constants from IRremoteESP8266), in microseconds.
+struct IrPulseDistance {
+    uint16_t headerMarkUs;
+    uint16_t headerSpaceUs;
+    uint16_t bitMarkUs;
+    uint16_t oneSpaceUs;
+    uint16_t zeroSpaceUs;
+    uint16_t footerMarkUs;
+    uint16_t carrierKHz;
+};
+
+// Longest code irRawEncode() accepts, and the timing count it needs.
+static const uint16_t kIrRawEncodeMaxBits = 128;
+static const size_t kIrRawEncodeMaxTimings = 2 + 2 * kIrRawEncodeMaxBits + 1;
+
+// Shape for `protocol`, or nullptr if it cannot be pre-encoded (only NEC and
+// SAMSUNG; everything else keeps going through IRsend::send()).
+const IrPulseDistance* irPulseDistance(decode_type_t protocol);
+
+// Encode one frame of `protocol` into mark/space durations for
+// IRsend::sendRaw(): header, `bits` data bits MSB first, footer mark. The
+// trailing gap is left to the sender's frame timing. Bits above 64 come from
+// valueHi. Returns the number of timings written, or 0 if the protocol is not
+// encodable, bits is 0 or above kIrRawEncodeMaxBits, or `max` is too small.
+size_t irRawEncode(decode_type_t protocol, uint64_t valueHi, uint64_t valueLo, uint16_t bits,
+                   uint16_t* out, size_t max);
+
+#endif // IR_RAW_ENCODER_H
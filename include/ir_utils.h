@@ -2,6 +2,7 @@
 #define IR_UTILS_H
 
 #include <Arduino.h>
+#include <IRremoteESP8266.h>
 #include "hex_utils.h"
 
 struct IrCapture {
@@ -11,7 +12,16 @@ struct IrCapture {
   String human;
 };
 
-// Build replay URL for protocols we can send (currently NEC only). Returns empty if not supported.
+// Resolve a protocol name (case-insensitive, e.g. "nec", "SAMSUNG", "rc5") to a
+// type IrSender can transmit from a value + bit count. Rejects unknown names and
+// A/C protocols that need a full state array.
+bool parseSendableProtocol(const char* name, decode_type_t& out);
+
+// Same check for a protocol given by its decode_type_t value (e.g. from a
+// binary WebSocket frame).
+bool isSendableProtocol(decode_type_t type);
+
+// Build replay URL for protocols we can send. Returns empty if not supported.
 String replayUrlFor(const IrCapture& c);
 
 // Build /save URL for a capture, with optional name query param.
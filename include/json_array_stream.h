@@ -0,0 +1,57 @@
+#ifndef JSON_ARRAY_STREAM_H
+#define JSON_ARRAY_STREAM_H
+
+#include <stddef.h>
+#include <functional>
+#include <vector>
+
+// Splits a JSON array that arrives in chunks (an HTTP body) into the text of
+// its top-level elements, so each element can be parsed on its own and the
+// whole document never has to be in memory. Only the structure needed to
+// find element boundaries is checked (brackets, strings, escapes); elements
+// are validated by whoever parses them.
+//
+// Elements longer than the limit are not buffered: they are reported with a
+// null text so the caller can count them as skipped, and RAM stays bounded
+// by the limit regardless of the body size.
+class JsonArrayStream {
+public:
+    enum class Status { More, Done, Error };
+
+    // Called once per element, in order: index is the element's position in
+    // the array, json its text (not NUL-terminated, surrounding whitespace
+    // trimmed) or nullptr when it exceeded maxElementBytes.
+    typedef std::function<void(size_t index, const char* json, size_t len)> ElementFn;
+
+    explicit JsonArrayStream(size_t maxElementBytes);
+
+    // Scan the next chunk. Returns Done after the closing bracket, Error on
+    // malformed input (see error()), otherwise More. Once Done or Error,
+    // further chunks are ignored except that trailing non-whitespace after
+    // Done is an error.
+    Status feed(const char* data, size_t len, const ElementFn& onElement);
+
+    Status status() const { return _status; }
+    size_t elements() const { return _index; }
+    const char* error() const { return _error; }
+
+private:
+    enum class State { BeforeArray, BeforeElement, InElement, AfterArray };
+
+    void fail(const char* error);
+    void finishElement(const ElementFn& onElement);
+
+    size_t _maxElementBytes;
+    std::vector<char> _element;
+    bool _oversized = false;
+    State _state = State::BeforeArray;
+    Status _status = Status::More;
+    const char* _error = nullptr;
+    size_t _index = 0;
+    size_t _depth = 0;
+    bool _inString = false;
+    bool _escape = false;
+    bool _sawComma = false;
+};
+
+#endif // JSON_ARRAY_STREAM_H
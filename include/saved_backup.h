@@ -0,0 +1,106 @@
+#ifndef SAVED_BACKUP_H
+#define SAVED_BACKUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "saved_code_table.h"
+#include "saved_sequence_table.h"
+
+// Binary image of all saved codes and sequences, for backing a device up and
+// provisioning another one (GET /saved/backup, POST /saved/restore). Both
+// ends work on a stream: the writer produces the image a few KB at a time
+// from the tables, and the reader applies it element by element as it
+// arrives, so neither holds the whole image.
+//
+// Format, integers little-endian:
+//   header   16 bytes: "IRB", version, u32 body bytes, u32 CRC-32 of the
+//            body (IEEE, as zlib's crc32), u16 codes, u16 sequences
+//   body     elements: u8 kind, u32 payload bytes, payload
+//     codes     a SavedCodeTable blob of the next codes in list order (ids
+//               kept); all code elements come before any sequence
+//     sequence  one sequence's record (see saved_sequence_table.h): u8
+//               name bytes, name, u8 steps, then per step: u16 saved code
+//               id (0 for its own code), i16 protocol, u64 value, u16 bits,
+//               u8 repeat, u8 reserved, u16 delay ms
+// Code elements hold as many codes as fit in kSavedBackupCodesTarget bytes, at
+// least one; no element may exceed kSavedBackupMaxElementBytes.
+static const uint8_t kSavedBackupVersion = 1;
+static const size_t kSavedBackupHeaderBytes = 16;
+static const size_t kSavedBackupElementHeaderBytes = 5;
+static const size_t kSavedBackupCodesTarget = 2048;
+static const size_t kSavedBackupMaxElementBytes = 8192;
+
+// CRC-32 (IEEE) of data, continuing from crc.
+uint32_t savedBackupCrc32(const uint8_t* data, size_t len, uint32_t crc = 0);
+
+// Produces the image of two tables. The tables must not change while it is
+// read; callers that cannot hold them still check their generation()
+// between reads.
+class SavedBackupWriter {
+public:
+    // Walks the tables once to size the image and compute its CRC.
+    SavedBackupWriter(const SavedCodeTable& codes, const SavedSequenceTable& sequences);
+
+    size_t size() const { return kSavedBackupHeaderBytes + _bodyBytes; }
+    uint32_t crc() const { return _crc; }
+
+    // Copy the next bytes of the image to buf. Returns the bytes copied,
+    // less than len only at the end of the image.
+    size_t read(uint8_t* buf, size_t len);
+
+private:
+    void rewind();
+    bool nextElement();
+
+    const SavedCodeTable& _codes;
+    const SavedSequenceTable& _sequences;
+    size_t _bodyBytes = 0;
+    uint32_t _crc = 0;
+    size_t _nextCode = 0;
+    size_t _nextSequence = 0;
+    std::vector<uint8_t> _element;  // bytes being read out
+    size_t _elementPos = 0;
+    std::vector<uint8_t> _blob;     // scratch for code elements
+};
+
+// Applies an image, fed in chunks, to a pair of tables (normally empty ones,
+// committed once the image is Done). Holds at most one element. The CRC is
+// only known at the end, so on Error the tables hold part of the image and
+// should be dropped.
+class SavedBackupReader {
+public:
+    enum class Status { More, Done, Error };
+
+    SavedBackupReader(SavedCodeTable& codes, SavedSequenceTable& sequences) : _codes(codes), _sequences(sequences) {}
+
+    // Scan the next chunk. Returns Done once the whole body is in and its
+    // CRC and counts match, Error on anything else wrong (see error()),
+    // otherwise More. Data after the end of the image is an error.
+    Status feed(const uint8_t* data, size_t len);
+
+    Status status() const { return _status; }
+    const char* error() const { return _error; }
+    size_t imageBytes() const { return kSavedBackupHeaderBytes + _bodyBytes; }  // from the header
+
+private:
+    Status fail(const char* error);
+    bool applyElement();
+
+    SavedCodeTable& _codes;
+    SavedSequenceTable& _sequences;
+    std::vector<uint8_t> _buf;  // header, then the element being read
+    size_t _need = kSavedBackupHeaderBytes;  // bytes _buf needs before it is parsed
+    bool _inHeader = true;
+    bool _inPayload = false;
+    size_t _bodyBytes = 0;
+    size_t _bodyRead = 0;
+    uint32_t _crc = 0;
+    uint32_t _expectedCrc = 0;
+    uint16_t _expectedCodes = 0;
+    uint16_t _expectedSequences = 0;
+    Status _status = Status::More;
+    const char* _error = nullptr;
+};
+
+#endif // SAVED_BACKUP_H
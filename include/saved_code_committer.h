@@ -0,0 +1,59 @@
+#ifndef SAVED_CODE_COMMITTER_H
+#define SAVED_CODE_COMMITTER_H
+
+#include <stdint.h>
+
+// When to commit the saved-code journal (see saved_code_store.h), and how
+// long commits take. Changes are committed once none has come for quietMs,
+// so a burst of edits becomes one write, but no later than maxDelayMs after
+// the first uncommitted one; a failed commit is retried after retryMs.
+// Times are milliseconds on any wrapping monotonic clock (millis()). Not
+// thread-safe: call with the saved codes locked.
+class SavedCodeCommitter {
+public:
+    static const uint32_t kIdle = UINT32_MAX;
+
+    SavedCodeCommitter(uint32_t quietMs, uint32_t maxDelayMs, uint32_t retryMs)
+        : _quietMs(quietMs), _maxDelayMs(maxDelayMs), _retryMs(retryMs) {}
+
+    // A change was journaled.
+    void changed(uint32_t nowMs);
+
+    // Milliseconds until a commit should start (0 = now), or kIdle when
+    // nothing waits. `worthwhile` is the store's commitDue(): while it is
+    // false, journaled changes are left where they are.
+    uint32_t dueInMs(uint32_t nowMs, bool worthwhile) const;
+
+    // A commit that started at startMs has finished. `pending` is whether
+    // changes made while it was written are still only in the journal.
+    void committed(uint32_t startMs, uint32_t endMs, bool ok, bool pending);
+
+    // Nothing is left to commit (the journal was emptied another way).
+    void clear() { _pending = false; _retrying = false; }
+
+    // Age of the oldest uncommitted change (0 if none).
+    uint32_t oldestMs(uint32_t nowMs) const { return _pending ? nowMs - _firstMs : 0; }
+
+    uint32_t commits() const { return _commits; }
+    uint32_t failures() const { return _failures; }
+    uint32_t lastCommitMs() const { return _lastCommitMs; }   // duration of the last commit
+    uint32_t maxCommitMs() const { return _maxCommitMs; }
+    uint32_t lastLatencyMs() const { return _lastLatencyMs; } // first change to committed
+
+private:
+    uint32_t _quietMs;
+    uint32_t _maxDelayMs;
+    uint32_t _retryMs;
+    bool _pending = false;
+    uint32_t _firstMs = 0;  // first uncommitted change
+    uint32_t _lastMs = 0;   // latest change
+    bool _retrying = false;
+    uint32_t _retryAtMs = 0;
+    uint32_t _commits = 0;
+    uint32_t _failures = 0;
+    uint32_t _lastCommitMs = 0;
+    uint32_t _maxCommitMs = 0;
+    uint32_t _lastLatencyMs = 0;
+};
+
+#endif // SAVED_CODE_COMMITTER_H
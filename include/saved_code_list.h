@@ -0,0 +1,54 @@
+#ifndef SAVED_CODE_LIST_H
+#define SAVED_CODE_LIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "saved_code_table.h"
+
+// The text listings of the saved codes, produced one entry at a time so a
+// response can be streamed from the table through a small buffer instead of
+// being built whole in RAM:
+//   Json  the GET /saved array: [{"index","id","name","protocol","value","bits"},...]
+//         byte for byte as ArduinoJson's serializeJson() writes it
+//   Dump  the GET /dump text: comment lines and irsend calls to paste into
+//         firmware (lines over 255 bytes are cut there, as they always were)
+// The writer holds one entry's text at a time, so its memory does not grow
+// with the number of codes. The table must not change while it is read;
+// callers that cannot hold it check its generation() between reads.
+class SavedCodeListWriter {
+public:
+    enum class Format { Json, Dump };
+
+    // Name of a protocol as IRremoteESP8266 spells it (typeToString()), for
+    // the Dump send lines. The result is copied before the next call.
+    typedef const char* (*ProtocolNameFn)(decode_type_t type);
+
+    SavedCodeListWriter(const SavedCodeTable& codes, Format format, ProtocolNameFn protocolName = nullptr);
+
+    // Copy the next bytes of the listing to buf. Returns the bytes copied,
+    // less than len only at the end (0 once it is all read).
+    size_t read(uint8_t* buf, size_t len);
+
+    // Bytes in the whole listing (walks the table; the read position is kept).
+    size_t size() const;
+
+    // Bytes held for the entry being read out.
+    size_t bufferBytes() const { return _piece.capacity(); }
+
+private:
+    bool nextPiece();
+    void appendJsonEntry(size_t i);
+    void appendDumpEntry(size_t i);
+
+    const SavedCodeTable& _codes;
+    Format _format;
+    ProtocolNameFn _protocolName;
+    size_t _next = 0;         // next entry to write
+    bool _started = false;    // opening text written
+    bool _finished = false;   // closing text written
+    std::string _piece;       // text being read out
+    size_t _piecePos = 0;
+};
+
+#endif // SAVED_CODE_LIST_H
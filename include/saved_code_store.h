@@ -0,0 +1,154 @@
+#ifndef SAVED_CODE_STORE_H
+#define SAVED_CODE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "saved_code_table.h"
+#include "saved_sequence_table.h"
+
+// Where the saved codes and sequences live between boots. The
+// SavedCodeTable and SavedSequenceTable caches are the working copy:
+// handlers change them, then tell the store what changed.
+//
+// A store keeps two things: a snapshot (the codes' blob, see
+// saved_code_table.h, followed by the sequences' blob, see
+// saved_sequence_table.h, when there are any) and a journal of the changes
+// made since. Each change
+// appends one small record to the journal, so nothing is lost on a power
+// cut; folding the journal into a new snapshot (a commit) is the slow write
+// and can run later, in the background, without the table locked.
+//
+// Journal format, little-endian: header "IRL", version, u32 hash of the
+// snapshot it follows, then records: u8 op, u16 payload length, payload,
+// u16 check. Payloads:
+//   append    the new code as a one-code blob (keeps its id)
+//   rename    u16 id, new name (not NUL-terminated)
+//   remove    u16 id
+//   move      u16 id, u16 new index
+//   snapshot  u32 hash of a snapshot being committed; records before it are
+//             in that snapshot
+//   sequence add     the new last sequence's record
+//   sequence remove  u16 index
+// Loading replays the records that follow the stored snapshot (from the
+// header, or from its snapshot record if a commit was cut short before the
+// journal was trimmed). A torn or inconsistent tail (power lost mid-write)
+// ends the replay and is dropped by the next append. A call that returns
+// false has left the previously stored codes and sequences in place, and
+// the caller reloads the caches from the store.
+//
+// Backends: SavedCodeStoreNvs (Preferences, the default),
+// SavedCodeStoreFs (files, e.g. on LittleFS), selected at build time with
+// SAVED_CODES_STORE, and SavedCodeStoreMemory for host tests.
+class SavedCodeStore {
+public:
+    // A commit in progress: the snapshot to write and where it ends in the journal.
+    struct Commit {
+        std::vector<uint8_t> blob;
+        uint32_t hash = 0;
+        size_t journalMark = 0;  // journal bytes up to and including its snapshot record
+        size_t changes = 0;      // journal records it folds in
+    };
+
+    virtual ~SavedCodeStore() {}
+
+    virtual const char* name() const = 0;
+
+    // Replace the tables with the stored codes and sequences. Returns false
+    // (tables empty) when none are stored or what is stored cannot be read.
+    bool load(SavedCodeTable& codes, SavedSequenceTable& sequences);
+
+    // Store both tables as a new snapshot and empty the journal (import,
+    // restore, migration). Must not run while a commit is being written.
+    bool save(const SavedCodeTable& codes, const SavedSequenceTable& sequences);
+
+    // Journal a change already applied to the tables. appended: the last
+    // code is new. renamed: code `index` has a new name. removed: the code
+    // with `id` was removed. moved: code `to` was moved there from
+    // elsewhere in the list. sequenceAdded: the last sequence is new.
+    // sequenceRemoved: sequence `index` was removed. While nothing is
+    // stored, the first change is saved as a snapshot of both tables.
+    bool appended(const SavedCodeTable& codes, const SavedSequenceTable& sequences);
+    bool renamed(const SavedCodeTable& codes, const SavedSequenceTable& sequences, size_t index);
+    bool removed(const SavedCodeTable& codes, const SavedSequenceTable& sequences, uint16_t id);
+    bool moved(const SavedCodeTable& codes, const SavedSequenceTable& sequences, size_t to);
+    bool sequenceAdded(const SavedCodeTable& codes, const SavedSequenceTable& sequences);
+    bool sequenceRemoved(const SavedCodeTable& codes, const SavedSequenceTable& sequences, size_t index);
+
+    // Commit in three steps so only the first and last need the tables (and
+    // the store) locked: beginCommit() takes the snapshot and journals its
+    // hash, writeCommit() writes it (slow, touches only the snapshot), and
+    // endCommit() drops the journal records the snapshot holds, keeping any
+    // made while it was written. beginCommit() returns false if there is
+    // nothing to commit or the journal could not be written.
+    bool beginCommit(const SavedCodeTable& codes, const SavedSequenceTable& sequences, Commit& commit);
+    bool writeCommit(const Commit& commit);
+    bool endCommit(const Commit& commit);
+
+    // True when enough changes are journaled that a commit is worthwhile.
+    bool commitDue() const { return _changes > 0 && _journalBytes >= commitAfterBytes(); }
+
+    size_t pendingChanges() const { return _changes; }  // journaled, not in the snapshot
+    size_t snapshotBytes() const { return _snapshotBytes; }
+    size_t journalBytes() const { return _journalBytes; }  // valid bytes, header included
+
+protected:
+    // Journal bytes past which a commit is due: 0 when appending costs more
+    // as the journal grows (it is rewritten whole), larger when appends are
+    // cheap and the journal may as well soak up many changes.
+    virtual size_t commitAfterBytes() const { return 0; }
+
+    // Storage. readSnapshot() returns false when there is none. Writes
+    // replace the old contents atomically (all or nothing); an empty
+    // journal may be removed. appendJournal() may be cut short by a power
+    // loss (the caller detects it by its check).
+    virtual bool readSnapshot(std::vector<uint8_t>& out) = 0;
+    virtual bool writeSnapshot(const uint8_t* data, size_t len) = 0;
+    virtual bool readJournal(std::vector<uint8_t>& out, size_t from) = 0;
+    virtual bool writeJournal(const uint8_t* data, size_t len) = 0;
+    virtual bool appendJournal(const uint8_t* data, size_t len) = 0;
+
+private:
+    bool appendRecord(const SavedCodeTable& codes, const SavedSequenceTable& sequences, uint8_t op,
+                      const uint8_t* payload, size_t len);
+    bool replay(SavedCodeTable& codes, SavedSequenceTable& sequences, const std::vector<uint8_t>& journal);
+
+    bool _haveSnapshot = false;
+    uint32_t _snapshotHash = 0;
+    size_t _snapshotBytes = 0;
+    size_t _journalBytes = 0;   // 0 = no journal
+    size_t _changes = 0;
+    bool _journalTorn = false;  // bytes past _journalBytes are garbage
+};
+
+// Keeps the snapshot and journal in RAM; counts writes so host benchmarks
+// can compare it with the other backends. Stops accepting writes that would
+// hold more than `capacity` bytes.
+class SavedCodeStoreMemory : public SavedCodeStore {
+public:
+    explicit SavedCodeStoreMemory(size_t capacity = SIZE_MAX) : _capacity(capacity) {}
+
+    const char* name() const override { return "memory"; }
+
+    size_t writes() const { return _writes; }
+    size_t bytesWritten() const { return _bytesWritten; }
+
+protected:
+    bool readSnapshot(std::vector<uint8_t>& out) override;
+    bool writeSnapshot(const uint8_t* data, size_t len) override;
+    bool readJournal(std::vector<uint8_t>& out, size_t from) override;
+    bool writeJournal(const uint8_t* data, size_t len) override;
+    bool appendJournal(const uint8_t* data, size_t len) override;
+
+private:
+    bool fits(size_t snapshotBytes, size_t journalBytes) const;
+
+    std::vector<uint8_t> _snapshot;
+    std::vector<uint8_t> _journal;
+    bool _haveSnapshot = false;
+    size_t _capacity;
+    size_t _writes = 0;
+    size_t _bytesWritten = 0;
+};
+
+#endif // SAVED_CODE_STORE_H
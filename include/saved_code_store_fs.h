@@ -0,0 +1,41 @@
+#ifndef SAVED_CODE_STORE_FS_H
+#define SAVED_CODE_STORE_FS_H
+
+#include <FS.h>
+#include "saved_code_store.h"
+
+// The store in files under `dir` on an Arduino filesystem (LittleFS):
+//   codes.bin  snapshot: the codes' blob, then the sequences' blob
+//   codes.log  journal, appended one record per change
+// Whole-file writes go to a .tmp file renamed over the old one, so they
+// are atomic. Appending is cheap here, so the journal is only committed
+// once it outgrows the snapshot (and kCommitMinBytes): a save, rename,
+// delete or move writes a few dozen bytes instead of the whole table.
+class SavedCodeStoreFs : public SavedCodeStore {
+public:
+    static const size_t kCommitMinBytes = 4096;
+
+    SavedCodeStoreFs(fs::FS& fs, const char* dir);
+
+    const char* name() const override { return "LittleFS"; }
+
+protected:
+    size_t commitAfterBytes() const override;
+    bool readSnapshot(std::vector<uint8_t>& out) override;
+    bool writeSnapshot(const uint8_t* data, size_t len) override;
+    bool readJournal(std::vector<uint8_t>& out, size_t from) override;
+    bool writeJournal(const uint8_t* data, size_t len) override;
+    bool appendJournal(const uint8_t* data, size_t len) override;
+
+private:
+    bool readFile(const char* path, std::vector<uint8_t>& out, size_t from);
+    bool replaceFile(const char* path, const char* tmpPath, const uint8_t* data, size_t len);
+
+    fs::FS& _fs;
+    char _snapshotPath[48];
+    char _snapshotTmpPath[48];
+    char _journalPath[48];
+    char _journalTmpPath[48];
+};
+
+#endif // SAVED_CODE_STORE_FS_H
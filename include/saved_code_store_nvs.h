@@ -0,0 +1,36 @@
+#ifndef SAVED_CODE_STORE_NVS_H
+#define SAVED_CODE_STORE_NVS_H
+
+#include <Preferences.h>
+#include "saved_code_store.h"
+
+// The store in NVS namespace `ns`: the snapshot as one blob under `key`,
+// the journal under `journalKey`. NVS replaces a value atomically but
+// cannot append, so each change rewrites the journal, which is therefore
+// committed as soon as the caller's debounce allows. Each call opens
+// its own Preferences handle, so a commit can be written from another task
+// while changes are journaled.
+class SavedCodeStoreNvs : public SavedCodeStore {
+public:
+    SavedCodeStoreNvs(const char* ns, const char* key, const char* journalKey)
+        : _ns(ns), _key(key), _journalKey(journalKey) {}
+
+    const char* name() const override { return "NVS"; }
+
+protected:
+    bool readSnapshot(std::vector<uint8_t>& out) override;
+    bool writeSnapshot(const uint8_t* data, size_t len) override;
+    bool readJournal(std::vector<uint8_t>& out, size_t from) override;
+    bool writeJournal(const uint8_t* data, size_t len) override;
+    bool appendJournal(const uint8_t* data, size_t len) override;
+
+private:
+    bool read(const char* key, std::vector<uint8_t>& out);
+    bool write(const char* key, const uint8_t* data, size_t len);
+
+    const char* _ns;
+    const char* _key;
+    const char* _journalKey;
+};
+
+#endif // SAVED_CODE_STORE_NVS_H
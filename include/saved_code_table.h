@@ -0,0 +1,216 @@
+#ifndef SAVED_CODE_TABLE_H
+#define SAVED_CODE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <IRremoteESP8266.h>
+
+// In-RAM form of the saved codes, parsed once when the cache is loaded or a
+// code is added/renamed/deleted. Senders read fixed-size entries; the text
+// fields (name, protocol as stored, value as stored) live in one string pool
+// so listing endpoints can reproduce the stored JSON exactly. Mark/space
+// timings (captured with the code, or pre-encoded from its value) live in a
+// second pool and are sent with IrSender::queueRaw().
+//
+// Each code has a stable id (1-65535) that survives deletes and moves of
+// other codes, so clients can keep referring to it while the positional
+// index changes.
+//
+// The table is stored as one binary blob (toBlob()/loadBlob()), all
+// integers little-endian, records in list order:
+//   header   16 bytes: "IRC", version, u16 count, u16 next id,
+//            u32 string table bytes, u32 timings count
+//   records  count x 20 bytes: u64 value, i16 protocol, u16 bits,
+//            u8 repeat, u8 flags, u16 timings count, u16 carrier kHz, u16 id
+//   strings  name, protocol and value of each record, NUL-terminated
+//   timings  u16 captured timings of each record with kTimingsCaptured
+// Pre-encoded timings are not stored; they are rebuilt on load.
+//
+// Names are indexed case-insensitively, codes by (protocol, value), and ids,
+// in hash tables kept up to date by every change, so indexOfName(),
+// indexOfCode() and indexOfId() do not scan the list.
+class SavedCodeTable {
+public:
+    struct Entry {
+        uint64_t value;        // parsed value (valid only with kValueValid)
+        int16_t protocol;      // decode_type_t; UNKNOWN when not sendable
+        uint16_t bits;
+        uint8_t repeat;        // stored repeat count; 0 = use the global default
+        uint8_t flags;
+        uint32_t nameOffset;   // offsets into the string pool
+        uint32_t protocolOffset;
+        uint32_t valueOffset;
+        uint32_t timingsOffset;  // offset into the timings pool
+        uint16_t timingsCount;   // 0 = no timings
+        uint16_t carrierKHz;
+        uint16_t id;             // stable id, never 0
+    };
+
+    static const uint8_t kValueValid = 0x01;
+    static const uint8_t kTimingsCaptured = 0x02;  // stored with the code
+    static const uint8_t kTimingsEncoded = 0x04;   // pre-encoded from the value
+
+    static const uint8_t kBlobVersion = 2;
+    static const size_t kBlobHeaderBytes = 16;
+    static const size_t kBlobRecordBytes = 20;
+
+    // Pre-encode codes of protocols irRawEncode() supports when they are
+    // appended (costs 2 bytes per timing, about 134 per 32-bit NEC code).
+    void setPreEncode(bool on) { _preEncode = on; }
+    bool preEncode() const { return _preEncode; }
+
+    void clear();
+    void reserve(size_t entries, size_t poolBytes);
+
+    // Append a code. `protocol` is the already-resolved send type (UNKNOWN if
+    // the stored protocol name cannot be sent); valueHex is kept verbatim and
+    // parsed as up to 64 bits of hex. `timings` (optional) are captured
+    // mark/space durations to send instead of encoding the value. The code
+    // gets the next free id.
+    void append(const char* name, const char* protocolName, decode_type_t protocol,
+                const char* valueHex, uint16_t bits, uint8_t repeat,
+                const uint16_t* timings = nullptr, size_t timingsCount = 0, uint16_t carrierKHz = 38);
+
+    // Replace the name of entry i. Old pool bytes are reclaimed by compact().
+    void rename(size_t i, const char* name);
+
+    // Remove entry i, shifting later entries down.
+    void remove(size_t i);
+
+    // Move entry `from` to position `to`, shifting the entries in between.
+    void move(size_t from, size_t to);
+
+    // Index of the code with stable id `id`, or -1.
+    int indexOfId(uint16_t id) const;
+
+    // Index of the first code named `name` (ASCII case-insensitive), or -1.
+    int indexOfName(const char* name) const;
+
+    // Index of the first saved code with this protocol name (case-insensitive)
+    // and value, preferring one whose bits also match (exact = true), or -1.
+    // Only codes with a valid value take part.
+    int indexOfCode(const char* protocolName, uint64_t value, uint16_t bits, bool& exact) const;
+
+    size_t size() const { return _entries.size(); }
+
+    // Counts changes to the codes (append, rename, remove, move, clear,
+    // blob loads), so output built from the table can be cached until it
+    // moves on. Never reset; copies of the table carry it along.
+    uint32_t generation() const { return _generation; }
+
+    const Entry& at(size_t i) const { return _entries[i]; }
+
+    const char* name(size_t i) const { return &_pool[_entries[i].nameOffset]; }
+    const char* protocolName(size_t i) const { return &_pool[_entries[i].protocolOffset]; }
+    const char* valueText(size_t i) const { return &_pool[_entries[i].valueOffset]; }
+
+    // True if the entry has a sendable protocol and a valid value.
+    bool isSendable(size_t i) const;
+
+    // Mark/space timings to send for entry i (captured or pre-encoded).
+    bool hasTimings(size_t i) const { return _entries[i].timingsCount > 0; }
+    const uint16_t* timings(size_t i) const { return &_timings[_entries[i].timingsOffset]; }
+
+    // Bytes of the pool no longer referenced by any entry.
+    size_t garbageBytes() const { return _garbage; }
+    size_t poolBytes() const { return _pool.size(); }
+    size_t timingsBytes() const { return _timings.size() * sizeof(uint16_t); }
+
+    // Rewrite the pools without unreferenced strings and timings.
+    void compact();
+
+    // Compact and release spare capacity, after bulk changes (load, import).
+    void shrinkToFit();
+
+    // Heap bytes held by the table (capacity of every array it owns). The
+    // table owns a fixed number of arrays whatever its size, so adding codes
+    // does not add heap blocks.
+    size_t memoryBytes() const;
+
+    // Serialize the table to its blob form (replaces the contents of out).
+    // The range form writes only entries first..first+count-1.
+    void toBlob(std::vector<uint8_t>& out) const { toBlob(out, 0, size()); }
+    void toBlob(std::vector<uint8_t>& out, size_t first, size_t count) const;
+    size_t blobBytes() const { return blobBytes(0, size()); }
+    size_t blobBytes(size_t first, size_t count) const;
+
+    // Length of the blob that starts at data, from its header (what follows
+    // it is not looked at), or 0 if data does not start with a blob header.
+    static size_t blobLength(const uint8_t* data, size_t len);
+
+    // Replace the table with the blob's codes: no text parsing, one copy of
+    // the string table. Returns false (table left empty) if the blob is
+    // truncated, inconsistent (including two codes with one id), or of
+    // another version.
+    bool loadBlob(const uint8_t* data, size_t len);
+
+    // Append the blob's codes, keeping their ids, and take its next id.
+    // Returns false (table unchanged) like loadBlob(), and when one of the
+    // blob's ids is already in the table.
+    bool appendBlob(const uint8_t* data, size_t len);
+
+    // Replace the table with other's codes, ids and next id, leaving other
+    // empty (a restore staged in a second table). Keeps this table's
+    // pre-encode setting, so stage with the same one. Counts as a change.
+    void take(SavedCodeTable& other);
+
+private:
+    uint32_t addString(const char* s);
+    uint32_t addTimings(const uint16_t* timings, size_t count);
+    void encodeTimings(Entry& e, const char* valueHex);
+    uint16_t allocateId();
+    uint32_t codeHash(size_t i) const;
+    void rebuildIndexes();
+
+    // Open addressing with linear probing over entry indexes, kept at most
+    // half full; slots hold entry index + 1 (0 = empty). Callers keep it in
+    // step with _entries: append() after adding an entry, remove()/move()
+    // alongside the same change to the list.
+    class HashIndex {
+    public:
+        void clear();
+        void reserve(size_t entries) { _hashes.reserve(entries); }
+        void shrinkToFit();
+        size_t memoryBytes() const;
+        void append(uint32_t hash);
+        void update(size_t i, uint32_t hash);
+        void remove(size_t i);
+        void move(size_t from, size_t to);
+        void rebuild(std::vector<uint32_t>& hashes);  // takes the hashes
+
+        // Call visit(i) for each entry i whose hash is `hash`.
+        template <typename F>
+        void forEach(uint32_t hash, F visit) const {
+            if (_slots.empty()) return;
+            size_t mask = _slots.size() - 1;
+            for (size_t s = hash & mask; _slots[s] != 0; s = (s + 1) & mask) {
+                size_t i = _slots[s] - 1;
+                if (_hashes[i] == hash) visit(i);
+            }
+        }
+
+    private:
+        void insert(size_t i);
+        void erase(size_t i);
+        void resize();
+
+        std::vector<uint16_t> _slots;
+        std::vector<uint32_t> _hashes;  // hash of each entry
+    };
+
+    std::vector<Entry> _entries;
+    std::vector<char> _pool;
+    std::vector<uint16_t> _timings;
+    size_t _garbage = 0;
+    size_t _timingsGarbage = 0;  // unreferenced timings, in entries
+    bool _preEncode = false;
+    uint16_t _nextId = 1;
+    bool _idsWrapped = false;  // ids past _nextId may be in use
+    uint32_t _generation = 0;
+    HashIndex _names;  // folded name
+    HashIndex _codes;  // folded protocol name and value
+    HashIndex _ids;
+};
+
+#endif // SAVED_CODE_TABLE_H
@@ -0,0 +1,96 @@
+#ifndef SAVED_SEQUENCE_TABLE_H
+#define SAVED_SEQUENCE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "IrSender.h"
+#include "saved_code_table.h"
+
+// In-RAM form of the saved sequences ("macros"). Each step either refers to a
+// saved code by its stable id (see saved_code_table.h) or carries its own
+// code. Steps are resolved against the saved codes when the sequence is sent
+// or listed, so renaming, moving or deleting a code never touches sequences;
+// a step whose code was deleted is skipped.
+//
+// Binary form, integers little-endian, shared by the saved-code store and
+// the backup image:
+//   record  one sequence: u8 name bytes, name, u8 steps, then per step
+//           18 bytes: u16 saved code id (kRawCode for its own code),
+//           i16 protocol, u64 value, u16 bits, u8 repeat, u8 reserved,
+//           u16 delay ms
+//   blob    the whole table: "IRS", version, u16 count, then per sequence
+//           u16 record bytes and the record
+class SavedSequenceTable {
+public:
+    static const uint16_t kRawCode = 0;  // Step::codeId for a step with its own code
+    static const size_t kMaxSequences = 16;
+
+    static const uint8_t kBlobVersion = 1;
+    static const size_t kBlobHeaderBytes = 6;
+    static const size_t kRecordStepBytes = 18;
+
+    struct Step {
+        uint16_t codeId;       // saved code id, or kRawCode
+        int16_t protocol;      // decode_type_t (raw code only)
+        uint64_t value;        // raw code only
+        uint16_t bits;         // raw code only
+        uint8_t repeat;        // 0 = the saved code's repeat, else the default
+        uint16_t postDelayMs;  // silence after the step, <= IrSender::kMaxPostDelayMs
+    };
+
+    void clear();
+
+    // Append a sequence. Returns false if the table is full, count exceeds
+    // IrSender::kMaxSequenceSteps, or a step is out of range. A sequence may
+    // be empty.
+    bool add(const char* name, const Step* steps, size_t count);
+
+    // Remove sequence i, shifting later ones down.
+    void remove(size_t i);
+
+    size_t size() const { return _sequences.size(); }
+
+    // Counts changes to the sequences, like SavedCodeTable::generation().
+    uint32_t generation() const { return _generation; }
+
+    const char* name(size_t i) const { return _sequences[i].name.c_str(); }
+    size_t stepCount(size_t i) const { return _sequences[i].steps.size(); }
+    const Step& step(size_t i, size_t j) const { return _sequences[i].steps[j]; }
+
+    // First sequence whose name matches (case-insensitive), or -1.
+    int indexOf(const char* name) const;
+
+    // Build IrSender steps for sequence i (out must hold kMaxSequenceSteps).
+    // Steps whose code is gone or not sendable are skipped. Returns the step
+    // count.
+    size_t resolve(size_t i, const SavedCodeTable& codes, uint8_t defaultRepeat,
+                   IrSender::SequenceStep* out) const;
+
+    // Record of sequence i (names longer than 255 bytes are cut short).
+    size_t recordBytes(size_t i) const;
+    void toRecord(size_t i, uint8_t* out) const;  // out holds recordBytes(i)
+
+    // Append the sequence in a record. Returns false if the record is
+    // malformed or add() refuses it.
+    bool addRecord(const uint8_t* data, size_t len);
+
+    // Serialize the table to its blob form (replaces the contents of out).
+    void toBlob(std::vector<uint8_t>& out) const;
+
+    // Replace the table with the blob's sequences. Returns false (table left
+    // empty) if the blob is truncated, inconsistent or of another version.
+    bool loadBlob(const uint8_t* data, size_t len);
+
+private:
+    struct Sequence {
+        std::string name;
+        std::vector<Step> steps;
+    };
+
+    std::vector<Sequence> _sequences;
+    uint32_t _generation = 0;
+};
+
+#endif // SAVED_SEQUENCE_TABLE_H
@@ -0,0 +1,63 @@
+#ifndef WORKER_TASK_H
+#define WORKER_TASK_H
+
+#include <stdint.h>
+#include <atomic>
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+// Minimal worker-thread abstraction: a FreeRTOS task with direct-to-task
+// notifications on the ESP32, std::thread with a condition variable on the
+// host (native tests).
+class WorkerTask {
+public:
+    typedef void (*Entry)(void* arg);
+
+    // Spawn the worker running entry(arg). Returns false if it could not be created.
+    bool start(const char* name, Entry entry, void* arg, uint32_t stackBytes, int priority);
+
+    // Ask the worker to exit (running() turns false), wake it and wait for it to return.
+    void stop();
+
+    // True between start() and stop(); the entry function should return once false.
+    bool running() const { return _running.load(std::memory_order_acquire); }
+
+    // Wake the worker. Notifications given before wait() are not lost.
+    void notify();
+
+    // Block the worker until notified. Call only from the worker.
+    void wait();
+
+    // Monotonic milliseconds on the worker's clock.
+    uint32_t nowMs() const;
+
+    // Sleep until wakeMs + periodMs, then advance wakeMs by periodMs
+    // (vTaskDelayUntil semantics). Returns early once stop() has been called.
+    // Call only from the worker.
+    void delayUntil(uint32_t& wakeMs, uint32_t periodMs);
+
+private:
+    std::atomic<bool> _running{false};
+    Entry _entry = nullptr;
+    void* _arg = nullptr;
+#if defined(ESP_PLATFORM)
+    static void trampoline(void* self);
+    TaskHandle_t _handle = nullptr;
+    SemaphoreHandle_t _done = nullptr;
+#else
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    uint32_t _notifications = 0;
+#endif
+};
+
+#endif // WORKER_TASK_H
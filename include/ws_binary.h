@@ -0,0 +1,89 @@
+#ifndef WS_BINARY_H
+#define WS_BINARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact binary frames on /ws, an opt-in alternative to the JSON messages
+// for clients that send often. A client opts in by sending a Hello frame;
+// from then on the device sends it IR events as binary frames too. JSON
+// commands keep working on the same connection. One message per WebSocket
+// binary frame, integers little-endian:
+//   Hello    2 bytes, both ways: type, version
+//   Send    16 bytes, client -> device: type, u16 request id (echoed in the
+//           ack), i16 protocol (decode_type_t), u16 bits, u8 repeat, u64 value
+//   Ack      9 bytes, device -> client: type, u16 request id, u8 status
+//           (WsSendStatus), u8 admission (IrSender::Admission), u32 job id
+//           (0 unless status is Ok)
+//   IrEvent 22 bytes, device -> client: type, u32 seq, i16 protocol, u16
+//           bits, u64 value, u8 match (0 none, 1 likely, 2 exact), u16 id of
+//           the matching saved code (0 if none), u16 repeat (captures of the
+//           code this event stands for, see ws_event_limiter.h)
+// A frame of the wrong size for its type is answered with an Ack whose
+// status is BadFrame (request id 0 if it could not be read).
+static const uint8_t kWsBinaryVersion = 1;
+static const size_t kWsHelloBytes = 2;
+static const size_t kWsSendBytes = 16;
+static const size_t kWsAckBytes = 9;
+static const size_t kWsIrEventBytes = 22;
+
+enum class WsFrameType : uint8_t {
+    Hello = 1,
+    Send = 2,
+    Ack = 3,
+    IrEvent = 4,
+};
+
+// Outcome of a WebSocket send, JSON or binary. The JSON ack's "error" is
+// wsSendStatusText().
+enum class WsSendStatus : uint8_t {
+    Ok = 0,
+    InvalidRepeat,    // repeat outside 1-20
+    UnsupportedType,  // not a protocol IrSender can send from a value
+    InvalidLength,    // bits outside 1-128, or (JSON) data not hex
+    QueueFull,
+    BadFrame,         // binary frame of the wrong size or type
+};
+
+const char* wsSendStatusText(WsSendStatus status);
+
+struct WsSendFrame {
+    uint16_t request;
+    int16_t protocol;
+    uint16_t bits;
+    uint8_t repeat;
+    uint64_t value;
+};
+
+struct WsAckFrame {
+    uint16_t request;
+    WsSendStatus status;
+    uint8_t admission;
+    uint32_t job;
+};
+
+struct WsIrEventFrame {
+    uint32_t seq;
+    int16_t protocol;
+    uint16_t bits;
+    uint64_t value;
+    uint8_t match;
+    uint16_t savedId;
+    uint16_t repeat;
+};
+
+// Type of a frame, or 0 if it is empty.
+inline uint8_t wsFrameType(const uint8_t* data, size_t len) { return len ? data[0] : 0; }
+
+// Encoders write exactly the frame's size to out and return it. Decoders
+// return false unless data is a whole frame of their type.
+size_t wsEncodeHello(uint8_t* out);
+bool wsDecodeHello(const uint8_t* data, size_t len, uint8_t& version);
+size_t wsEncodeSend(const WsSendFrame& frame, uint8_t* out);
+bool wsDecodeSend(const uint8_t* data, size_t len, WsSendFrame& out);
+size_t wsEncodeAck(const WsAckFrame& frame, uint8_t* out);
+bool wsDecodeAck(const uint8_t* data, size_t len, WsAckFrame& out);
+size_t wsEncodeIrEvent(const WsIrEventFrame& frame, uint8_t* out);
+bool wsDecodeIrEvent(const uint8_t* data, size_t len, WsIrEventFrame& out);
+
+#endif // WS_BINARY_H
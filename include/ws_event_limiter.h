@@ -0,0 +1,85 @@
+#ifndef WS_EVENT_LIMITER_H
+#define WS_EVENT_LIMITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-client pacing of IR events on /ws. A client is sent at most one event
+// every minIntervalMs; a capture that comes sooner waits. Further captures of
+// the same code (a held button) fold into the waiting event, whose repeat
+// count says how many captures it stands for; a different code replaces it
+// and the replaced captures count as dropped. A client that cannot take
+// another message is skipped and its event keeps waiting; once it has been
+// backed up for stallMs it is reported for closing.
+//
+// Only the latest capture is ever waiting, so the caller builds each body
+// from its own copy of that capture. Driven from one task: capture() for
+// each new code, then a pass over the connected clients, beginPass(),
+// next() for each, endPass(). A client missing from a pass is forgotten.
+class WsEventLimiter {
+public:
+    static const size_t kClients = 8;  // AsyncWebSocket's default client limit
+
+    enum class Action : uint8_t {
+        None,   // nothing due for this client now
+        Send,   // send the latest capture with this repeat count
+        Close,  // backed up for stallMs: close the connection
+    };
+
+    struct Decision {
+        Action action;
+        uint16_t repeat;
+    };
+
+    WsEventLimiter(uint32_t minIntervalMs, uint32_t stallMs) : _minIntervalMs(minIntervalMs), _stallMs(stallMs) {}
+
+    // A new code was received.
+    void capture(int16_t protocol, uint64_t value, uint16_t bits);
+
+    // Whether a pass could send anything: a capture since the last pass, or
+    // an event still waiting for some client.
+    bool waiting() const;
+
+    void beginPass(uint32_t nowMs);
+    // `ready` is whether the client can take another message now.
+    Decision next(uint32_t clientId, bool ready);
+    void endPass();
+
+    uint32_t sent() const { return _sent; }            // events handed to clients
+    uint32_t coalesced() const { return _coalesced; }  // captures folded into a repeat count
+    uint32_t dropped() const { return _dropped; }      // captures a client never got
+    uint32_t deferred() const { return _deferred; }    // events held back by a backed-up client
+    uint32_t closed() const { return _closed; }        // clients closed for staying backed up
+
+private:
+    struct Client {
+        uint32_t id = 0;  // 0 = free
+        uint32_t seen = 0;  // captures accounted for
+        uint16_t repeat = 0;  // captures in the waiting event, 0 if none
+        bool visited = false;
+        bool sentOnce = false;
+        bool stalled = false;
+        uint32_t lastSentMs = 0;
+        uint32_t stalledMs = 0;
+    };
+
+    Client* find(uint32_t clientId);
+
+    uint32_t _minIntervalMs;
+    uint32_t _stallMs;
+    Client _clients[kClients];
+    uint32_t _captures = 0;
+    uint32_t _passCaptures = 0;  // _captures at the last pass
+    bool _sameAsPrevious = false;
+    int16_t _protocol = 0;
+    uint64_t _value = 0;
+    uint16_t _bits = 0;
+    uint32_t _nowMs = 0;
+    uint32_t _sent = 0;
+    uint32_t _coalesced = 0;
+    uint32_t _dropped = 0;
+    uint32_t _deferred = 0;
+    uint32_t _closed = 0;
+};
+
+#endif // WS_EVENT_LIMITER_H
@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""Back up, restore and inspect saved-code images (GET /saved/backup, POST /saved/restore).
+
+    python scripts/ir_backup.py backup http://<device-ip> blaster.bin
+    python scripts/ir_backup.py restore http://<new-device-ip> blaster.bin
+    python scripts/ir_backup.py info blaster.bin
+
+The image format is described in include/saved_backup.h. `backup` and `info`
+check the image's length and CRC; `restore` refuses an image that fails them
+before sending it. `backup` also reports the image size against the JSON that
+/saved would return for the same codes.
+
+Dependencies: requests  (see requirements-test.txt)
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+HEADER = struct.Struct("<3sBIIHH")
+ELEMENT = struct.Struct("<BI")
+STEP = struct.Struct("<HhQHBxH")
+BLOB_HEADER = struct.Struct("<3sBHHII")
+VERSION = 1
+
+
+def parse_image(data: bytes) -> dict:
+    """Check an image and return its codes and sequences. Raises ValueError."""
+    if len(data) < HEADER.size:
+        raise ValueError("shorter than the header")
+    magic, version, body_len, crc, n_codes, n_sequences = HEADER.unpack_from(data)
+    if magic != b"IRB":
+        raise ValueError("not a backup image")
+    if version != VERSION:
+        raise ValueError("unsupported image version %d" % version)
+    body = data[HEADER.size:]
+    if len(body) != body_len:
+        raise ValueError("body is %d bytes, header says %d" % (len(body), body_len))
+    if zlib.crc32(body) != crc:
+        raise ValueError("CRC mismatch")
+
+    codes, sequences = [], []
+    pos = 0
+    while pos < len(body):
+        kind, length = ELEMENT.unpack_from(body, pos)
+        payload = body[pos + ELEMENT.size:pos + ELEMENT.size + length]
+        pos += ELEMENT.size + length
+        if kind == 1:
+            codes.extend(_parse_codes(payload))
+        elif kind == 2:
+            sequences.append(_parse_sequence(payload))
+        else:
+            raise ValueError("unknown element %d" % kind)
+    if len(codes) != n_codes or len(sequences) != n_sequences:
+        raise ValueError("counts do not match the header")
+    return {"codes": codes, "sequences": sequences}
+
+
+def _parse_codes(blob: bytes) -> list:
+    magic, version, count, _next_id, string_bytes, _timings = BLOB_HEADER.unpack_from(blob)
+    if magic != b"IRC" or version != 2:
+        raise ValueError("unexpected code blob")
+    records = BLOB_HEADER.size
+    strings = blob[records + count * 20:records + count * 20 + string_bytes].split(b"\0")
+    codes = []
+    for i in range(count):
+        _value, _protocol, bits, repeat, _flags, timings, _khz, code_id = struct.unpack_from(
+            "<QhHBBHHH", blob, records + i * 20)
+        name, protocol, value = (s.decode("utf-8", "replace") for s in strings[3 * i:3 * i + 3])
+        codes.append({"id": code_id, "name": name, "protocol": protocol, "value": value, "bits": bits,
+                      "repeat": repeat, "timings": timings})
+    return codes
+
+
+def _parse_sequence(payload: bytes) -> dict:
+    name_len = payload[0]
+    name = payload[1:1 + name_len].decode("utf-8", "replace")
+    count = payload[1 + name_len]
+    steps = []
+    for j in range(count):
+        code_id, protocol, value, bits, repeat, delay = STEP.unpack_from(payload, 2 + name_len + j * STEP.size)
+        steps.append({"id": code_id, "protocol": protocol, "value": value, "bits": bits,
+                      "repeat": repeat, "delay_ms": delay})
+    return {"name": name, "steps": steps}
+
+
+def _describe(image: dict, size: int) -> str:
+    return "%d codes, %d sequences, %d bytes" % (len(image["codes"]), len(image["sequences"]), size)
+
+
+def cmd_backup(args) -> int:
+    import requests
+
+    base = args.device.rstrip("/")
+    r = requests.get(base + "/saved/backup", timeout=30)
+    r.raise_for_status()
+    image = parse_image(r.content)
+    with open(args.file, "wb") as f:
+        f.write(r.content)
+    json_bytes = len(requests.get(base + "/saved", timeout=30).content)
+    print("Saved %s to %s" % (_describe(image, len(r.content)), args.file))
+    print("/saved JSON for the same codes: %d bytes (%.1fx the image)" % (json_bytes, json_bytes / len(r.content)))
+    return 0
+
+
+def cmd_restore(args) -> int:
+    import requests
+
+    with open(args.file, "rb") as f:
+        data = f.read()
+    image = parse_image(data)
+    r = requests.post(args.device.rstrip("/") + "/saved/restore", data=data,
+                      headers={"Content-Type": "application/octet-stream"}, timeout=60)
+    if r.status_code != 200:
+        print("Restore failed (%d): %s" % (r.status_code, r.text), file=sys.stderr)
+        return 1
+    print("Restored %s" % _describe(image, len(data)))
+    return 0
+
+
+def cmd_info(args) -> int:
+    with open(args.file, "rb") as f:
+        data = f.read()
+    image = parse_image(data)
+    print(_describe(image, len(data)))
+    for c in image["codes"]:
+        print("  #%-5d %-24s %-10s %s/%d%s" % (c["id"], c["name"], c["protocol"], c["value"], c["bits"],
+                                               " (%d timings)" % c["timings"] if c["timings"] else ""))
+    for s in image["sequences"]:
+        print("  sequence %r: %d steps" % (s["name"], len(s["steps"])))
+    return 0
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+    p = sub.add_parser("backup", help="download a device's image")
+    p.add_argument("device", help="base URL, e.g. http://192.168.1.42")
+    p.add_argument("file")
+    p.set_defaults(run=cmd_backup)
+    p = sub.add_parser("restore", help="replace a device's saved codes and sequences with an image")
+    p.add_argument("device")
+    p.add_argument("file")
+    p.set_defaults(run=cmd_restore)
+    p = sub.add_parser("info", help="check an image and list what it holds")
+    p.add_argument("file")
+    p.set_defaults(run=cmd_info)
+    args = parser.parse_args()
+    try:
+        return args.run(args)
+    except ValueError as e:
+        print("Bad image: %s" % e, file=sys.stderr)
+        return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -48,15 +48,30 @@ if not ble_device_name:
 
 ir_recv_enabled = _as_bool01(dotenv.get("IR_RECV_ENABLED", "1"))
 ir_send_repeat = _as_int(dotenv.get("IR_SEND_REPEAT", "1"), default=1, min_v=1, max_v=20)
+ir_send_queue_depth = _as_int(dotenv.get("IR_SEND_QUEUE_DEPTH", "8"), default=8, min_v=1, max_v=32)
+ir_tx_task = _as_bool01(dotenv.get("IR_TX_TASK", "0"), default="0")
+ir_send_preencode = _as_bool01(dotenv.get("IR_SEND_PREENCODE", "0"), default="0")
+ir_send_coalesce_max = _as_int(dotenv.get("IR_SEND_COALESCE_MAX", "20"), default=20, min_v=0, max_v=100)
+saved_codes_store = dotenv.get("SAVED_CODES_STORE", "nvs").strip().lower()
+if saved_codes_store not in ("nvs", "littlefs"):
+    raise ValueError("SAVED_CODES_STORE must be nvs or littlefs")
 
 env.Append(  # type: ignore[name-defined]
     CPPDEFINES=[
         ("BLE_DEVICE_NAME", env.StringifyMacro(ble_device_name)),  # type: ignore[name-defined]
         ("IR_RECV_ENABLED", ir_recv_enabled),
         ("IR_SEND_REPEAT", ir_send_repeat),
+        ("IR_SEND_QUEUE_DEPTH", ir_send_queue_depth),
+        ("IR_TX_TASK", ir_tx_task),
+        ("IR_SEND_COALESCE_MAX", ir_send_coalesce_max),
+        ("IR_SEND_PREENCODE", ir_send_preencode),
+        ("SAVED_CODES_STORE_LITTLEFS", 1 if saved_codes_store == "littlefs" else 0),
     ]
 )
 print(
     f"[pio_env_flags] BLE_DEVICE_NAME={ble_device_name!r} "
-    f"IR_RECV_ENABLED={ir_recv_enabled} IR_SEND_REPEAT={ir_send_repeat}"
+    f"IR_RECV_ENABLED={ir_recv_enabled} IR_SEND_REPEAT={ir_send_repeat} "
+    f"IR_SEND_QUEUE_DEPTH={ir_send_queue_depth} IR_TX_TASK={ir_tx_task} "
+    f"IR_SEND_COALESCE_MAX={ir_send_coalesce_max} IR_SEND_PREENCODE={ir_send_preencode} "
+    f"SAVED_CODES_STORE={saved_codes_store}"
 )
@@ -1,61 +1,653 @@
 #include "IrSender.h"
+#include <string.h>
 
-IrSender::IrSender(IRsend& irsend)
-    : _irsend(irsend), _mutex(),
-      _pendingValue(0), _pendingLength(0), _pendingRepeats(0), _jobPending(false),
-      _currentValue(0), _currentLength(0), _currentRepeatsLeft(0),
-      _lastSendTime(0), _active(false), _startImmediate(false) {}
+static size_t clampDepth(size_t depth) {
+    if (depth < 1) return 1;
+    if (depth > IrSender::kMaxQueueDepth) return IrSender::kMaxQueueDepth;
+    return depth;
+}
 
-void IrSender::queue(uint32_t value, uint16_t length, int repeat) {
-    if (repeat < 1) return;
+// Step repeats are a uint8_t, so a sequence job's never exceed the ticket
+static_assert(UINT8_MAX <= IrSender::kMaxRepeat, "sequence step repeat must fit a job ticket");
 
-    std::lock_guard<std::mutex> lock(_mutex);
-    _pendingValue = value;
-    _pendingLength = length;
-    _pendingRepeats = repeat;
-    _jobPending = true;
+static uint32_t makeTicket(uint32_t pos, int repeats) {
+    return ((pos & 0xFFFF) << 16) | ((uint32_t)repeats & 0xFFFF);
 }
 
-void IrSender::loop() {
-    // Check if there is a new job
-    {
-        std::lock_guard<std::mutex> lock(_mutex);
-        if (_jobPending) {
-            _currentValue = _pendingValue;
-            _currentLength = _pendingLength;
-            _currentRepeatsLeft = _pendingRepeats;
-            _jobPending = false;
+static uint32_t packCode(decode_type_t protocol, uint16_t bits) {
+    return ((uint32_t)(uint16_t)(int16_t)protocol << 16) | bits;
+}
+
+static decode_type_t codeProtocol(uint32_t code) {
+    return (decode_type_t)(int16_t)(uint16_t)(code >> 16);
+}
+
+// _extension word: open flag, generation (bumped per opened job), extra repeats.
+static const uint32_t kExtOpen = 0x80000000u;
+static const uint32_t kExtGenMask = 0x7FFF0000u;
+static const uint32_t kExtRepeatsMask = 0x0000FFFFu;
+
+// Repeat count after merging `add` more into `current`, capped at `limit`
+// (a count already above the cap is left as is).
+static uint32_t mergedRepeats(uint32_t current, uint32_t add, uint32_t limit) {
+    uint32_t merged = current + add;
+    if (merged <= limit) return merged;
+    return current > limit ? current : limit;
+}
+
+IrSender::IrSender(IRsend& irsend, size_t depth, OverflowPolicy policy, uint16_t coalesceLimit)
+    : _irsend(irsend), _depth(clampDepth(depth)), _policy(policy), _coalesceLimit(coalesceLimit),
+      _head(0), _tail(0), _count(0), _extension(0), _extValueLo(0), _extValueHi(0), _extCode(0),
+      _extJobId(0), _nextJobId(1), _statusVersion(0), _freshJobs(0), _coalescedJobs(0), _task(), _taskMode(false),
+      _current(), _currentJobId(0), _currentStarted(false), _sequence(nullptr), _raw(nullptr), _step(0), _currentPostDelayMs(0), _extensionOpen(false),
+      _currentTiming(&irProtocolTiming(UNKNOWN)), _currentRepeatsLeft(0),
+      _lastFrameStart(0), _lastFrameEnd(0), _lastTiming(_currentTiming), _lastGapMs(0), _lastFramePadded(false),
+      _active(false), _hasSent(false) {
+    for (uint32_t i = 0; i < kRingSize; i++) {
+        _slots[i].seq.store(i, std::memory_order_relaxed);
+        _slots[i].id.store(0, std::memory_order_relaxed);
+        _slots[i].valueLo.store(0, std::memory_order_relaxed);
+        _slots[i].valueHi.store(0, std::memory_order_relaxed);
+        _slots[i].code.store(0, std::memory_order_relaxed);
+        _slots[i].ticket.store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < kSequenceSlots; i++) {
+        _sequences[i].inUse.store(false, std::memory_order_relaxed);
+        _sequences[i].count = 0;
+    }
+    for (size_t i = 0; i < kRawSlots; i++) {
+        _raws[i].inUse.store(false, std::memory_order_relaxed);
+        _raws[i].count = 0;
+    }
+    for (size_t i = 0; i < kStatusSlots; i++) {
+        _status[i].id.store(0, std::memory_order_relaxed);
+        _status[i].state.store((uint8_t)JobState::Unknown, std::memory_order_relaxed);
+        _status[i].queuedMs.store(0, std::memory_order_relaxed);
+        _status[i].startedMs.store(0, std::memory_order_relaxed);
+        _status[i].finishedMs.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Claim one of the `_depth` job slots. Fails when the queue is full.
+bool IrSender::reserve() {
+    uint32_t count = _count.load(std::memory_order_relaxed);
+    do {
+        if (count >= _depth) return false;
+    } while (!_count.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel,
+                                           std::memory_order_relaxed));
+    return true;
+}
+
+// Publish a job; must be preceded by a successful reserve().
+void IrSender::enqueue(const Job& job) {
+    uint32_t pos = _tail.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &_slots[pos & kRingMask];
+        uint32_t seq = slot->seq.load(std::memory_order_acquire);
+        int32_t dif = (int32_t)(seq - pos);
+        if (dif == 0) {
+            if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else {
+            // dif < 0 cannot happen while _count <= kMaxQueueDepth < kRingSize
+            pos = _tail.load(std::memory_order_relaxed);
+        }
+    }
+    slot->id.store(job.id, std::memory_order_relaxed);
+    slot->valueLo.store((uint32_t)job.value, std::memory_order_relaxed);
+    slot->valueHi.store((uint32_t)(job.value >> 32), std::memory_order_relaxed);
+    slot->code.store(packCode(job.protocol, job.bits), std::memory_order_relaxed);
+    slot->ticket.store(makeTicket(pos, job.repeats), std::memory_order_relaxed);
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+// Take the oldest published job. Used by loop() and by producers evicting
+// under OverflowPolicy::DropOldest.
+bool IrSender::dequeue(Job& out) {
+    uint32_t pos = _head.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &_slots[pos & kRingMask];
+        uint32_t seq = slot->seq.load(std::memory_order_acquire);
+        int32_t dif = (int32_t)(seq - (pos + 1));
+        if (dif == 0) {
+            if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (dif < 0) {
+            return false;  // empty, or the next job is reserved but not yet published
+        } else {
+            pos = _head.load(std::memory_order_relaxed);
+        }
+    }
+    uint32_t code = slot->code.load(std::memory_order_relaxed);
+    out.id = slot->id.load(std::memory_order_relaxed);
+    out.protocol = codeProtocol(code);
+    out.bits = (uint16_t)(code & 0xFFFF);
+    out.value = ((uint64_t)slot->valueHi.load(std::memory_order_relaxed) << 32) |
+                slot->valueLo.load(std::memory_order_relaxed);
+    out.repeats = (int)(slot->ticket.exchange(0, std::memory_order_acq_rel) & 0xFFFF);
+    slot->seq.store(pos + kRingSize, std::memory_order_release);
+    _count.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+// Update the repeat count of a published job with the same code, scanning
+// from position `first` to the tail: overwrite it (ReplaceSameCode) or add to
+// it up to the coalesce limit. The seq re-check discards records that were
+// consumed or recycled while being read, and the tagged ticket CAS fails if
+// the consumer claimed the job meanwhile.
+bool IrSender::updatePending(const Job& job, uint32_t first, bool add, uint32_t& id) {
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+    for (uint32_t pos = first; pos != tail; pos++) {
+        Slot& slot = _slots[pos & kRingMask];
+        if (slot.seq.load(std::memory_order_acquire) != pos + 1) continue;
+        uint32_t valueLo = slot.valueLo.load(std::memory_order_relaxed);
+        uint32_t valueHi = slot.valueHi.load(std::memory_order_relaxed);
+        uint32_t code = slot.code.load(std::memory_order_relaxed);
+        uint32_t ticket = slot.ticket.load(std::memory_order_relaxed);
+        uint32_t jobId = slot.id.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != pos + 1) continue;
+        if (code != packCode(job.protocol, job.bits)) continue;
+        if (valueLo != (uint32_t)job.value || valueHi != (uint32_t)(job.value >> 32)) continue;
+        if (ticket == 0 || (ticket >> 16) != (pos & 0xFFFF)) continue;
+        uint32_t repeats = add ? mergedRepeats(ticket & 0xFFFF, job.repeats, _coalesceLimit) : job.repeats;
+        if (slot.ticket.compare_exchange_strong(ticket, makeTicket(pos, repeats),
+                                                std::memory_order_acq_rel)) {
+            id = jobId;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Add repeats to the job being transmitted if it has the same code and is
+// still open (see openExtension()).
+bool IrSender::extendActive(const Job& job, uint32_t& id) {
+    uint32_t state = _extension.load(std::memory_order_acquire);
+    if (!(state & kExtOpen)) return false;
+    const uint32_t opened = state & ~kExtRepeatsMask;
+    bool same = _extCode.load(std::memory_order_relaxed) == packCode(job.protocol, job.bits) &&
+                _extValueLo.load(std::memory_order_relaxed) == (uint32_t)job.value &&
+                _extValueHi.load(std::memory_order_relaxed) == (uint32_t)(job.value >> 32);
+    uint32_t jobId = _extJobId.load(std::memory_order_relaxed);
+    // Pairs with the fence in openExtension(): if the fields were rewritten
+    // for another job, the CAS below sees that job's generation and fails
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!same) return false;
+    for (;;) {
+        uint32_t extra = mergedRepeats(state & kExtRepeatsMask, job.repeats, _coalesceLimit);
+        if (_extension.compare_exchange_weak(state, opened | extra,
+                                             std::memory_order_acq_rel, std::memory_order_acquire)) {
+            id = jobId;
+            return true;
+        }
+        if ((state & ~kExtRepeatsMask) != opened) return false;
+    }
+}
+
+// Merge a resubmitted code into the newest job: the last pending one, or the
+// active one when nothing is pending.
+bool IrSender::coalesce(const Job& job, uint32_t& id) {
+    if (_coalesceLimit == 0) return false;
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+    if (tail != _head.load(std::memory_order_acquire)) return updatePending(job, tail - 1, true, id);
+    return extendActive(job, id);
+}
+
+// Start a status record for a new job. The record was last used by job
+// id - kStatusSlots, long finished: at most depth + 1 jobs are in flight.
+void IrSender::newStatus(uint32_t id) {
+    StatusRecord& rec = _status[id & (kStatusSlots - 1)];
+    rec.id.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    rec.queuedMs.store((uint32_t)millis(), std::memory_order_relaxed);
+    rec.startedMs.store(0, std::memory_order_relaxed);
+    rec.finishedMs.store(0, std::memory_order_relaxed);
+    rec.state.store((uint8_t)JobState::Queued, std::memory_order_relaxed);
+    rec.id.store(id, std::memory_order_release);
+    _statusVersion.fetch_add(1, std::memory_order_release);
+}
+
+// Move job `id` to `state`, stamping the time.
+void IrSender::setStatus(uint32_t id, JobState state) {
+    StatusRecord& rec = _status[id & (kStatusSlots - 1)];
+    if (id == 0 || rec.id.load(std::memory_order_relaxed) != id) return;
+    uint32_t now = (uint32_t)millis();
+    if (state == JobState::Transmitting) {
+        rec.startedMs.store(now, std::memory_order_relaxed);
+    } else {
+        rec.finishedMs.store(now, std::memory_order_relaxed);
+    }
+    rec.state.store((uint8_t)state, std::memory_order_release);
+    _statusVersion.fetch_add(1, std::memory_order_release);
+}
+
+bool IrSender::jobStatus(uint32_t id, JobStatus& out) const {
+    out.id = id;
+    out.state = JobState::Unknown;
+    out.queuedMs = out.startedMs = out.finishedMs = 0;
+    if (id == 0) return false;
+    const StatusRecord& rec = _status[id & (kStatusSlots - 1)];
+    if (rec.id.load(std::memory_order_acquire) != id) return false;
+    // State first: the timestamp of a state is stored before the state itself
+    JobState state = (JobState)rec.state.load(std::memory_order_acquire);
+    uint32_t queuedMs = rec.queuedMs.load(std::memory_order_relaxed);
+    uint32_t startedMs = rec.startedMs.load(std::memory_order_relaxed);
+    uint32_t finishedMs = rec.finishedMs.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (rec.id.load(std::memory_order_relaxed) != id) return false;
+    out.state = state;
+    out.queuedMs = queuedMs;
+    out.startedMs = startedMs;
+    out.finishedMs = finishedMs;
+    return true;
+}
+
+const char* IrSender::admissionName(Admission admission) {
+    switch (admission) {
+        case Admission::Accepted: return "accepted";
+        case Admission::Coalesced: return "coalesced";
+        case Admission::Replaced: return "replaced";
+        case Admission::RejectedFull: return "rejected-full";
+        case Admission::RejectedInvalid: return "rejected-invalid";
+    }
+    return "unknown";
+}
+
+const char* IrSender::jobStateName(JobState state) {
+    switch (state) {
+        case JobState::Queued: return "queued";
+        case JobState::Transmitting: return "transmitting";
+        case JobState::Done: return "done";
+        case JobState::Dropped: return "dropped";
+        case JobState::Unknown: break;
+    }
+    return "unknown";
+}
+
+// Free what a job owns once it is done or evicted.
+void IrSender::releaseJob(const Job& job) {
+    if (job.protocol == kSequenceJob) {
+        _sequences[job.value].inUse.store(false, std::memory_order_release);
+    } else if (job.protocol == kRawJob) {
+        _raws[job.value].inUse.store(false, std::memory_order_release);
+    }
+}
+
+// Reserve room (evicting under DropOldest), assign the job its id and
+// publish it.
+bool IrSender::submit(Job& job) {
+    while (!reserve()) {
+        if (_policy != OverflowPolicy::DropOldest) return false;
+        // Give up rather than spin if the oldest job is still being published
+        // by a preempted producer.
+        Job dropped;
+        if (!dequeue(dropped)) return false;
+        releaseJob(dropped);
+        setStatus(dropped.id, JobState::Dropped);
+    }
+    do {
+        job.id = _nextJobId.fetch_add(1, std::memory_order_acq_rel);
+    } while (job.id == 0);
+    newStatus(job.id);
+    enqueue(job);
+    if (_taskMode.load(std::memory_order_acquire)) _task.notify();
+    return true;
+}
+
+IrSender::Submission IrSender::queue(decode_type_t protocol, uint64_t value, uint16_t bits, int repeat) {
+    if (repeat < 1 || repeat > kMaxRepeat || protocol == kSequenceJob || protocol == kRawJob) {
+        return {Admission::RejectedInvalid, 0};
+    }
+    Job job = {protocol, value, bits, repeat, 0};
+
+    uint32_t id = 0;
+    if (coalesce(job, id)) {
+        _coalescedJobs.fetch_add(1, std::memory_order_relaxed);
+        return {Admission::Coalesced, id};
+    }
+    if (_policy == OverflowPolicy::ReplaceSameCode &&
+        updatePending(job, _head.load(std::memory_order_acquire), false, id)) {
+        _coalescedJobs.fetch_add(1, std::memory_order_relaxed);
+        return {Admission::Replaced, id};
+    }
+    if (!submit(job)) return {Admission::RejectedFull, 0};
+    _freshJobs.fetch_add(1, std::memory_order_relaxed);
+    return {Admission::Accepted, job.id};
+}
+
+IrSender::Submission IrSender::queue(uint32_t value, uint16_t length, int repeat) {
+    return queue(NEC, value, length, repeat);
+}
+
+IrSender::Submission IrSender::queueSequence(const SequenceStep* steps, size_t count) {
+    const Submission invalid = {Admission::RejectedInvalid, 0};
+    if (!steps || count < 1 || count > kMaxSequenceSteps) return invalid;
+    for (size_t i = 0; i < count; i++) {
+        if (steps[i].repeat < 1 || steps[i].postDelayMs > kMaxPostDelayMs) return invalid;
+        if (steps[i].protocol == kSequenceJob || steps[i].protocol == kRawJob) return invalid;
+    }
 
-            _active = true;
-            _startImmediate = true;
+    for (size_t i = 0; i < kSequenceSlots; i++) {
+        bool expected = false;
+        if (!_sequences[i].inUse.compare_exchange_strong(expected, true, std::memory_order_acquire,
+                                                         std::memory_order_relaxed)) {
+            continue;
         }
+        SequenceSlot& slot = _sequences[i];
+        for (size_t j = 0; j < count; j++) slot.steps[j] = steps[j];
+        slot.count = count;
+        Job job = {kSequenceJob, (uint64_t)i, 0, 1, 0};
+        if (submit(job)) {
+            _freshJobs.fetch_add(1, std::memory_order_relaxed);
+            return {Admission::Accepted, job.id};
+        }
+        releaseJob(job);
+        break;
+    }
+    return {Admission::RejectedFull, 0};
+}
+
+IrSender::Submission IrSender::queueRaw(decode_type_t protocol, const uint16_t* timings, size_t count,
+                                        uint16_t carrierKHz, int repeat) {
+    if (!timings || count < 1 || count > kMaxRawTimings || repeat < 1 || repeat > kMaxRepeat ||
+        protocol == kSequenceJob || protocol == kRawJob) {
+        return {Admission::RejectedInvalid, 0};
+    }
+
+    for (size_t i = 0; i < kRawSlots; i++) {
+        bool expected = false;
+        if (!_raws[i].inUse.compare_exchange_strong(expected, true, std::memory_order_acquire,
+                                                    std::memory_order_relaxed)) {
+            continue;
+        }
+        RawSlot& slot = _raws[i];
+        memcpy(slot.timings, timings, count * sizeof(uint16_t));
+        slot.count = count;
+        slot.protocol = protocol;
+        slot.carrierKHz = carrierKHz;
+        Job job = {kRawJob, (uint64_t)i, 0, repeat, 0};
+        if (submit(job)) {
+            _freshJobs.fetch_add(1, std::memory_order_relaxed);
+            return {Admission::Accepted, job.id};
+        }
+        releaseJob(job);
+        break;
     }
+    return {Admission::RejectedFull, 0};
+}
+
+// True if the previous frame's timing lets the next frame start at `now`:
+// one frame period after it started, and its minimum gap (or the step's
+// post-delay) after it ended.
+bool IrSender::frameDue(uint32_t now) const {
+    if (!_hasSent) return true;
+    return now - _lastFrameStart >= _lastTiming->framePeriodMs &&
+           now - _lastFrameEnd >= _lastGapMs;
+}
+
+uint32_t IrSender::clockMs(bool inTask) const {
+    return inTask ? _task.nowMs() : (uint32_t)millis();
+}
 
-    if (!_active) return;
+// Make a dequeued job the active one.
+void IrSender::startJob(const Job& job) {
+    _currentJobId = job.id;
+    _currentStarted = false;
+    if (job.protocol == kSequenceJob) {
+        _sequence = &_sequences[job.value];
+        _step = 0;
+        loadStep();
+        return;
+    }
+    _sequence = nullptr;
+    _current = job;
+    _currentPostDelayMs = 0;
+    _currentRepeatsLeft = _current.repeats;
+    if (job.protocol == kRawJob) {
+        _raw = &_raws[job.value];
+        _currentTiming = &irProtocolTiming(_raw->protocol);
+        return;
+    }
+    _currentTiming = &irProtocolTiming(_current.protocol);
+    if (_coalesceLimit > 0) openExtension();
+}
 
-    unsigned long now = millis();
+// Publish the active job's code so queue() can add repeats to it.
+void IrSender::openExtension() {
+    // The previous job's extension is closed; order that before the new fields
+    std::atomic_thread_fence(std::memory_order_release);
+    _extCode.store(packCode(_current.protocol, _current.bits), std::memory_order_relaxed);
+    _extValueLo.store((uint32_t)_current.value, std::memory_order_relaxed);
+    _extValueHi.store((uint32_t)(_current.value >> 32), std::memory_order_relaxed);
+    _extJobId.store(_currentJobId, std::memory_order_relaxed);
+    uint32_t gen = (_extension.load(std::memory_order_relaxed) + 0x10000u) & kExtGenMask;
+    _extension.store(kExtOpen | gen, std::memory_order_release);
+    _extensionOpen = true;
+}
 
-    // Check if we can send now: either it's the first time (_startImmediate)
-    // or enough time (50ms) has passed since the last send.
-    if (_startImmediate || (now - _lastSendTime >= 50)) {
-        if (_currentRepeatsLeft > 0) {
-            _irsend.sendNEC(_currentValue, _currentLength);
-            _lastSendTime = millis();
-            _startImmediate = false;
-            _currentRepeatsLeft--;
+// Take the repeats queue() added to the active job. With none, close the job
+// to further additions when `close` is set. Returns the repeats taken.
+uint32_t IrSender::takeExtension(bool close) {
+    if (!_extensionOpen) return 0;
+    uint32_t state = _extension.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t extra = state & kExtRepeatsMask;
+        if (extra == 0 && !close) return 0;
+        uint32_t next = extra ? (state & ~kExtRepeatsMask) : (state & ~kExtOpen);
+        if (_extension.compare_exchange_weak(state, next, std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+            if (!extra) _extensionOpen = false;
+            return extra;
         }
+    }
+}
+
+void IrSender::loadStep() {
+    const SequenceStep& step = _sequence->steps[_step];
+    _current.protocol = step.protocol;
+    _current.value = step.value;
+    _current.bits = step.bits;
+    _current.repeats = step.repeat;
+    _currentPostDelayMs = step.postDelayMs;
+    _currentTiming = &irProtocolTiming(_current.protocol);
+    _currentRepeatsLeft = _current.repeats;
+}
+
+// Release the active job and record its final state; a job none of whose
+// frames could be sent counts as dropped.
+void IrSender::finishJob(JobState state) {
+    if (_currentJobId != 0) {
+        setStatus(_currentJobId, _currentStarted ? state : JobState::Dropped);
+        _currentJobId = 0;
+    }
+    if (_extensionOpen) {
+        _extension.fetch_and(~(kExtOpen | kExtRepeatsMask), std::memory_order_acq_rel);
+        _extensionOpen = false;
+    }
+    if (_sequence != nullptr) {
+        _sequence->inUse.store(false, std::memory_order_release);
+        _sequence = nullptr;
+    }
+    if (_raw != nullptr) {
+        _raw->inUse.store(false, std::memory_order_release);
+        _raw = nullptr;
+    }
+    _currentRepeatsLeft = 0;
+}
+
+// Continue the active job with `extra` more repeat frames (0 = linger).
+void IrSender::addRepeats(uint32_t extra) {
+    _currentRepeatsLeft = (int)extra;
+    _current.repeats = (int)extra + 1;  // every remaining frame is a repeat
+}
 
-        if (_currentRepeatsLeft <= 0) {
-            _active = false;
+// Emit the next frame of the active job and advance through its repeats and
+// sequence steps. A step whose code cannot be sent is skipped. After the last
+// frame of a plain job the job stays open for one more frame slot, so a
+// resubmitted code continues as repeats instead of restarting. Returns false
+// once the job is finished.
+bool IrSender::transmitNext(bool inTask) {
+    if (_currentRepeatsLeft == 0) {
+        uint32_t extra = takeExtension(true);
+        if (extra == 0) {
+            finishJob();
+            return false;
+        }
+        addRepeats(extra);
+    }
+    bool repeatFrame = _currentRepeatsLeft < _current.repeats;
+    _lastFrameStart = clockMs(inTask);
+    bool sent = emitFrame(_current, repeatFrame);
+    _lastFrameEnd = clockMs(inTask);
+    if (sent && !_currentStarted) {
+        _currentStarted = true;
+        setStatus(_currentJobId, JobState::Transmitting);
+    }
+    _hasSent = true;
+    // A frame IRsend padded to its message time already ends with the gap
+    _lastGapMs = _lastFramePadded ? 0 : _currentTiming->minGapMs;
+    _currentRepeatsLeft = sent ? _currentRepeatsLeft - 1 : 0;
+    if (_currentRepeatsLeft > 0) return true;
+    if (sent && _extensionOpen) {
+        // Linger only while nothing else is waiting
+        bool pending = _count.load(std::memory_order_acquire) != 0;
+        uint32_t extra = takeExtension(pending);
+        if (extra > 0 || !pending) {
+            addRepeats(extra);
+            return true;  // more repeats, or linger until the next frame slot
         }
     }
+
+    if (_currentPostDelayMs > _lastGapMs) _lastGapMs = _currentPostDelayMs;
+    if (_sequence != nullptr && ++_step < _sequence->count) {
+        loadStep();
+        return true;
+    }
+    finishJob();
+    return false;
+}
+
+// Send one frame: the full code (pre-encoded timings for raw jobs), or for
+// repeats of a RepeatBurst protocol the short repeat code. Returns false if
+// IRsend cannot encode the protocol.
+bool IrSender::emitFrame(const Job& job, bool repeatFrame) {
+    _lastTiming = _currentTiming;
+    _lastFramePadded = false;
+    if (repeatFrame && _currentTiming->repeatStyle == IrRepeatStyle::RepeatBurst) {
+        _irsend.enableIROut(kIrRepeatBurstCarrierHz);
+        _irsend.mark(_currentTiming->burstHeaderMarkUs);
+        _irsend.space(_currentTiming->burstHeaderSpaceUs);
+        _irsend.mark(_currentTiming->burstStopMarkUs);
+        return true;
+    }
+    if (job.protocol == kRawJob) {
+        _irsend.sendRaw(_raw->timings, (uint16_t)_raw->count, _raw->carrierKHz);
+        return true;
+    }
+    if (_irsend.send(job.protocol, job.value, job.bits)) {
+        _lastFramePadded = _currentTiming->sendPadsFrame;
+        return true;
+    }
+    printf("[IR] TX failed: protocol %d cannot be sent\n", (int)job.protocol);
+    return false;
+}
+
+void IrSender::loop() {
+    if (_taskMode.load(std::memory_order_relaxed)) return;
+
+    // Start the next queued job once the previous one has fully completed
+    if (!_active.load(std::memory_order_relaxed)) {
+        if (_count.load(std::memory_order_acquire) == 0) return;
+        Job job;
+        if (!dequeue(job)) return;
+        startJob(job);
+        _active.store(true, std::memory_order_relaxed);
+    }
+
+    // Send the first frame of an idle sender immediately; otherwise space
+    // frames (repeats, sequence steps and back-to-back jobs) by the previous
+    // frame's timing.
+    if (!frameDue(millis())) return;
+    bool lingering = _currentRepeatsLeft == 0;
+    if (transmitNext(false)) return;
+    _active.store(false, std::memory_order_relaxed);
+
+    // A job that lingered for coalescing ended without a frame; hand its
+    // frame slot to the next job right away
+    if (!lingering || _count.load(std::memory_order_acquire) == 0) return;
+    Job job;
+    if (!dequeue(job)) return;
+    startJob(job);
+    _active.store(true, std::memory_order_relaxed);
+    if (!transmitNext(false)) _active.store(false, std::memory_order_relaxed);
+}
+
+bool IrSender::startTask(int priority, uint32_t stackBytes) {
+    if (_taskMode.load(std::memory_order_acquire)) return true;
+    // loop() must not be mid-job when the task takes over
+    if (_active.load(std::memory_order_relaxed)) return false;
+    // Frame times were taken from millis(); the task runs on its own clock
+    _hasSent = false;
+    if (!_task.start("ir_tx", taskEntry, this, stackBytes, priority)) return false;
+    _taskMode.store(true, std::memory_order_release);
+    _task.notify();
+    return true;
+}
+
+void IrSender::stopTask() {
+    if (!_taskMode.load(std::memory_order_acquire)) return;
+    _task.stop();
+    _hasSent = false;
+    _taskMode.store(false, std::memory_order_release);
+}
+
+void IrSender::taskEntry(void* self) {
+    static_cast<IrSender*>(self)->taskLoop();
+}
+
+// Sleep until frameDue() would hold, using delayUntil so the frame period is
+// measured from the previous frame's start rather than from when we woke.
+void IrSender::waitForFrameSlot() {
+    if (!_hasSent) return;
+    if (_task.nowMs() - _lastFrameStart < _lastTiming->framePeriodMs) {
+        uint32_t wake = _lastFrameStart;
+        _task.delayUntil(wake, _lastTiming->framePeriodMs);
+    }
+    if (_task.nowMs() - _lastFrameEnd < _lastGapMs) {
+        uint32_t wake = _lastFrameEnd;
+        _task.delayUntil(wake, _lastGapMs);
+    }
+}
+
+// Task-mode transmit loop: sleep until notified, then drain the queue with
+// the same frame timing as loop().
+void IrSender::taskLoop() {
+    while (_task.running()) {
+        Job job;
+        if (!dequeue(job)) {
+            _task.wait();
+            continue;
+        }
+        startJob(job);
+        _active.store(true, std::memory_order_relaxed);
+        for (;;) {
+            waitForFrameSlot();
+            if (!_task.running() || !transmitNext(true)) break;
+        }
+        finishJob(JobState::Dropped);  // no-op unless stopTask() cut the job short
+        _active.store(false, std::memory_order_relaxed);
+    }
 }
 
 bool IrSender::isActive() const {
-    return _active;
+    return _active.load(std::memory_order_relaxed);
 }
 
 bool IrSender::isJobPending() const {
-    std::lock_guard<std::mutex> lock(_mutex);
-    return _jobPending;
+    return _count.load(std::memory_order_acquire) > 0;
+}
+
+size_t IrSender::pendingJobs() const {
+    return _count.load(std::memory_order_acquire);
 }
@@ -4,7 +4,8 @@
 //
 // Exposes four characteristics behind bonded encryption:
 //   - Saved Codes  (Read)   — JSON array of stored IR commands
-//   - Send Command (Write)  — write a single byte (NVS index) to send that code
+//   - Send Command (Write)  — write a single byte (NVS index) to send that code,
+//                             or 0xFF + index to run a saved sequence
 //   - Status       (Notify) — result string after a send ("OK:<name>" or "ERR:…")
 //   - Schedule     (Write)  — JSON: configure disconnect-delayed command
 //
@@ -31,10 +32,12 @@
 // ---------------------------------------------------------------------------
 // External helpers defined in main.cpp
 // ---------------------------------------------------------------------------
-extern String getSavedCodesJson();
 extern String getSavedCodesJsonCompact();
 extern int    getSavedCodeIndexByName(const char *name);
-extern bool   sendSavedCode(int index, String &outName);
+extern int    getSavedCodeIndexById(uint16_t id);
+extern bool   sendSavedCode(int index, String &outName, uint32_t *outJobId = nullptr);
+extern int    getSequenceIndexByName(const char *name);
+extern bool   sendSequence(int index, String &outName, const char **outError, uint32_t *outJobId = nullptr);
 
 // ---------------------------------------------------------------------------
 // Module state
@@ -198,7 +201,9 @@ class SavedCodesCallbacks : public BLECharacteristicCallbacks {
   }
 };
 
-// Send Command — the client writes one byte (the saved-code index).
+// Send Command — the client writes one byte (the saved-code index),
+// BLE_SEND_SEQUENCE_PREFIX followed by a saved-sequence index, or
+// BLE_SEND_ID_PREFIX followed by a saved code's stable id (2 bytes, little-endian).
 class SendCommandCallbacks : public BLECharacteristicCallbacks {
   void onWrite(BLECharacteristic* pCharacteristic) override {
     std::string val = pCharacteristic->getValue();
@@ -207,6 +212,36 @@ class SendCommandCallbacks : public BLECharacteristicCallbacks {
       return;
     }
 
+    if (val.size() >= 2 && (uint8_t)val[0] == BLE_SEND_SEQUENCE_PREFIX) {
+      int index = (uint8_t)val[1];
+      String name;
+      const char* error = "";
+      String status;
+      if (sendSequence(index, name, &error)) {
+        status = "OK:" + (name.length() > 0 ? name : String(index));
+      } else {
+        status = "ERR:sequence " + String(index) + " " + error;
+      }
+      setStatus(status);
+      printf("[BLE] Send sequence: index=%d -> %s\n", index, status.c_str());
+      return;
+    }
+
+    if (val.size() == 3 && (uint8_t)val[0] == BLE_SEND_ID_PREFIX) {
+      uint16_t id = (uint16_t)((uint8_t)val[1] | ((uint8_t)val[2] << 8));
+      int index = getSavedCodeIndexById(id);
+      String name;
+      String status;
+      if (index >= 0 && sendSavedCode(index, name)) {
+        status = "OK:" + (name.length() > 0 ? name : String(index));
+      } else {
+        status = "ERR:id " + String(id);
+      }
+      setStatus(status);
+      printf("[BLE] Send command: id=%u -> %s\n", (unsigned)id, status.c_str());
+      return;
+    }
+
     int index = (uint8_t)val[0];
     String name;
     bool ok = sendSavedCode(index, name);
@@ -451,6 +486,7 @@ void loopBLE() {
   if (!shouldRun) return;
 
   int idx = getSavedCodeIndexByName(commandToRun);
+  int seqIdx = idx < 0 ? getSequenceIndexByName(commandToRun) : -1;
   if (idx >= 0) {
     String name;
     if (sendSavedCode(idx, name)) {
@@ -459,6 +495,15 @@ void loopBLE() {
     } else {
       setStatus("ERR:scheduled send");
     }
+  } else if (seqIdx >= 0) {
+    // No code by that name; fall back to a saved sequence
+    String name;
+    if (sendSequence(seqIdx, name, nullptr)) {
+      setStatus("OK:scheduled " + name);
+      printf("[BLE] Scheduled sequence executed: %s\n", name.c_str());
+    } else {
+      setStatus("ERR:scheduled send");
+    }
   } else {
     setStatus("ERR:scheduled not found");
     printf("[BLE] Scheduled command not found: %s\n", commandToRun);
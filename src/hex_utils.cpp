@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <string.h>
 
 bool isHexValue(const char *s) {
   if (!s || !*s) return false;
@@ -18,6 +19,15 @@ String uint64ToHex(uint64_t val) {
   return String(buf);
 }
 
+String uint64ToHexBits(uint64_t val, uint16_t bits) {
+  if (bits <= 32) return uint64ToHex(val);
+  int digits = bits >= 64 ? 16 : (bits + 3) / 4;
+  if (digits < 16) val &= (1ULL << (digits * 4)) - 1;
+  char buf[20];
+  snprintf(buf, sizeof(buf), "%0*llX", digits, (unsigned long long)val);
+  return String(buf);
+}
+
 bool parseHex32(const char* s, uint32_t& out_value) {
   if (!isHexValue(s)) {
     return false;
@@ -37,3 +47,41 @@ bool parseHex32(const char* s, uint32_t& out_value) {
   out_value = (uint32_t)val;
   return true;
 }
+
+bool parseHex64(const char* s, uint64_t& out_value) {
+  if (!isHexValue(s)) {
+    return false;
+  }
+  char* endptr;
+  errno = 0;
+  unsigned long long val = strtoull(s, &endptr, 16);
+  if (errno == ERANGE) {
+    return false;
+  }
+  if (*endptr != '\0') {
+    return false;
+  }
+  out_value = (uint64_t)val;
+  return true;
+}
+
+bool parseHex128(const char* s, uint64_t& out_hi, uint64_t& out_lo) {
+  if (!isHexValue(s)) {
+    return false;
+  }
+  while (*s == '0' && s[1] != '\0') s++;
+  size_t len = strlen(s);
+  if (len > 32) {
+    return false;
+  }
+  uint64_t hi = 0, lo = 0;
+  for (const char* p = s; *p; ++p) {
+    char c = (char)toupper((unsigned char)*p);
+    uint64_t digit = (c <= '9') ? (uint64_t)(c - '0') : (uint64_t)(c - 'A' + 10);
+    hi = (hi << 4) | (lo >> 60);
+    lo = (lo << 4) | digit;
+  }
+  out_hi = hi;
+  out_lo = lo;
+  return true;
+}
@@ -0,0 +1,33 @@
+#include "ir_protocol_timing.h"
+
+namespace {
+
+struct TimingEntry {
+    decode_type_t protocol;
+    IrProtocolTiming timing;
+};
+
+// IRsend pads every frame of these protocols to its message time (the
+// frame period); the minimum gaps are for raw frames of the same protocol.
+const TimingEntry kTimings[] = {
+    // NEC: 108 ms frame period; held buttons send 9 ms / 2.25 ms / 560 us repeat codes
+    {NEC, {108, 40, true, IrRepeatStyle::RepeatBurst, 9000, 2250, 560}},
+    // LG: NEC-like, with an 8.5 ms repeat header
+    {LG, {108, 40, true, IrRepeatStyle::RepeatBurst, 8500, 2250, 550}},
+    {SAMSUNG, {108, 20, true, IrRepeatStyle::FullFrame, 0, 0, 0}},
+    {SONY, {45, 10, true, IrRepeatStyle::FullFrame, 0, 0, 0}},
+    {RC5, {114, 0, true, IrRepeatStyle::FullFrame, 0, 0, 0}},
+    {RC6, {83, 0, true, IrRepeatStyle::FullFrame, 0, 0, 0}},
+    {JVC, {60, 10, true, IrRepeatStyle::FullFrame, 0, 0, 0}},
+};
+
+const IrProtocolTiming kDefaultTiming = {0, 50, false, IrRepeatStyle::FullFrame, 0, 0, 0};
+
+}  // namespace
+
+const IrProtocolTiming& irProtocolTiming(decode_type_t protocol) {
+    for (const TimingEntry& e : kTimings) {
+        if (e.protocol == protocol) return e.timing;
+    }
+    return kDefaultTiming;
+}
@@ -0,0 +1,44 @@
+#include "ir_raw_encoder.h"
+
+namespace {
+
+struct ShapeEntry {
+    decode_type_t protocol;
+    IrPulseDistance shape;
+};
+
+const ShapeEntry kShapes[] = {
+    // NEC: 16/8-tick header, 560 us tick (kNecHdrMark, kNecHdrSpace, ...)
+    {NEC, {8960, 4480, 560, 1680, 560, 560, 38}},
+    // SAMSUNG: NEC bit timing with an 8/8-tick header
+    {SAMSUNG, {4480, 4480, 560, 1680, 560, 560, 38}},
+};
+
+}  // namespace
+
+const IrPulseDistance* irPulseDistance(decode_type_t protocol) {
+    for (const ShapeEntry& e : kShapes) {
+        if (e.protocol == protocol) return &e.shape;
+    }
+    return nullptr;
+}
+
+size_t irRawEncode(decode_type_t protocol, uint64_t valueHi, uint64_t valueLo, uint16_t bits,
+                   uint16_t* out, size_t max) {
+    const IrPulseDistance* shape = irPulseDistance(protocol);
+    if (shape == nullptr || bits == 0 || bits > kIrRawEncodeMaxBits) return 0;
+    size_t count = 2 + 2 * (size_t)bits + 1;
+    if (count > max) return 0;
+
+    size_t n = 0;
+    out[n++] = shape->headerMarkUs;
+    out[n++] = shape->headerSpaceUs;
+    for (int bit = bits - 1; bit >= 0; bit--) {
+        uint64_t word = bit >= 64 ? valueHi : valueLo;
+        bool one = (word >> (bit & 63)) & 1;
+        out[n++] = shape->bitMarkUs;
+        out[n++] = one ? shape->oneSpaceUs : shape->zeroSpaceUs;
+    }
+    out[n++] = shape->footerMarkUs;
+    return n;
+}
@@ -1,13 +1,30 @@
 #include "ir_utils.h"
+#include <IRutils.h>
 #include <ctype.h>
 
+bool parseSendableProtocol(const char* name, decode_type_t& out) {
+  if (!name || !*name) return false;
+  decode_type_t type = strToDecodeType(name);
+  if (!isSendableProtocol(type)) return false;
+  out = type;
+  return true;
+}
+
+bool isSendableProtocol(decode_type_t type) {
+  if (type <= decode_type_t::UNUSED || type > kLastDecodeType) return false;
+  return !hasACState(type);
+}
+
 String replayUrlFor(const IrCapture& c) {
-  if (!c.protocol.equalsIgnoreCase("NEC")) return "";
-  return "/send?type=nec&data=" + uint64ToHex(c.value) + "&length=" + String(c.bits);
+  decode_type_t type;
+  if (!parseSendableProtocol(c.protocol.c_str(), type)) return "";
+  String slug = c.protocol;
+  slug.toLowerCase();
+  return "/send?type=" + slug + "&data=" + uint64ToHexBits(c.value, c.bits) + "&length=" + String(c.bits);
 }
 
 String saveUrlFor(const IrCapture& c, const String& name) {
-  String url = "/save?protocol=" + c.protocol + "&value=" + uint64ToHex(c.value) + "&length=" + String(c.bits);
+  String url = "/save?protocol=" + c.protocol + "&value=" + uint64ToHexBits(c.value, c.bits) + "&length=" + String(c.bits);
   if (name.length() > 0) url += "&name=" + name;
   return url;
 }
@@ -0,0 +1,102 @@
+#include "json_array_stream.h"
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+JsonArrayStream::JsonArrayStream(size_t maxElementBytes) : _maxElementBytes(maxElementBytes) {
+    _element.reserve(maxElementBytes);
+}
+
+void JsonArrayStream::fail(const char* error) {
+    _status = Status::Error;
+    _error = error;
+    _element.clear();
+}
+
+void JsonArrayStream::finishElement(const ElementFn& onElement) {
+    size_t len = _element.size();
+    while (len > 0 && isSpace(_element[len - 1])) len--;
+    if (_oversized) {
+        onElement(_index, nullptr, 0);
+    } else {
+        onElement(_index, _element.data(), len);
+    }
+    _index++;
+    _element.clear();
+    _oversized = false;
+}
+
+JsonArrayStream::Status JsonArrayStream::feed(const char* data, size_t len, const ElementFn& onElement) {
+    for (size_t i = 0; i < len && _status != Status::Error; i++) {
+        char c = data[i];
+        switch (_state) {
+        case State::BeforeArray:
+            if (isSpace(c)) break;
+            if (c != '[') {
+                fail("Expected JSON array");
+                break;
+            }
+            _state = State::BeforeElement;
+            break;
+
+        case State::BeforeElement:
+            if (isSpace(c)) break;
+            if (c == ']' && !_sawComma) {
+                _state = State::AfterArray;
+                _status = Status::Done;
+                break;
+            }
+            if (c == ']' || c == ',') {
+                fail("Invalid JSON");
+                break;
+            }
+            _state = State::InElement;
+            _sawComma = false;
+            // fall through - c is the element's first character
+        case State::InElement:
+            if (_inString) {
+                if (_escape) {
+                    _escape = false;
+                } else if (c == '\\') {
+                    _escape = true;
+                } else if (c == '"') {
+                    _inString = false;
+                }
+            } else if (c == '"') {
+                _inString = true;
+            } else if (c == '{' || c == '[') {
+                _depth++;
+            } else if ((c == '}' || c == ']') && _depth > 0) {
+                _depth--;
+            } else if (c == '}') {
+                fail("Invalid JSON");
+                break;
+            } else if (c == ']' || (c == ',' && _depth == 0)) {
+                finishElement(onElement);
+                if (c == ',') {
+                    _sawComma = true;
+                    _state = State::BeforeElement;
+                } else {
+                    _state = State::AfterArray;
+                    _status = Status::Done;
+                }
+                break;
+            }
+            if (_oversized) break;
+            if (_element.size() >= _maxElementBytes) {
+                // Drop what was buffered; only the boundary is still needed
+                _oversized = true;
+                _element.clear();
+                break;
+            }
+            _element.push_back(c);
+            break;
+
+        case State::AfterArray:
+            if (!isSpace(c)) fail("Invalid JSON");
+            break;
+        }
+    }
+    return _status;
+}
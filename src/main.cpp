@@ -1,6 +1,8 @@
 #include <Arduino.h>
 #include <strings.h>
 #include <ctype.h>
+#include <atomic>
+#include <memory>
 #include <WiFi.h>
 #include <LittleFS.h>
 #include <ESPAsyncWebServer.h>
@@ -16,6 +18,17 @@
 #include "ir_utils.h"
 #include "hex_utils.h"
 #include "IrSender.h"
+#include "saved_code_table.h"
+#include "saved_sequence_table.h"
+#include "json_array_stream.h"
+#include "saved_code_store_fs.h"
+#include "saved_code_store_nvs.h"
+#include "saved_code_committer.h"
+#include "saved_backup.h"
+#include "saved_code_list.h"
+#include "ws_binary.h"
+#include "ws_event_limiter.h"
+#include "worker_task.h"
 #include "ble_server.h"
 
 // Helper to robustly parse String to int
@@ -32,13 +45,24 @@ static bool parseIntStr(const String& str, int& out_val) {
   return true;
 }
 
-// Overridden by -DIR_RECV_ENABLED / -DIR_SEND_REPEAT from .env via scripts/pio_env_flags.py
+// Overridden by -DIR_RECV_ENABLED / -DIR_SEND_REPEAT / -DIR_SEND_QUEUE_DEPTH / -DIR_TX_TASK /
+// -DIR_SEND_COALESCE_MAX / -DIR_SEND_PREENCODE / -DSAVED_CODES_STORE_LITTLEFS from .env
+// via scripts/pio_env_flags.py
 #ifndef IR_RECV_ENABLED
 #define IR_RECV_ENABLED 1
 #endif
 #ifndef IR_SEND_REPEAT
 #define IR_SEND_REPEAT 1
 #endif
+#ifndef IR_TX_TASK
+#define IR_TX_TASK 0
+#endif
+#ifndef IR_SEND_PREENCODE
+#define IR_SEND_PREENCODE 0
+#endif
+#ifndef SAVED_CODES_STORE_LITTLEFS
+#define SAVED_CODES_STORE_LITTLEFS 0
+#endif
 
 #if IR_RECV_ENABLED
 #include <IRrecv.h>
@@ -46,11 +70,25 @@ static bool parseIntStr(const String& str, int& out_val) {
 
 #define HISTORY_SIZE 5
 #define SAVED_CODES_NAMESPACE "ir_saved"
-#define SAVED_CODE_MAX 500   // NVS value limit ~508; keep JSON under this
+#define SAVED_CODES_BLOB_KEY "codes"  // all saved codes, SavedCodeTable blob format (NVS store)
+#define SAVED_CODES_JOURNAL_KEY "codes_log"  // changes since the blob (NVS store)
+#define SAVED_COMMIT_QUIET_MS 1000  // commit journaled changes once none came for this long
+#define SAVED_COMMIT_MAX_DELAY_MS 5000  // ... or this long after the first one
+#define SAVED_COMMIT_RETRY_MS 10000  // retry a failed commit after this long
+#define SAVED_BODY_CACHE_MAX 16384  // largest /saved, /dump or BLE list body kept between requests
+#define SAVED_COMMIT_TASK_STACK 4096
+#define SAVED_COMMIT_TASK_PRIORITY 1
+#define SAVED_IMPORT_ENTRY_MAX 512  // one element of a /saved/import array
+#define SAVED_IMPORT_CODES_MAX 1000  // codes staged by one /saved/import
+#define SAVED_IMPORT_BODY_MAX 262144  // bytes; the body is streamed, not buffered
+#define SAVED_RESTORE_BODY_MAX 262144  // bytes of a /saved/restore image, also streamed
 
 #define MAX_PARAM_PROTOCOL 16
 #define MAX_PARAM_DATA 128
 #define MAX_PARAM_NAME 64
+#define WS_CLIENTS_MAX 8  // AsyncWebSocket's default client limit
+#define WS_EVENT_MIN_INTERVAL_MS 250  // per client; IR events sooner than this fold into the next one
+#define WS_EVENT_STALL_MS 10000  // a client whose send queue stays full this long is closed
 
 #if IR_RECV_ENABLED
 const uint16_t RECV_PIN = 10;     // IR receiver on GPIO10 (ESP32-C3)
@@ -74,27 +112,44 @@ AsyncWebSocket ws("/ws");
 String lastHumanReadable = "";
 String lastRawJson = "";
 uint32_t lastCodeSeq = 0;  // Incremented on each new IR decode; client polls /last to detect changes
+// Mark/space timings of the newest capture when its protocol cannot be sent
+// from a value (count 0 otherwise); GET /save stores them with the code.
+uint16_t lastCaptureTimings[IrSender::kMaxRawTimings];
+uint16_t lastCaptureTimingsCount = 0;
 
 IrCapture history[HISTORY_SIZE];
 int historyLen = 0;
 int historyHead = 0;
 
 Preferences savedCodes;
-struct SavedCodeCacheEntry {
-  String raw;
-  String name;
-};
-static std::vector<SavedCodeCacheEntry> g_savedCodesCache;
+static SavedCodeTable g_savedCodesCache;
+static SavedSequenceTable g_sequencesCache;
 static bool g_cacheLoaded = false;
+#if SAVED_CODES_STORE_LITTLEFS
+static SavedCodeStoreFs g_codeStore(LittleFS, "/saved");
+#else
+static SavedCodeStoreNvs g_codeStore(SAVED_CODES_NAMESPACE, SAVED_CODES_BLOB_KEY, SAVED_CODES_JOURNAL_KEY);
+#endif
+static SavedCodeCommitter g_codeCommitter(SAVED_COMMIT_QUIET_MS, SAVED_COMMIT_MAX_DELAY_MS, SAVED_COMMIT_RETRY_MS);
+static WorkerTask g_commitTask;
+// Heap around the last cache load: free bytes and largest free block
+static struct {
+  uint32_t freeBefore, largestBefore, freeAfter, largestAfter;
+} g_cacheLoadHeap;
 
 // BLE callbacks and AsyncWebServer handlers run on different tasks, so NVS access
 // through this shared Preferences instance must be serialized.
 static SemaphoreHandle_t savedCodesMutex = nullptr;
+// Held through a whole commit of the saved codes (see commitSavedCodes()) and
+// by whole-table saves, so one snapshot write at a time is in flight. Taken
+// before savedCodesMutex, never while holding it.
+static SemaphoreHandle_t savedCodesCommitMutex = nullptr;
 
 static bool initSavedCodesMutex() {
-  if (savedCodesMutex != nullptr) return true;
-  savedCodesMutex = xSemaphoreCreateMutex();
-  if (savedCodesMutex == nullptr) {
+  if (savedCodesMutex != nullptr && savedCodesCommitMutex != nullptr) return true;
+  if (savedCodesMutex == nullptr) savedCodesMutex = xSemaphoreCreateMutex();
+  if (savedCodesCommitMutex == nullptr) savedCodesCommitMutex = xSemaphoreCreateMutex();
+  if (savedCodesMutex == nullptr || savedCodesCommitMutex == nullptr) {
     printf("[IR] Failed to create saved codes mutex\n");
     return false;
   }
@@ -103,16 +158,16 @@ static bool initSavedCodesMutex() {
 
 class SavedCodesLock {
 public:
-  SavedCodesLock() : locked(false) {
+  explicit SavedCodesLock(SemaphoreHandle_t &mutex = savedCodesMutex) : mutex(mutex), locked(false) {
     if (!initSavedCodesMutex()) return;
-    locked = (xSemaphoreTake(savedCodesMutex, portMAX_DELAY) == pdTRUE);
+    locked = (xSemaphoreTake(mutex, portMAX_DELAY) == pdTRUE);
     if (!locked) {
       printf("[IR] Failed to lock saved codes mutex\n");
     }
   }
 
   ~SavedCodesLock() {
-    if (locked) xSemaphoreGive(savedCodesMutex);
+    if (locked) xSemaphoreGive(mutex);
   }
 
   explicit operator bool() const {
@@ -120,27 +175,310 @@ public:
   }
 
 private:
+  SemaphoreHandle_t &mutex;
   bool locked;
 };
 
-// Must be called with SavedCodesLock held.
-static void ensureCacheLoaded() {
-  if (g_cacheLoaded) return;
-  savedCodes.begin(SAVED_CODES_NAMESPACE, true);
-  int n = savedCodes.getInt("n", 0);
-  g_savedCodesCache.clear();
-  g_savedCodesCache.reserve(n);
+// Parse a code's "raw" array of mark/space durations (microseconds, starting
+// with a mark); timings may be nullptr to only validate. Returns an error
+// message, or nullptr.
+static const char *parseRawTimings(JsonArrayConst in, uint16_t *timings, size_t &count) {
+  if (in.size() < 1 || in.size() > IrSender::kMaxRawTimings) return "Raw timings: 1-512 values";
+  count = 0;
+  for (JsonVariantConst v : in) {
+    if (!v.is<uint32_t>()) return "Raw timing is not a number";
+    uint32_t us = v.as<uint32_t>();
+    if (us < 1 || us > 65535) return "Raw timing out of range";
+    if (timings) timings[count] = (uint16_t)us;
+    count++;
+  }
+  return nullptr;
+}
+
+// Parse one stored JSON entry into the table. Must be called with SavedCodesLock held.
+static void appendCachedCode(JsonDocument &entry) {
+  // Only touched under SavedCodesLock
+  static uint16_t timings[IrSender::kMaxRawTimings];
+  const char *protocol = entry["protocol"] | "";
+  decode_type_t type;
+  if (!parseSendableProtocol(protocol, type)) type = decode_type_t::UNKNOWN;
+  int repeat = entry["repeat"] | 0;
+  if (repeat < 0 || repeat > 20) repeat = 0;
+  size_t count = 0;
+  if (entry["raw"].is<JsonArrayConst>() && parseRawTimings(entry["raw"].as<JsonArrayConst>(), timings, count) != nullptr) {
+    count = 0;
+  }
+  g_savedCodesCache.append(entry["name"] | "", protocol, type, entry["value"] | "",
+                           entry["bits"] | 32, (uint8_t)repeat, timings, count, entry["khz"] | 38);
+}
+
+// Parse a sequence's "steps" array: each step is { "id": ID } (saved code
+// id), { "code": N } (saved code index, kept as that code's id) or
+// { "protocol", "value", "bits" }, plus optional "repeat" and "delay_ms".
+// Steps of a request must name codes that exist; ones stored by older
+// firmware may name codes deleted since. Must be called with SavedCodesLock
+// held and the cache loaded. Returns an error message, or nullptr.
+static const char *parseSequenceSteps(JsonArrayConst in, bool stored, SavedSequenceTable::Step *steps,
+                                      size_t &count) {
+  if (in.size() > IrSender::kMaxSequenceSteps) return "Too many steps";
+  count = 0;
+  for (JsonVariantConst v : in) {
+    if (!v.is<JsonObjectConst>()) return "Step is not an object";
+    SavedSequenceTable::Step &step = steps[count];
+    step.codeId = SavedSequenceTable::kRawCode;
+    step.protocol = (int16_t)decode_type_t::UNKNOWN;
+    step.value = 0;
+    step.bits = 0;
+    if (v["id"].is<int>()) {
+      int id = v["id"];
+      if (id < 1 || id > 0xFFFF || (!stored && g_savedCodesCache.indexOfId((uint16_t)id) < 0)) return "Unknown id";
+      step.codeId = (uint16_t)id;
+    } else if (v["code"].is<int>()) {
+      int code = v["code"];
+      if (code < 0 || code >= (int)g_savedCodesCache.size()) return "Invalid code index";
+      step.codeId = g_savedCodesCache.at(code).id;
+    } else {
+      decode_type_t type;
+      if (!parseSendableProtocol(v["protocol"] | "", type)) return "Unsupported protocol";
+      if (!parseHex64(v["value"] | "", step.value)) return "Value must be hex";
+      int bits = v["bits"] | 32;
+      if (bits < 1 || bits > 64) return "Bits out of range";
+      step.protocol = (int16_t)type;
+      step.bits = (uint16_t)bits;
+    }
+    int repeat = v["repeat"] | 0;
+    if (repeat < 0 || repeat > 20) return "Invalid repeat (0-20)";
+    int delayMs = v["delay_ms"] | 0;
+    if (delayMs < 0 || delayMs > IrSender::kMaxPostDelayMs) return "Invalid delay_ms";
+    step.repeat = (uint8_t)repeat;
+    step.postDelayMs = (uint16_t)delayMs;
+    count++;
+  }
+  return nullptr;
+}
+
+// Write sequence i's steps in the API form, with the referenced code's
+// current index and name unless it was deleted. Must be called with
+// SavedCodesLock held.
+static void appendSequenceSteps(size_t i, JsonArray out) {
+  for (size_t j = 0; j < g_sequencesCache.stepCount(i); j++) {
+    const SavedSequenceTable::Step &step = g_sequencesCache.step(i, j);
+    JsonObject o = out.add<JsonObject>();
+    if (step.codeId != SavedSequenceTable::kRawCode) {
+      o["id"] = step.codeId;
+      int code = g_savedCodesCache.indexOfId(step.codeId);
+      if (code >= 0) {
+        o["code"] = code;
+        o["codeName"] = g_savedCodesCache.name(code);
+      }
+    } else {
+      o["protocol"] = typeToString((decode_type_t)step.protocol);
+      o["value"] = uint64ToHexBits(step.value, step.bits);
+      o["bits"] = step.bits;
+    }
+    if (step.repeat) o["repeat"] = step.repeat;
+    if (step.postDelayMs) o["delay_ms"] = step.postDelayMs;
+  }
+}
+
+// Parse one sequence stored by older firmware (JSON) into the table.
+// Unreadable entries load as empty sequences, keeping the order of the
+// "s<N>" keys. Must be called with SavedCodesLock held.
+static void appendCachedSequence(JsonDocument &entry) {
+  const char *name = entry["name"] | "";
+  SavedSequenceTable::Step steps[IrSender::kMaxSequenceSteps];
+  size_t count = 0;
+  if (parseSequenceSteps(entry["steps"].as<JsonArrayConst>(), true, steps, count) != nullptr) {
+    printf("[IR] Stored sequence \"%s\" is invalid; loading it empty\n", name);
+    count = 0;
+  }
+  g_sequencesCache.add(name, steps, count);
+}
+
+// Check the result of storing a change to the saved codes. Must be called
+// with SavedCodesLock held. On failure the cache is marked stale, so the next
+// access reloads what the store still holds.
+static bool persisted(bool stored) {
+  if (!stored) {
+    printf("[IR] Failed to store saved codes (%s full?)\n", g_codeStore.name());
+    g_cacheLoaded = false;
+  }
+  return stored;
+}
+
+// persisted() for a change journaled with one of the store's change hooks:
+// on success the commit task is told, and commits it once the debounce
+// allows. Must be called with SavedCodesLock held.
+static bool journaled(bool stored) {
+  if (!persisted(stored)) return false;
+  g_codeCommitter.changed(millis());
+  g_commitTask.notify();
+  return true;
+}
+
+// Load codes stored by older firmware, one JSON string per key "0".."n-1".
+// Must be called with SavedCodesLock held and the namespace open.
+static void loadLegacySavedCodes(int n) {
+  g_savedCodesCache.reserve(n, n * 32);
   for (int i = 0; i < n; i++) {
     char keyBuf[16];
     snprintf(keyBuf, sizeof(keyBuf), "%d", i);
     String raw = savedCodes.getString(keyBuf, "{}");
     JsonDocument entry;
     deserializeJson(entry, raw);
-    String name = entry["name"] | "";
-    g_savedCodesCache.push_back({raw, name});
+    appendCachedCode(entry);
+  }
+}
+
+// Load sequences stored by older firmware, one JSON string per key
+// "s0".."s<sn-1>". Must be called with SavedCodesLock held and the namespace
+// open.
+static void loadLegacySequences(int sn) {
+  g_sequencesCache.clear();
+  for (int i = 0; i < sn; i++) {
+    char keyBuf[16];
+    snprintf(keyBuf, sizeof(keyBuf), "s%d", i);
+    String raw = savedCodes.getString(keyBuf, "{}");
+    JsonDocument entry;
+    deserializeJson(entry, raw);
+    appendCachedSequence(entry);
+  }
+}
+
+// Move codes and sequences from an older format into the store: legacy
+// per-key codes (n of them) and sequences (sn), or, for the file store, the
+// NVS blob (nvsBlob). The store is written first and the old data removed
+// only once it is in place (a failed or interrupted migration is retried on
+// the next boot). Also clears keys left over from a migration that stored
+// them but did not get to remove them. Must be called with SavedCodesLock
+// held; in practice it runs from setupStorage(), before the commit task
+// starts.
+static void migrateLegacySavedCodes(int n, int sn, bool stored, bool nvsBlob) {
+  if (!stored && !persisted(g_codeStore.save(g_savedCodesCache, g_sequencesCache))) {
+    g_cacheLoaded = true;  // keep serving the legacy codes and sequences
+    return;
+  }
+  savedCodes.begin(SAVED_CODES_NAMESPACE, false);
+  for (int i = 0; i < n; i++) {
+    char keyBuf[16];
+    snprintf(keyBuf, sizeof(keyBuf), "%d", i);
+    savedCodes.remove(keyBuf);
+  }
+  if (n > 0) savedCodes.remove("n");
+  for (int i = 0; i < sn; i++) {
+    char keyBuf[16];
+    snprintf(keyBuf, sizeof(keyBuf), "s%d", i);
+    savedCodes.remove(keyBuf);
+  }
+  if (sn > 0) savedCodes.remove("sn");
+  if (nvsBlob) {
+    savedCodes.remove(SAVED_CODES_BLOB_KEY);
+    savedCodes.remove(SAVED_CODES_JOURNAL_KEY);
+  }
+  savedCodes.end();
+  printf("[IR] Migrated %u saved codes and %u sequences to %s\n", (unsigned)g_savedCodesCache.size(),
+         (unsigned)g_sequencesCache.size(), g_codeStore.name());
+}
+
+// Must be called with SavedCodesLock held.
+static void ensureCacheLoaded() {
+  if (g_cacheLoaded) return;
+  g_savedCodesCache.setPreEncode(IR_SEND_PREENCODE != 0);
+  g_savedCodesCache.clear();
+  g_savedCodesCache.shrinkToFit();
+  g_cacheLoadHeap.freeBefore = ESP.getFreeHeap();
+  g_cacheLoadHeap.largestBefore = ESP.getMaxAllocHeap();
+  bool stored = g_codeStore.load(g_savedCodesCache, g_sequencesCache);
+  bool nvsBlob = false;
+#if SAVED_CODES_STORE_LITTLEFS
+  // Codes and sequences saved by an NVS build move to the file store
+  if (!stored) {
+    SavedCodeStoreNvs nvs(SAVED_CODES_NAMESPACE, SAVED_CODES_BLOB_KEY, SAVED_CODES_JOURNAL_KEY);
+    nvsBlob = nvs.load(g_savedCodesCache, g_sequencesCache);
+  }
+#endif
+  savedCodes.begin(SAVED_CODES_NAMESPACE, true);
+  int n = savedCodes.getInt("n", 0);
+  if (!stored && !nvsBlob) {
+    g_savedCodesCache.clear();
+    loadLegacySavedCodes(n);
   }
+  // Sequences kept in "s<N>" keys by older firmware; once the store holds
+  // sequences, any such keys are leftovers of a migration
+  int sn = savedCodes.getInt("sn", 0);
+  bool legacySequences = sn > 0 && g_sequencesCache.size() == 0;
+  if (legacySequences) loadLegacySequences(sn);
   savedCodes.end();
+  g_savedCodesCache.shrinkToFit();
+  g_cacheLoadHeap.freeAfter = ESP.getFreeHeap();
+  g_cacheLoadHeap.largestAfter = ESP.getMaxAllocHeap();
+  printf("[IR] Loaded %u saved codes from %s: %u B cache, heap free %u -> %u B, largest block %u -> %u B\n",
+         (unsigned)g_savedCodesCache.size(), g_codeStore.name(), (unsigned)g_savedCodesCache.memoryBytes(),
+         (unsigned)g_cacheLoadHeap.freeBefore, (unsigned)g_cacheLoadHeap.freeAfter,
+         (unsigned)g_cacheLoadHeap.largestBefore, (unsigned)g_cacheLoadHeap.largestAfter);
   g_cacheLoaded = true;
+  // Changes journaled before a reboot are committed like new ones
+  if (g_codeStore.pendingChanges() > 0) g_codeCommitter.changed(millis());
+  if (n > 0 || sn > 0 || nvsBlob) migrateLegacySavedCodes(n, sn, stored && !legacySequences, nvsBlob);
+}
+
+// Fold the journaled changes into a new snapshot, when the committer says
+// they are due or when forced. The table is locked only to take the snapshot
+// and to trim the journal; the slow write in between runs unlocked, so
+// lookups, sends and new changes go on meanwhile. Returns false if the
+// commit failed (the journal still holds every change); `changes` gets the
+// number committed.
+static bool commitSavedCodes(bool force, size_t *changes = nullptr) {
+  if (changes) *changes = 0;
+  SavedCodesLock commitLock(savedCodesCommitMutex);
+  if (!commitLock) return false;
+  SavedCodeStore::Commit commit;
+  uint32_t start;
+  {
+    SavedCodesLock lock;
+    if (!lock) return false;
+    ensureCacheLoaded();
+    if (g_codeStore.pendingChanges() == 0) {
+      g_codeCommitter.clear();
+      return true;
+    }
+    start = millis();
+    if (!force && g_codeCommitter.dueInMs(start, g_codeStore.commitDue()) != 0) return true;
+    if (!g_codeStore.beginCommit(g_savedCodesCache, g_sequencesCache, commit)) {
+      g_codeCommitter.committed(start, millis(), false, true);
+      return false;
+    }
+  }
+  bool ok = g_codeStore.writeCommit(commit);
+  SavedCodesLock lock;
+  if (ok && lock) g_codeStore.endCommit(commit);
+  uint32_t took = millis() - start;
+  g_codeCommitter.committed(start, start + took, ok, g_codeStore.pendingChanges() > 0);
+  if (ok) {
+    printf("[IR] Committed %u saved code changes to %s (%u B) in %u ms\n", (unsigned)commit.changes,
+           g_codeStore.name(), (unsigned)commit.blob.size(), (unsigned)took);
+    if (changes) *changes = commit.changes;
+  }
+  return ok;
+}
+
+// Commit task: sleeps until the committer says changes are due.
+static void savedCommitTaskLoop(void *) {
+  while (g_commitTask.running()) {
+    uint32_t due = SavedCodeCommitter::kIdle;
+    {
+      SavedCodesLock lock;
+      if (lock) due = g_codeCommitter.dueInMs(millis(), g_codeStore.commitDue());
+    }
+    if (due == SavedCodeCommitter::kIdle) {
+      g_commitTask.wait();
+    } else if (due > 0) {
+      uint32_t wake = g_commitTask.nowMs();
+      g_commitTask.delayUntil(wake, due);
+    } else {
+      commitSavedCodes(false);
+    }
+  }
 }
 
 int getSavedCount() {
@@ -150,27 +488,39 @@ int getSavedCount() {
   return (int)g_savedCodesCache.size();
 }
 
-// Build the JSON array of all saved codes (shared by HTTP and BLE).
-String getSavedCodesJson() {
-  SavedCodesLock lock;
-  if (!lock) return "[]";
-  ensureCacheLoaded();
-  int n = (int)g_savedCodesCache.size();
-  JsonDocument doc;
-  JsonArray arr = doc.to<JsonArray>();
-  for (int i = 0; i < n; i++) {
-    JsonObject obj = arr.add<JsonObject>();
-    JsonDocument entry;
-    deserializeJson(entry, g_savedCodesCache[i].raw);
-    obj["index"] = i;
-    obj["name"] = entry["name"].as<const char *>();
-    obj["protocol"] = entry["protocol"].as<const char *>();
-    obj["value"] = entry["value"].as<const char *>();
-    obj["bits"] = entry["bits"].as<uint16_t>();
+// A response body built from the saved codes, kept until they change (the
+// table's generation moves on) so polling clients get it without a rebuild.
+// Bodies over SAVED_BODY_CACHE_MAX are not held: /saved and /dump stream them
+// from the table instead. Only touched under SavedCodesLock.
+struct SavedBodyCache {
+  uint32_t generation = 0;
+  std::shared_ptr<const String> body;  // null when nothing is held
+  uint32_t hits = 0;
+  uint32_t misses = 0;
+  uint32_t notModified = 0;  // 304 replies: the client's copy was current
+};
+static SavedBodyCache g_savedJsonBody;     // GET /saved
+static SavedBodyCache g_savedCompactBody;  // BLE saved-codes list
+static SavedBodyCache g_savedDumpBody;     // GET /dump
+
+// The cached body if it is still current, else null (a miss). Must be called
+// with SavedCodesLock held and the cache loaded.
+static std::shared_ptr<const String> currentSavedBody(SavedBodyCache &cache) {
+  if (cache.body && cache.generation == g_savedCodesCache.generation()) {
+    cache.hits++;
+    return cache.body;
   }
-  String out;
-  serializeJson(doc, out);
-  return out;
+  cache.misses++;
+  cache.body.reset();
+  return nullptr;
+}
+
+// Keep a freshly built body for the current generation if it is small enough.
+static std::shared_ptr<const String> storeSavedBody(SavedBodyCache &cache, String body) {
+  auto shared = std::make_shared<const String>(std::move(body));
+  cache.generation = g_savedCodesCache.generation();
+  if (shared->length() <= SAVED_BODY_CACHE_MAX) cache.body = shared;
+  return shared;
 }
 
 // Compact JSON for BLE only (index + name, short keys) to stay under 600-byte characteristic limit.
@@ -178,10 +528,8 @@ String getSavedCodesJson() {
 static const size_t BLE_SAVED_CODES_MAX_LEN = 590;
 // Reserve for truncation sentinel: ,{"i":-1,"n":"","_truncated":true,"_total":NNN} + ']'
 static const size_t BLE_SAVED_TRUNCATED_SUFFIX_LEN = 50;
-String getSavedCodesJsonCompact() {
-  SavedCodesLock lock;
-  if (!lock) return "[]";
-  ensureCacheLoaded();
+// Must be called with SavedCodesLock held.
+static String buildSavedCodesJsonCompact() {
   int n = (int)g_savedCodesCache.size();
   String out;
   out.reserve(BLE_SAVED_CODES_MAX_LEN);
@@ -192,15 +540,15 @@ String getSavedCodesJsonCompact() {
   char fragBuf[256];
 
   for (; i < n; i++) {
-    // Avoid full JSON deserialization by using the pre-parsed cached name
-    const char *name = g_savedCodesCache[i].name.c_str();
+    const char *name = g_savedCodesCache.name(i);
 
     int len = 0;
     if (out.length() > 1) {
       fragBuf[len++] = ',';
     }
 
-    len += snprintf(fragBuf + len, sizeof(fragBuf) - len, "{\"i\":%d,\"n\":\"", i);
+    len += snprintf(fragBuf + len, sizeof(fragBuf) - len, "{\"i\":%d,\"id\":%u,\"n\":\"", i,
+                    (unsigned)g_savedCodesCache.at(i).id);
 
     const char *p = name;
     // Keep 10 bytes margin in buffer for escapes and ending characters
@@ -255,24 +603,41 @@ String getSavedCodesJsonCompact() {
   return out;
 }
 
+String getSavedCodesJsonCompact() {
+  SavedCodesLock lock;
+  if (!lock) return "[]";
+  ensureCacheLoaded();
+  std::shared_ptr<const String> body = currentSavedBody(g_savedCompactBody);
+  if (!body) body = storeSavedBody(g_savedCompactBody, buildSavedCodesJsonCompact());
+  return *body;
+}
+
+// Index of the saved code with stable id `id`. Returns -1 if not found.
+int getSavedCodeIndexById(uint16_t id) {
+  SavedCodesLock lock;
+  if (!lock) return -1;
+  ensureCacheLoaded();
+  return g_savedCodesCache.indexOfId(id);
+}
+
 // Find first saved code index whose name matches (case-insensitive). Returns -1 if not found.
 int getSavedCodeIndexByName(const char *name) {
   if (!name || !*name) return -1;
   SavedCodesLock lock;
   if (!lock) return -1;
   ensureCacheLoaded();
-  for (size_t i = 0; i < g_savedCodesCache.size(); i++) {
-    if (strcasecmp(g_savedCodesCache[i].name.c_str(), name) == 0) {
-      return (int)i;
-    }
-  }
-  return -1;
+  return g_savedCodesCache.indexOfName(name);
 }
 
 // Send a stored IR code by NVS index.  Shared by HTTP, WebSocket, and BLE.
-// Returns true on success; fills outName with the code's stored name.
-bool sendSavedCode(int index, String &outName) {
-  String raw;
+// Codes with captured or pre-encoded timings go out through the raw send path.
+// Returns true on success; fills outName with the code's stored name and
+// outJobId (if given) with the IrSender job id.
+bool sendSavedCode(int index, String &outName, uint32_t *outJobId = nullptr) {
+  SavedCodeTable::Entry code;
+  bool sendable;
+  IrSender::Submission queued = {IrSender::Admission::RejectedFull, 0};
+  int repeat = IR_SEND_REPEAT;
   {
     SavedCodesLock lock;
     if (!lock) {
@@ -284,36 +649,84 @@ bool sendSavedCode(int index, String &outName) {
       outName = "";
       return false;
     }
-    raw = g_savedCodesCache[index].raw;
+    code = g_savedCodesCache.at(index);
+    sendable = g_savedCodesCache.isSendable(index) || g_savedCodesCache.hasTimings(index);
+    outName = g_savedCodesCache.name(index);
+    if (code.repeat) repeat = code.repeat;
+    // queueRaw() copies the timings, so it has to run before the lock is released
+    if (g_savedCodesCache.hasTimings(index)) {
+      queued = irSender.queueRaw((decode_type_t)code.protocol, g_savedCodesCache.timings(index),
+                                 code.timingsCount, code.carrierKHz, repeat);
+    }
   }
 
-  JsonDocument entry;
-  DeserializationError err = deserializeJson(entry, raw);
-  if (err) {
-    outName = "";
+  if (!sendable) {
+    printf("[IR] Saved code #%d is not sendable (protocol or value)\n", index);
+    return false;
+  }
+  if (code.timingsCount == 0) {
+    queued = irSender.queue((decode_type_t)code.protocol, code.value, code.bits, repeat);
+  }
+  if (!queued) {
+    printf("[IR] TX queue full; dropped saved code #%d\n", index);
     return false;
   }
+  if (outJobId) *outJobId = queued.jobId;
+  printf("[IR] TX saved #%d %db x%d job %u %s (%s)\n", index, code.bits, repeat, (unsigned)queued.jobId,
+         IrSender::admissionName(queued.admission), outName.length() ? outName.c_str() : "no name");
+  return true;
+}
 
-  outName = entry["name"] | "";
-  const char *protocol = entry["protocol"] | "";
-  const char *valueHex = entry["value"] | "";
-  uint16_t bits = entry["bits"] | 32;
-
-  if (String(protocol).equalsIgnoreCase("NEC") && strlen(valueHex) > 0) {
-    uint32_t value;
-    if (parseHex32(valueHex, value)) {
-      irSender.queue(value, bits, IR_SEND_REPEAT);
-      printf("[IR] TX NEC 0x%s %db x%d (%s)\n", valueHex, bits, IR_SEND_REPEAT,
-             outName.length() ? outName.c_str() : "no name");
-      return true;
+int getSequenceIndexByName(const char *name) {
+  SavedCodesLock lock;
+  if (!lock) return -1;
+  ensureCacheLoaded();
+  return g_sequencesCache.indexOf(name);
+}
+
+// Queue a stored sequence as one IrSender job.  Shared by HTTP, WebSocket, and BLE.
+// Returns true on success; fills outName with the sequence name, outJobId
+// (if given) with the IrSender job id and, on failure, outError (if given)
+// with the reason.
+bool sendSequence(int index, String &outName, const char **outError, uint32_t *outJobId = nullptr) {
+  IrSender::SequenceStep steps[IrSender::kMaxSequenceSteps];
+  size_t count = 0;
+  const char *error = nullptr;
+  {
+    SavedCodesLock lock;
+    if (!lock) {
+      error = "Storage unavailable";
     } else {
-      printf("[IR] Invalid or out-of-range hex value for saved code #%d: %s\n", index, valueHex);
-      return false;
+      ensureCacheLoaded();
+      if (index < 0 || index >= (int)g_sequencesCache.size()) {
+        error = "Invalid index";
+      } else {
+        outName = g_sequencesCache.name(index);
+        count = g_sequencesCache.resolve(index, g_savedCodesCache, IR_SEND_REPEAT, steps);
+      }
     }
   }
 
-  printf("[IR] Unsupported protocol for saved code #%d: %s\n", index, protocol);
-  return false;
+  if (!error && count == 0) {
+    printf("[IR] Sequence #%d has no sendable steps\n", index);
+    error = "No sendable steps";
+  }
+  IrSender::Submission queued = {IrSender::Admission::RejectedInvalid, 0};
+  if (!error) {
+    queued = irSender.queueSequence(steps, count);
+    if (!queued) {
+      printf("[IR] TX queue full; dropped sequence #%d\n", index);
+      error = "IR queue full";
+    }
+  }
+  if (error) {
+    if (outError) *outError = error;
+    return false;
+  }
+  if (outJobId) *outJobId = queued.jobId;
+  printf("[IR] TX sequence #%d, %u steps, job %u (%s)\n", index, (unsigned)count, (unsigned)queued.jobId,
+         outName.length() ? outName.c_str() : "no name");
+  return true;
 }
 
 // Template processor for LittleFS pages — replaces %PLACEHOLDER% tokens.
@@ -348,6 +761,7 @@ static bool accumulateBody(AsyncWebServerRequest *request, uint8_t *data, size_t
 }
 
 // POST /save — body JSON: { "name": "Power", "protocol": "NEC", "value": "FF827D", "bits": 32 }
+// or captured timings instead of a value: { "name", "protocol", "raw": [9000, 4500, ...], "khz": 38 }
 // Body handler accumulates and processes when complete.
 void onSaveBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
   String body;
@@ -365,11 +779,22 @@ void onSaveBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_
   const char *protocol = doc["protocol"] | "UNKNOWN";
   const char *valueHex = doc["value"];
   uint16_t bits = doc["bits"] | 32;
-  if (bits < 1 || bits > 128) {
+  bool hasRaw = doc["raw"].is<JsonArray>();
+  if (!hasRaw && (bits < 1 || bits > 128)) {
     request->send(400, "application/json", "{\"error\":\"Invalid bits\"}");
     return;
   }
-  if (!valueHex) {
+  if (hasRaw) {
+    size_t count = 0;
+    const char *rawError = parseRawTimings(doc["raw"].as<JsonArrayConst>(), nullptr, count);
+    uint16_t khz = doc["khz"] | 38;
+    if (!rawError && (khz < 10 || khz > 500)) rawError = "Invalid khz";
+    if (rawError) {
+      request->send(400, "application/json", String("{\"error\":\"") + rawError + "\"}");
+      return;
+    }
+  }
+  if (!valueHex && !hasRaw) {
     request->send(400, "application/json", "{\"error\":\"Missing value\"}");
     return;
   }
@@ -379,146 +804,307 @@ void onSaveBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_
     return;
   }
   ensureCacheLoaded();
-  savedCodes.begin(SAVED_CODES_NAMESPACE, false);
   int n = (int)g_savedCodesCache.size();
-  JsonObject obj = doc.to<JsonObject>();
-  obj["name"] = name;
-  obj["protocol"] = protocol;
-  obj["value"] = valueHex;
-  obj["bits"] = bits;
-  if (measureJson(doc) >= SAVED_CODE_MAX) {
-    savedCodes.end();
-    request->send(413, "application/json", "{\"error\":\"Code too large\"}");
-    return;
-  }
-  char buf[SAVED_CODE_MAX];
-  serializeJson(doc, buf, sizeof(buf));
-  char keyBuf[16];
-  snprintf(keyBuf, sizeof(keyBuf), "%d", n);
-  savedCodes.putString(keyBuf, buf);
-  savedCodes.putInt("n", n + 1);
-  savedCodes.end();
-  g_savedCodesCache.push_back({String(buf), String(doc["name"] | "")});
-  request->send(200, "application/json", "{\"ok\":true,\"index\":" + String(n) + ",\"total\":" + String(n + 1) + "}");
+  JsonDocument entry;
+  entry["name"] = name;
+  entry["protocol"] = protocol;
+  entry["value"] = valueHex ? valueHex : "";
+  entry["bits"] = bits;
+  if (hasRaw) {
+    entry["raw"] = doc["raw"];
+    entry["khz"] = doc["khz"] | 38;
+  }
+  appendCachedCode(entry);
+  bool stored = journaled(g_codeStore.appended(g_savedCodesCache, g_sequencesCache));
+  if (!stored) {
+    request->send(507, "application/json", "{\"error\":\"Storage full\"}");
+    return;
+  }
+  request->send(200, "application/json", "{\"ok\":true,\"index\":" + String(n) + ",\"id\":" +
+                String(g_savedCodesCache.at(n).id) + ",\"total\":" + String(n + 1) + "}");
 }
 
-static bool parseAndValidateImport(const String &body, JsonDocument &inputDoc, String &errorMsg) {
-  DeserializationError err = deserializeJson(inputDoc, body);
-  if (err) {
-    errorMsg = "{\"ok\":false,\"error\":\"Invalid JSON\"}";
-    return false;
-  }
-  if (!inputDoc.is<JsonArray>()) {
-    errorMsg = "{\"ok\":false,\"error\":\"Expected JSON array\"}";
-    return false;
+// One POST /saved/import while its body streams in: array elements are parsed
+// and validated one at a time and the valid ones staged here, so RAM holds the
+// staged codes plus one element, never the whole body.
+struct SavedImport {
+  JsonArrayStream stream{SAVED_IMPORT_ENTRY_MAX};
+  SavedCodeTable staged;
+  int skipped = 0;
+  JsonDocument errors;
+};
+
+static void skipImportEntry(SavedImport &import, size_t index, const char *reason) {
+  import.skipped++;
+  if (import.errors.size() < 12) {
+    JsonObject e = import.errors.add<JsonObject>();
+    e["index"] = (int)index;
+    e["reason"] = reason;
   }
-  return true;
 }
 
-static bool saveImportedCodes(JsonArray in, JsonDocument &outDoc) {
-  outDoc["ok"] = true;
-  outDoc["imported"] = 0;
-  outDoc["skipped"] = 0;
-  JsonArray errors = outDoc["errors"].to<JsonArray>();
+static void stageImportEntry(SavedImport &import, size_t index, const char *json, size_t len) {
+  if (!json) {
+    skipImportEntry(import, index, "Entry too large");
+    return;
+  }
+  if (import.staged.size() >= SAVED_IMPORT_CODES_MAX) {
+    skipImportEntry(import, index, "Too many codes");
+    return;
+  }
+  JsonDocument doc;
+  if (deserializeJson(doc, json, len)) {
+    skipImportEntry(import, index, "Invalid JSON");
+    return;
+  }
+  if (!doc.is<JsonObject>()) {
+    skipImportEntry(import, index, "Entry is not an object");
+    return;
+  }
 
+  const char *name = doc["name"] | "";
+  const char *protocol = doc["protocol"] | "";
+  const char *valueHex = doc["value"] | "";
+  uint16_t bits = doc["bits"] | 32;
+
+  const char *reason = nullptr;
+  if (!*protocol) reason = "Missing protocol";
+  else if (!*valueHex) reason = "Missing value";
+  else if (!isHexValue(valueHex)) reason = "Value must be hex";
+  else if (bits < 1 || bits > 64) reason = "Bits out of range";
+  if (reason) {
+    skipImportEntry(import, index, reason);
+    return;
+  }
+  decode_type_t type;
+  if (!parseSendableProtocol(protocol, type)) type = decode_type_t::UNKNOWN;
+  import.staged.append(name, protocol, type, valueHex, bits, 0);
+}
+
+// Append the staged codes and store the table with one snapshot write, so
+// either all of them are saved or (on a failed write, which reloads the cache
+// from the store) none. Returns the HTTP status: 200, 500 (storage
+// unavailable) or 507 (storage full, nothing imported).
+static int commitSavedImport(SavedImport &import, JsonDocument &outDoc) {
+  SavedCodesLock commitLock(savedCodesCommitMutex);
   SavedCodesLock lock;
-  if (!lock) return false;
+  if (!commitLock || !lock) return 500;
 
   ensureCacheLoaded();
-  savedCodes.begin(SAVED_CODES_NAMESPACE, false);
-  int n = (int)g_savedCodesCache.size();
+  const SavedCodeTable &staged = import.staged;
+  for (size_t i = 0; i < staged.size(); i++) {
+    const SavedCodeTable::Entry &e = staged.at(i);
+    g_savedCodesCache.append(staged.name(i), staged.protocolName(i), (decode_type_t)e.protocol,
+                             staged.valueText(i), e.bits, 0);
+  }
+  if (staged.size() > 0) {
+    // The snapshot also holds every change journaled so far
+    uint32_t start = millis();
+    if (!persisted(g_codeStore.save(g_savedCodesCache, g_sequencesCache))) return 507;
+    g_codeCommitter.committed(start, millis(), true, false);
+    g_savedCodesCache.shrinkToFit();
+  }
+  outDoc["ok"] = true;
+  outDoc["imported"] = (int)staged.size();
+  outDoc["skipped"] = import.skipped;
+  outDoc["errors"] = import.errors.as<JsonArray>();
+  outDoc["total"] = (int)g_savedCodesCache.size();
+  return 200;
+}
 
-  const int maxErrors = 12;
-  for (size_t i = 0; i < in.size(); i++) {
-    JsonVariant v = in[i];
-    if (!v.is<JsonObject>()) {
-      outDoc["skipped"] = (int)outDoc["skipped"] + 1;
-      if ((int)errors.size() < maxErrors) {
-        JsonObject e = errors.add<JsonObject>();
-        e["index"] = (int)i;
-        e["reason"] = "Entry is not an object";
-      }
-      continue;
-    }
+static void endSavedImport(AsyncWebServerRequest *request) {
+  delete (SavedImport *)request->_tempObject;
+  request->_tempObject = nullptr;
+}
 
-    JsonObject src = v.as<JsonObject>();
-    const char *name = src["name"] | "";
-    const char *protocol = src["protocol"] | "";
-    const char *valueHex = src["value"] | "";
-    uint16_t bits = src["bits"] | 32;
-
-    const char *reason = nullptr;
-    if (!protocol || !*protocol) reason = "Missing protocol";
-    else if (!valueHex || !*valueHex) reason = "Missing value";
-    else if (!isHexValue(valueHex)) reason = "Value must be hex";
-    else if (bits < 1 || bits > 64) reason = "Bits out of range";
-
-    if (reason) {
-      outDoc["skipped"] = (int)outDoc["skipped"] + 1;
-      if ((int)errors.size() < maxErrors) {
-        JsonObject e = errors.add<JsonObject>();
-        e["index"] = (int)i;
-        e["reason"] = reason;
-      }
-      continue;
+// POST /saved/import — body JSON array of { "name", "protocol", "value", "bits" }.
+// Appends valid entries to the saved codes and skips invalid entries with a summary.
+// The body is parsed as it arrives; nothing is stored unless it is a complete
+// JSON array.
+void onSavedImportBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+  if (total > SAVED_IMPORT_BODY_MAX) {
+    if (index == 0) request->send(413, "application/json", "{\"ok\":false,\"error\":\"Payload too large\"}");
+    return;
+  }
+  SavedImport *import = (SavedImport *)request->_tempObject;
+  if (import == nullptr) {
+    if (index != 0) return;  // already answered
+    import = new SavedImport();
+    import->errors.to<JsonArray>();
+    request->_tempObject = import;
+    // The server frees _tempObject without running destructors
+    request->onDisconnect([request]() { endSavedImport(request); });
+  }
+
+  JsonArrayStream::Status st = import->stream.feed((const char *)data, len, [import](size_t i, const char *json, size_t n) {
+    stageImportEntry(*import, i, json, n);
+  });
+  if (st == JsonArrayStream::Status::Error) {
+    request->send(400, "application/json", String("{\"ok\":false,\"error\":\"") + import->stream.error() + "\"}");
+    endSavedImport(request);
+    return;
+  }
+  if (index + len != total) return;
+  if (st != JsonArrayStream::Status::Done) {
+    request->send(400, "application/json", "{\"ok\":false,\"error\":\"Invalid JSON\"}");
+    endSavedImport(request);
+    return;
+  }
+
+  JsonDocument outDoc;
+  int status = commitSavedImport(*import, outDoc);
+  printf("[IR] Import: %u staged, %d skipped, status %d\n", (unsigned)import->staged.size(), import->skipped, status);
+  endSavedImport(request);
+  if (status == 500) {
+    request->send(500, "application/json", "{\"ok\":false,\"error\":\"Storage unavailable\"}");
+    return;
+  }
+  if (status == 507) {
+    request->send(507, "application/json", "{\"ok\":false,\"error\":\"Storage full\"}");
+    return;
+  }
+
+  String out;
+  serializeJson(outDoc, out);
+  request->send(200, "application/json", out);
+}
+
+// GET /saved/backup — every saved code and sequence as one binary image
+// (format in include/saved_backup.h). The image is produced from the cache as
+// the client reads it, never held whole. If the codes or sequences change
+// while it is being sent, the rest of it is zeros, so its CRC check fails.
+struct SavedBackupStream {
+  SavedBackupWriter writer{g_savedCodesCache, g_sequencesCache};
+  uint32_t codesGeneration = g_savedCodesCache.generation();
+  uint32_t sequencesGeneration = g_sequencesCache.generation();
+  bool stale = false;
+};
+
+// Next bytes of a backup being sent, from offset `index`.
+static size_t fillSavedBackup(SavedBackupStream &backup, uint8_t *buf, size_t maxLen, size_t index) {
+  {
+    SavedCodesLock lock;
+    if (lock && !backup.stale && backup.codesGeneration == g_savedCodesCache.generation() &&
+        backup.sequencesGeneration == g_sequencesCache.generation()) {
+      return backup.writer.read(buf, maxLen);
     }
+  }
+  if (!backup.stale) printf("[IR] Saved codes changed during a backup; sending the rest as zeros\n");
+  backup.stale = true;
+  size_t n = backup.writer.size() - index;
+  if (n > maxLen) n = maxLen;
+  memset(buf, 0, n);
+  return n;
+}
 
-    JsonDocument entry;
-    entry["name"] = name;
-    entry["protocol"] = protocol;
-    entry["value"] = valueHex;
-    entry["bits"] = bits;
-
-    if (measureJson(entry) >= SAVED_CODE_MAX) {
-      outDoc["skipped"] = (int)outDoc["skipped"] + 1;
-      if ((int)errors.size() < maxErrors) {
-        JsonObject e = errors.add<JsonObject>();
-        e["index"] = (int)i;
-        e["reason"] = "Entry too large";
-      }
-      continue;
+void handleSavedBackup(AsyncWebServerRequest *request) {
+  std::shared_ptr<SavedBackupStream> backup;
+  {
+    SavedCodesLock lock;
+    if (!lock) {
+      request->send(500, "application/json", "{\"error\":\"Storage unavailable\"}");
+      return;
     }
-    char buf[SAVED_CODE_MAX];
-    serializeJson(entry, buf, sizeof(buf));
+    ensureCacheLoaded();
+    backup = std::make_shared<SavedBackupStream>();
+  }
+  AsyncWebServerResponse *response = request->beginResponse("application/octet-stream", backup->writer.size(),
+      [backup](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+        return fillSavedBackup(*backup, buf, maxLen, index);
+      });
+  response->addHeader("Content-Disposition", "attachment; filename=\"ir-backup.bin\"");
+  request->send(response);
+}
 
-    char keyBuf[16];
-    snprintf(keyBuf, sizeof(keyBuf), "%d", n);
-    savedCodes.putString(keyBuf, buf);
-    g_savedCodesCache.push_back({String(buf), String(entry["name"] | "")});
-    n++;
-    outDoc["imported"] = (int)outDoc["imported"] + 1;
+// One POST /saved/restore while its body streams in: the image is applied to
+// staged tables element by element, so RAM holds the staged codes plus one
+// element, and replaces the live ones only once it is complete and its CRC
+// matches.
+struct SavedRestore {
+  SavedCodeTable codes;
+  SavedSequenceTable sequences;
+  SavedBackupReader reader{codes, sequences};
+};
+
+static void endSavedRestore(AsyncWebServerRequest *request) {
+  delete (SavedRestore *)request->_tempObject;
+  request->_tempObject = nullptr;
+}
+
+// Replace the saved codes and sequences with the restored ones and store
+// both with one snapshot write, so either all of the image is saved or (on
+// a failed write, which reloads the old codes and sequences from storage)
+// none. Returns the HTTP status like commitSavedImport().
+static int commitSavedRestore(SavedRestore &restore, JsonDocument &outDoc) {
+  SavedCodesLock commitLock(savedCodesCommitMutex);
+  SavedCodesLock lock;
+  if (!commitLock || !lock) return 500;
+
+  ensureCacheLoaded();
+  g_savedCodesCache.take(restore.codes);
+  g_sequencesCache.clear();
+  for (size_t i = 0; i < restore.sequences.size(); i++) {
+    size_t steps = restore.sequences.stepCount(i);
+    g_sequencesCache.add(restore.sequences.name(i), steps ? &restore.sequences.step(i, 0) : nullptr, steps);
   }
+  uint32_t start = millis();
+  if (!persisted(g_codeStore.save(g_savedCodesCache, g_sequencesCache))) return 507;
+  g_codeCommitter.committed(start, millis(), true, false);
+  g_savedCodesCache.shrinkToFit();
 
-  savedCodes.putInt("n", n);
-  savedCodes.end();
-  outDoc["total"] = n;
-  return true;
+  outDoc["ok"] = true;
+  outDoc["codes"] = (int)g_savedCodesCache.size();
+  outDoc["sequences"] = (int)g_sequencesCache.size();
+  return 200;
 }
 
-// POST /saved/import — body JSON array of { "name", "protocol", "value", "bits" }.
-// Appends valid entries to NVS and skips invalid entries with a summary.
-void onSavedImportBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-  String body;
-  if (!accumulateBody(request, data, len, index, total, 10240, "{\"ok\":false,\"error\":\"Payload too large\"}", body)) {
+// POST /saved/restore — body: an image from GET /saved/backup. Replaces all
+// saved codes (keeping their ids) and sequences once the whole image is in
+// and its CRC matches; nothing changes otherwise.
+void onSavedRestoreBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+  if (total > SAVED_RESTORE_BODY_MAX) {
+    if (index == 0) request->send(413, "application/json", "{\"ok\":false,\"error\":\"Payload too large\"}");
     return;
   }
+  SavedRestore *restore = (SavedRestore *)request->_tempObject;
+  if (restore == nullptr) {
+    if (index != 0) return;  // already answered
+    restore = new SavedRestore();
+    restore->codes.setPreEncode(IR_SEND_PREENCODE != 0);
+    request->_tempObject = restore;
+    // The server frees _tempObject without running destructors
+    request->onDisconnect([request]() { endSavedRestore(request); });
+  }
 
-  JsonDocument inputDoc;
-  String errorMsg;
-  if (!parseAndValidateImport(body, inputDoc, errorMsg)) {
-    request->send(400, "application/json", errorMsg);
+  SavedBackupReader::Status st = restore->reader.feed(data, len);
+  if (st == SavedBackupReader::Status::Error) {
+    request->send(400, "application/json", String("{\"ok\":false,\"error\":\"") + restore->reader.error() + "\"}");
+    endSavedRestore(request);
+    return;
+  }
+  if (index + len != total) return;
+  if (st != SavedBackupReader::Status::Done) {
+    request->send(400, "application/json", "{\"ok\":false,\"error\":\"Truncated image\"}");
+    endSavedRestore(request);
     return;
   }
 
   JsonDocument outDoc;
-  if (!saveImportedCodes(inputDoc.as<JsonArray>(), outDoc)) {
+  int status = commitSavedRestore(*restore, outDoc);
+  printf("[IR] Restore: %u B image, status %d\n", (unsigned)total, status);
+  endSavedRestore(request);
+  if (status == 500) {
     request->send(500, "application/json", "{\"ok\":false,\"error\":\"Storage unavailable\"}");
     return;
   }
+  if (status == 507) {
+    request->send(507, "application/json", "{\"ok\":false,\"error\":\"Storage full\"}");
+    return;
+  }
 
   String out;
   serializeJson(outDoc, out);
-  request->send(200, "application/json", out);
+  request->send(status, "application/json", out);
 }
 
 // GET /save or POST with query params: save last code or specific code via query params
@@ -531,6 +1117,7 @@ void handleSaveGet(AsyncWebServerRequest *request) {
 
   String protocol, valueHex;
   uint16_t bits = 32;
+  uint16_t rawCount = 0;  // captured timings saved with the last code
   if (request->hasParam("protocol") && request->hasParam("value")) {
     protocol = request->getParam("protocol")->value();
     valueHex = request->getParam("value")->value();
@@ -555,10 +1142,11 @@ void handleSaveGet(AsyncWebServerRequest *request) {
     }
     const IrCapture &c = history[historyHead];
     protocol = c.protocol;
-    valueHex = uint64ToHex(c.value);
+    valueHex = uint64ToHexBits(c.value, c.bits);
     bits = c.bits;
+    rawCount = lastCaptureTimingsCount;
   }
-  if (bits < 1 || bits > 128) {
+  if (rawCount == 0 && (bits < 1 || bits > 128)) {
     request->send(400, "text/plain", "Invalid bits");
     return;
   }
@@ -568,83 +1156,219 @@ void handleSaveGet(AsyncWebServerRequest *request) {
     return;
   }
   ensureCacheLoaded();
-  savedCodes.begin(SAVED_CODES_NAMESPACE, false);
   int n = (int)g_savedCodesCache.size();
   JsonDocument doc;
   doc["name"] = name;
   doc["protocol"] = protocol;
   doc["value"] = valueHex;
   doc["bits"] = bits;
-  if (measureJson(doc) >= SAVED_CODE_MAX) {
-    savedCodes.end();
-    request->send(413, "application/json", "{\"error\":\"Code too large\"}");
+  if (rawCount > 0) {
+    JsonArray raw = doc["raw"].to<JsonArray>();
+    for (uint16_t k = 0; k < rawCount; k++) raw.add(lastCaptureTimings[k]);
+    doc["khz"] = 38;
+  }
+  appendCachedCode(doc);
+  bool stored = journaled(g_codeStore.appended(g_savedCodesCache, g_sequencesCache));
+  if (!stored) {
+    request->send(507, "application/json", "{\"error\":\"Storage full\"}");
     return;
   }
-  char buf[SAVED_CODE_MAX];
-  serializeJson(doc, buf, sizeof(buf));
-  char keyBuf[16];
-  snprintf(keyBuf, sizeof(keyBuf), "%d", n);
-  savedCodes.putString(keyBuf, buf);
-  savedCodes.putInt("n", n + 1);
-  savedCodes.end();
-  g_savedCodesCache.push_back({String(buf), String(doc["name"] | "")});
-  request->send(200, "application/json", "{\"ok\":true,\"index\":" + String(n) + ",\"total\":" + String(n + 1) + "}");
+  request->send(200, "application/json", "{\"ok\":true,\"index\":" + String(n) + ",\"id\":" +
+                String(g_savedCodesCache.at(n).id) + ",\"total\":" + String(n + 1) + "}");
+}
+
+// Entity tags for conditional GETs. Every tag starts with a value drawn at
+// boot, so a tag handed out before a reboot (when generations and sequence
+// numbers start over) never matches.
+static uint32_t g_bootTag = 0;
+static uint32_t g_lastNotModified = 0;  // 304 replies to GET /last
+
+// Strong ETag for a body that depends on the counters a and b.
+static String makeEtag(char kind, uint32_t a, uint32_t b = 0) {
+  char tag[40];
+  snprintf(tag, sizeof(tag), "\"%08x-%c%x-%x\"", (unsigned)g_bootTag, kind, (unsigned)a, (unsigned)b);
+  return tag;
+}
+
+// True if the request's If-None-Match names `etag` (or is "*").
+static bool etagMatches(AsyncWebServerRequest *request, const String &etag) {
+  const AsyncWebHeader *header = request->getHeader("If-None-Match");
+  if (!header) return false;
+  return header->value() == "*" || header->value().indexOf(etag) >= 0;
+}
+
+static void sendNotModified(AsyncWebServerRequest *request, const String &etag, const char *cacheControl) {
+  AsyncWebServerResponse *response = request->beginResponse(304);
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", cacheControl);
+  request->send(response);
+}
+
+// typeToString() for SavedCodeListWriter. Must be called with SavedCodesLock held.
+static const char *protocolTypeName(decode_type_t type) {
+  static String name;
+  name = typeToString(type);
+  return name.c_str();
+}
+
+// A /saved or /dump listing too big to cache, written from the cache into
+// each chunk as the client reads it. If the codes change while it is being
+// sent, the response ends early and the client sees a truncated body.
+struct SavedListingStream {
+  SavedCodeListWriter writer;
+  uint32_t generation = g_savedCodesCache.generation();
+  bool stale = false;
+  explicit SavedListingStream(SavedCodeListWriter::Format format)
+      : writer(g_savedCodesCache, format, protocolTypeName) {}
+};
+
+static size_t fillSavedListing(SavedListingStream &listing, uint8_t *buf, size_t maxLen) {
+  SavedCodesLock lock;
+  if (lock && !listing.stale && listing.generation == g_savedCodesCache.generation()) {
+    return listing.writer.read(buf, maxLen);
+  }
+  if (!listing.stale) printf("[IR] Saved codes changed during a listing; ending it early\n");
+  listing.stale = true;
+  return 0;
+}
+
+// Send the /saved or /dump listing: 304 when the client's copy (ETag from the
+// codes' generation) is current, else the cached body when it is current,
+// else one built into the cache if it fits, else streamed from the table
+// through the writer's buffer. False (nothing sent) if the storage lock is
+// unavailable.
+static bool sendSavedListing(AsyncWebServerRequest *request, SavedBodyCache &cache, char tagKind,
+                             SavedCodeListWriter::Format format, const char *contentType) {
+  std::shared_ptr<const String> body;
+  std::shared_ptr<SavedListingStream> listing;
+  String etag;
+  bool notModified;
+  {
+    SavedCodesLock lock;
+    if (!lock) return false;
+    ensureCacheLoaded();
+    etag = makeEtag(tagKind, g_savedCodesCache.generation());
+    notModified = etagMatches(request, etag);
+    if (notModified) {
+      cache.notModified++;
+    } else {
+      body = currentSavedBody(cache);
+    }
+    if (!notModified && !body) {
+      listing = std::make_shared<SavedListingStream>(format);
+      size_t len = listing->writer.size();
+      String text;
+      if (len <= SAVED_BODY_CACHE_MAX && text.reserve(len)) {
+        uint8_t buf[256];
+        for (size_t n; (n = listing->writer.read(buf, sizeof(buf))) > 0;) text.concat((const char *)buf, n);
+        body = storeSavedBody(cache, std::move(text));
+        listing.reset();
+      }
+    }
+  }
+  if (notModified) {
+    sendNotModified(request, etag, "no-cache");
+    return true;
+  }
+  AsyncWebServerResponse *response;
+  if (body) {
+    response = request->beginResponse(contentType, body->length(),
+        [body](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+          size_t n = body->length() - index;
+          if (n > maxLen) n = maxLen;
+          memcpy(buf, body->c_str() + index, n);
+          return n;
+        });
+  } else {
+    response = request->beginChunkedResponse(contentType,
+        [listing](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+          return fillSavedListing(*listing, buf, maxLen);
+        });
+  }
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+  return true;
 }
 
 // GET /saved — JSON array of saved codes
 void handleSaved(AsyncWebServerRequest *request) {
-  String out = getSavedCodesJson();
-  request->send(200, "application/json", out);
+  if (!sendSavedListing(request, g_savedJsonBody, 's', SavedCodeListWriter::Format::Json, "application/json")) {
+    request->send(200, "application/json", "[]");
+  }
 }
 
-// POST /saved/delete?index=N — remove saved code at index; shift rest down
-void handleSavedDelete(AsyncWebServerRequest *request) {
-  if (!request->hasParam("index")) {
-    request->send(400, "application/json", "{\"error\":\"Missing index\"}");
-    return;
+// The saved code a request refers to, by "id" (stable) or "index" (position
+// in the list; `key` overrides the parameter name). Returns its index, or -1
+// after replying 400. Must be called with SavedCodesLock held.
+static int savedCodeParam(AsyncWebServerRequest *request, const char *key = "index") {
+  bool byId = strcmp(key, "index") == 0 && request->hasParam("id");
+  if (byId) key = "id";
+  if (!request->hasParam(key)) {
+    request->send(400, "application/json", String("{\"error\":\"Missing ") + (strcmp(key, "index") == 0 ? "index or id" : key) + "\"}");
+    return -1;
   }
-  int index;
-  if (!parseIntStr(request->getParam("index")->value(), index)) {
+  int value;
+  if (!parseIntStr(request->getParam(key)->value(), value)) {
     request->send(400, "application/json", "{\"error\":\"Invalid index format\"}");
-    return;
+    return -1;
   }
+  ensureCacheLoaded();
+  int index = value;
+  if (byId) index = (value > 0 && value <= 0xFFFF) ? g_savedCodesCache.indexOfId((uint16_t)value) : -1;
+  if (index < 0 || index >= (int)g_savedCodesCache.size()) {
+    request->send(400, "application/json", byId ? "{\"error\":\"Unknown id\"}" : "{\"error\":\"Invalid index\"}");
+    return -1;
+  }
+  return index;
+}
+
+// POST /saved/delete?index=N or ?id=ID — remove a saved code; later indexes shift down
+void handleSavedDelete(AsyncWebServerRequest *request) {
   SavedCodesLock lock;
   if (!lock) {
     request->send(500, "application/json", "{\"error\":\"Storage unavailable\"}");
     return;
   }
-  ensureCacheLoaded();
-  savedCodes.begin(SAVED_CODES_NAMESPACE, false);
+  int index = savedCodeParam(request);
+  if (index < 0) return;
   int n = (int)g_savedCodesCache.size();
-  if (index < 0 || index >= n) {
-    savedCodes.end();
-    request->send(400, "application/json", "{\"error\":\"Invalid index\"}");
+  uint16_t id = g_savedCodesCache.at(index).id;
+  // Sequences refer to codes by id; their steps for this one are skipped from now on
+  g_savedCodesCache.remove(index);
+  if (!journaled(g_codeStore.removed(g_savedCodesCache, g_sequencesCache, id))) {
+    request->send(507, "application/json", "{\"error\":\"Storage full\"}");
     return;
   }
-  for (int i = index; i < n - 1; i++) {
-    String nextRaw = g_savedCodesCache[i + 1].raw;
-    char keyBuf[16];
-    snprintf(keyBuf, sizeof(keyBuf), "%d", i);
-    savedCodes.putString(keyBuf, nextRaw.c_str());
-  }
-  char keyBufLast[16];
-  snprintf(keyBufLast, sizeof(keyBufLast), "%d", n - 1);
-  savedCodes.remove(keyBufLast);
-  savedCodes.putInt("n", n - 1);
-  savedCodes.end();
-  g_savedCodesCache.erase(g_savedCodesCache.begin() + index);
   request->send(200, "application/json", "{\"ok\":true,\"remaining\":" + String(n - 1) + "}");
 }
 
-// POST /saved/rename?index=N&name=NewName — rename one saved code.
-void handleSavedRename(AsyncWebServerRequest *request) {
-  if (!request->hasParam("index") || !request->hasParam("name")) {
-    request->send(400, "application/json", "{\"error\":\"Missing index or name\"}");
+// POST /saved/move?index=N&to=M or ?id=ID&to=M — move a saved code to position M
+void handleSavedMove(AsyncWebServerRequest *request) {
+  SavedCodesLock lock;
+  if (!lock) {
+    request->send(500, "application/json", "{\"error\":\"Storage unavailable\"}");
     return;
   }
-  int index;
-  if (!parseIntStr(request->getParam("index")->value(), index)) {
-    request->send(400, "application/json", "{\"error\":\"Invalid index format\"}");
+  int from = savedCodeParam(request);
+  if (from < 0) return;
+  int to = savedCodeParam(request, "to");
+  if (to < 0) return;
+  uint16_t id = g_savedCodesCache.at(from).id;
+  if (from != to) {
+    g_savedCodesCache.move(from, to);
+    if (!journaled(g_codeStore.moved(g_savedCodesCache, g_sequencesCache, to))) {
+      request->send(507, "application/json", "{\"error\":\"Storage full\"}");
+      return;
+    }
+  }
+  request->send(200, "application/json", "{\"ok\":true,\"index\":" + String(to) + ",\"id\":" + String(id) + "}");
+}
+
+// POST /saved/rename?index=N&name=NewName (or id=ID) — rename one saved code.
+void handleSavedRename(AsyncWebServerRequest *request) {
+  if ((!request->hasParam("index") && !request->hasParam("id")) || !request->hasParam("name")) {
+    request->send(400, "application/json", "{\"error\":\"Missing index or name\"}");
     return;
   }
   String newName = request->getParam("name")->value();
@@ -659,70 +1383,234 @@ void handleSavedRename(AsyncWebServerRequest *request) {
     request->send(500, "application/json", "{\"error\":\"Storage unavailable\"}");
     return;
   }
-  ensureCacheLoaded();
-  savedCodes.begin(SAVED_CODES_NAMESPACE, false);
-  int n = (int)g_savedCodesCache.size();
-  if (index < 0 || index >= n) {
-    savedCodes.end();
-    request->send(400, "application/json", "{\"error\":\"Invalid index\"}");
+  int index = savedCodeParam(request);
+  if (index < 0) return;
+  g_savedCodesCache.rename(index, newName.c_str());
+  bool stored = journaled(g_codeStore.renamed(g_savedCodesCache, g_sequencesCache, index));
+  if (!stored) {
+    request->send(507, "application/json", "{\"error\":\"Storage full\"}");
     return;
   }
-  char keyBuf[16];
-  snprintf(keyBuf, sizeof(keyBuf), "%d", index);
-  String raw = g_savedCodesCache[index].raw;
-  JsonDocument entry;
-  DeserializationError err = deserializeJson(entry, raw);
-  if (err) {
-    savedCodes.end();
-    request->send(500, "application/json", "{\"error\":\"Stored code parse failed\"}");
+  request->send(200, "application/json",
+                "{\"ok\":true,\"index\":" + String(index) + ",\"id\":" + String(g_savedCodesCache.at(index).id) + "}");
+}
+
+// POST /saved/flush — commit journaled changes now rather than after the
+// debounce. Replies with the number committed and how long it took; 507 if
+// the snapshot could not be written (the changes stay journaled).
+void handleSavedFlush(AsyncWebServerRequest *request) {
+  size_t changes = 0;
+  if (!commitSavedCodes(true, &changes)) {
+    request->send(507, "application/json", "{\"error\":\"Storage full\"}");
     return;
   }
-  entry["name"] = newName;
-  if (measureJson(entry) >= SAVED_CODE_MAX) {
-    savedCodes.end();
-    request->send(413, "application/json", "{\"error\":\"Name too long\"}");
+  JsonDocument doc;
+  doc["ok"] = true;
+  doc["committed"] = (unsigned)changes;
+  {
+    SavedCodesLock lock;
+    if (lock) {
+      doc["ms"] = changes > 0 ? g_codeCommitter.lastCommitMs() : 0;
+      doc["pending"] = (unsigned)g_codeStore.pendingChanges();
+    }
+  }
+  String out;
+  serializeJson(doc, out);
+  request->send(200, "application/json", out);
+}
+
+// GET /sequences — JSON array of saved sequences with their steps
+void handleSequences(AsyncWebServerRequest *request) {
+  SavedCodesLock lock;
+  if (!lock) {
+    request->send(500, "application/json", "{\"error\":\"Storage unavailable\"}");
     return;
   }
-  char buf[SAVED_CODE_MAX];
-  serializeJson(entry, buf, sizeof(buf));
-  savedCodes.putString(keyBuf, buf);
-  savedCodes.end();
-  g_savedCodesCache[index] = {String(buf), String(entry["name"] | "")};
-  request->send(200, "application/json", "{\"ok\":true,\"index\":" + String(index) + "}");
+  ensureCacheLoaded();
+  JsonDocument doc;
+  JsonArray arr = doc.to<JsonArray>();
+  for (size_t i = 0; i < g_sequencesCache.size(); i++) {
+    JsonObject obj = arr.add<JsonObject>();
+    obj["index"] = (int)i;
+    obj["name"] = g_sequencesCache.name(i);
+    appendSequenceSteps(i, obj["steps"].to<JsonArray>());
+  }
+  String out;
+  serializeJson(doc, out);
+  request->send(200, "application/json", out);
 }
 
-// GET /dump — plain text for hardcoding (C-style)
-void handleDump(AsyncWebServerRequest *request) {
+// POST /sequences — body JSON: { "name": "Movie mode", "steps": [ { "code": 0, "delay_ms": 500 },
+//   { "id": 7 }, { "protocol": "NEC", "value": "20DF10EF", "bits": 32, "repeat": 2 } ] }
+void onSequenceBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+  String body;
+  if (!accumulateBody(request, data, len, index, total, 4096, "{\"error\":\"Payload too large\"}", body)) {
+    return;
+  }
+
+  JsonDocument doc;
+  if (deserializeJson(doc, body)) {
+    request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+    return;
+  }
+  const char *name = doc["name"] | "";
+  if (strlen(name) > MAX_PARAM_NAME) {
+    request->send(400, "application/json", "{\"error\":\"Name too long\"}");
+    return;
+  }
+  if (!doc["steps"].is<JsonArray>() || doc["steps"].size() == 0) {
+    request->send(400, "application/json", "{\"error\":\"Missing steps\"}");
+    return;
+  }
+
   SavedCodesLock lock;
   if (!lock) {
-    request->send(500, "text/plain", "Storage unavailable");
+    request->send(500, "application/json", "{\"error\":\"Storage unavailable\"}");
     return;
   }
   ensureCacheLoaded();
-  int n = (int)g_savedCodesCache.size();
-  String out = "// Saved IR codes — paste into firmware\n";
-  char buf[256];
-  snprintf(buf, sizeof(buf), "// Count: %d\n\n", n);
-  out += buf;
-  for (int i = 0; i < n; i++) {
-    JsonDocument entry;
-    deserializeJson(entry, g_savedCodesCache[i].raw);
-    const char *name = entry["name"] | "";
-    const char *protocol = entry["protocol"] | "UNKNOWN";
-    const char *valueHex = entry["value"] | "0";
-    uint16_t bits = entry["bits"] | 32;
+  SavedSequenceTable::Step steps[IrSender::kMaxSequenceSteps];
+  size_t count = 0;
+  const char *error = parseSequenceSteps(doc["steps"].as<JsonArrayConst>(), false, steps, count);
+  if (error) {
+    JsonDocument err;
+    err["error"] = error;
+    String out;
+    serializeJson(err, out);
+    request->send(400, "application/json", out);
+    return;
+  }
+  int sn = (int)g_sequencesCache.size();
+  if (!g_sequencesCache.add(name, steps, count)) {
+    request->send(400, "application/json", "{\"error\":\"Too many sequences\"}");
+    return;
+  }
+  if (!journaled(g_codeStore.sequenceAdded(g_savedCodesCache, g_sequencesCache))) {
+    request->send(507, "application/json", "{\"error\":\"Storage full\"}");
+    return;
+  }
+  request->send(200, "application/json", "{\"ok\":true,\"index\":" + String(sn) + ",\"total\":" + String(sn + 1) + "}");
+}
 
-    snprintf(buf, sizeof(buf), "// %d %s %s 0x%s %ub\n", i, name, protocol, valueHex, bits);
-    out += buf;
+// POST /sequences/delete?index=N — remove saved sequence at index; shift rest down
+void handleSequenceDelete(AsyncWebServerRequest *request) {
+  if (!request->hasParam("index")) {
+    request->send(400, "application/json", "{\"error\":\"Missing index\"}");
+    return;
+  }
+  int index;
+  if (!parseIntStr(request->getParam("index")->value(), index)) {
+    request->send(400, "application/json", "{\"error\":\"Invalid index format\"}");
+    return;
+  }
+  SavedCodesLock lock;
+  if (!lock) {
+    request->send(500, "application/json", "{\"error\":\"Storage unavailable\"}");
+    return;
+  }
+  ensureCacheLoaded();
+  int sn = (int)g_sequencesCache.size();
+  if (index < 0 || index >= sn) {
+    request->send(400, "application/json", "{\"error\":\"Invalid index\"}");
+    return;
+  }
+  g_sequencesCache.remove(index);
+  if (!journaled(g_codeStore.sequenceRemoved(g_savedCodesCache, g_sequencesCache, index))) {
+    request->send(507, "application/json", "{\"error\":\"Storage full\"}");
+    return;
+  }
+  request->send(200, "application/json", "{\"ok\":true,\"remaining\":" + String(sn - 1) + "}");
+}
 
-    if (strcasecmp(protocol, "NEC") == 0) {
-      snprintf(buf, sizeof(buf), "irsend.sendNEC(0x%su, %u);  // %s\n", valueHex, bits, name);
-    } else {
-      snprintf(buf, sizeof(buf), "// irsend.send... (unsupported protocol); value=0x%s %s\n", valueHex, name);
+// POST /sequences/send?index=N or ?name=Name — queue a saved sequence as one job
+void handleSequenceSend(AsyncWebServerRequest *request) {
+  int index = -1;
+  if (request->hasParam("index")) {
+    if (!parseIntStr(request->getParam("index")->value(), index)) {
+      request->send(400, "application/json", "{\"error\":\"Invalid index format\"}");
+      return;
+    }
+  } else if (request->hasParam("name")) {
+    String name = request->getParam("name")->value();
+    if (name.length() > MAX_PARAM_NAME) {
+      request->send(400, "application/json", "{\"error\":\"Name too long\"}");
+      return;
     }
-    out += buf;
+    index = getSequenceIndexByName(name.c_str());
+  } else {
+    request->send(400, "application/json", "{\"error\":\"Missing index or name\"}");
+    return;
+  }
+
+  String name;
+  const char *error = "Invalid index";
+  uint32_t jobId = 0;
+  if (!sendSequence(index, name, &error, &jobId)) {
+    JsonDocument err;
+    err["error"] = error;
+    String out;
+    serializeJson(err, out);
+    int status = strcmp(error, "IR queue full") == 0 ? 503 : (strcmp(error, "Storage unavailable") == 0 ? 500 : 400);
+    request->send(status, "application/json", out);
+    return;
+  }
+  JsonDocument doc;
+  doc["ok"] = true;
+  doc["index"] = index;
+  doc["name"] = name;
+  doc["job"] = jobId;
+  String out;
+  serializeJson(doc, out);
+  request->send(200, "application/json", out);
+}
+
+// GET /dump — plain text for hardcoding (C-style)
+void handleDump(AsyncWebServerRequest *request) {
+  if (!sendSavedListing(request, g_savedDumpBody, 'd', SavedCodeListWriter::Format::Dump, "text/plain")) {
+    request->send(500, "text/plain", "Storage unavailable");
   }
-  request->send(200, "text/plain", out);
+}
+
+// Static assets served from LittleFS with max-age and an ETag from a CRC of
+// the file, computed at boot (a filesystem upload reboots the device), so an
+// expired copy revalidates with a 304 unless the file changed.
+struct StaticAsset {
+  const char *path;
+  const char *contentType;
+  String etag;  // empty if the file is missing
+};
+static StaticAsset g_staticAssets[] = {
+  {"/app.css", "text/css", String()},
+  {"/app.js", "application/javascript", String()},
+};
+static const char *STATIC_CACHE_CONTROL = "max-age=86400";
+
+static String fileEtag(const char *path) {
+  File f = LittleFS.open(path, "r");
+  if (!f) return String();
+  uint8_t buf[512];
+  uint32_t crc = 0;
+  size_t n;
+  while ((n = f.read(buf, sizeof(buf))) > 0) crc = savedBackupCrc32(buf, n, crc);
+  char tag[24];
+  snprintf(tag, sizeof(tag), "\"%08x-%x\"", (unsigned)crc, (unsigned)f.size());
+  f.close();
+  return tag;
+}
+
+static void handleStaticAsset(AsyncWebServerRequest *request, const StaticAsset &asset) {
+  if (asset.etag.length() == 0) {
+    request->send(404, "text/plain", "Not found");
+    return;
+  }
+  if (etagMatches(request, asset.etag)) {
+    sendNotModified(request, asset.etag, STATIC_CACHE_CONTROL);
+    return;
+  }
+  AsyncWebServerResponse *response = request->beginResponse(LittleFS, asset.path, asset.contentType);
+  response->addHeader("ETag", asset.etag);
+  response->addHeader("Cache-Control", STATIC_CACHE_CONTROL);
+  request->send(response);
 }
 
 void handleRoot(AsyncWebServerRequest *request) {
@@ -730,20 +1618,215 @@ void handleRoot(AsyncWebServerRequest *request) {
   request->send(LittleFS, "/index.html", "text/html", false, templateProcessor);
 }
 
-// GET /last — JSON for live-update polling: { seq, human, raw, replayUrl }
+// Saved code matching a received capture: same protocol and value, and
+// (exact) the same bits. index is -1 when no saved code matches.
+struct SavedMatch {
+  int index = -1;
+  bool exact = false;
+  uint16_t id = 0;
+  String name;
+};
+
+static SavedMatch findSavedMatch(const IrCapture &c) {
+  SavedMatch m;
+  SavedCodesLock lock;
+  if (!lock) return m;
+  ensureCacheLoaded();
+  m.index = g_savedCodesCache.indexOfCode(c.protocol.c_str(), c.value, c.bits, m.exact);
+  if (m.index >= 0) {
+    m.id = g_savedCodesCache.at(m.index).id;
+    m.name = g_savedCodesCache.name(m.index);
+  }
+  return m;
+}
+
+// Adds "match" ("exact", "likely" or "unknown") and, unless unknown,
+// "saved": { index, id, name }.
+static void appendSavedMatch(JsonDocument &doc, const SavedMatch &m) {
+  if (m.index < 0) {
+    doc["match"] = "unknown";
+    return;
+  }
+  doc["match"] = m.exact ? "exact" : "likely";
+  JsonObject saved = doc["saved"].to<JsonObject>();
+  saved["index"] = m.index;
+  saved["id"] = m.id;
+  saved["name"] = m.name;
+}
+
+// GET /last — JSON for live-update polling: { seq, human, raw, replayUrl, match, saved }.
+// Its ETag follows lastCodeSeq and the saved codes (the match can change with
+// them), so a poller that sends If-None-Match gets 304 until either moves.
 void handleLast(AsyncWebServerRequest *request) {
+  uint32_t generation = 0;
+  {
+    SavedCodesLock lock;
+    if (lock) {
+      ensureCacheLoaded();
+      generation = g_savedCodesCache.generation();
+    }
+  }
+  String etag = makeEtag('l', lastCodeSeq, generation);
+  if (etagMatches(request, etag)) {
+    g_lastNotModified++;
+    sendNotModified(request, etag, "no-cache");
+    return;
+  }
   JsonDocument doc;
   doc["seq"] = lastCodeSeq;
   doc["human"] = lastHumanReadable;
   doc["raw"] = lastRawJson;
   String replayUrl = (historyLen > 0) ? replayUrlFor(history[historyHead]) : "";
   doc["replayUrl"] = replayUrl;
+  if (historyLen > 0) appendSavedMatch(doc, findSavedMatch(history[historyHead]));
+  String out;
+  serializeJson(doc, out);
+  AsyncWebServerResponse *response = request->beginResponse(200, "application/json", out);
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+// Pacing of IR events for /ws clients (see broadcastIrEvents())
+static WsEventLimiter g_wsEvents(WS_EVENT_MIN_INTERVAL_MS, WS_EVENT_STALL_MS);
+static SavedMatch g_wsEventMatch;  // of the latest capture, the one g_wsEvents sends
+static uint32_t g_wsEventBodies = 0;  // IR event bodies serialized
+
+// IR queue counters (sends that became a new job vs. ones merged into a
+// queued or active one), WebSocket IR event counters, heap, the saved-code
+// cache's RAM and storage, and hits/misses of the cached list bodies
+void handleStats(AsyncWebServerRequest *request) {
+  JsonDocument doc;
+  doc["fresh"] = irSender.freshJobs();
+  doc["coalesced"] = irSender.coalescedJobs();
+  doc["pending"] = (unsigned)irSender.pendingJobs();
+  doc["depth"] = (unsigned)irSender.depth();
+  doc["coalesceMax"] = irSender.coalesceLimit();
+  JsonObject events = doc["wsEvents"].to<JsonObject>();
+  events["sent"] = g_wsEvents.sent();
+  events["bodies"] = g_wsEventBodies;
+  events["coalesced"] = g_wsEvents.coalesced();
+  events["dropped"] = g_wsEvents.dropped();
+  events["deferred"] = g_wsEvents.deferred();
+  events["closed"] = g_wsEvents.closed();
+  events["minIntervalMs"] = WS_EVENT_MIN_INTERVAL_MS;
+  doc["heapFree"] = ESP.getFreeHeap();
+  doc["heapLargestBlock"] = ESP.getMaxAllocHeap();
+  doc["heapMinFree"] = ESP.getMinFreeHeap();
+  {
+    SavedCodesLock lock;
+    if (lock) {
+      ensureCacheLoaded();
+      JsonObject cache = doc["savedCodes"].to<JsonObject>();
+      cache["count"] = (unsigned)g_savedCodesCache.size();
+      cache["bytes"] = (unsigned)g_savedCodesCache.memoryBytes();
+      cache["heapFreeBefore"] = g_cacheLoadHeap.freeBefore;
+      cache["heapFreeAfter"] = g_cacheLoadHeap.freeAfter;
+      cache["largestBlockBefore"] = g_cacheLoadHeap.largestBefore;
+      cache["largestBlockAfter"] = g_cacheLoadHeap.largestAfter;
+      // Journal not yet committed to the snapshot, and commit timings
+      cache["store"] = g_codeStore.name();
+      cache["snapshotBytes"] = (unsigned)g_codeStore.snapshotBytes();
+      cache["journalBytes"] = (unsigned)g_codeStore.journalBytes();
+      cache["pending"] = (unsigned)g_codeStore.pendingChanges();
+      cache["oldestPendingMs"] = g_codeCommitter.oldestMs(millis());
+      cache["commits"] = g_codeCommitter.commits();
+      cache["commitFailures"] = g_codeCommitter.failures();
+      cache["lastCommitMs"] = g_codeCommitter.lastCommitMs();
+      cache["maxCommitMs"] = g_codeCommitter.maxCommitMs();
+      cache["lastCommitLatencyMs"] = g_codeCommitter.lastLatencyMs();
+      cache["generation"] = g_savedCodesCache.generation();
+      // Cached /saved, BLE list and /dump bodies
+      JsonObject bodies = doc["responseCache"].to<JsonObject>();
+      const struct {
+        const char *name;
+        const SavedBodyCache &body;
+      } caches[] = {{"saved", g_savedJsonBody}, {"ble", g_savedCompactBody}, {"dump", g_savedDumpBody}};
+      for (const auto &c : caches) {
+        JsonObject o = bodies[c.name].to<JsonObject>();
+        o["hits"] = c.body.hits;
+        o["misses"] = c.body.misses;
+        o["bytes"] = c.body.body ? (unsigned)c.body.body->length() : 0u;
+        o["notModified"] = c.body.notModified;
+      }
+      bodies["last"]["notModified"] = g_lastNotModified;
+    }
+  }
   String out;
   serializeJson(doc, out);
   request->send(200, "application/json", out);
 }
 
-// Simple NEC-style sender: /send?type=nec&data=FF827D&length=32
+static void appendJobStatus(JsonObject out, const IrSender::JobStatus &status) {
+  out["id"] = status.id;
+  out["state"] = IrSender::jobStateName(status.state);
+  out["queuedMs"] = status.queuedMs;
+  if (status.startedMs) out["startedMs"] = status.startedMs;
+  if (status.finishedMs) out["finishedMs"] = status.finishedMs;
+}
+
+// GET /jobs — recent IR jobs, newest first; GET /jobs/<id> — one job.
+// Times are millis() since boot; "uptimeMs" is the current value.
+void handleJobs(AsyncWebServerRequest *request) {
+  JsonDocument doc;
+  IrSender::JobStatus status;
+  String url = request->url();
+  if (url.length() > 6) {
+    int id;
+    if (!url.startsWith("/jobs/") || !parseIntStr(url.substring(6), id) || id < 1) {
+      request->send(400, "application/json", "{\"error\":\"Invalid job id\"}");
+      return;
+    }
+    if (!irSender.jobStatus((uint32_t)id, status)) {
+      request->send(404, "application/json", "{\"error\":\"Unknown job\"}");
+      return;
+    }
+    appendJobStatus(doc.to<JsonObject>(), status);
+  } else {
+    JsonArray jobs = doc["jobs"].to<JsonArray>();
+    uint32_t last = irSender.lastJobId();
+    for (uint32_t n = 0; n < IrSender::kStatusSlots && last - n != 0; n++) {
+      if (irSender.jobStatus(last - n, status)) appendJobStatus(jobs.add<JsonObject>(), status);
+    }
+  }
+  doc["uptimeMs"] = (uint32_t)millis();
+  String out;
+  serializeJson(doc, out);
+  request->send(200, "application/json", out);
+}
+
+// Broadcast {"event":"job",...} over WebSocket for each job whose state
+// changed since the last call.  Polled from loop(); cheap when nothing moved.
+static void broadcastJobEvents() {
+  static uint32_t seenVersion = 0;
+  static uint8_t reported[IrSender::kStatusSlots];
+  static uint32_t reportedId[IrSender::kStatusSlots];
+  uint32_t version = irSender.statusVersion();
+  if (version == seenVersion) return;
+  seenVersion = version;
+  bool listening = ws.count() > 0;
+
+  uint32_t last = irSender.lastJobId();
+  IrSender::JobStatus status;
+  // Oldest first, so a client sees each job's states in order
+  for (uint32_t n = IrSender::kStatusSlots; n-- > 0;) {
+    uint32_t id = last - n;
+    if (n >= last || !irSender.jobStatus(id, status)) continue;
+    size_t i = id % IrSender::kStatusSlots;
+    if (reportedId[i] == id && reported[i] == (uint8_t)status.state) continue;
+    reportedId[i] = id;
+    reported[i] = (uint8_t)status.state;
+    if (!listening) continue;
+    JsonDocument doc;
+    appendJobStatus(doc.to<JsonObject>(), status);
+    doc["event"] = "job";
+    String out;
+    serializeJson(doc, out);
+    ws.textAll(out);
+  }
+}
+
+// Sender for any value-based protocol: /send?type=nec&data=FF827D&length=32
 void handleSend(AsyncWebServerRequest *request) {
   if (!request->hasParam("type") || !request->hasParam("data")) {
     request->send(400, "text/plain", "Missing type or data");
@@ -783,28 +1866,299 @@ void handleSend(AsyncWebServerRequest *request) {
     return;
   }
 
-  if (type == "nec") {
-    uint32_t value;
-    if (!parseHex32(data.c_str(), value)) {
-      request->send(400, "text/plain", "Invalid hex data or out of range");
-      return;
+  decode_type_t protocol;
+  if (!parseSendableProtocol(type.c_str(), protocol)) {
+    request->send(400, "text/plain", "Unsupported type");
+    return;
+  }
+  uint64_t value;
+  if (!parseHex64(data.c_str(), value)) {
+    request->send(400, "text/plain", "Invalid hex data or out of range");
+    return;
+  }
+  IrSender::Submission queued = irSender.queue(protocol, value, length, repeat);
+  if (!queued) {
+    request->send(503, "text/plain", "IR queue full");
+    return;
+  }
+  String protoName = typeToString(protocol);
+  printf("[IR] TX %s 0x%s %db x%d job %u %s (no name)\n", protoName.c_str(), data.c_str(), length, repeat,
+         (unsigned)queued.jobId, IrSender::admissionName(queued.admission));
+  AsyncWebServerResponse *response =
+      request->beginResponse(200, "text/plain", "Sent " + protoName + " " + data + " (job " + String(queued.jobId) + ")");
+  response->addHeader("X-Job-Id", String(queued.jobId));
+  response->addHeader("X-Job-Admission", IrSender::admissionName(queued.admission));
+  request->send(response);
+}
+
+// Check one /send/batch item and resolve it into `step`: a code given like
+// /send's parameters ("type", "data", "length"), or else a saved code by
+// "code" (index), "id" or "name"; either with optional "repeat" (1-20) and
+// "delay_ms" (silence after it). Fills `result` with what will be sent.
+// Returns an error message, or nullptr. Must be called with SavedCodesLock
+// held and the cache loaded.
+static const char *resolveBatchItem(JsonVariantConst item, IrSender::SequenceStep &step, JsonObject result) {
+  if (!item.is<JsonObjectConst>()) return "Item is not an object";
+  int repeat = IR_SEND_REPEAT;
+  if (item["type"].isNull() && item["data"].isNull()) {
+    int index = -1;
+    if (item["code"].is<int>()) {
+      index = item["code"];
+      if (index >= (int)g_savedCodesCache.size()) index = -1;
+    } else if (item["id"].is<int>()) {
+      int id = item["id"];
+      if (id > 0 && id <= 0xFFFF) index = g_savedCodesCache.indexOfId((uint16_t)id);
+    } else if (item["name"].is<const char *>()) {
+      const char *name = item["name"];
+      if (strlen(name) > MAX_PARAM_NAME) return "Name too long";
+      index = g_savedCodesCache.indexOfName(name);
+    } else {
+      return "Missing code, id, name or type";
     }
-    irSender.queue(value, length, repeat);
-    printf("[IR] TX NEC 0x%s %db x%d (no name)\n", data.c_str(), length, repeat);
-    request->send(200, "text/plain", "Sent NEC " + data);
+    if (index < 0) return "Unknown saved code";
+    // Captured timings alone cannot go in a sequence job
+    if (!g_savedCodesCache.isSendable(index)) return "Saved code is not sendable by value";
+    const SavedCodeTable::Entry &code = g_savedCodesCache.at(index);
+    step.protocol = (decode_type_t)code.protocol;
+    step.value = code.value;
+    step.bits = code.bits;
+    if (code.repeat) repeat = code.repeat;
+    result["id"] = code.id;
+    result["name"] = g_savedCodesCache.name(index);
   } else {
-    request->send(400, "text/plain", "Unsupported type");
+    const char *type = item["type"] | "";
+    const char *data = item["data"] | "";
+    if (strlen(type) > MAX_PARAM_PROTOCOL || strlen(data) > MAX_PARAM_DATA) return "Input too long";
+    if (!*type || !*data) return "Missing type or data";
+    if (!parseSendableProtocol(type, step.protocol)) return "Unsupported type";
+    if (!parseHex64(data, step.value)) return "Invalid hex data or out of range";
+    int length = item["length"] | 32;
+    if (length < 1 || length > 128) return "Invalid length (1-128)";
+    step.bits = (uint16_t)length;
+  }
+  if (!item["repeat"].isNull()) {
+    if (!item["repeat"].is<int>()) return "Invalid repeat format";
+    repeat = item["repeat"];
   }
+  if (repeat < 1 || repeat > 20) return "Invalid repeat (1-20)";
+  int delayMs = item["delay_ms"] | 0;
+  if (delayMs < 0 || delayMs > IrSender::kMaxPostDelayMs) return "Invalid delay_ms";
+  step.repeat = (uint8_t)repeat;
+  step.postDelayMs = (uint16_t)delayMs;
+  result["protocol"] = typeToString(step.protocol);
+  result["value"] = uint64ToHexBits(step.value, step.bits);
+  result["bits"] = step.bits;
+  result["repeat"] = step.repeat;
+  if (step.postDelayMs) result["delay_ms"] = step.postDelayMs;
+  return nullptr;
 }
 
-void handleWsData(AsyncWebSocketClient *client, void *arg, uint8_t *data, size_t len) {
-  AwsFrameInfo *info = (AwsFrameInfo *)arg;
-  if (info->opcode != WS_TEXT) return;
+// Send a batch of codes (/send/batch, WebSocket "batch") as one sequence
+// job, so they go out in order with nothing in between. Every item is
+// checked before anything is queued; if one is invalid none are sent. `out`
+// gets "ok", a result per item under "results" and, when queued, the "job"
+// and its "admission" (else "error"). Returns the HTTP status.
+static int sendBatch(JsonVariantConst items, JsonDocument &out) {
+  if (!items.is<JsonArrayConst>() || items.size() == 0) {
+    out["ok"] = false;
+    out["error"] = "Missing items";
+    return 400;
+  }
+  if (items.size() > IrSender::kMaxSequenceSteps) {
+    out["ok"] = false;
+    out["error"] = "Too many items (max " + String((unsigned)IrSender::kMaxSequenceSteps) + ")";
+    return 400;
+  }
+  IrSender::SequenceStep steps[IrSender::kMaxSequenceSteps];
+  size_t count = 0;
+  int invalid = 0;
+  JsonArray results = out["results"].to<JsonArray>();
+  {
+    SavedCodesLock lock;
+    if (!lock) {
+      out.clear();
+      out["ok"] = false;
+      out["error"] = "Storage unavailable";
+      return 500;
+    }
+    ensureCacheLoaded();
+    for (JsonVariantConst item : items.as<JsonArrayConst>()) {
+      JsonObject result = results.add<JsonObject>();
+      const char *error = resolveBatchItem(item, steps[count], result);
+      if (error) {
+        result.clear();
+        result["ok"] = false;
+        result["error"] = error;
+        invalid++;
+      } else {
+        result["ok"] = true;
+        count++;
+      }
+    }
+  }
+  if (invalid) {
+    out["ok"] = false;
+    out["error"] = invalid == 1 ? "1 invalid item; nothing sent" : String(invalid) + " invalid items; nothing sent";
+    return 400;
+  }
+  IrSender::Submission queued = irSender.queueSequence(steps, count);
+  if (!queued) {
+    printf("[IR] TX queue full; dropped batch of %u\n", (unsigned)count);
+    out["ok"] = false;
+    out["error"] = "IR queue full";
+    return 503;
+  }
+  printf("[IR] TX batch of %u, job %u\n", (unsigned)count, (unsigned)queued.jobId);
+  out["ok"] = true;
+  out["job"] = queued.jobId;
+  out["admission"] = IrSender::admissionName(queued.admission);
+  return 200;
+}
+
+// POST /send/batch — body JSON: an array of up to 16 items, each a saved code
+// ({ "code": N }, { "id": ID } or { "name": "Power" }) or a code as for /send
+// ({ "type": "nec", "data": "FF827D", "length": 32 }), with optional "repeat"
+// and "delay_ms". Sent in order as one job.
+void onSendBatchBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+  String body;
+  if (!accumulateBody(request, data, len, index, total, 4096, "{\"ok\":false,\"error\":\"Payload too large\"}", body)) {
+    return;
+  }
+  JsonDocument req;
+  if (deserializeJson(req, body)) {
+    request->send(400, "application/json", "{\"ok\":false,\"error\":\"Invalid JSON\"}");
+    return;
+  }
+  JsonDocument doc;
+  int status = sendBatch(req.as<JsonVariantConst>(), doc);
+  String out;
+  serializeJson(doc, out);
+  AsyncWebServerResponse *response = request->beginResponse(status, "application/json", out);
+  if (doc["job"].is<uint32_t>()) {
+    response->addHeader("X-Job-Id", String(doc["job"].as<uint32_t>()));
+    response->addHeader("X-Job-Admission", doc["admission"].as<const char *>());
+  }
+  request->send(response);
+}
+
+// WebSocket { "cmd": "sequence", "index": N } or { "cmd": "sequence", "name": "Movie mode" }
+static void handleWsSequence(AsyncWebSocketClient *client, JsonDocument &req) {
+  int index = -1;
+  if (req["index"].is<int>()) {
+    index = req["index"];
+  } else if (req["name"].is<const char *>()) {
+    index = getSequenceIndexByName(req["name"]);
+  }
+  String name;
+  const char *error = "Invalid index";
+  uint32_t jobId = 0;
+  JsonDocument ack;
+  if (sendSequence(index, name, &error, &jobId)) {
+    ack["ok"] = true;
+    ack["msg"] = "Sent sequence " + name;
+    ack["name"] = name;
+    ack["job"] = jobId;
+    ack["admission"] = IrSender::admissionName(IrSender::Admission::Accepted);
+  } else {
+    ack["ok"] = false;
+    ack["error"] = error;
+  }
+  String ackStr;
+  serializeJson(ack, ackStr);
+  client->text(ackStr);
+}
+
+// WebSocket { "cmd": "batch", "items": [ ... ] } — items as for POST /send/batch
+static void handleWsBatch(AsyncWebSocketClient *client, JsonDocument &req) {
+  JsonDocument ack;
+  sendBatch(req["items"].as<JsonVariantConst>(), ack);
+  String ackStr;
+  serializeJson(ack, ackStr);
+  client->text(ackStr);
+}
+
+// WebSocket { "ok": false, "error": ... }
+static void sendWsError(AsyncWebSocketClient *client, const char *error) {
+  JsonDocument err;
+  err["ok"] = false;
+  err["error"] = error;
+  String errStr;
+  serializeJson(err, errStr);
+  client->text(errStr);
+}
+
+// Check and queue a code sent over the WebSocket, as JSON or binary.
+static WsSendStatus queueWsSend(decode_type_t protocol, uint64_t value, int bits, int repeat,
+                                IrSender::Submission &queued) {
+  if (repeat < 1 || repeat > 20) return WsSendStatus::InvalidRepeat;
+  if (!isSendableProtocol(protocol)) return WsSendStatus::UnsupportedType;
+  if (bits < 1 || bits > 128) return WsSendStatus::InvalidLength;
+  queued = irSender.queue(protocol, value, bits, repeat);
+  return queued ? WsSendStatus::Ok : WsSendStatus::QueueFull;
+}
+
+// Ids of the connected WebSocket clients, and of those that opted in to
+// binary frames (0 = free). Changed from the web server's task, read from
+// loop(), which looks each client up by id rather than walking the server's
+// client list without its lock.
+typedef std::atomic<uint32_t> WsClientIds[WS_CLIENTS_MAX];
+static WsClientIds g_wsClients;
+static WsClientIds g_wsBinaryClients;
+
+static bool addWsClientId(WsClientIds &ids, uint32_t id) {
+  for (std::atomic<uint32_t> &slot : ids) {
+    if (slot.load() == id) return true;
+  }
+  for (std::atomic<uint32_t> &slot : ids) {
+    uint32_t free = 0;
+    if (slot.compare_exchange_strong(free, id)) return true;
+  }
+  return false;
+}
+
+static void removeWsClientId(WsClientIds &ids, uint32_t id) {
+  for (std::atomic<uint32_t> &slot : ids) {
+    uint32_t expected = id;
+    slot.compare_exchange_strong(expected, 0);
+  }
+}
+
+static bool hasWsClientId(const WsClientIds &ids, uint32_t id) {
+  for (const std::atomic<uint32_t> &slot : ids) {
+    if (slot.load() == id) return true;
+  }
+  return false;
+}
+
+// A capture as a binary IrEvent frame.
+static WsIrEventFrame wsIrEvent(const IrCapture &c, const SavedMatch &m, uint16_t repeat = 1) {
+  WsIrEventFrame ev;
+  ev.seq = lastCodeSeq;
+  ev.protocol = (int16_t)strToDecodeType(c.protocol.c_str());
+  ev.bits = c.bits;
+  ev.value = c.value;
+  ev.match = m.index < 0 ? 0 : (m.exact ? 2 : 1);
+  ev.savedId = m.index < 0 ? 0 : m.id;
+  ev.repeat = repeat;
+  return ev;
+}
+
+// JSON commands: "send", "sequence", "batch"
+static void handleWsText(AsyncWebSocketClient *client, uint8_t *data, size_t len) {
   if (len == 0) return;
   JsonDocument req;
   DeserializationError err = deserializeJson(req, data, len);
   if (err) return;
-  if (!req["cmd"].is<const char *>() || String(req["cmd"].as<const char *>()) != "send") return;
+  if (!req["cmd"].is<const char *>()) return;
+  if (String(req["cmd"].as<const char *>()) == "sequence") {
+    handleWsSequence(client, req);
+    return;
+  }
+  if (String(req["cmd"].as<const char *>()) == "batch") {
+    handleWsBatch(client, req);
+    return;
+  }
+  if (String(req["cmd"].as<const char *>()) != "send") return;
   String stype = req["type"] | "";
   String sdata = req["data"] | "";
   int length = req["length"] | 32;
@@ -812,51 +2166,82 @@ void handleWsData(AsyncWebSocketClient *client, void *arg, uint8_t *data, size_t
   String name = req["name"] | "";
 
   if (stype.length() > MAX_PARAM_PROTOCOL || sdata.length() > MAX_PARAM_DATA || name.length() > MAX_PARAM_NAME) {
-    JsonDocument ack;
-    ack["ok"] = false;
-    ack["error"] = "Input too long";
-    String ackStr;
-    serializeJson(ack, ackStr);
-    client->text(ackStr);
+    sendWsError(client, "Input too long");
     return;
   }
 
-  if (repeat < 1 || repeat > 20) {
-    JsonDocument ack;
-    ack["ok"] = false;
-    ack["error"] = "Invalid repeat (1-20)";
-    String ackStr;
-    serializeJson(ack, ackStr);
-    client->text(ackStr);
-    return;
-  }
-
-  if (stype == "nec") {
-    uint32_t value;
-    if (sdata.length() > 0 && length > 0 && length <= 128 && parseHex32(sdata.c_str(), value)) {
-      irSender.queue(value, length, repeat);
-      printf("[IR] TX NEC 0x%s %db x%d (%s)\n", sdata.c_str(), length, repeat,
-             name.length() ? name.c_str() : "no name");
-      JsonDocument ack;
-      ack["ok"] = true;
-      ack["msg"] = "Sent NEC " + sdata;
-      if (name.length() > 0) ack["name"] = name;
-      String ackStr;
-      serializeJson(ack, ackStr);
-      client->text(ackStr);
+  // Unknown protocols and unreadable data are reported by the shared checks
+  decode_type_t protocol;
+  if (!parseSendableProtocol(stype.c_str(), protocol)) protocol = decode_type_t::UNKNOWN;
+  uint64_t value = 0;
+  if (sdata.length() == 0 || !parseHex64(sdata.c_str(), value)) length = 0;
+  IrSender::Submission queued = {IrSender::Admission::RejectedInvalid, 0};
+  WsSendStatus status = queueWsSend(protocol, value, length, repeat, queued);
+  if (status != WsSendStatus::Ok) {
+    sendWsError(client, wsSendStatusText(status));
+    return;
+  }
+  String protoName = typeToString(protocol);
+  printf("[IR] TX %s 0x%s %db x%d job %u %s (%s)\n", protoName.c_str(), sdata.c_str(), length, repeat,
+         (unsigned)queued.jobId, IrSender::admissionName(queued.admission), name.length() ? name.c_str() : "no name");
+  JsonDocument ack;
+  ack["ok"] = true;
+  ack["msg"] = "Sent " + protoName + " " + sdata;
+  ack["job"] = queued.jobId;
+  ack["admission"] = IrSender::admissionName(queued.admission);
+  if (name.length() > 0) ack["name"] = name;
+  String ackStr;
+  serializeJson(ack, ackStr);
+  client->text(ackStr);
+}
+
+// Binary frames (include/ws_binary.h): Hello opts the client in to binary IR
+// events, Send queues a code and is answered with an Ack.
+static void handleWsBinary(AsyncWebSocketClient *client, const uint8_t *data, size_t len) {
+  uint8_t out[kWsAckBytes];
+  uint8_t version;
+  if (wsDecodeHello(data, len, version)) {
+    if (version == kWsBinaryVersion && addWsClientId(g_wsBinaryClients, client->id())) {
+      client->binary(out, wsEncodeHello(out));
+      if (historyLen > 0) {
+        uint8_t event[kWsIrEventBytes];
+        client->binary(event, wsEncodeIrEvent(wsIrEvent(history[historyHead], findSavedMatch(history[historyHead])), event));
+      }
     } else {
-      JsonDocument err;
-      err["ok"] = false;
-      err["error"] = "Invalid data or length";
-      String errStr;
-      serializeJson(err, errStr);
-      client->text(errStr);
+      client->binary(out, wsEncodeHello(out));  // our version; the client stays on JSON
     }
+    return;
+  }
+  WsAckFrame ack = {0, WsSendStatus::BadFrame, (uint8_t)IrSender::Admission::RejectedInvalid, 0};
+  WsSendFrame frame;
+  if (wsDecodeSend(data, len, frame)) {
+    IrSender::Submission queued = {IrSender::Admission::RejectedInvalid, 0};
+    ack.request = frame.request;
+    ack.status = queueWsSend((decode_type_t)frame.protocol, frame.value, frame.bits, frame.repeat, queued);
+    ack.admission = (uint8_t)queued.admission;
+    ack.job = queued.jobId;
+    if (ack.status == WsSendStatus::Ok) {
+      printf("[IR] TX %s 0x%s %ub x%u job %u %s (binary)\n", typeToString((decode_type_t)frame.protocol).c_str(),
+             uint64ToHexBits(frame.value, frame.bits).c_str(), frame.bits, frame.repeat, (unsigned)queued.jobId,
+             IrSender::admissionName(queued.admission));
+    }
+  }
+  client->binary(out, wsEncodeAck(ack, out));
+}
+
+void handleWsData(AsyncWebSocketClient *client, void *arg, uint8_t *data, size_t len) {
+  AwsFrameInfo *info = (AwsFrameInfo *)arg;
+  if (info->opcode == WS_BINARY) {
+    // Binary messages are small and never fragmented
+    if (info->final && info->index == 0 && info->len == len) handleWsBinary(client, data, len);
+    return;
   }
+  if (info->opcode == WS_TEXT) handleWsText(client, data, len);
 }
 
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
   if (type == WS_EVT_CONNECT) {
+    addWsClientId(g_wsClients, client->id());
     // Send current last code so new client gets state
     JsonDocument doc;
     doc["event"] = "ir";
@@ -866,12 +2251,16 @@ void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventTyp
     doc["replayUrl"] = (historyLen > 0) ? replayUrlFor(history[historyHead]) : "";
     if (historyLen > 0) {
       doc["protocol"] = history[historyHead].protocol;
-      doc["value"] = uint64ToHex(history[historyHead].value);
+      doc["value"] = uint64ToHexBits(history[historyHead].value, history[historyHead].bits);
       doc["bits"] = history[historyHead].bits;
+      appendSavedMatch(doc, findSavedMatch(history[historyHead]));
     }
     String out;
     serializeJson(doc, out);
     client->text(out);
+  } else if (type == WS_EVT_DISCONNECT) {
+    removeWsClientId(g_wsClients, client->id());
+    removeWsClientId(g_wsBinaryClients, client->id());
   } else if (type == WS_EVT_DATA) {
     handleWsData(client, arg, data, len);
   }
@@ -910,6 +2299,14 @@ void setupStorage() {
   } else {
     printf("[IR] LittleFS mounted\n");
   }
+  // Load (and if needed migrate) the saved codes now rather than on first use
+  printf("[IR] %d saved codes loaded\n", getSavedCount());
+  if (g_commitTask.start("saved_commit", savedCommitTaskLoop, nullptr, SAVED_COMMIT_TASK_STACK,
+                         SAVED_COMMIT_TASK_PRIORITY)) {
+    printf("[IR] Saved codes commit task started\n");
+  } else {
+    printf("[IR] Saved codes commit task unavailable; committing from loop()\n");
+  }
 }
 
 void setupIR() {
@@ -919,22 +2316,43 @@ void setupIR() {
 #else
   printf("[IR] IR receive disabled (IR_RECV_ENABLED=0)\n");
 #endif
-  printf("[IR] IR send repeat default: %d\n", IR_SEND_REPEAT);
+  printf("[IR] IR send repeat default: %d, queue depth: %u, coalesce max: %u\n", IR_SEND_REPEAT,
+         (unsigned)irSender.depth(), (unsigned)irSender.coalesceLimit());
   irsend.begin();
+#if IR_TX_TASK
+  if (irSender.startTask()) {
+    printf("[IR] TX task started (priority %d)\n", IR_TX_TASK_PRIORITY);
+  } else {
+    printf("[IR] TX task unavailable; sending from loop()\n");
+  }
+#endif
 }
 
 void setupWebserver() {
+  g_bootTag = esp_random();
   server.on("/", HTTP_GET, handleRoot);
-  // Serve static assets from LittleFS (app.css, app.js, etc.)
-  server.serveStatic("/app.css", LittleFS, "/app.css").setCacheControl("max-age=86400");
-  server.serveStatic("/app.js", LittleFS, "/app.js").setCacheControl("max-age=86400");
+  // Static assets from LittleFS (app.css, app.js)
+  for (StaticAsset &asset : g_staticAssets) {
+    asset.etag = fileEtag(asset.path);
+    server.on(asset.path, HTTP_GET, [&asset](AsyncWebServerRequest *request) { handleStaticAsset(request, asset); });
+  }
   server.on("/ip", HTTP_GET, [](AsyncWebServerRequest *request) { request->send(200, "text/plain", WiFi.localIP().toString()); });
   server.on("/last", HTTP_GET, handleLast);
+  // "/send" also matches "/send/batch" so the batch goes first
+  server.on("/send/batch", HTTP_POST, [](AsyncWebServerRequest *request) {
+    if (request->contentLength() == 0) {
+      request->send(411, "application/json", "{\"ok\":false,\"error\":\"Content-Length required\"}");
+      return;
+    }
+    /* body handled in onSendBatchBody */
+  }, nullptr, onSendBatchBody);
   server.on("/send", HTTP_POST, handleSend);
   // GET removed for security
   server.on("/save", HTTP_POST, [](AsyncWebServerRequest *request) { if (request->contentLength() == 0) handleSaveGet(request); }, nullptr, onSaveBody);
   ws.onEvent(onWsEvent);
   server.addHandler(&ws);
+  // "/saved" also matches "/saved/..." so GET sub-paths go first
+  server.on("/saved/backup", HTTP_GET, handleSavedBackup);
   server.on("/saved", HTTP_GET, handleSaved);
   server.on("/saved/import", HTTP_POST, [](AsyncWebServerRequest *request) {
     if (request->contentLength() == 0) {
@@ -943,9 +2361,31 @@ void setupWebserver() {
     }
     /* body handled in onSavedImportBody */
   }, nullptr, onSavedImportBody);
+  server.on("/saved/restore", HTTP_POST, [](AsyncWebServerRequest *request) {
+    if (request->contentLength() == 0) {
+      request->send(411, "application/json", "{\"ok\":false,\"error\":\"Content-Length required\"}");
+      return;
+    }
+    /* body handled in onSavedRestoreBody */
+  }, nullptr, onSavedRestoreBody);
   server.on("/saved/delete", HTTP_POST, handleSavedDelete);
   server.on("/saved/rename", HTTP_POST, handleSavedRename);
+  server.on("/saved/move", HTTP_POST, handleSavedMove);
+  server.on("/saved/flush", HTTP_POST, handleSavedFlush);
+  // "/sequences" also matches "/sequences/..." so the sub-paths go first
+  server.on("/sequences/delete", HTTP_POST, handleSequenceDelete);
+  server.on("/sequences/send", HTTP_POST, handleSequenceSend);
+  server.on("/sequences", HTTP_GET, handleSequences);
+  server.on("/sequences", HTTP_POST, [](AsyncWebServerRequest *request) {
+    if (request->contentLength() == 0) {
+      request->send(411, "application/json", "{\"error\":\"Content-Length required\"}");
+      return;
+    }
+    /* body handled in onSequenceBody */
+  }, nullptr, onSequenceBody);
   server.on("/dump", HTTP_GET, handleDump);
+  server.on("/stats", HTTP_GET, handleStats);
+  server.on("/jobs", HTTP_GET, handleJobs);  // also matches /jobs/<id>
   server.on("/favicon.ico", HTTP_GET, [](AsyncWebServerRequest *request) { request->send(204, "text/plain", ""); });
   server.onNotFound([](AsyncWebServerRequest *request) { request->send(404, "text/plain", "Not found"); });
   server.begin();
@@ -984,6 +2424,87 @@ void handleHeartbeat() {
   }
 }
 
+// IR event bodies for /ws are serialized once into a shared buffer that
+// every client's send queue references (see broadcastIrEvents()).
+static AsyncWebSocketSharedBuffer irEventJson(uint16_t repeat) {
+  const IrCapture &c = history[historyHead];
+  JsonDocument doc;
+  doc["event"] = "ir";
+  doc["seq"] = lastCodeSeq;
+  doc["human"] = lastHumanReadable;
+  doc["raw"] = lastRawJson;
+  doc["replayUrl"] = replayUrlFor(c);
+  doc["protocol"] = c.protocol;
+  doc["value"] = uint64ToHexBits(c.value, c.bits);
+  doc["bits"] = c.bits;
+  doc["repeat"] = repeat;
+  appendSavedMatch(doc, g_wsEventMatch);
+  size_t len = measureJson(doc);
+  AsyncWebSocketSharedBuffer body = std::make_shared<std::vector<uint8_t>>(len + 1);
+  serializeJson(doc, (char *)body->data(), len + 1);
+  body->resize(len);
+  g_wsEventBodies++;
+  return body;
+}
+
+static AsyncWebSocketSharedBuffer irEventBinary(uint16_t repeat) {
+  AsyncWebSocketSharedBuffer body = std::make_shared<std::vector<uint8_t>>(kWsIrEventBytes);
+  wsEncodeIrEvent(wsIrEvent(history[historyHead], g_wsEventMatch, repeat), body->data());
+  g_wsEventBodies++;
+  return body;
+}
+
+// Send the IR events that are due. Polled from loop(); returns at once
+// unless a code came in or some client still has one waiting.
+static void broadcastIrEvents() {
+  if (!g_wsEvents.waiting()) return;
+  // Bodies built this pass, per repeat count; clients on the same schedule
+  // share one
+  struct Bodies {
+    uint16_t repeat;
+    AsyncWebSocketSharedBuffer json;
+    AsyncWebSocketSharedBuffer binary;
+  } bodies[4];
+  size_t bodyCount = 0;
+  // Work from a copy of the ids; a client may go at any point, so it is
+  // only ever reached by id through the server's locked helpers (a client
+  // that has gone reads as writable and the send is dropped)
+  uint32_t ids[WS_CLIENTS_MAX];
+  size_t idCount = 0;
+  for (const std::atomic<uint32_t> &slot : g_wsClients) {
+    uint32_t id = slot.load();
+    if (id) ids[idCount++] = id;
+  }
+  g_wsEvents.beginPass(millis());
+  for (size_t i = 0; i < idCount; i++) {
+    uint32_t id = ids[i];
+    WsEventLimiter::Decision d = g_wsEvents.next(id, ws.availableForWrite(id));
+    if (d.action == WsEventLimiter::Action::Close) {
+      printf("[WS] Closing client %u: send queue full for %u ms\n", (unsigned)id, (unsigned)WS_EVENT_STALL_MS);
+      ws.close(id);
+      continue;
+    }
+    if (d.action != WsEventLimiter::Action::Send) continue;
+    Bodies spare = {d.repeat, nullptr, nullptr};
+    Bodies *b = &spare;
+    for (size_t k = 0; k < bodyCount; k++) {
+      if (bodies[k].repeat == d.repeat) b = &bodies[k];
+    }
+    if (b == &spare && bodyCount < sizeof(bodies) / sizeof(bodies[0])) {
+      b = &bodies[bodyCount++];
+      *b = spare;
+    }
+    if (hasWsClientId(g_wsBinaryClients, id)) {
+      if (!b->binary) b->binary = irEventBinary(d.repeat);
+      ws.binary(id, b->binary);
+    } else {
+      if (!b->json) b->json = irEventJson(d.repeat);
+      ws.text(id, b->json);
+    }
+  }
+  g_wsEvents.endPass();
+}
+
 void handleIRReceive() {
 #if IR_RECV_ENABLED
   if (irrecv.decode(&results)) {
@@ -999,24 +2520,31 @@ void handleIRReceive() {
     history[historyHead].human = lastHumanReadable;
     if (historyLen < HISTORY_SIZE) historyLen++;
 
+    // Keep the timings of codes IRsend cannot encode so they can be saved and replayed
+    decode_type_t sendable;
+    lastCaptureTimingsCount = 0;
+    if (!parseSendableProtocol(history[historyHead].protocol.c_str(), sendable)) {
+      uint16_t count = getCorrectedRawLength(&results);
+      if (count <= IrSender::kMaxRawTimings) {
+        uint16_t *timings = resultToRawArray(&results);
+        memcpy(lastCaptureTimings, timings, count * sizeof(uint16_t));
+        delete[] timings;
+        lastCaptureTimingsCount = count;
+      }
+    }
+
+    SavedMatch match = findSavedMatch(history[historyHead]);
     printf("[IR] %s\n", lastHumanReadable.c_str());
     printf("[IR] %s\n", lastRawJson.c_str());
-
-    if (ws.count() > 0) {
-      JsonDocument doc;
-      doc["event"] = "ir";
-      doc["seq"] = lastCodeSeq;
-      doc["human"] = lastHumanReadable;
-      doc["raw"] = lastRawJson;
-      doc["replayUrl"] = replayUrlFor(history[historyHead]);
-      doc["protocol"] = history[historyHead].protocol;
-      doc["value"] = uint64ToHex(history[historyHead].value);
-      doc["bits"] = history[historyHead].bits;
-      String out;
-      serializeJson(doc, out);
-      ws.textAll(out);
+    if (match.index >= 0) {
+      printf("[IR] Matches saved code %d \"%s\"%s\n", match.index, match.name.c_str(),
+             match.exact ? "" : " (bits differ)");
     }
 
+    // Sent to /ws clients by broadcastIrEvents(), paced per client
+    g_wsEventMatch = match;
+    g_wsEvents.capture((int16_t)results.decode_type, results.value, results.bits);
+
     irrecv.resume();
   }
 #endif
@@ -1024,9 +2552,12 @@ void handleIRReceive() {
 
 void loop() {
   irSender.loop();
+  broadcastJobEvents();
   handleHeartbeat();
   handleIRReceive();
+  broadcastIrEvents();
   loopBLE();
+  if (!g_commitTask.running()) commitSavedCodes(false);
 
   // AsyncWebServer handles HTTP in background.
 }
@@ -0,0 +1,186 @@
+#include "saved_backup.h"
+#include <string.h>
+
+// Element kinds
+enum : uint8_t { kCodesElement = 1, kSequenceElement = 2 };
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+uint32_t savedBackupCrc32(const uint8_t* data, size_t len, uint32_t crc) {
+    // Reflected polynomial 0xEDB88320, a nibble at a time
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+SavedBackupWriter::SavedBackupWriter(const SavedCodeTable& codes, const SavedSequenceTable& sequences)
+    : _codes(codes), _sequences(sequences) {
+    rewind();
+    _element.clear();
+    while (nextElement()) {
+        _bodyBytes += _element.size();
+        _crc = savedBackupCrc32(_element.data(), _element.size(), _crc);
+    }
+    rewind();
+}
+
+// Back to the start: the header is the first thing read.
+void SavedBackupWriter::rewind() {
+    _nextCode = 0;
+    _nextSequence = 0;
+    _elementPos = 0;
+    _element.assign(kSavedBackupHeaderBytes, 0);
+    memcpy(&_element[0], "IRB", 3);
+    _element[3] = kSavedBackupVersion;
+    put32(&_element[4], (uint32_t)_bodyBytes);
+    put32(&_element[8], _crc);
+    put16(&_element[12], (uint16_t)_codes.size());
+    put16(&_element[14], (uint16_t)_sequences.size());
+}
+
+// Build the next body element in _element. False after the last one.
+bool SavedBackupWriter::nextElement() {
+    _elementPos = 0;
+    if (_nextCode < _codes.size()) {
+        size_t count = 0;
+        size_t bytes = SavedCodeTable::kBlobHeaderBytes;
+        while (_nextCode + count < _codes.size()) {
+            size_t code = _codes.blobBytes(_nextCode + count, 1) - SavedCodeTable::kBlobHeaderBytes;
+            if (count > 0 && bytes + code > kSavedBackupCodesTarget) break;
+            bytes += code;
+            count++;
+        }
+        _codes.toBlob(_blob, _nextCode, count);
+        _nextCode += count;
+        _element.assign(kSavedBackupElementHeaderBytes, 0);
+        _element[0] = kCodesElement;
+        put32(&_element[1], (uint32_t)_blob.size());
+        _element.insert(_element.end(), _blob.begin(), _blob.end());
+        return true;
+    }
+    if (_nextSequence < _sequences.size()) {
+        size_t i = _nextSequence++;
+        size_t len = _sequences.recordBytes(i);
+        _element.assign(kSavedBackupElementHeaderBytes + len, 0);
+        _element[0] = kSequenceElement;
+        put32(&_element[1], (uint32_t)len);
+        _sequences.toRecord(i, &_element[kSavedBackupElementHeaderBytes]);
+        return true;
+    }
+    _element.clear();
+    return false;
+}
+
+size_t SavedBackupWriter::read(uint8_t* buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        if (_elementPos == _element.size() && !nextElement()) break;
+        size_t n = _element.size() - _elementPos;
+        if (n > len - done) n = len - done;
+        memcpy(buf + done, &_element[_elementPos], n);
+        _elementPos += n;
+        done += n;
+    }
+    return done;
+}
+
+SavedBackupReader::Status SavedBackupReader::fail(const char* error) {
+    _status = Status::Error;
+    _error = error;
+    return _status;
+}
+
+SavedBackupReader::Status SavedBackupReader::feed(const uint8_t* data, size_t len) {
+    if (_status == Status::Error) return _status;
+    if (_status == Status::Done) return len > 0 ? fail("Data after the image") : _status;
+    while (len > 0) {
+        size_t n = _need - _buf.size();
+        if (n > len) n = len;
+        if (!_inHeader) {
+            if (n > _bodyBytes - _bodyRead) return fail("Element overruns the image");
+            _crc = savedBackupCrc32(data, n, _crc);
+            _bodyRead += n;
+        }
+        _buf.insert(_buf.end(), data, data + n);
+        data += n;
+        len -= n;
+        if (_buf.size() < _need) break;
+
+        if (_inHeader) {
+            const uint8_t* h = _buf.data();
+            if (memcmp(h, "IRB", 3) != 0) return fail("Not a backup image");
+            if (h[3] != kSavedBackupVersion) return fail("Unsupported image version");
+            _bodyBytes = get32(h + 4);
+            _expectedCrc = get32(h + 8);
+            _expectedCodes = get16(h + 12);
+            _expectedSequences = get16(h + 14);
+            _inHeader = false;
+            _need = kSavedBackupElementHeaderBytes;
+        } else if (!_inPayload) {
+            size_t payload = get32(&_buf[1]);
+            if (payload > kSavedBackupMaxElementBytes) return fail("Element too large");
+            _inPayload = true;
+            _need += payload;
+            if (payload > 0) continue;
+        }
+        if (_inPayload) {
+            if (!applyElement()) return _status == Status::Error ? _status : fail("Corrupt image");
+            _inPayload = false;
+            _need = kSavedBackupElementHeaderBytes;
+        }
+        _buf.clear();
+        if (_bodyRead == _bodyBytes) break;
+    }
+    if (!_inHeader && _bodyRead == _bodyBytes && _buf.empty()) {
+        if (_crc != _expectedCrc) return fail("CRC mismatch");
+        if (_codes.size() != _expectedCodes || _sequences.size() != _expectedSequences) {
+            return fail("Counts do not match the header");
+        }
+        _status = Status::Done;
+        if (len > 0) return fail("Data after the image");
+    }
+    return _status;
+}
+
+// Apply the element in _buf (header and payload) to the tables.
+bool SavedBackupReader::applyElement() {
+    const uint8_t* payload = _buf.data() + kSavedBackupElementHeaderBytes;
+    size_t len = _buf.size() - kSavedBackupElementHeaderBytes;
+    switch (_buf[0]) {
+    case kCodesElement:
+        if (_sequences.size() > 0) {
+            fail("Codes after sequences");
+            return false;
+        }
+        return _codes.appendBlob(payload, len);
+    case kSequenceElement:
+        return _sequences.addRecord(payload, len);
+    default:
+        fail("Unknown element");
+        return false;
+    }
+}
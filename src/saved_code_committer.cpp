@@ -0,0 +1,46 @@
+#include "saved_code_committer.h"
+
+// Milliseconds from now until `at`, 0 if it has passed
+static uint32_t until(uint32_t nowMs, uint32_t atMs) {
+    int32_t remaining = (int32_t)(atMs - nowMs);
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
+
+void SavedCodeCommitter::changed(uint32_t nowMs) {
+    if (!_pending) _firstMs = nowMs;
+    _pending = true;
+    _lastMs = nowMs;
+}
+
+uint32_t SavedCodeCommitter::dueInMs(uint32_t nowMs, bool worthwhile) const {
+    if (!_pending || !worthwhile) return kIdle;
+    uint32_t quiet = until(nowMs, _lastMs + _quietMs);
+    uint32_t latest = until(nowMs, _firstMs + _maxDelayMs);
+    uint32_t due = quiet < latest ? quiet : latest;
+    if (_retrying) {
+        uint32_t retry = until(nowMs, _retryAtMs);
+        if (retry > due) due = retry;
+    }
+    return due;
+}
+
+void SavedCodeCommitter::committed(uint32_t startMs, uint32_t endMs, bool ok, bool pending) {
+    uint32_t took = endMs - startMs;
+    _lastCommitMs = took;
+    if (took > _maxCommitMs) _maxCommitMs = took;
+    if (!ok) {
+        _failures++;
+        _retrying = true;
+        _retryAtMs = endMs + _retryMs;
+        return;
+    }
+    _commits++;
+    _retrying = false;
+    if (_pending) _lastLatencyMs = endMs - _firstMs;
+    // Changes made during the write are at most as old as the commit
+    _pending = pending;
+    if (pending) {
+        _firstMs = startMs;
+        if ((int32_t)(_lastMs - startMs) < 0) _lastMs = startMs;
+    }
+}
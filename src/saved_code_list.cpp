@@ -0,0 +1,121 @@
+#include "saved_code_list.h"
+#include <stdio.h>
+#include <string.h>
+
+// The entry text is rebuilt in place for each entry; most fit in this much.
+static const size_t kPieceReserve = 256;
+
+// Append s as a JSON string, escaping what ArduinoJson escapes.
+static void appendJsonString(std::string& out, const char* s) {
+    out += '"';
+    for (; *s; s++) {
+        char c = *s;
+        const char* escape = nullptr;
+        switch (c) {
+        case '"': escape = "\\\""; break;
+        case '\\': escape = "\\\\"; break;
+        case '\b': escape = "\\b"; break;
+        case '\f': escape = "\\f"; break;
+        case '\n': escape = "\\n"; break;
+        case '\r': escape = "\\r"; break;
+        case '\t': escape = "\\t"; break;
+        }
+        if (escape) {
+            out += escape;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+SavedCodeListWriter::SavedCodeListWriter(const SavedCodeTable& codes, Format format, ProtocolNameFn protocolName)
+    : _codes(codes), _format(format), _protocolName(protocolName) {
+    _piece.reserve(kPieceReserve);
+}
+
+size_t SavedCodeListWriter::size() const {
+    SavedCodeListWriter counter(_codes, _format, _protocolName);
+    uint8_t buf[128];
+    size_t total = 0;
+    for (size_t n; (n = counter.read(buf, sizeof(buf))) > 0;) total += n;
+    return total;
+}
+
+size_t SavedCodeListWriter::read(uint8_t* buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        if (_piecePos == _piece.size() && !nextPiece()) break;
+        size_t n = _piece.size() - _piecePos;
+        if (n > len - done) n = len - done;
+        memcpy(buf + done, _piece.data() + _piecePos, n);
+        _piecePos += n;
+        done += n;
+    }
+    return done;
+}
+
+// Build the next text to read out in _piece. False at the end.
+bool SavedCodeListWriter::nextPiece() {
+    _piece.clear();
+    _piecePos = 0;
+    if (_finished) return false;
+    if (!_started) {
+        _started = true;
+        if (_format == Format::Json) {
+            _piece += '[';
+        } else {
+            char buf[64];
+            snprintf(buf, sizeof(buf), "// Count: %d\n\n", (int)_codes.size());
+            _piece += "// Saved IR codes \xE2\x80\x94 paste into firmware\n";
+            _piece += buf;
+        }
+    }
+    if (_next < _codes.size()) {
+        if (_format == Format::Json) {
+            appendJsonEntry(_next);
+        } else {
+            appendDumpEntry(_next);
+        }
+        _next++;
+        return true;
+    }
+    _finished = true;
+    if (_format == Format::Json) _piece += ']';
+    return !_piece.empty();
+}
+
+void SavedCodeListWriter::appendJsonEntry(size_t i) {
+    char num[48];
+    snprintf(num, sizeof(num), "%s{\"index\":%u,\"id\":%u,\"name\":", i ? "," : "", (unsigned)i,
+             (unsigned)_codes.at(i).id);
+    _piece += num;
+    appendJsonString(_piece, _codes.name(i));
+    _piece += ",\"protocol\":";
+    appendJsonString(_piece, _codes.protocolName(i));
+    _piece += ",\"value\":";
+    appendJsonString(_piece, _codes.valueText(i));
+    snprintf(num, sizeof(num), ",\"bits\":%u}", (unsigned)_codes.at(i).bits);
+    _piece += num;
+}
+
+void SavedCodeListWriter::appendDumpEntry(size_t i) {
+    const char* name = _codes.name(i);
+    const char* protocol = *_codes.protocolName(i) ? _codes.protocolName(i) : "UNKNOWN";
+    const char* valueHex = *_codes.valueText(i) ? _codes.valueText(i) : "0";
+    unsigned bits = _codes.at(i).bits;
+    char buf[256];
+    snprintf(buf, sizeof(buf), "// %d %s %s 0x%s %ub\n", (int)i, name, protocol, valueHex, bits);
+    _piece += buf;
+
+    decode_type_t type = (decode_type_t)_codes.at(i).protocol;
+    if (type == decode_type_t::NEC) {
+        snprintf(buf, sizeof(buf), "irsend.sendNEC(0x%su, %u);  // %s\n", valueHex, bits, name);
+    } else if (type != decode_type_t::UNKNOWN) {
+        snprintf(buf, sizeof(buf), "irsend.send(%s, 0x%sULL, %u);  // %s\n",
+                 _protocolName ? _protocolName(type) : protocol, valueHex, bits, name);
+    } else {
+        snprintf(buf, sizeof(buf), "// irsend.send... (unsupported protocol); value=0x%s %s\n", valueHex, name);
+    }
+    _piece += buf;
+}
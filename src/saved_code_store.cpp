@@ -0,0 +1,371 @@
+#include "saved_code_store.h"
+#include <stdio.h>
+#include <string.h>
+
+static const size_t kJournalHeaderBytes = 8;
+static const uint8_t kJournalVersion = 1;
+static const size_t kRecordOverhead = 5;  // op, length, check
+
+// Journal record ops
+enum : uint8_t {
+    kAppend = 1,
+    kRename = 2,
+    kRemove = 3,
+    kMove = 4,
+    kSnapshot = 5,
+    kSequenceAdd = 6,
+    kSequenceRemove = 7,
+};
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint32_t fnv1a(const uint8_t* p, size_t len, uint32_t h = 2166136261u) {
+    for (size_t i = 0; i < len; i++) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+// Check value of a record: its op and length bytes, then the payload
+static uint16_t recordCheck(const uint8_t* head, const uint8_t* payload, size_t len) {
+    uint32_t h = fnv1a(payload, len, fnv1a(head, 3));
+    return (uint16_t)(h ^ (h >> 16));
+}
+
+// Length of the intact record at data[pos], or 0 if it is cut short or
+// fails its check.
+static size_t recordBytes(const std::vector<uint8_t>& data, size_t pos) {
+    if (data.size() - pos < kRecordOverhead) return 0;
+    size_t len = get16(&data[pos + 1]);
+    if (data.size() - pos - kRecordOverhead < len) return 0;
+    if (get16(&data[pos + 3 + len]) != recordCheck(&data[pos], &data[pos + 3], len)) return 0;
+    return kRecordOverhead + len;
+}
+
+// The snapshot of both tables: the codes' blob, then the sequences' blob
+// when there are any (so a store without sequences reads as before they
+// were stored here)
+static void snapshotOf(const SavedCodeTable& codes, const SavedSequenceTable& sequences, std::vector<uint8_t>& out) {
+    codes.toBlob(out);
+    if (sequences.size() == 0) return;
+    std::vector<uint8_t> blob;
+    sequences.toBlob(blob);
+    out.insert(out.end(), blob.begin(), blob.end());
+}
+
+// Load a snapshot into the tables. False (tables in no defined state) if it
+// cannot be read.
+static bool loadSnapshot(SavedCodeTable& codes, SavedSequenceTable& sequences, const std::vector<uint8_t>& blob) {
+    size_t codesBytes = SavedCodeTable::blobLength(blob.data(), blob.size());
+    if (codesBytes == 0 || codesBytes > blob.size() || !codes.loadBlob(blob.data(), codesBytes)) return false;
+    if (codesBytes == blob.size()) {
+        sequences.clear();
+        return true;
+    }
+    return sequences.loadBlob(&blob[codesBytes], blob.size() - codesBytes);
+}
+
+// Apply one journal record to the tables. False if it does not fit them.
+static bool applyRecord(SavedCodeTable& table, SavedSequenceTable& sequences, uint8_t op, const uint8_t* payload,
+                        size_t len) {
+    int index = len >= 2 ? table.indexOfId(get16(payload)) : -1;
+    switch (op) {
+    case kAppend:
+        return table.appendBlob(payload, len);
+    case kRename: {
+        if (index < 0) return false;
+        std::vector<char> name(payload + 2, payload + len);
+        name.push_back('\0');
+        table.rename(index, name.data());
+        return true;
+    }
+    case kRemove:
+        if (index < 0 || len != 2) return false;
+        table.remove(index);
+        return true;
+    case kMove: {
+        if (index < 0 || len != 4 || get16(payload + 2) >= table.size()) return false;
+        table.move(index, get16(payload + 2));
+        return true;
+    }
+    case kSnapshot:
+        return len == 4;
+    case kSequenceAdd:
+        return sequences.addRecord(payload, len);
+    case kSequenceRemove:
+        if (len != 2 || get16(payload) >= sequences.size()) return false;
+        sequences.remove(get16(payload));
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool SavedCodeStore::load(SavedCodeTable& table, SavedSequenceTable& sequences) {
+    table.clear();
+    sequences.clear();
+    _haveSnapshot = false;
+    _snapshotBytes = 0;
+    _journalBytes = 0;
+    _changes = 0;
+    _journalTorn = false;
+    std::vector<uint8_t> blob;
+    if (!readSnapshot(blob)) return false;
+    if (!loadSnapshot(table, sequences, blob)) {
+        printf("[IR] Saved codes snapshot in %s unreadable (%u bytes)\n", name(), (unsigned)blob.size());
+        table.clear();
+        sequences.clear();
+        return false;
+    }
+    _haveSnapshot = true;
+    _snapshotHash = fnv1a(blob.data(), blob.size());
+    _snapshotBytes = blob.size();
+    blob = std::vector<uint8_t>();  // free it before the replay allocates
+
+    std::vector<uint8_t> journal;
+    if (readJournal(journal, 0) && !journal.empty()) replay(table, sequences, journal);
+    return true;
+}
+
+// Replay the journal onto the snapshot just loaded, from the header or the
+// record of that snapshot. A journal that leads to neither (left over from
+// an older snapshot) is removed.
+bool SavedCodeStore::replay(SavedCodeTable& table, SavedSequenceTable& sequences, const std::vector<uint8_t>& journal) {
+    size_t start = 0, end = kJournalHeaderBytes;
+    if (journal.size() >= kJournalHeaderBytes && memcmp(journal.data(), "IRL", 3) == 0 &&
+        journal[3] == kJournalVersion) {
+        if (get32(&journal[4]) == _snapshotHash) start = end;
+        for (size_t n; (n = recordBytes(journal, end)) > 0; end += n) {
+            if (journal[end] == kSnapshot && get16(&journal[end + 1]) == 4 && get32(&journal[end + 3]) == _snapshotHash)
+                start = end + n;
+        }
+    }
+    if (start == 0) {
+        printf("[IR] Saved codes journal in %s does not follow the snapshot, removing it\n", name());
+        writeJournal(nullptr, 0);
+        return false;
+    }
+    for (size_t pos = start; pos < end; pos += kRecordOverhead + get16(&journal[pos + 1])) {
+        const uint8_t* payload = &journal[pos + 3];
+        if (!applyRecord(table, sequences, journal[pos], payload, get16(&journal[pos + 1]))) {
+            end = pos;
+            break;
+        }
+        if (journal[pos] != kSnapshot) _changes++;
+    }
+    _journalBytes = end;
+    _journalTorn = end < journal.size();
+    if (_journalTorn) {
+        printf("[IR] Saved codes journal in %s has a torn tail after %u bytes\n", name(), (unsigned)end);
+    }
+    return true;
+}
+
+bool SavedCodeStore::save(const SavedCodeTable& table, const SavedSequenceTable& sequences) {
+    std::vector<uint8_t> blob;
+    snapshotOf(table, sequences, blob);
+    if (!writeSnapshot(blob.data(), blob.size())) {
+        printf("[IR] Failed to write %u-byte saved codes snapshot (%s full?)\n", (unsigned)blob.size(), name());
+        return false;
+    }
+    // A journal that is not removed no longer matches the snapshot's hash
+    writeJournal(nullptr, 0);
+    _haveSnapshot = true;
+    _snapshotHash = fnv1a(blob.data(), blob.size());
+    _snapshotBytes = blob.size();
+    _journalBytes = 0;
+    _changes = 0;
+    _journalTorn = false;
+    return true;
+}
+
+bool SavedCodeStore::appendRecord(const SavedCodeTable& table, const SavedSequenceTable& sequences, uint8_t op,
+                                  const uint8_t* payload, size_t len) {
+    if (!_haveSnapshot) return save(table, sequences);
+    if (len > UINT16_MAX) return false;
+
+    bool fresh = _journalBytes == 0;
+    std::vector<uint8_t> record;
+    record.reserve(kJournalHeaderBytes + kRecordOverhead + len);
+    if (fresh) {
+        uint8_t header[kJournalHeaderBytes] = {'I', 'R', 'L', kJournalVersion};
+        put32(header + 4, _snapshotHash);
+        record.insert(record.end(), header, header + sizeof(header));
+    }
+    uint8_t head[3] = {op, 0, 0};
+    put16(head + 1, (uint16_t)len);
+    uint8_t check[2];
+    put16(check, recordCheck(head, payload, len));
+    record.insert(record.end(), head, head + sizeof(head));
+    record.insert(record.end(), payload, payload + len);
+    record.insert(record.end(), check, check + sizeof(check));
+
+    bool ok;
+    if (fresh) {
+        ok = writeJournal(record.data(), record.size());
+    } else if (_journalTorn) {
+        // A torn record would hide every later one: rewrite without it
+        std::vector<uint8_t> journal;
+        ok = readJournal(journal, 0) && journal.size() >= _journalBytes;
+        journal.resize(_journalBytes);
+        journal.insert(journal.end(), record.begin(), record.end());
+        ok = ok && writeJournal(journal.data(), journal.size());
+    } else {
+        ok = appendJournal(record.data(), record.size());
+    }
+    if (!ok) {
+        _journalTorn = !fresh;
+        printf("[IR] Failed to journal a saved codes change (%s full?)\n", name());
+        return false;
+    }
+    _journalBytes += record.size();
+    _journalTorn = false;
+    if (op != kSnapshot) _changes++;
+    return true;
+}
+
+bool SavedCodeStore::appended(const SavedCodeTable& table, const SavedSequenceTable& sequences) {
+    std::vector<uint8_t> blob;
+    table.toBlob(blob, table.size() - 1, 1);
+    return appendRecord(table, sequences, kAppend, blob.data(), blob.size());
+}
+
+bool SavedCodeStore::renamed(const SavedCodeTable& table, const SavedSequenceTable& sequences, size_t index) {
+    const char* name = table.name(index);
+    size_t nameLen = strlen(name);
+    std::vector<uint8_t> payload(2 + nameLen);
+    put16(&payload[0], table.at(index).id);
+    memcpy(&payload[2], name, nameLen);
+    return appendRecord(table, sequences, kRename, payload.data(), payload.size());
+}
+
+bool SavedCodeStore::removed(const SavedCodeTable& table, const SavedSequenceTable& sequences, uint16_t id) {
+    uint8_t payload[2];
+    put16(payload, id);
+    return appendRecord(table, sequences, kRemove, payload, sizeof(payload));
+}
+
+bool SavedCodeStore::moved(const SavedCodeTable& table, const SavedSequenceTable& sequences, size_t to) {
+    uint8_t payload[4];
+    put16(payload, table.at(to).id);
+    put16(payload + 2, (uint16_t)to);
+    return appendRecord(table, sequences, kMove, payload, sizeof(payload));
+}
+
+bool SavedCodeStore::sequenceAdded(const SavedCodeTable& table, const SavedSequenceTable& sequences) {
+    std::vector<uint8_t> record(sequences.recordBytes(sequences.size() - 1));
+    sequences.toRecord(sequences.size() - 1, record.data());
+    return appendRecord(table, sequences, kSequenceAdd, record.data(), record.size());
+}
+
+bool SavedCodeStore::sequenceRemoved(const SavedCodeTable& table, const SavedSequenceTable& sequences, size_t index) {
+    uint8_t payload[2];
+    put16(payload, (uint16_t)index);
+    return appendRecord(table, sequences, kSequenceRemove, payload, sizeof(payload));
+}
+
+bool SavedCodeStore::beginCommit(const SavedCodeTable& table, const SavedSequenceTable& sequences, Commit& commit) {
+    if (!_haveSnapshot || _changes == 0) return false;
+    snapshotOf(table, sequences, commit.blob);
+    commit.hash = fnv1a(commit.blob.data(), commit.blob.size());
+    commit.changes = _changes;
+    uint8_t payload[4];
+    put32(payload, commit.hash);
+    if (!appendRecord(table, sequences, kSnapshot, payload, sizeof(payload))) return false;
+    commit.journalMark = _journalBytes;
+    return true;
+}
+
+bool SavedCodeStore::writeCommit(const Commit& commit) {
+    if (writeSnapshot(commit.blob.data(), commit.blob.size())) return true;
+    printf("[IR] Failed to write %u-byte saved codes snapshot (%s full?)\n", (unsigned)commit.blob.size(), name());
+    return false;
+}
+
+bool SavedCodeStore::endCommit(const Commit& commit) {
+    _snapshotHash = commit.hash;
+    _snapshotBytes = commit.blob.size();
+
+    // Changes journaled while the snapshot was written start the new journal
+    std::vector<uint8_t> tail;
+    if (_journalBytes <= commit.journalMark || !readJournal(tail, commit.journalMark)) tail.clear();
+    if (tail.size() > _journalBytes - commit.journalMark) tail.resize(_journalBytes - commit.journalMark);
+    size_t changes = 0;
+    for (size_t pos = 0, n; pos < tail.size(); pos += n) {
+        n = recordBytes(tail, pos);
+        if (n == 0) {
+            tail.resize(pos);
+            break;
+        }
+        if (tail[pos] != kSnapshot) changes++;
+    }
+    _changes = changes;
+
+    std::vector<uint8_t> journal;
+    if (!tail.empty()) {
+        journal.assign({'I', 'R', 'L', kJournalVersion, 0, 0, 0, 0});
+        put32(&journal[4], commit.hash);
+        journal.insert(journal.end(), tail.begin(), tail.end());
+    }
+    if (!writeJournal(journal.data(), journal.size())) {
+        // The old journal still leads to the new snapshot through its record
+        printf("[IR] Failed to trim the saved codes journal (%s full?)\n", name());
+        return false;
+    }
+    _journalBytes = journal.size();
+    _journalTorn = false;
+    return true;
+}
+
+bool SavedCodeStoreMemory::fits(size_t snapshotBytes, size_t journalBytes) const {
+    return snapshotBytes <= _capacity && journalBytes <= _capacity - snapshotBytes;
+}
+
+bool SavedCodeStoreMemory::readSnapshot(std::vector<uint8_t>& out) {
+    out = _snapshot;
+    return _haveSnapshot;
+}
+
+bool SavedCodeStoreMemory::writeSnapshot(const uint8_t* data, size_t len) {
+    if (!fits(len, _journal.size())) return false;
+    _snapshot.assign(data, data + len);
+    _haveSnapshot = true;
+    _writes++;
+    _bytesWritten += len;
+    return true;
+}
+
+bool SavedCodeStoreMemory::readJournal(std::vector<uint8_t>& out, size_t from) {
+    out.assign(_journal.begin() + (from < _journal.size() ? from : _journal.size()), _journal.end());
+    return true;
+}
+
+bool SavedCodeStoreMemory::writeJournal(const uint8_t* data, size_t len) {
+    if (!fits(_snapshot.size(), len)) return false;
+    _journal.assign(data, data + len);
+    _writes++;
+    _bytesWritten += len;
+    return true;
+}
+
+bool SavedCodeStoreMemory::appendJournal(const uint8_t* data, size_t len) {
+    if (!fits(_snapshot.size(), _journal.size() + len)) return false;
+    _journal.insert(_journal.end(), data, data + len);
+    _writes++;
+    _bytesWritten += len;
+    return true;
+}
@@ -0,0 +1,68 @@
+#include "saved_code_store_fs.h"
+#include <stdio.h>
+
+SavedCodeStoreFs::SavedCodeStoreFs(fs::FS& fs, const char* dir) : _fs(fs) {
+    snprintf(_snapshotPath, sizeof(_snapshotPath), "%s/codes.bin", dir);
+    snprintf(_snapshotTmpPath, sizeof(_snapshotTmpPath), "%s/codes.tmp", dir);
+    snprintf(_journalPath, sizeof(_journalPath), "%s/codes.log", dir);
+    snprintf(_journalTmpPath, sizeof(_journalTmpPath), "%s/codes.log.tmp", dir);
+}
+
+size_t SavedCodeStoreFs::commitAfterBytes() const {
+    return snapshotBytes() > kCommitMinBytes ? snapshotBytes() : kCommitMinBytes;
+}
+
+bool SavedCodeStoreFs::readFile(const char* path, std::vector<uint8_t>& out, size_t from) {
+    out.clear();
+    if (!_fs.exists(path)) return false;
+    fs::File f = _fs.open(path, FILE_READ);
+    if (!f) return false;
+    size_t size = f.size();
+    bool read = true;
+    if (from < size) {
+        out.resize(size - from);
+        read = f.seek(from) && f.read(out.data(), out.size()) == out.size();
+    }
+    f.close();
+    if (!read) out.clear();
+    return read;
+}
+
+bool SavedCodeStoreFs::replaceFile(const char* path, const char* tmpPath, const uint8_t* data, size_t len) {
+    fs::File f = _fs.open(tmpPath, FILE_WRITE, true);
+    bool written = f && (len == 0 || f.write(data, len) == len);
+    if (f) f.close();
+    if (!written || !_fs.rename(tmpPath, path)) {
+        _fs.remove(tmpPath);
+        return false;
+    }
+    return true;
+}
+
+bool SavedCodeStoreFs::readSnapshot(std::vector<uint8_t>& out) {
+    return readFile(_snapshotPath, out, 0);
+}
+
+bool SavedCodeStoreFs::writeSnapshot(const uint8_t* data, size_t len) {
+    return replaceFile(_snapshotPath, _snapshotTmpPath, data, len);
+}
+
+bool SavedCodeStoreFs::readJournal(std::vector<uint8_t>& out, size_t from) {
+    // No journal reads as an empty one
+    return readFile(_journalPath, out, from) || !_fs.exists(_journalPath);
+}
+
+bool SavedCodeStoreFs::writeJournal(const uint8_t* data, size_t len) {
+    if (len == 0) {
+        _fs.remove(_journalPath);
+        return true;
+    }
+    return replaceFile(_journalPath, _journalTmpPath, data, len);
+}
+
+bool SavedCodeStoreFs::appendJournal(const uint8_t* data, size_t len) {
+    fs::File f = _fs.open(_journalPath, FILE_APPEND, true);
+    bool written = f && f.write(data, len) == len;
+    if (f) f.close();
+    return written;
+}
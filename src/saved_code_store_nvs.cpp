@@ -0,0 +1,52 @@
+#include "saved_code_store_nvs.h"
+
+bool SavedCodeStoreNvs::read(const char* key, std::vector<uint8_t>& out) {
+    Preferences prefs;
+    out.clear();
+    if (!prefs.begin(_ns, true)) return false;
+    size_t len = prefs.getBytesLength(key);
+    if (len > 0) {
+        out.resize(len);
+        if (prefs.getBytes(key, out.data(), len) != len) out.clear();
+    }
+    prefs.end();
+    return !out.empty();
+}
+
+bool SavedCodeStoreNvs::write(const char* key, const uint8_t* data, size_t len) {
+    Preferences prefs;
+    if (!prefs.begin(_ns, false)) return false;
+    bool stored = true;
+    if (len == 0) {
+        prefs.remove(key);
+    } else {
+        stored = prefs.putBytes(key, data, len) == len;
+    }
+    prefs.end();
+    return stored;
+}
+
+bool SavedCodeStoreNvs::readSnapshot(std::vector<uint8_t>& out) {
+    return read(_key, out);
+}
+
+bool SavedCodeStoreNvs::writeSnapshot(const uint8_t* data, size_t len) {
+    return write(_key, data, len);
+}
+
+bool SavedCodeStoreNvs::readJournal(std::vector<uint8_t>& out, size_t from) {
+    read(_journalKey, out);
+    out.erase(out.begin(), out.begin() + (from < out.size() ? from : out.size()));
+    return true;
+}
+
+bool SavedCodeStoreNvs::writeJournal(const uint8_t* data, size_t len) {
+    return write(_journalKey, data, len);
+}
+
+bool SavedCodeStoreNvs::appendJournal(const uint8_t* data, size_t len) {
+    std::vector<uint8_t> journal;
+    read(_journalKey, journal);
+    journal.insert(journal.end(), data, data + len);
+    return write(_journalKey, journal.data(), journal.size());
+}
@@ -0,0 +1,521 @@
+#include "saved_code_table.h"
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+#include <utility>
+#include "hex_utils.h"
+#include "ir_raw_encoder.h"
+
+// FNV-1a over the ASCII-lowercased string
+static uint32_t foldedHash(const char* s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++) {
+        char c = *s;
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        h = (h ^ (uint8_t)c) * 16777619u;
+    }
+    return h;
+}
+
+// Continues FNV-1a from h over the 8 bytes of value
+static uint32_t valueHash(uint32_t h, uint64_t value) {
+    for (int k = 0; k < 8; k++, value >>= 8) h = (h ^ (uint8_t)value) * 16777619u;
+    return h;
+}
+
+static uint32_t idHash(uint16_t id) {
+    return valueHash(2166136261u, id);
+}
+
+void SavedCodeTable::clear() {
+    _entries.clear();
+    _pool.clear();
+    _timings.clear();
+    _garbage = 0;
+    _timingsGarbage = 0;
+    _nextId = 1;
+    _idsWrapped = false;
+    _names.clear();
+    _codes.clear();
+    _ids.clear();
+    _generation++;
+}
+
+void SavedCodeTable::reserve(size_t entries, size_t poolBytes) {
+    _entries.reserve(entries);
+    _names.reserve(entries);
+    _codes.reserve(entries);
+    _ids.reserve(entries);
+    _pool.reserve(poolBytes);
+}
+
+uint32_t SavedCodeTable::addString(const char* s) {
+    if (!s) s = "";
+    uint32_t offset = (uint32_t)_pool.size();
+    _pool.insert(_pool.end(), s, s + strlen(s) + 1);
+    return offset;
+}
+
+uint32_t SavedCodeTable::addTimings(const uint16_t* timings, size_t count) {
+    uint32_t offset = (uint32_t)_timings.size();
+    _timings.insert(_timings.end(), timings, timings + count);
+    return offset;
+}
+
+void SavedCodeTable::append(const char* name, const char* protocolName, decode_type_t protocol,
+                            const char* valueHex, uint16_t bits, uint8_t repeat,
+                            const uint16_t* timings, size_t timingsCount, uint16_t carrierKHz) {
+    Entry e;
+    e.protocol = (int16_t)protocol;
+    e.bits = bits;
+    e.repeat = repeat;
+    e.flags = parseHex64(valueHex, e.value) ? kValueValid : 0;
+    if (!(e.flags & kValueValid)) e.value = 0;
+    e.nameOffset = addString(name);
+    e.protocolOffset = addString(protocolName);
+    e.valueOffset = addString(valueHex);
+    e.timingsOffset = 0;
+    e.timingsCount = 0;
+    e.carrierKHz = 0;
+    e.id = allocateId();
+    if (timings && timingsCount > 0 && timingsCount <= UINT16_MAX) {
+        e.timingsOffset = addTimings(timings, timingsCount);
+        e.timingsCount = (uint16_t)timingsCount;
+        e.carrierKHz = carrierKHz;
+        e.flags |= kTimingsCaptured;
+    } else {
+        encodeTimings(e, valueHex);
+    }
+    _entries.push_back(e);
+    size_t i = _entries.size() - 1;
+    _names.append(foldedHash(this->name(i)));
+    _codes.append(codeHash(i));
+    _ids.append(idHash(e.id));
+    _generation++;
+}
+
+// Pre-encode e's value into the timings pool when enabled and supported.
+void SavedCodeTable::encodeTimings(Entry& e, const char* valueHex) {
+    decode_type_t protocol = (decode_type_t)e.protocol;
+    if (!_preEncode || irPulseDistance(protocol) == nullptr) return;
+    // Parsed separately from `value`: long codes keep their upper 64 bits
+    uint64_t hi, lo;
+    uint16_t encoded[kIrRawEncodeMaxTimings];
+    size_t n = 0;
+    if (parseHex128(valueHex, hi, lo)) {
+        n = irRawEncode(protocol, hi, lo, e.bits, encoded, kIrRawEncodeMaxTimings);
+    }
+    if (n > 0) {
+        e.timingsOffset = addTimings(encoded, n);
+        e.timingsCount = (uint16_t)n;
+        e.carrierKHz = irPulseDistance(protocol)->carrierKHz;
+        e.flags |= kTimingsEncoded;
+    }
+}
+
+void SavedCodeTable::rename(size_t i, const char* name) {
+    _garbage += strlen(this->name(i)) + 1;
+    _entries[i].nameOffset = addString(name);
+    _names.update(i, foldedHash(this->name(i)));
+    _generation++;
+    if (_garbage > _pool.size() / 2) compact();
+}
+
+void SavedCodeTable::remove(size_t i) {
+    _garbage += strlen(name(i)) + strlen(protocolName(i)) + strlen(valueText(i)) + 3;
+    _timingsGarbage += _entries[i].timingsCount;
+    _entries.erase(_entries.begin() + i);
+    _names.remove(i);
+    _codes.remove(i);
+    _ids.remove(i);
+    _generation++;
+    if (_garbage > _pool.size() / 2 || _timingsGarbage > _timings.size() / 2) compact();
+}
+
+// Ids count up and wrap past 65535; after a wrap, ids still in use are skipped.
+uint16_t SavedCodeTable::allocateId() {
+    for (;;) {
+        uint16_t id = _nextId++;
+        if (_nextId == 0) {
+            _nextId = 1;
+            _idsWrapped = true;
+        }
+        if (!_idsWrapped || indexOfId(id) < 0) return id;
+    }
+}
+
+int SavedCodeTable::indexOfId(uint16_t id) const {
+    int found = -1;
+    _ids.forEach(idHash(id), [&](size_t i) {
+        if (_entries[i].id == id) found = (int)i;
+    });
+    return found;
+}
+
+void SavedCodeTable::move(size_t from, size_t to) {
+    if (from == to) return;
+    Entry e = _entries[from];
+    _entries.erase(_entries.begin() + from);
+    _entries.insert(_entries.begin() + to, e);
+    _names.move(from, to);
+    _codes.move(from, to);
+    _ids.move(from, to);
+    _generation++;
+}
+
+int SavedCodeTable::indexOfName(const char* name) const {
+    if (!name) return -1;
+    int found = -1;
+    // Duplicate names share a probe run; the lowest index wins
+    _names.forEach(foldedHash(name), [&](size_t i) {
+        if ((found < 0 || (int)i < found) && strcasecmp(this->name(i), name) == 0) found = (int)i;
+    });
+    return found;
+}
+
+int SavedCodeTable::indexOfCode(const char* protocolName, uint64_t value, uint16_t bits, bool& exact) const {
+    exact = false;
+    if (!protocolName) return -1;
+    int found = -1;
+    _codes.forEach(valueHash(foldedHash(protocolName), value), [&](size_t i) {
+        const Entry& e = _entries[i];
+        if (!(e.flags & kValueValid) || e.value != value || strcasecmp(this->protocolName(i), protocolName) != 0) {
+            return;
+        }
+        bool same = e.bits == bits;
+        if (found < 0 || (same && !exact) || (same == exact && (int)i < found)) {
+            found = (int)i;
+            exact = same;
+        }
+    });
+    return found;
+}
+
+uint32_t SavedCodeTable::codeHash(size_t i) const {
+    return valueHash(foldedHash(protocolName(i)), _entries[i].value);
+}
+
+void SavedCodeTable::rebuildIndexes() {
+    std::vector<uint32_t> names(_entries.size()), codes(_entries.size()), ids(_entries.size());
+    for (size_t i = 0; i < _entries.size(); i++) {
+        names[i] = foldedHash(name(i));
+        codes[i] = codeHash(i);
+        ids[i] = idHash(_entries[i].id);
+    }
+    _names.rebuild(names);
+    _codes.rebuild(codes);
+    _ids.rebuild(ids);
+}
+
+void SavedCodeTable::HashIndex::clear() {
+    _slots.clear();
+    _hashes.clear();
+}
+
+void SavedCodeTable::HashIndex::shrinkToFit() {
+    _hashes.shrink_to_fit();
+}
+
+size_t SavedCodeTable::HashIndex::memoryBytes() const {
+    return _slots.capacity() * sizeof(uint16_t) + _hashes.capacity() * sizeof(uint32_t);
+}
+
+void SavedCodeTable::HashIndex::append(uint32_t hash) {
+    _hashes.push_back(hash);
+    if (_slots.size() < 2 * _hashes.size()) {
+        resize();  // includes the new entry
+    } else {
+        insert(_hashes.size() - 1);
+    }
+}
+
+void SavedCodeTable::HashIndex::update(size_t i, uint32_t hash) {
+    erase(i);
+    _hashes[i] = hash;
+    insert(i);
+}
+
+void SavedCodeTable::HashIndex::remove(size_t i) {
+    erase(i);
+    _hashes.erase(_hashes.begin() + i);
+    for (uint16_t& slot : _slots) {
+        if (slot > i + 1) slot--;
+    }
+}
+
+// Slots depend only on the hash, so renumbering the entries is enough
+void SavedCodeTable::HashIndex::move(size_t from, size_t to) {
+    uint32_t hash = _hashes[from];
+    _hashes.erase(_hashes.begin() + from);
+    _hashes.insert(_hashes.begin() + to, hash);
+    size_t lo = from < to ? from : to, hi = from < to ? to : from;
+    for (uint16_t& slot : _slots) {
+        if (slot == 0 || slot - 1u < lo || slot - 1u > hi) continue;
+        if (slot - 1u == from) {
+            slot = (uint16_t)(to + 1);
+        } else {
+            slot += from < to ? -1 : 1;
+        }
+    }
+}
+
+void SavedCodeTable::HashIndex::rebuild(std::vector<uint32_t>& hashes) {
+    _hashes.swap(hashes);
+    resize();
+}
+
+void SavedCodeTable::HashIndex::insert(size_t i) {
+    size_t mask = _slots.size() - 1;
+    size_t s = _hashes[i] & mask;
+    while (_slots[s] != 0) s = (s + 1) & mask;
+    _slots[s] = (uint16_t)(i + 1);
+}
+
+// Later slots of the probe run are shifted back into the hole so lookups
+// never stop early at it.
+void SavedCodeTable::HashIndex::erase(size_t i) {
+    if (_slots.empty()) return;
+    size_t mask = _slots.size() - 1;
+    size_t s = _hashes[i] & mask;
+    while (_slots[s] != i + 1) {
+        if (_slots[s] == 0) return;
+        s = (s + 1) & mask;
+    }
+    size_t hole = s;
+    for (;;) {
+        s = (s + 1) & mask;
+        if (_slots[s] == 0) break;
+        size_t home = _hashes[_slots[s] - 1] & mask;
+        // Move the slot into the hole unless its home lies between them
+        bool reachable = hole <= s ? (home > hole && home <= s) : (home > hole || home <= s);
+        if (!reachable) {
+            _slots[hole] = _slots[s];
+            hole = s;
+        }
+    }
+    _slots[hole] = 0;
+}
+
+void SavedCodeTable::HashIndex::resize() {
+    size_t slots = 16;
+    while (slots < 2 * _hashes.size()) slots *= 2;
+    _slots.assign(slots, 0);
+    for (size_t i = 0; i < _hashes.size(); i++) insert(i);
+}
+
+bool SavedCodeTable::isSendable(size_t i) const {
+    const Entry& e = _entries[i];
+    return (e.flags & kValueValid) && e.protocol != (int16_t)decode_type_t::UNKNOWN;
+}
+
+void SavedCodeTable::compact() {
+    std::vector<char> old;
+    old.swap(_pool);
+    _pool.reserve(old.size() - _garbage);
+    std::vector<uint16_t> oldTimings;
+    oldTimings.swap(_timings);
+    _timings.reserve(oldTimings.size() - _timingsGarbage);
+    for (Entry& e : _entries) {
+        e.nameOffset = addString(&old[e.nameOffset]);
+        e.protocolOffset = addString(&old[e.protocolOffset]);
+        e.valueOffset = addString(&old[e.valueOffset]);
+        if (e.timingsCount > 0) e.timingsOffset = addTimings(&oldTimings[e.timingsOffset], e.timingsCount);
+    }
+    _garbage = 0;
+    _timingsGarbage = 0;
+}
+
+void SavedCodeTable::shrinkToFit() {
+    if (_garbage > 0 || _timingsGarbage > 0) compact();
+    _entries.shrink_to_fit();
+    _pool.shrink_to_fit();
+    _timings.shrink_to_fit();
+    _names.shrinkToFit();
+    _codes.shrinkToFit();
+    _ids.shrinkToFit();
+}
+
+size_t SavedCodeTable::memoryBytes() const {
+    return _entries.capacity() * sizeof(Entry) + _pool.capacity() + _timings.capacity() * sizeof(uint16_t) +
+           _names.memoryBytes() + _codes.memoryBytes() + _ids.memoryBytes();
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static bool capturedTimings(const SavedCodeTable::Entry& e) {
+    return (e.flags & SavedCodeTable::kTimingsCaptured) && e.timingsCount > 0;
+}
+
+size_t SavedCodeTable::blobBytes(size_t first, size_t count) const {
+    size_t bytes = kBlobHeaderBytes + count * kBlobRecordBytes;
+    for (size_t i = first; i < first + count; i++) {
+        bytes += strlen(name(i)) + strlen(protocolName(i)) + strlen(valueText(i)) + 3;
+        if (capturedTimings(_entries[i])) bytes += _entries[i].timingsCount * sizeof(uint16_t);
+    }
+    return bytes;
+}
+
+void SavedCodeTable::toBlob(std::vector<uint8_t>& out, size_t first, size_t count) const {
+    out.assign(blobBytes(first, count), 0);
+    uint8_t* record = &out[kBlobHeaderBytes];
+    uint8_t* strings = record + count * kBlobRecordBytes;
+    uint8_t* p = strings;
+    uint32_t timingsCount = 0;
+    for (size_t i = first; i < first + count; i++, record += kBlobRecordBytes) {
+        const Entry& e = _entries[i];
+        bool captured = capturedTimings(e);
+        put32(record, (uint32_t)e.value);
+        put32(record + 4, (uint32_t)(e.value >> 32));
+        put16(record + 8, (uint16_t)e.protocol);
+        put16(record + 10, e.bits);
+        record[12] = e.repeat;
+        record[13] = e.flags & (kValueValid | kTimingsCaptured);
+        put16(record + 14, captured ? e.timingsCount : 0);
+        put16(record + 16, captured ? e.carrierKHz : 0);
+        put16(record + 18, e.id);
+        const char* text[] = {name(i), protocolName(i), valueText(i)};
+        for (const char* s : text) {
+            size_t n = strlen(s) + 1;
+            memcpy(p, s, n);
+            p += n;
+        }
+        if (captured) timingsCount += e.timingsCount;
+    }
+    uint8_t* timings = p;
+    for (size_t i = first; i < first + count; i++) {
+        const Entry& e = _entries[i];
+        if (!capturedTimings(e)) continue;
+        for (uint16_t k = 0; k < e.timingsCount; k++, timings += 2) put16(timings, _timings[e.timingsOffset + k]);
+    }
+
+    uint8_t* header = &out[0];
+    memcpy(header, "IRC", 3);
+    header[3] = kBlobVersion;
+    put16(header + 4, (uint16_t)count);
+    put16(header + 6, _nextId);
+    put32(header + 8, (uint32_t)(p - strings));
+    put32(header + 12, timingsCount);
+}
+
+bool SavedCodeTable::loadBlob(const uint8_t* data, size_t len) {
+    clear();
+    return appendBlob(data, len);
+}
+
+size_t SavedCodeTable::blobLength(const uint8_t* data, size_t len) {
+    if (!data || len < kBlobHeaderBytes || memcmp(data, "IRC", 3) != 0 || data[3] != kBlobVersion) return 0;
+    return kBlobHeaderBytes + get16(data + 4) * kBlobRecordBytes + (size_t)get32(data + 8) +
+           (size_t)get32(data + 12) * sizeof(uint16_t);
+}
+
+bool SavedCodeTable::appendBlob(const uint8_t* data, size_t len) {
+    size_t bytes = blobLength(data, len);
+    if (bytes == 0 || bytes != len) return false;
+    size_t count = get16(data + 4);
+    uint16_t nextId = get16(data + 6);
+    size_t stringBytes = get32(data + 8);
+    size_t timingsCount = get32(data + 12);
+    if (nextId == 0) return false;
+    const uint8_t* record = data + kBlobHeaderBytes;
+    const char* strings = (const char*)(record + count * kBlobRecordBytes);
+    const uint8_t* timings = (const uint8_t*)strings + stringBytes;
+    if (count > 0 && (stringBytes == 0 || strings[stringBytes - 1] != '\0')) return false;
+
+    // On failure the table is cut back to what it held before
+    size_t oldCount = _entries.size();
+    size_t oldPool = _pool.size();
+    size_t oldTimings = _timings.size();
+    auto fail = [&]() {
+        _entries.resize(oldCount);
+        _pool.resize(oldPool);
+        _timings.resize(oldTimings);
+        return false;
+    };
+    _entries.reserve(oldCount + count);
+    _pool.insert(_pool.end(), strings, strings + stringBytes);
+    _timings.reserve(oldTimings + timingsCount);
+    uint32_t offset = (uint32_t)oldPool;
+    uint32_t end = (uint32_t)(oldPool + stringBytes);
+    size_t timingsLeft = timingsCount;
+    uint16_t maxId = 0;
+    for (size_t i = 0; i < count; i++, record += kBlobRecordBytes) {
+        Entry e;
+        e.value = get32(record) | ((uint64_t)get32(record + 4) << 32);
+        e.protocol = (int16_t)get16(record + 8);
+        e.bits = get16(record + 10);
+        e.repeat = record[12];
+        e.flags = record[13] & (kValueValid | kTimingsCaptured);
+        e.timingsCount = get16(record + 14);
+        e.carrierKHz = get16(record + 16);
+        e.id = get16(record + 18);
+        e.timingsOffset = 0;
+        uint32_t* fields[] = {&e.nameOffset, &e.protocolOffset, &e.valueOffset};
+        for (uint32_t* field : fields) {
+            if (offset >= end) return fail();
+            *field = offset;
+            offset += (uint32_t)strlen(&_pool[offset]) + 1;
+        }
+        if ((e.flags & kTimingsCaptured) != (e.timingsCount > 0 ? kTimingsCaptured : 0) ||
+            e.timingsCount > timingsLeft || e.id == 0 || indexOfId(e.id) >= 0) {
+            return fail();
+        }
+        if (e.timingsCount > 0) {
+            e.timingsOffset = (uint32_t)_timings.size();
+            for (uint16_t k = 0; k < e.timingsCount; k++, timings += 2) _timings.push_back(get16(timings));
+            timingsLeft -= e.timingsCount;
+        } else {
+            e.carrierKHz = 0;
+            encodeTimings(e, &_pool[e.valueOffset]);
+        }
+        if (e.id > maxId) maxId = e.id;
+        _entries.push_back(e);
+    }
+    if (offset != end || timingsLeft != 0) return fail();
+    // Ids already in the table were checked above (the index holds only
+    // those); here, ids repeated within the blob
+    std::vector<uint16_t> ids;
+    ids.reserve(count);
+    for (size_t i = oldCount; i < _entries.size(); i++) ids.push_back(_entries[i].id);
+    std::sort(ids.begin(), ids.end());
+    if (std::adjacent_find(ids.begin(), ids.end()) != ids.end()) return fail();
+
+    if (oldCount == 0) {
+        _idsWrapped = false;
+        rebuildIndexes();
+    } else {
+        for (size_t i = oldCount; i < _entries.size(); i++) {
+            _names.append(foldedHash(name(i)));
+            _codes.append(codeHash(i));
+            _ids.append(idHash(_entries[i].id));
+        }
+    }
+    _nextId = nextId;
+    _idsWrapped = _idsWrapped || _nextId <= maxId;
+    _generation++;
+    return true;
+}
+
+void SavedCodeTable::take(SavedCodeTable& other) {
+    uint32_t generation = _generation;
+    bool preEncode = _preEncode;
+    *this = std::move(other);
+    other.clear();
+    _preEncode = preEncode;
+    _generation = generation + 1;
+}
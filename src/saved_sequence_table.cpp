@@ -0,0 +1,158 @@
+#include "saved_sequence_table.h"
+#include <string.h>
+#include <strings.h>
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+void SavedSequenceTable::clear() {
+    _sequences.clear();
+    _generation++;
+}
+
+bool SavedSequenceTable::add(const char* name, const Step* steps, size_t count) {
+    if (_sequences.size() >= kMaxSequences) return false;
+    if (count > IrSender::kMaxSequenceSteps || (count > 0 && !steps)) return false;
+    for (size_t j = 0; j < count; j++) {
+        if (steps[j].postDelayMs > IrSender::kMaxPostDelayMs) return false;
+    }
+    Sequence seq;
+    seq.name = name ? name : "";
+    if (count > 0) seq.steps.assign(steps, steps + count);
+    _sequences.push_back(seq);
+    _generation++;
+    return true;
+}
+
+void SavedSequenceTable::remove(size_t i) {
+    _sequences.erase(_sequences.begin() + i);
+    _generation++;
+}
+
+int SavedSequenceTable::indexOf(const char* name) const {
+    if (!name || !*name) return -1;
+    for (size_t i = 0; i < _sequences.size(); i++) {
+        if (strcasecmp(_sequences[i].name.c_str(), name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+size_t SavedSequenceTable::resolve(size_t i, const SavedCodeTable& codes, uint8_t defaultRepeat,
+                                   IrSender::SequenceStep* out) const {
+    size_t n = 0;
+    for (const Step& s : _sequences[i].steps) {
+        IrSender::SequenceStep& o = out[n];
+        uint8_t savedRepeat = 0;
+        if (s.codeId == kRawCode) {
+            if (s.protocol == (int16_t)decode_type_t::UNKNOWN) continue;
+            o.protocol = (decode_type_t)s.protocol;
+            o.value = s.value;
+            o.bits = s.bits;
+        } else {
+            int k = codes.indexOfId(s.codeId);
+            if (k < 0 || !codes.isSendable(k)) continue;
+            const SavedCodeTable::Entry& code = codes.at(k);
+            o.protocol = (decode_type_t)code.protocol;
+            o.value = code.value;
+            o.bits = code.bits;
+            savedRepeat = code.repeat;
+        }
+        o.repeat = s.repeat ? s.repeat : (savedRepeat ? savedRepeat : defaultRepeat);
+        o.postDelayMs = s.postDelayMs;
+        n++;
+    }
+    return n;
+}
+
+size_t SavedSequenceTable::recordBytes(size_t i) const {
+    size_t nameBytes = _sequences[i].name.size();
+    if (nameBytes > 255) nameBytes = 255;
+    return 2 + nameBytes + _sequences[i].steps.size() * kRecordStepBytes;
+}
+
+void SavedSequenceTable::toRecord(size_t i, uint8_t* p) const {
+    const Sequence& seq = _sequences[i];
+    size_t nameBytes = seq.name.size();
+    if (nameBytes > 255) nameBytes = 255;
+    *p++ = (uint8_t)nameBytes;
+    memcpy(p, seq.name.data(), nameBytes);
+    p += nameBytes;
+    *p++ = (uint8_t)seq.steps.size();
+    for (const Step& s : seq.steps) {
+        put16(p, s.codeId);
+        put16(p + 2, (uint16_t)s.protocol);
+        put32(p + 4, (uint32_t)s.value);
+        put32(p + 8, (uint32_t)(s.value >> 32));
+        put16(p + 12, s.bits);
+        p[14] = s.repeat;
+        p[15] = 0;
+        put16(p + 16, s.postDelayMs);
+        p += kRecordStepBytes;
+    }
+}
+
+bool SavedSequenceTable::addRecord(const uint8_t* p, size_t len) {
+    if (len < 2 || len < 2 + (size_t)p[0]) return false;
+    std::string name((const char*)p + 1, p[0]);
+    const uint8_t* s = p + 1 + p[0];
+    size_t count = *s++;
+    if (len != 2 + name.size() + count * kRecordStepBytes || count > IrSender::kMaxSequenceSteps) return false;
+    Step steps[IrSender::kMaxSequenceSteps];
+    for (size_t j = 0; j < count; j++, s += kRecordStepBytes) {
+        Step& step = steps[j];
+        step.codeId = get16(s);
+        step.protocol = (int16_t)get16(s + 2);
+        step.value = get32(s + 4) | ((uint64_t)get32(s + 8) << 32);
+        step.bits = get16(s + 12);
+        step.repeat = s[14];
+        step.postDelayMs = get16(s + 16);
+    }
+    return add(name.c_str(), steps, count);
+}
+
+void SavedSequenceTable::toBlob(std::vector<uint8_t>& out) const {
+    size_t bytes = kBlobHeaderBytes;
+    for (size_t i = 0; i < size(); i++) bytes += 2 + recordBytes(i);
+    out.assign(bytes, 0);
+    memcpy(&out[0], "IRS", 3);
+    out[3] = kBlobVersion;
+    put16(&out[4], (uint16_t)size());
+    uint8_t* p = &out[kBlobHeaderBytes];
+    for (size_t i = 0; i < size(); i++) {
+        size_t len = recordBytes(i);
+        put16(p, (uint16_t)len);
+        toRecord(i, p + 2);
+        p += 2 + len;
+    }
+}
+
+bool SavedSequenceTable::loadBlob(const uint8_t* data, size_t len) {
+    clear();
+    if (!data || len < kBlobHeaderBytes || memcmp(data, "IRS", 3) != 0 || data[3] != kBlobVersion) return false;
+    size_t count = get16(data + 4);
+    size_t pos = kBlobHeaderBytes;
+    for (size_t i = 0; i < count; i++) {
+        if (len - pos < 2) break;
+        size_t recordLen = get16(data + pos);
+        if (recordLen > len - pos - 2 || !addRecord(data + pos + 2, recordLen)) break;
+        pos += 2 + recordLen;
+    }
+    if (size() == count && pos == len) return true;
+    clear();
+    return false;
+}
@@ -0,0 +1,109 @@
+#include "worker_task.h"
+
+#if defined(ESP_PLATFORM)
+
+void WorkerTask::trampoline(void* self) {
+    WorkerTask* task = static_cast<WorkerTask*>(self);
+    task->_entry(task->_arg);
+    xSemaphoreGive(task->_done);
+    vTaskDelete(nullptr);
+}
+
+bool WorkerTask::start(const char* name, Entry entry, void* arg, uint32_t stackBytes, int priority) {
+    if (_handle != nullptr) return false;
+    if (_done == nullptr) _done = xSemaphoreCreateBinary();
+    if (_done == nullptr) return false;
+    _entry = entry;
+    _arg = arg;
+    _running.store(true, std::memory_order_release);
+    if (xTaskCreate(trampoline, name, stackBytes, this, priority, &_handle) != pdPASS) {
+        _running.store(false, std::memory_order_release);
+        _handle = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void WorkerTask::stop() {
+    if (_handle == nullptr) return;
+    _running.store(false, std::memory_order_release);
+    xTaskNotifyGive(_handle);
+    xSemaphoreTake(_done, portMAX_DELAY);
+    _handle = nullptr;
+}
+
+void WorkerTask::notify() {
+    if (_handle != nullptr) xTaskNotifyGive(_handle);
+}
+
+void WorkerTask::wait() {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+uint32_t WorkerTask::nowMs() const {
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+// Blocks on the task notification rather than vTaskDelayUntil so stop() can
+// cut a long sequence post-delay short; notifications from queue() only
+// re-arm the wait (the transmit loop drains the queue before sleeping).
+void WorkerTask::delayUntil(uint32_t& wakeMs, uint32_t periodMs) {
+    wakeMs += periodMs;
+    for (;;) {
+        int32_t remaining = (int32_t)(wakeMs - nowMs());
+        if (remaining <= 0 || !running()) return;
+        ulTaskNotifyTake(pdFALSE, pdMS_TO_TICKS(remaining));
+    }
+}
+
+#else
+
+#include <chrono>
+
+static const std::chrono::steady_clock::time_point kEpoch = std::chrono::steady_clock::now();
+
+bool WorkerTask::start(const char* name, Entry entry, void* arg, uint32_t stackBytes, int priority) {
+    (void)name;
+    (void)stackBytes;
+    (void)priority;
+    if (_thread.joinable()) return false;
+    _entry = entry;
+    _arg = arg;
+    _running.store(true, std::memory_order_release);
+    _thread = std::thread([this]() { _entry(_arg); });
+    return true;
+}
+
+void WorkerTask::stop() {
+    if (!_thread.joinable()) return;
+    _running.store(false, std::memory_order_release);
+    notify();
+    _thread.join();
+}
+
+void WorkerTask::notify() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _notifications++;
+    }
+    _cv.notify_one();
+}
+
+void WorkerTask::wait() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv.wait(lock, [this]() { return _notifications > 0; });
+    _notifications = 0;
+}
+
+uint32_t WorkerTask::nowMs() const {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - kEpoch).count();
+}
+
+void WorkerTask::delayUntil(uint32_t& wakeMs, uint32_t periodMs) {
+    wakeMs += periodMs;
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv.wait_until(lock, kEpoch + std::chrono::milliseconds(wakeMs), [this]() { return !running(); });
+}
+
+#endif
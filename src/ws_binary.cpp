@@ -0,0 +1,114 @@
+#include "ws_binary.h"
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void put64(uint8_t* p, uint64_t v) {
+    put32(p, (uint32_t)v);
+    put32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint64_t get64(const uint8_t* p) {
+    return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+const char* wsSendStatusText(WsSendStatus status) {
+    switch (status) {
+    case WsSendStatus::Ok: return "ok";
+    case WsSendStatus::InvalidRepeat: return "Invalid repeat (1-20)";
+    case WsSendStatus::UnsupportedType: return "Unsupported type";
+    case WsSendStatus::InvalidLength: return "Invalid data or length";
+    case WsSendStatus::QueueFull: return "IR queue full";
+    case WsSendStatus::BadFrame: return "Bad frame";
+    }
+    return "?";
+}
+
+size_t wsEncodeHello(uint8_t* out) {
+    out[0] = (uint8_t)WsFrameType::Hello;
+    out[1] = kWsBinaryVersion;
+    return kWsHelloBytes;
+}
+
+bool wsDecodeHello(const uint8_t* data, size_t len, uint8_t& version) {
+    if (len != kWsHelloBytes || data[0] != (uint8_t)WsFrameType::Hello) return false;
+    version = data[1];
+    return true;
+}
+
+size_t wsEncodeSend(const WsSendFrame& frame, uint8_t* out) {
+    out[0] = (uint8_t)WsFrameType::Send;
+    put16(out + 1, frame.request);
+    put16(out + 3, (uint16_t)frame.protocol);
+    put16(out + 5, frame.bits);
+    out[7] = frame.repeat;
+    put64(out + 8, frame.value);
+    return kWsSendBytes;
+}
+
+bool wsDecodeSend(const uint8_t* data, size_t len, WsSendFrame& out) {
+    if (len != kWsSendBytes || data[0] != (uint8_t)WsFrameType::Send) return false;
+    out.request = get16(data + 1);
+    out.protocol = (int16_t)get16(data + 3);
+    out.bits = get16(data + 5);
+    out.repeat = data[7];
+    out.value = get64(data + 8);
+    return true;
+}
+
+size_t wsEncodeAck(const WsAckFrame& frame, uint8_t* out) {
+    out[0] = (uint8_t)WsFrameType::Ack;
+    put16(out + 1, frame.request);
+    out[3] = (uint8_t)frame.status;
+    out[4] = frame.admission;
+    put32(out + 5, frame.job);
+    return kWsAckBytes;
+}
+
+bool wsDecodeAck(const uint8_t* data, size_t len, WsAckFrame& out) {
+    if (len != kWsAckBytes || data[0] != (uint8_t)WsFrameType::Ack) return false;
+    out.request = get16(data + 1);
+    out.status = (WsSendStatus)data[3];
+    out.admission = data[4];
+    out.job = get32(data + 5);
+    return true;
+}
+
+size_t wsEncodeIrEvent(const WsIrEventFrame& frame, uint8_t* out) {
+    out[0] = (uint8_t)WsFrameType::IrEvent;
+    put32(out + 1, frame.seq);
+    put16(out + 5, (uint16_t)frame.protocol);
+    put16(out + 7, frame.bits);
+    put64(out + 9, frame.value);
+    out[17] = frame.match;
+    put16(out + 18, frame.savedId);
+    put16(out + 20, frame.repeat);
+    return kWsIrEventBytes;
+}
+
+bool wsDecodeIrEvent(const uint8_t* data, size_t len, WsIrEventFrame& out) {
+    if (len != kWsIrEventBytes || data[0] != (uint8_t)WsFrameType::IrEvent) return false;
+    out.seq = get32(data + 1);
+    out.protocol = (int16_t)get16(data + 5);
+    out.bits = get16(data + 7);
+    out.value = get64(data + 9);
+    out.match = data[17];
+    out.savedId = get16(data + 18);
+    out.repeat = get16(data + 20);
+    return true;
+}
@@ -0,0 +1,101 @@
+#include "ws_event_limiter.h"
+
+void WsEventLimiter::capture(int16_t protocol, uint64_t value, uint16_t bits) {
+    _sameAsPrevious = _captures > 0 && protocol == _protocol && value == _value && bits == _bits;
+    _protocol = protocol;
+    _value = value;
+    _bits = bits;
+    _captures++;
+}
+
+bool WsEventLimiter::waiting() const {
+    if (_captures != _passCaptures) return true;
+    for (const Client& c : _clients) {
+        if (c.id && c.repeat) return true;
+    }
+    return false;
+}
+
+void WsEventLimiter::beginPass(uint32_t nowMs) {
+    _nowMs = nowMs;
+    for (Client& c : _clients) c.visited = false;
+}
+
+// The client's slot, a new one (given the captures since the last pass), or null
+WsEventLimiter::Client* WsEventLimiter::find(uint32_t clientId) {
+    Client* free = nullptr;
+    Client* unvisited = nullptr;
+    for (Client& c : _clients) {
+        if (c.id == clientId) return &c;
+        if (!c.id) {
+            if (!free) free = &c;
+        } else if (!c.visited && !unvisited) {
+            unvisited = &c;
+        }
+    }
+    // All taken: a slot not seen yet this pass is most likely a client that
+    // has gone since the last one
+    Client* slot = free ? free : unvisited;
+    if (!slot) return nullptr;
+    _dropped += slot->repeat;
+    *slot = Client();
+    slot->id = clientId;
+    slot->seen = _passCaptures;
+    return slot;
+}
+
+WsEventLimiter::Decision WsEventLimiter::next(uint32_t clientId, bool ready) {
+    Decision none = {Action::None, 0};
+    Client* c = find(clientId);
+    if (!c) return none;
+    c->visited = true;
+
+    uint32_t fresh = _captures - c->seen;
+    if (fresh) {
+        c->seen = _captures;
+        // Only the latest capture is known; anything between it and the
+        // waiting event is lost
+        if (fresh == 1 && c->repeat && _sameAsPrevious) {
+            if (c->repeat < UINT16_MAX) c->repeat++;
+            _coalesced++;
+        } else {
+            _dropped += c->repeat + fresh - 1;
+            c->repeat = 1;
+        }
+    }
+    if (!c->repeat) {
+        c->stalled = false;
+        return none;
+    }
+    if (c->sentOnce && _nowMs - c->lastSentMs < _minIntervalMs) return none;
+    if (!ready) {
+        if (!c->stalled) {
+            c->stalled = true;
+            c->stalledMs = _nowMs;
+            _deferred++;
+        } else if (_nowMs - c->stalledMs >= _stallMs) {
+            _dropped += c->repeat;
+            _closed++;
+            *c = Client();
+            return {Action::Close, 0};
+        }
+        return none;
+    }
+    Decision send = {Action::Send, c->repeat};
+    c->repeat = 0;
+    c->stalled = false;
+    c->sentOnce = true;
+    c->lastSentMs = _nowMs;
+    _sent++;
+    return send;
+}
+
+void WsEventLimiter::endPass() {
+    _passCaptures = _captures;
+    for (Client& c : _clients) {
+        if (c.id && !c.visited) {
+            _dropped += c.repeat;
+            c = Client();
+        }
+    }
+}
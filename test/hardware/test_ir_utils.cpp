@@ -32,9 +32,29 @@ void test_replayUrlFor_nec_16bit(void) {
   TEST_ASSERT_TRUE(url.endsWith("&length=16"));
 }
 
-void test_replayUrlFor_non_nec_returns_empty(void) {
+void test_replayUrlFor_sony(void) {
   IrCapture c;
-  c.protocol = "Sony";
+  c.protocol = "SONY";
+  c.value = 0xA90;
+  c.bits = 12;
+
+  String url = replayUrlFor(c);
+  TEST_ASSERT_EQUAL_STRING("/send?type=sony&data=00000A90&length=12", url.c_str());
+}
+
+void test_replayUrlFor_wide_value_keeps_upper_bits(void) {
+  IrCapture c;
+  c.protocol = "PANASONIC";
+  c.value = 0x40040100BCBDULL;
+  c.bits = 48;
+
+  String url = replayUrlFor(c);
+  TEST_ASSERT_EQUAL_STRING("/send?type=panasonic&data=40040100BCBD&length=48", url.c_str());
+}
+
+void test_replayUrlFor_unknown_returns_empty(void) {
+  IrCapture c;
+  c.protocol = "UNKNOWN";
   c.value = 0x1234;
   c.bits = 12;
 
@@ -42,6 +62,39 @@ void test_replayUrlFor_non_nec_returns_empty(void) {
   TEST_ASSERT_EQUAL_STRING("", url.c_str());
 }
 
+void test_replayUrlFor_ac_state_protocol_returns_empty(void) {
+  IrCapture c;
+  c.protocol = "DAIKIN";
+  c.value = 0x1234;
+  c.bits = 280;
+
+  String url = replayUrlFor(c);
+  TEST_ASSERT_EQUAL_STRING("", url.c_str());
+}
+
+// ---------------------------------------------------------------------------
+// parseSendableProtocol
+// ---------------------------------------------------------------------------
+
+void test_parseSendableProtocol_known(void) {
+  decode_type_t type = decode_type_t::UNKNOWN;
+  TEST_ASSERT_TRUE(parseSendableProtocol("nec", type));
+  TEST_ASSERT_EQUAL(decode_type_t::NEC, type);
+  TEST_ASSERT_TRUE(parseSendableProtocol("SAMSUNG", type));
+  TEST_ASSERT_EQUAL(decode_type_t::SAMSUNG, type);
+  TEST_ASSERT_TRUE(parseSendableProtocol("Rc5", type));
+  TEST_ASSERT_EQUAL(decode_type_t::RC5, type);
+}
+
+void test_parseSendableProtocol_rejects(void) {
+  decode_type_t type;
+  TEST_ASSERT_FALSE(parseSendableProtocol("", type));
+  TEST_ASSERT_FALSE(parseSendableProtocol(nullptr, type));
+  TEST_ASSERT_FALSE(parseSendableProtocol("bogus", type));
+  TEST_ASSERT_FALSE(parseSendableProtocol("UNKNOWN", type));
+  TEST_ASSERT_FALSE(parseSendableProtocol("DAIKIN", type));
+}
+
 void test_replayUrlFor_nec_case_insensitive(void) {
   IrCapture c;
   c.protocol = "nec";
@@ -179,10 +232,17 @@ void setup() {
   // replayUrlFor
   RUN_TEST(test_replayUrlFor_nec_32bit);
   RUN_TEST(test_replayUrlFor_nec_16bit);
-  RUN_TEST(test_replayUrlFor_non_nec_returns_empty);
+  RUN_TEST(test_replayUrlFor_sony);
+  RUN_TEST(test_replayUrlFor_wide_value_keeps_upper_bits);
+  RUN_TEST(test_replayUrlFor_unknown_returns_empty);
+  RUN_TEST(test_replayUrlFor_ac_state_protocol_returns_empty);
   RUN_TEST(test_replayUrlFor_nec_case_insensitive);
   RUN_TEST(test_replayUrlFor_nec_large_value);
 
+  // parseSendableProtocol
+  RUN_TEST(test_parseSendableProtocol_known);
+  RUN_TEST(test_parseSendableProtocol_rejects);
+
   // saveUrlFor
   RUN_TEST(test_saveUrlFor_with_name);
   RUN_TEST(test_saveUrlFor_without_name);
@@ -12,6 +12,8 @@ Dependencies: pytest, requests  (see requirements-test.txt)
 import ipaddress
 import os
 import re
+import struct
+import zlib
 
 import pytest
 import requests
@@ -79,6 +81,14 @@ class TestLast:
         for key in ("seq", "human", "raw", "replayUrl"):
             assert key in data, f"Missing key: {key}"
 
+    def test_match_label(self):
+        # Present once a code has been received
+        data = requests.get(url("/last")).json()
+        if "match" not in data:
+            pytest.skip("nothing received yet")
+        assert data["match"] in ("exact", "likely", "unknown")
+        assert ("saved" in data) == (data["match"] != "unknown")
+
     def test_seq_is_int(self):
         r = requests.get(url("/last"))
         data = r.json()
@@ -103,9 +113,18 @@ class TestSend:
         r = requests.post(url("/send"))
         assert r.status_code == 400
 
+    def test_send_other_protocol_success(self):
+        r = requests.post(url("/send"), params={
+            "type": "samsung",
+            "data": "E0E040BF",
+            "length": 32,
+        })
+        assert r.status_code == 200
+        assert "Sent SAMSUNG" in r.text
+
     def test_send_unsupported_type(self):
         r = requests.post(url("/send"), params={
-            "type": "rc5",
+            "type": "bogus",
             "data": "1234",
         })
         assert r.status_code == 400
@@ -130,6 +149,53 @@ class TestSend:
         assert "Invalid length" in r.text
 
 
+class TestSendBatch:
+    def test_batch_queued_as_one_job(self):
+        r = requests.post(url("/save"), json={"name": "_batch_", "protocol": "NEC", "value": "20DF10EF", "bits": 32})
+        assert r.status_code == 200
+        saved_id = r.json()["id"]
+        try:
+            r = requests.post(url("/send/batch"), json=[
+                {"type": "nec", "data": "FF827D", "length": 32, "delay_ms": 100},
+                {"id": saved_id, "repeat": 2},
+                {"type": "samsung", "data": "E0E040BF"},
+            ])
+            assert r.status_code == 200
+            body = r.json()
+            assert body["ok"] is True
+            assert body["job"] == int(r.headers["X-Job-Id"])
+            assert [x["ok"] for x in body["results"]] == [True, True, True]
+            assert body["results"][0]["delay_ms"] == 100
+            assert body["results"][1]["name"] == "_batch_"
+            assert body["results"][1]["repeat"] == 2
+            assert body["results"][2]["protocol"] == "SAMSUNG"
+        finally:
+            requests.post(url("/saved/delete"), params={"id": saved_id})
+
+    def test_invalid_item_sends_nothing(self):
+        newest = [j["id"] for j in requests.get(url("/jobs")).json()["jobs"][:1]]
+        r = requests.post(url("/send/batch"), json=[
+            {"type": "nec", "data": "FF827D"},
+            {"type": "bogus", "data": "1234"},
+            {"type": "nec", "data": "FF827D", "repeat": 25},
+        ])
+        assert r.status_code == 400
+        body = r.json()
+        assert body["ok"] is False
+        assert body["results"][0]["ok"] is True
+        assert "Unsupported" in body["results"][1]["error"]
+        assert "Invalid repeat" in body["results"][2]["error"]
+        assert "X-Job-Id" not in r.headers
+        assert [j["id"] for j in requests.get(url("/jobs")).json()["jobs"][:1]] == newest
+
+    def test_rejects_bad_bodies(self):
+        assert requests.post(url("/send/batch"), json=[]).status_code == 400
+        assert requests.post(url("/send/batch"), json={"type": "nec"}).status_code == 400
+        assert requests.post(url("/send/batch"), json=[{"type": "nec", "data": "1"}] * 17).status_code == 400
+        r = requests.post(url("/send/batch"), data="[{", headers={"Content-Type": "application/json"})
+        assert r.status_code == 400
+
+
 # ---------------------------------------------------------------------------
 # GET /saved
 # ---------------------------------------------------------------------------
@@ -192,6 +258,26 @@ class TestSaveAndDelete:
         r = requests.post(url("/save"), json=payload)
         assert r.status_code == 400
 
+    def test_save_raw_timings_roundtrip(self):
+        payload = {
+            "name": "_test_raw_",
+            "protocol": "UNKNOWN",
+            "raw": [3500, 1750, 450, 1300, 450, 420, 450],
+            "khz": 38,
+        }
+        r = requests.post(url("/save"), json=payload)
+        assert r.status_code == 200
+        saved_index = r.json()["index"]
+        names = [it.get("name") for it in requests.get(url("/saved")).json()]
+        assert "_test_raw_" in names
+        r2 = requests.post(url("/saved/delete"), params={"index": saved_index})
+        assert r2.status_code == 200
+
+    def test_save_invalid_raw_returns_400(self):
+        payload = {"name": "bad", "protocol": "UNKNOWN", "raw": [9000, 0, 560]}
+        r = requests.post(url("/save"), json=payload)
+        assert r.status_code == 400
+
     def test_save_invalid_json_returns_400(self):
         r = requests.post(
             url("/save"),
@@ -247,6 +333,136 @@ class TestDump:
         assert "Saved IR codes" in r.text
 
 
+# ---------------------------------------------------------------------------
+# GET /stats
+# ---------------------------------------------------------------------------
+
+class TestStats:
+    def test_json_keys(self):
+        r = requests.get(url("/stats"))
+        assert r.status_code == 200
+        data = r.json()
+        for key in ("fresh", "coalesced", "pending", "depth", "coalesceMax"):
+            assert key in data, f"Missing key: {key}"
+
+    def test_heap_and_cache_memory(self):
+        data = requests.get(url("/stats")).json()
+        assert 0 < data["heapLargestBlock"] <= data["heapFree"]
+        cache = data["savedCodes"]
+        assert cache["count"] == len(requests.get(url("/saved")).json())
+        assert cache["bytes"] >= 0
+
+    def test_ws_event_counters(self):
+        events = requests.get(url("/stats")).json()["wsEvents"]
+        for key in ("sent", "bodies", "coalesced", "dropped", "deferred", "closed"):
+            assert events[key] >= 0, f"Missing key: {key}"
+        assert events["minIntervalMs"] > 0
+        # Bodies are shared, so never more than one per event sent
+        assert events["bodies"] <= events["sent"]
+
+    def test_saved_body_cache(self):
+        before = requests.get(url("/stats")).json()
+        first = requests.get(url("/saved")).text
+        assert requests.get(url("/saved")).text == first
+        after = requests.get(url("/stats")).json()
+        if after["responseCache"]["saved"]["bytes"] > 0:
+            assert after["responseCache"]["saved"]["hits"] > before["responseCache"]["saved"]["hits"]
+        # A change is served on the next request
+        r = requests.post(url("/save"), json={"name": "_cache_", "protocol": "NEC", "value": "1", "bits": 32})
+        assert r.status_code == 200
+        assert requests.get(url("/stats")).json()["savedCodes"]["generation"] != after["savedCodes"]["generation"]
+        assert any(it["name"] == "_cache_" for it in requests.get(url("/saved")).json())
+        assert "_cache_" in requests.get(url("/dump")).text
+        requests.post(url("/saved/delete"), params={"id": r.json()["id"]})
+        assert not any(it["name"] == "_cache_" for it in requests.get(url("/saved")).json())
+
+    def test_resend_is_coalesced(self):
+        if requests.get(url("/stats")).json()["coalesceMax"] == 0:
+            pytest.skip("coalescing disabled (IR_SEND_COALESCE_MAX=0)")
+        params = {"type": "nec", "data": "FF827D", "length": 32, "repeat": 5}
+        before = requests.get(url("/stats")).json()
+        assert requests.post(url("/send"), params=params).status_code == 200
+        assert requests.post(url("/send"), params=params).status_code == 200
+        after = requests.get(url("/stats")).json()
+        assert after["coalesced"] > before["coalesced"]
+
+
+# ---------------------------------------------------------------------------
+# GET /jobs
+# ---------------------------------------------------------------------------
+
+class TestJobs:
+    def test_send_returns_job_id(self):
+        params = {"type": "nec", "data": "FF827D", "length": 32}
+        r = requests.post(url("/send"), params=params)
+        assert r.status_code == 200
+        assert int(r.headers["X-Job-Id"]) > 0
+        assert r.headers["X-Job-Admission"] in ("accepted", "coalesced")
+
+    def test_job_status(self):
+        params = {"type": "nec", "data": "FF827D", "length": 32}
+        job = requests.post(url("/send"), params=params).headers["X-Job-Id"]
+        r = requests.get(url("/jobs/" + job))
+        assert r.status_code == 200
+        data = r.json()
+        assert data["id"] == int(job)
+        assert data["state"] in ("queued", "transmitting", "done", "dropped")
+        assert data["queuedMs"] <= data["uptimeMs"]
+
+    def test_job_list(self):
+        r = requests.get(url("/jobs"))
+        assert r.status_code == 200
+        assert isinstance(r.json()["jobs"], list)
+
+    def test_unknown_job_404(self):
+        r = requests.get(url("/jobs/4000000000"))
+        assert r.status_code in (400, 404)
+
+
+# ---------------------------------------------------------------------------
+# ETag / If-None-Match
+# ---------------------------------------------------------------------------
+
+class TestConditionalGet:
+    def test_saved_not_modified_until_change(self):
+        r = requests.get(url("/saved"))
+        etag = r.headers["ETag"]
+        assert etag.startswith('"')
+        r2 = requests.get(url("/saved"), headers={"If-None-Match": etag})
+        assert r2.status_code == 304
+        assert r2.content == b""
+        assert r2.headers["ETag"] == etag
+        r = requests.post(url("/save"), json={"name": "_etag_", "protocol": "NEC", "value": "1", "bits": 32})
+        try:
+            r3 = requests.get(url("/saved"), headers={"If-None-Match": etag})
+            assert r3.status_code == 200
+            assert r3.headers["ETag"] != etag
+        finally:
+            requests.post(url("/saved/delete"), params={"id": r.json()["id"]})
+
+    def test_dump_and_last_not_modified(self):
+        for path in ("/dump", "/last"):
+            etag = requests.get(url(path)).headers["ETag"]
+            r = requests.get(url(path), headers={"If-None-Match": etag})
+            assert r.status_code == 304
+            assert requests.get(url(path), headers={"If-None-Match": '"other"'}).status_code == 200
+
+    def test_static_assets_revalidate(self):
+        for path in ("/app.js", "/app.css"):
+            r = requests.get(url(path))
+            assert r.status_code == 200
+            assert "max-age=86400" in r.headers["Cache-Control"]
+            r2 = requests.get(url(path), headers={"If-None-Match": r.headers["ETag"]})
+            assert r2.status_code == 304
+
+    def test_not_modified_counted(self):
+        etag = requests.get(url("/saved")).headers["ETag"]
+        before = requests.get(url("/stats")).json()["responseCache"]["saved"]["notModified"]
+        assert requests.get(url("/saved"), headers={"If-None-Match": etag}).status_code == 304
+        after = requests.get(url("/stats")).json()["responseCache"]["saved"]["notModified"]
+        assert after == before + 1
+
+
 # ---------------------------------------------------------------------------
 # 404
 # ---------------------------------------------------------------------------
@@ -257,6 +473,62 @@ class TestNotFound:
         assert r.status_code == 404
 
 
+# ---------------------------------------------------------------------------
+# Stable ids: POST /saved/move, id-based rename/delete
+# ---------------------------------------------------------------------------
+
+class TestSavedIds:
+    def _save(self, name):
+        r = requests.post(url("/save"), json={"name": name, "protocol": "NEC", "value": "A1B2C3D4", "bits": 32})
+        assert r.status_code == 200
+        return r.json()
+
+    def test_id_survives_delete_and_move(self):
+        first = self._save("_id_first_")
+        second = self._save("_id_second_")
+        assert second["id"] != first["id"]
+
+        # Deleting the first code shifts the second one's index, not its id
+        assert requests.post(url("/saved/delete"), params={"id": first["id"]}).status_code == 200
+        items = requests.get(url("/saved")).json()
+        moved = next(it for it in items if it["id"] == second["id"])
+        assert moved["index"] == second["index"] - 1
+        assert moved["name"] == "_id_second_"
+
+        r = requests.post(url("/saved/move"), params={"id": second["id"], "to": 0})
+        assert r.status_code == 200
+        assert r.json()["index"] == 0
+        assert requests.get(url("/saved")).json()[0]["id"] == second["id"]
+
+        r = requests.post(url("/saved/rename"), params={"id": second["id"], "name": "_id_renamed_"})
+        assert r.status_code == 200
+        assert r.json()["index"] == 0
+
+        requests.post(url("/saved/delete"), params={"id": second["id"]})
+
+    def test_flush_commits_journaled_changes(self):
+        saved = self._save("_flush_")
+        cache = requests.get(url("/stats")).json()["savedCodes"]
+        assert cache["pending"] >= 0 and cache["journalBytes"] >= 0
+        r = requests.post(url("/saved/flush"))
+        assert r.status_code == 200
+        data = r.json()
+        assert data["ok"] is True
+        assert data["pending"] == 0
+        cache = requests.get(url("/stats")).json()["savedCodes"]
+        assert cache["pending"] == 0 and cache["oldestPendingMs"] == 0
+        assert cache["commitFailures"] >= 0 and cache["maxCommitMs"] >= cache["lastCommitMs"]
+        # Committing nothing is fine too
+        assert requests.post(url("/saved/flush")).json()["committed"] == 0
+        requests.post(url("/saved/delete"), params={"id": saved["id"]})
+
+    def test_unknown_id_returns_400(self):
+        r = requests.post(url("/saved/delete"), params={"id": 65535})
+        assert r.status_code == 400
+        r = requests.post(url("/saved/move"), params={"index": 0, "to": 9999})
+        assert r.status_code == 400
+
+
 # ---------------------------------------------------------------------------
 # POST /saved/rename
 # ---------------------------------------------------------------------------
@@ -407,3 +679,174 @@ class TestSavedImport:
         for it in items:
             if it.get("name") == "_import_valid_":
                 requests.post(url("/saved/delete"), params={"index": it.get("index")})
+
+    def test_import_truncated_imports_nothing(self):
+        data = '[{"name":"_import_trunc_","protocol":"NEC","value":"55555555","bits":32},{"name":'
+        r = requests.post(url("/saved/import"), data=data, headers={"Content-Type": "application/json"})
+        assert r.status_code == 400
+        names = [it.get("name") for it in requests.get(url("/saved")).json()]
+        assert "_import_trunc_" not in names
+
+    def test_import_large_is_all_or_nothing(self):
+        # Larger than one TCP segment, so the body arrives in several chunks
+        payload = [
+            {"name": "_import_bulk_%d_" % i, "protocol": "NEC", "value": "%08X" % i, "bits": 32}
+            for i in range(150)
+        ]
+        r = requests.post(url("/saved/import"), json=payload)
+        assert r.status_code in (200, 507)
+        items = requests.get(url("/saved")).json()
+        bulk = [it for it in items if it.get("name", "").startswith("_import_bulk_")]
+        if r.status_code == 507:
+            assert bulk == []
+            return
+        assert r.json().get("imported") == 150
+        assert len(bulk) == 150
+        for it in bulk:
+            requests.post(url("/saved/delete"), params={"id": it["id"]})
+
+
+# ---------------------------------------------------------------------------
+# GET /saved/backup, POST /saved/restore  (binary image)
+# ---------------------------------------------------------------------------
+
+class TestSavedBackup:
+    """Image checks and a restore of the device's own backup (leaves the codes as they were)."""
+
+    @staticmethod
+    def backup() -> bytes:
+        r = requests.get(url("/saved/backup"))
+        assert r.status_code == 200
+        assert r.headers.get("Content-Type", "").startswith("application/octet-stream")
+        return r.content
+
+    @staticmethod
+    def restore(data: bytes):
+        return requests.post(url("/saved/restore"), data=data, headers={"Content-Type": "application/octet-stream"})
+
+    def test_backup_is_valid_image(self):
+        data = self.backup()
+        magic, version, body_len, crc, n_codes, n_sequences = struct.unpack_from("<3sBIIHH", data)
+        assert magic == b"IRB" and version == 1
+        assert len(data) == 16 + body_len
+        assert zlib.crc32(data[16:]) == crc
+        saved = requests.get(url("/saved"))
+        assert n_codes == len(saved.json())
+        assert n_sequences == len(requests.get(url("/sequences")).json())
+        if n_codes > 0:
+            assert len(data) < len(saved.content)
+
+    def test_restore_roundtrip(self):
+        before = requests.get(url("/saved")).json()
+        data = self.backup()
+        r = requests.post(url("/save"), json={"name": "_backup_tmp_", "protocol": "NEC", "value": "1", "bits": 32})
+        assert r.status_code == 200
+        r = self.restore(data)
+        assert r.status_code == 200
+        assert r.json().get("codes") == len(before)
+        assert requests.get(url("/saved")).json() == before  # same codes, same ids
+        assert self.backup() == data
+
+    def test_restore_rejects_damaged_image(self):
+        before = requests.get(url("/saved")).json()
+        data = bytearray(self.backup())
+        data[8] ^= 0xFF  # CRC
+        r = self.restore(bytes(data))
+        assert r.status_code == 400
+        assert r.json().get("ok") is False
+        r = self.restore(bytes(data[:-1]) if len(data) > 16 else b"IRB")
+        assert r.status_code == 400
+        assert requests.get(url("/saved")).json() == before
+
+    def test_restore_json_is_rejected(self):
+        r = requests.post(url("/saved/restore"), json=[])
+        assert r.status_code == 400
+
+
+# ---------------------------------------------------------------------------
+# /sequences  (saved sequences / macros)
+# ---------------------------------------------------------------------------
+
+class TestSequences:
+    """Save a sequence, list it, run it, then delete it."""
+
+    def test_sequence_roundtrip(self):
+        r = requests.post(url("/save"), json={
+            "name": "_seq_code_",
+            "protocol": "NEC",
+            "value": "20DF10EF",
+            "bits": 32,
+        })
+        assert r.status_code == 200
+        code_index = r.json()["index"]
+
+        try:
+            payload = {
+                "name": "_test_sequence_",
+                "steps": [
+                    {"code": code_index, "delay_ms": 200},
+                    {"protocol": "SONY", "value": "A90", "bits": 12, "repeat": 2},
+                ],
+            }
+            r = requests.post(url("/sequences"), json=payload)
+            assert r.status_code == 200
+            seq_index = r.json()["index"]
+
+            items = requests.get(url("/sequences")).json()
+            seq = next(it for it in items if it.get("name") == "_test_sequence_")
+            assert len(seq["steps"]) == 2
+            assert seq["steps"][0]["code"] == code_index
+            assert seq["steps"][0]["codeName"] == "_seq_code_"
+            assert seq["steps"][1]["protocol"] == "SONY"
+
+            r = requests.post(url("/sequences/send"), params={"name": "_test_sequence_"})
+            assert r.status_code == 200
+            assert r.json().get("ok") is True
+
+            r = requests.post(url("/sequences/delete"), params={"index": seq_index})
+            assert r.status_code == 200
+            assert r.json().get("ok") is True
+        finally:
+            requests.post(url("/saved/delete"), params={"index": code_index})
+
+    def test_steps_follow_codes_by_id(self):
+        codes = []
+        for name in ("_seq_a_", "_seq_b_"):
+            r = requests.post(url("/save"), json={"name": name, "protocol": "NEC", "value": "20DF10EF", "bits": 32})
+            assert r.status_code == 200
+            codes.append(r.json())
+        a, b = codes
+        try:
+            payload = {"name": "_id_sequence_", "steps": [{"id": b["id"]}, {"code": a["index"]}]}
+            r = requests.post(url("/sequences"), json=payload)
+            assert r.status_code == 200
+            seq_index = r.json()["index"]
+
+            # Moving and deleting codes leaves the steps on the same codes
+            assert requests.post(url("/saved/move"), params={"id": b["id"], "to": 0}).status_code == 200
+            assert requests.post(url("/saved/delete"), params={"id": a["id"]}).status_code == 200
+            steps = requests.get(url("/sequences")).json()[seq_index]["steps"]
+            assert steps[0] == {"id": b["id"], "code": 0, "codeName": "_seq_b_"}
+            assert steps[1] == {"id": a["id"]}  # deleted: skipped when sent
+            r = requests.post(url("/sequences/send"), params={"index": seq_index})
+            assert r.status_code == 200
+
+            r = requests.post(url("/sequences"), json={"name": "_bad_id_", "steps": [{"id": a["id"]}]})
+            assert r.status_code == 400
+            requests.post(url("/sequences/delete"), params={"index": seq_index})
+        finally:
+            for code in codes:
+                requests.post(url("/saved/delete"), params={"id": code["id"]})
+
+    def test_sequence_invalid_code_index_returns_400(self):
+        payload = {"name": "_bad_sequence_", "steps": [{"code": 9999}]}
+        r = requests.post(url("/sequences"), json=payload)
+        assert r.status_code == 400
+
+    def test_sequence_missing_steps_returns_400(self):
+        r = requests.post(url("/sequences"), json={"name": "_empty_sequence_", "steps": []})
+        assert r.status_code == 400
+
+    def test_send_unknown_sequence_returns_400(self):
+        r = requests.post(url("/sequences/send"), params={"name": "_no_such_sequence_"})
+        assert r.status_code == 400
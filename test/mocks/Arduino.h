@@ -1,13 +1,17 @@
 #ifndef ARDUINO_H
 #define ARDUINO_H
 
+#include <atomic>
 #include <cstdint>
 #include <iostream>
 #include <stdint.h>
 #include <string>
+#include <strings.h>
 
-extern unsigned long mock_millis;
-inline unsigned long millis() { return mock_millis; }
+// Atomic because millis() is called from producer threads as well as from
+// the thread that advances it (like the real one, it is thread-safe)
+extern std::atomic<unsigned long> mock_millis;
+inline unsigned long millis() { return mock_millis.load(std::memory_order_relaxed); }
 
 class String {
 public:
@@ -26,6 +30,9 @@ public:
     }
   }
 
+  bool equalsIgnoreCase(const char *s) const { return strcasecmp(str.c_str(), s) == 0; }
+  bool equalsIgnoreCase(const String &s) const { return strcasecmp(str.c_str(), s.c_str()) == 0; }
+
   bool operator==(const char *s) const { return str == s; }
   bool operator==(const String &s) const { return str == s.str; }
   bool operator!=(const char *s) const { return str != s; }
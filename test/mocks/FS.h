@@ -0,0 +1,100 @@
+#ifndef FS_H
+#define FS_H
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+// In-memory stand-in for the Arduino filesystem API, limited to what the
+// stores use. Files are byte strings shared with open handles. writeBudget
+// simulates a full disk or power lost mid-write: once it is spent, writes
+// are cut short.
+class File {
+public:
+  File() {}
+  File(std::shared_ptr<std::string> data, bool writable, long *budget, size_t *written)
+      : _data(data), _writable(writable), _budget(budget), _written(written) {}
+
+  explicit operator bool() const { return (bool)_data; }
+  size_t size() const { return _data ? _data->size() : 0; }
+
+  size_t read(uint8_t *buf, size_t len) {
+    if (!_data || _pos >= _data->size()) return 0;
+    size_t n = std::min(len, _data->size() - _pos);
+    memcpy(buf, _data->data() + _pos, n);
+    _pos += n;
+    return n;
+  }
+
+  bool seek(uint32_t pos) {
+    if (!_data || pos > _data->size()) return false;
+    _pos = pos;
+    return true;
+  }
+
+  size_t write(const uint8_t *buf, size_t len) {
+    if (!_data || !_writable) return 0;
+    if (*_budget >= 0 && (long)len > *_budget) len = (size_t)*_budget;
+    if (*_budget >= 0) *_budget -= (long)len;
+    _data->append((const char *)buf, len);
+    *_written += len;
+    return len;
+  }
+
+  void close() { _data.reset(); }
+
+private:
+  std::shared_ptr<std::string> _data;
+  size_t _pos = 0;
+  bool _writable = false;
+  long *_budget = nullptr;
+  size_t *_written = nullptr;
+};
+
+class FS {
+public:
+  File open(const char *path, const char *mode = FILE_READ, bool create = false) {
+    auto it = files.find(path);
+    if (mode[0] == 'r') {
+      if (it == files.end()) return File();
+      return File(it->second, false, &writeBudget, &bytesWritten);
+    }
+    if (mode[0] == 'w' || it == files.end()) {
+      files[path] = std::make_shared<std::string>();
+      it = files.find(path);
+    }
+    return File(it->second, true, &writeBudget, &bytesWritten);
+  }
+
+  bool exists(const char *path) const { return files.count(path) > 0; }
+  bool remove(const char *path) { return files.erase(path) > 0; }
+
+  bool rename(const char *from, const char *to) {
+    auto it = files.find(from);
+    if (it == files.end()) return false;
+    files[to] = it->second;
+    files.erase(from);
+    return true;
+  }
+
+  std::map<std::string, std::shared_ptr<std::string>> files;
+  long writeBudget = -1;  // bytes that may still be written; -1 = no limit
+  size_t bytesWritten = 0;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif
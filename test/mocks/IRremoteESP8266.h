@@ -0,0 +1,26 @@
+#ifndef IRREMOTEESP8266_MOCK_H
+#define IRREMOTEESP8266_MOCK_H
+
+// Subset of the library's protocol enum; values match IRremoteESP8266.h.
+enum decode_type_t {
+    UNKNOWN = -1,
+    UNUSED = 0,
+    RC5,
+    RC6,
+    NEC,
+    SONY,
+    PANASONIC,
+    JVC,
+    SAMSUNG,
+    WHYNTER,
+    AIWA_RC_T501,
+    LG,
+    SANYO,
+    MITSUBISHI,
+    DISH,
+    SHARP,
+    COOLIX,
+    DAIKIN,
+};
+
+#endif
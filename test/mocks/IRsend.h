@@ -2,6 +2,9 @@
 #define IRSEND_MOCK_H
 
 #include <stdint.h>
+#include <functional>
+#include <vector>
+#include "IRremoteESP8266.h"
 
 class IRsend {
 public:
@@ -10,10 +13,93 @@ public:
         lastData = data;
         lastNBits = nbits;
         sendCount++;
+        history.push_back(data);
+        // ir_NEC.cpp: kNecHdrMark, kNecHdrSpace, kNecBitMark, kNecOneSpace, kNecZeroSpace
+        sendGeneric(16 * 560, 8 * 560, 560, 3 * 560, 560, 560, data, nbits);
+        // kNecMinGap, kNecMinCommandLength
+        trailingSpace(22400, 108000);
     }
+    // Mirrors IRsend::send(): NEC goes through sendNEC(); DAIKIN stands in for
+    // the state-based protocols that cannot be sent from a 64-bit value.
+    bool send(decode_type_t type, uint64_t data, uint16_t nbits, uint16_t repeat = 0) {
+        (void)repeat;
+        if (onSend) onSend();
+        lastType = type;
+        if (type == UNKNOWN || type == UNUSED || type == DAIKIN) return false;
+        if (type == NEC) {
+            sendNEC((uint32_t)data, nbits);
+            return true;
+        }
+        if (type == SAMSUNG) {
+            // ir_Samsung.cpp: kSamsungHdrMark, kSamsungHdrSpace, kSamsungBitMark, ...
+            sendGeneric(8 * 560, 8 * 560, 560, 3 * 560, 560, 560, data, nbits);
+            // kSamsungMinGap, kSamsungMinMessageLength
+            trailingSpace(26880, 108000);
+        }
+        if (type == SONY) trailingSpace(10000, 45000);  // kSonyMinGap, kSonyRptLength
+        lastData = (uint32_t)data;
+        lastData64 = data;
+        lastNBits = nbits;
+        sendCount++;
+        history.push_back((uint32_t)data);
+        return true;
+    }
+    // Raw output, as used for NEC-style repeat codes
+    void enableIROut(uint32_t freq, uint8_t duty = 50) {
+        (void)duty;
+        if (onSend) onSend();
+        carrierHz = freq;
+        rawFrames++;
+    }
+    void sendRaw(const uint16_t buf[], uint16_t len, uint16_t hz) {
+        if (onSend) onSend();
+        rawSends++;
+        lastRaw.assign(buf, buf + len);
+        lastRawHz = hz;
+    }
+    uint16_t mark(uint16_t usec) {
+        raw.push_back(usec);
+        return 1;
+    }
+    void space(uint32_t usec) { raw.push_back(usec); }
     uint32_t lastData = 0;
+    uint64_t lastData64 = 0;
     uint16_t lastNBits = 0;
+    decode_type_t lastType = UNKNOWN;
     int sendCount = 0;
+    std::vector<uint32_t> history;  // every data word sent, in order
+    uint32_t carrierHz = 0;
+    int rawFrames = 0;              // enableIROut() calls, i.e. repeat bursts
+    std::vector<uint32_t> raw;      // mark/space durations in microseconds, in order
+    int rawSends = 0;               // sendRaw() calls
+    std::vector<uint16_t> lastRaw;  // buffer of the last sendRaw()
+    uint16_t lastRawHz = 0;
+    std::vector<uint16_t> encoded;  // marks/spaces of the last NEC or SAMSUNG frame sent via send()
+    std::function<void()> onSend;   // optional hook, called at the start of send(), enableIROut() and sendRaw()
+    // Optional hook, called at the end of a NEC, SAMSUNG or SONY send() with
+    // the trailing space IRsend::sendGeneric() adds: at least gapMs, and
+    // enough to make the frame last messageMs from its start.
+    std::function<void(uint32_t gapMs, uint32_t messageMs)> onTrailingSpace;
+
+private:
+    void trailingSpace(uint32_t gapUs, uint32_t messageUs) {
+        if (onTrailingSpace) onTrailingSpace((gapUs + 999) / 1000, (messageUs + 999) / 1000);
+    }
+
+    // IRsend::sendGeneric() for one pulse-distance frame, MSB first, without
+    // the trailing gap (see trailingSpace()). Bits beyond 64 are sent as zeros, as the library does.
+    void sendGeneric(uint16_t hdrMark, uint16_t hdrSpace, uint16_t bitMark, uint16_t oneSpace,
+                     uint16_t zeroSpace, uint16_t footerMark, uint64_t data, uint16_t nbits) {
+        encoded.clear();
+        encoded.push_back(hdrMark);
+        encoded.push_back(hdrSpace);
+        for (int bit = nbits - 1; bit >= 0; bit--) {
+            bool one = bit < 64 && ((data >> bit) & 1);
+            encoded.push_back(bitMark);
+            encoded.push_back(one ? oneSpace : zeroSpace);
+        }
+        encoded.push_back(footerMark);
+    }
 };
 
 #endif
@@ -1,2 +1,2 @@
 #include "Arduino.h"
-unsigned long mock_millis = 0;
+std::atomic<unsigned long> mock_millis(0);
@@ -93,6 +93,63 @@ void test_uint64ToHex(void) {
   TEST_ASSERT_EQUAL_STRING("00000000", uint64ToHex(0xFFFFFFFF00000000ULL).c_str());
 }
 
+void test_uint64ToHexBits(void) {
+  // Up to 32 bits matches uint64ToHex
+  TEST_ASSERT_EQUAL_STRING("00000A90", uint64ToHexBits(0xA90, 12).c_str());
+  TEST_ASSERT_EQUAL_STRING("E0E040BF", uint64ToHexBits(0xE0E040BF, 32).c_str());
+  TEST_ASSERT_EQUAL_STRING("12345678", uint64ToHexBits(0x9999999912345678ULL, 32).c_str());
+
+  // Wider codes keep their upper bits
+  TEST_ASSERT_EQUAL_STRING("40040100BCBD", uint64ToHexBits(0x40040100BCBDULL, 48).c_str());
+  TEST_ASSERT_EQUAL_STRING("000000001", uint64ToHexBits(1, 36).c_str());
+  TEST_ASSERT_EQUAL_STRING("FFFFFFFFFFFFFFFF", uint64ToHexBits(0xFFFFFFFFFFFFFFFFULL, 64).c_str());
+  TEST_ASSERT_EQUAL_STRING("FFFFFFFFFFFFFFFF", uint64ToHexBits(0xFFFFFFFFFFFFFFFFULL, 128).c_str());
+}
+
+void test_parseHex64_valid(void) {
+  uint64_t val = 0;
+  TEST_ASSERT_TRUE(parseHex64("40040100BCBD", val));
+  TEST_ASSERT_EQUAL_UINT64(0x40040100BCBDULL, val);
+
+  TEST_ASSERT_TRUE(parseHex64("FFFFFFFFFFFFFFFF", val));
+  TEST_ASSERT_EQUAL_UINT64(0xFFFFFFFFFFFFFFFFULL, val);
+
+  TEST_ASSERT_TRUE(parseHex64("0", val));
+  TEST_ASSERT_EQUAL_UINT64(0, val);
+}
+
+void test_parseHex64_invalid(void) {
+  uint64_t val = 0;
+  // Exceeds 64-bit max
+  TEST_ASSERT_FALSE(parseHex64("10000000000000000", val));
+
+  TEST_ASSERT_FALSE(parseHex64("FF827DG", val));
+  TEST_ASSERT_FALSE(parseHex64("0xFF827D", val));
+  TEST_ASSERT_FALSE(parseHex64("", val));
+  TEST_ASSERT_FALSE(parseHex64(NULL, val));
+}
+
+void test_parseHex128(void) {
+  uint64_t hi = 1, lo = 1;
+  TEST_ASSERT_TRUE(parseHex128("FF827D", hi, lo));
+  TEST_ASSERT_EQUAL_UINT64(0, hi);
+  TEST_ASSERT_EQUAL_UINT64(0xFF827D, lo);
+
+  TEST_ASSERT_TRUE(parseHex128("0123456789ABCDEFfedcba9876543210", hi, lo));
+  TEST_ASSERT_EQUAL_UINT64(0x0123456789ABCDEFULL, hi);
+  TEST_ASSERT_EQUAL_UINT64(0xFEDCBA9876543210ULL, lo);
+
+  // Leading zeros do not count against the 32 digits
+  TEST_ASSERT_TRUE(parseHex128("00000000000000000000000000000000001", hi, lo));
+  TEST_ASSERT_EQUAL_UINT64(0, hi);
+  TEST_ASSERT_EQUAL_UINT64(1, lo);
+
+  TEST_ASSERT_FALSE(parseHex128("100000000000000000000000000000000", hi, lo));
+  TEST_ASSERT_FALSE(parseHex128("FF827DG", hi, lo));
+  TEST_ASSERT_FALSE(parseHex128("", hi, lo));
+  TEST_ASSERT_FALSE(parseHex128(NULL, hi, lo));
+}
+
 void setUp(void) {}
 void tearDown(void) {}
 
@@ -107,5 +164,9 @@ int main(void) {
   RUN_TEST(test_parseHex32_valid);
   RUN_TEST(test_parseHex32_invalid);
   RUN_TEST(test_uint64ToHex);
+  RUN_TEST(test_uint64ToHexBits);
+  RUN_TEST(test_parseHex64_valid);
+  RUN_TEST(test_parseHex64_invalid);
+  RUN_TEST(test_parseHex128);
   return UNITY_END();
 }
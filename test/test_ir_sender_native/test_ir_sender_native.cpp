@@ -2,6 +2,20 @@
 #include "Arduino.h"
 #include "IrSender.h"
 #include "IRsend.h"
+#include "saved_code_table.h"
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+// Full frames, repeat bursts and raw frames
+static int framesSent(const IRsend& ir) {
+    return ir.sendCount + ir.rawFrames + ir.rawSends;
+}
+
+static const unsigned long kNecPeriodMs = irProtocolTiming(NEC).framePeriodMs;
 
 void setUp(void) {
     mock_millis = 0;
@@ -27,27 +41,178 @@ void test_IrSender_isActive_basic(void) {
     TEST_ASSERT_TRUE(sender.isActive());
     TEST_ASSERT_EQUAL(1, mockIr.sendCount);
 
-    mock_millis += 60;
+    mock_millis += kNecPeriodMs;
+    sender.loop();
+    TEST_ASSERT_EQUAL(2, framesSent(mockIr));
+
+    // Stays open for one more frame slot in case the code is sent again
+    TEST_ASSERT_TRUE(sender.isActive());
+    mock_millis += kNecPeriodMs;
     sender.loop();
     TEST_ASSERT_FALSE(sender.isActive());
-    TEST_ASSERT_EQUAL(2, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(2, framesSent(mockIr));
 }
 
-void test_IrSender_interruption(void) {
+void test_IrSender_fifo_no_interruption(void) {
     IRsend mockIr;
     IrSender sender(mockIr);
 
-    sender.queue(0xAAAA, 16, 10);
+    TEST_ASSERT_TRUE(sender.queue(0xAAAA, 16, 3));
     sender.loop();
     TEST_ASSERT_TRUE(sender.isActive());
     TEST_ASSERT_EQUAL(1, mockIr.sendCount);
     TEST_ASSERT_EQUAL(0xAAAA, mockIr.lastData);
 
-    sender.queue(0xBBBB, 16, 1);
-    sender.loop();
+    // A second job queued mid-sequence waits for the first to finish
+    TEST_ASSERT_TRUE(sender.queue(0xBBBB, 16, 1));
+    TEST_ASSERT_EQUAL(1, sender.pendingJobs());
+
+    for (int i = 0; i < 10; i++) {
+        mock_millis += kNecPeriodMs;
+        sender.loop();
+    }
     TEST_ASSERT_FALSE(sender.isActive());
+    TEST_ASSERT_FALSE(sender.isJobPending());
+    // NEC repeats go out as repeat codes between the two full frames
     TEST_ASSERT_EQUAL(2, mockIr.sendCount);
-    TEST_ASSERT_EQUAL(0xBBBB, mockIr.lastData);
+    TEST_ASSERT_EQUAL(2, mockIr.rawFrames);
+    TEST_ASSERT_EQUAL(0xAAAA, mockIr.history[0]);
+    TEST_ASSERT_EQUAL(0xBBBB, mockIr.history[1]);
+}
+
+void test_IrSender_back_to_back_jobs_keep_frame_gap(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+
+    sender.queue(0x1111, 32, 1);
+    sender.queue(0x2222, 32, 1);
+    sender.loop();
+    TEST_ASSERT_EQUAL(1, mockIr.sendCount);
+
+    // Next job is picked up but must not fire before the frame period elapses
+    mock_millis += kNecPeriodMs - 1;
+    sender.loop();
+    TEST_ASSERT_EQUAL(1, mockIr.sendCount);
+
+    mock_millis += 1;
+    sender.loop();
+    TEST_ASSERT_EQUAL(2, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(0x2222, mockIr.lastData);
+}
+
+void test_IrSender_overflow_reject(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr, 2, IrSender::OverflowPolicy::Reject);
+
+    TEST_ASSERT_TRUE(sender.queue(0x1, 32, 1));
+    TEST_ASSERT_TRUE(sender.queue(0x2, 32, 1));
+    TEST_ASSERT_FALSE(sender.queue(0x3, 32, 1));
+    TEST_ASSERT_EQUAL(2, sender.pendingJobs());
+
+    for (int i = 0; i < 4; i++) {
+        sender.loop();
+        mock_millis += kNecPeriodMs;
+    }
+    TEST_ASSERT_EQUAL(2, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(0x1, mockIr.history[0]);
+    TEST_ASSERT_EQUAL(0x2, mockIr.history[1]);
+}
+
+void test_IrSender_overflow_drop_oldest(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr, 2, IrSender::OverflowPolicy::DropOldest);
+
+    TEST_ASSERT_TRUE(sender.queue(0x1, 32, 1));
+    TEST_ASSERT_TRUE(sender.queue(0x2, 32, 1));
+    TEST_ASSERT_TRUE(sender.queue(0x3, 32, 1));
+    TEST_ASSERT_EQUAL(2, sender.pendingJobs());
+
+    for (int i = 0; i < 4; i++) {
+        sender.loop();
+        mock_millis += kNecPeriodMs;
+    }
+    TEST_ASSERT_EQUAL(2, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(0x2, mockIr.history[0]);
+    TEST_ASSERT_EQUAL(0x3, mockIr.history[1]);
+}
+
+void test_IrSender_overflow_replace_same_code(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr, 2, IrSender::OverflowPolicy::ReplaceSameCode);
+
+    TEST_ASSERT_TRUE(sender.queue(0x1, 32, 1));
+    TEST_ASSERT_TRUE(sender.queue(0x2, 32, 1));
+    // Same code as a pending job: updated in place, no new slot used
+    TEST_ASSERT_TRUE(sender.queue(0x1, 32, 3));
+    TEST_ASSERT_EQUAL(2, sender.pendingJobs());
+    // Different code with a full queue is rejected
+    TEST_ASSERT_FALSE(sender.queue(0x4, 32, 1));
+
+    for (int i = 0; i < 8; i++) {
+        sender.loop();
+        mock_millis += kNecPeriodMs;
+    }
+    TEST_ASSERT_EQUAL(4, framesSent(mockIr));
+    TEST_ASSERT_EQUAL(2, mockIr.rawFrames);
+    TEST_ASSERT_EQUAL(0x1, mockIr.history[0]);
+    TEST_ASSERT_EQUAL(0x2, mockIr.history[1]);
+}
+
+void test_IrSender_depth_is_clamped(void) {
+    IRsend mockIr;
+    IrSender zero(mockIr, 0);
+    IrSender huge(mockIr, 1000);
+    TEST_ASSERT_EQUAL(1, zero.depth());
+    TEST_ASSERT_EQUAL(IrSender::kMaxQueueDepth, huge.depth());
+}
+
+// Two producers (think HTTP and BLE) fire bursts while loop() runs on a 1 ms
+// tick. Every accepted job must be transmitted, in submission order.
+void test_IrSender_bursty_throughput(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+
+    const int bursts = 20;
+    const int burstSize = 4;
+    const int repeat = 2;
+    int accepted = 0;
+    int rejected = 0;
+    std::vector<uint32_t> expected;
+
+    uint32_t code = 0;
+    for (int b = 0; b < bursts; b++) {
+        for (int j = 0; j < burstSize; j++) {
+            code++;
+            if (sender.queue(code, 32, repeat)) {
+                accepted++;
+                expected.push_back(code);
+            } else {
+                rejected++;
+            }
+        }
+        // 300 ms between bursts
+        for (int t = 0; t < 300; t++) {
+            sender.loop();
+            mock_millis++;
+        }
+    }
+    while (sender.isActive() || sender.isJobPending()) {
+        sender.loop();
+        mock_millis++;
+    }
+
+    TEST_ASSERT_EQUAL(bursts * burstSize, accepted + rejected);
+    TEST_ASSERT_EQUAL((int)expected.size(), mockIr.sendCount);
+    TEST_ASSERT_EQUAL((int)expected.size() * (repeat - 1), mockIr.rawFrames);
+    for (size_t i = 0; i < expected.size(); i++) {
+        TEST_ASSERT_EQUAL(expected[i], mockIr.history[i]);
+    }
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "bursty: %d accepted, %d rejected, %d frames in %lu ms (%.1f frames/s)",
+             accepted, rejected, framesSent(mockIr), mock_millis.load(),
+             framesSent(mockIr) * 1000.0 / (double)mock_millis);
+    TEST_MESSAGE(msg);
 }
 
 void test_IrSender_queue_invalid_repeat(void) {
@@ -57,9 +222,21 @@ void test_IrSender_queue_invalid_repeat(void) {
     sender.queue(0x1234, 16, 0); // Invalid repeat (must be >= 1)
     TEST_ASSERT_FALSE(sender.isJobPending());
 
+    // Past what a job ticket holds: rejected rather than truncated to 0
+    IrSender::Submission big = sender.queue(NEC, 0x1234, 16, IrSender::kMaxRepeat + 1);
+    TEST_ASSERT_EQUAL(IrSender::Admission::RejectedInvalid, big.admission);
+    TEST_ASSERT_FALSE(sender.queue(NEC, 0x1234, 16, 65536 * 2 + 1));
+    const uint16_t timings[] = {8960, 4480, 560};
+    TEST_ASSERT_FALSE(sender.queueRaw(NEC, timings, 3, 38, IrSender::kMaxRepeat + 1));
+    TEST_ASSERT_FALSE(sender.isJobPending());
+
     sender.loop();
     TEST_ASSERT_FALSE(sender.isActive());
     TEST_ASSERT_EQUAL(0, mockIr.sendCount);
+
+    // The largest count is kept whole
+    TEST_ASSERT_TRUE(sender.queue(NEC, 0x1234, 16, IrSender::kMaxRepeat));
+    TEST_ASSERT_TRUE(sender.isJobPending());
 }
 
 void test_IrSender_isJobPending(void) {
@@ -76,10 +253,806 @@ void test_IrSender_isJobPending(void) {
     TEST_ASSERT_TRUE(sender.isActive());
 }
 
+void test_IrSender_dispatches_by_protocol(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+
+    TEST_ASSERT_TRUE(sender.queue(SAMSUNG, 0xE0E040BF, 32, 1));
+    TEST_ASSERT_TRUE(sender.queue(SONY, 0xA90, 12, 1));
+    TEST_ASSERT_TRUE(sender.queue(PANASONIC, 0x40040100BCBDULL, 48, 1));
+
+    sender.loop();
+    TEST_ASSERT_EQUAL(SAMSUNG, mockIr.lastType);
+    TEST_ASSERT_EQUAL_UINT64(0xE0E040BF, mockIr.lastData64);
+    TEST_ASSERT_EQUAL(32, mockIr.lastNBits);
+
+    mock_millis += irProtocolTiming(SAMSUNG).framePeriodMs;
+    sender.loop();
+    TEST_ASSERT_EQUAL(SONY, mockIr.lastType);
+    TEST_ASSERT_EQUAL(12, mockIr.lastNBits);
+
+    // Full 64-bit values survive the trip through the job ring
+    mock_millis += irProtocolTiming(SONY).framePeriodMs;
+    sender.loop();
+    TEST_ASSERT_EQUAL(PANASONIC, mockIr.lastType);
+    TEST_ASSERT_EQUAL_UINT64(0x40040100BCBDULL, mockIr.lastData64);
+    TEST_ASSERT_EQUAL(48, mockIr.lastNBits);
+    TEST_ASSERT_EQUAL(3, mockIr.sendCount);
+}
+
+void test_IrSender_unsendable_protocol_abandons_job(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+
+    sender.queue(DAIKIN, 0x1234, 32, 5);
+    sender.queue(NEC, 0x5678, 32, 1);
+
+    sender.loop();
+    TEST_ASSERT_FALSE(sender.isActive());
+    TEST_ASSERT_EQUAL(0, mockIr.sendCount);
+
+    mock_millis += IrSender::kFrameGapMs;
+    sender.loop();
+    TEST_ASSERT_EQUAL(1, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(0x5678, mockIr.lastData);
+}
+
+void test_IrSender_replace_same_code_matches_protocol(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr, 2, IrSender::OverflowPolicy::ReplaceSameCode);
+
+    sender.queue(NEC, 0x10, 32, 1);
+    // Same value and bits but another protocol is a different code
+    TEST_ASSERT_TRUE(sender.queue(SAMSUNG, 0x10, 32, 1));
+    TEST_ASSERT_EQUAL(2, sender.pendingJobs());
+}
+
+// Drive loop() on a 1 ms tick until idle. Every frame takes airtimeMs of
+// simulated transmit time, plus the trailing space IRsend pads full frames
+// with; returns the start time of each frame.
+static std::vector<unsigned long> runTimeline(IrSender& sender, IRsend& ir, unsigned long airtimeMs) {
+    std::vector<unsigned long> starts;
+    ir.onSend = [&]() {
+        starts.push_back(mock_millis);
+        mock_millis += airtimeMs;
+    };
+    ir.onTrailingSpace = [&](uint32_t gapMs, uint32_t messageMs) {
+        unsigned long end = mock_millis + gapMs;
+        if (end < starts.back() + messageMs) end = starts.back() + messageMs;
+        mock_millis = end;
+    };
+    for (int t = 0; t < 5000 && (sender.isActive() || sender.isJobPending()); t++) {
+        unsigned long before = mock_millis;
+        sender.loop();
+        if (mock_millis == before) mock_millis++;  // a frame took its own time
+    }
+    ir.onSend = nullptr;
+    ir.onTrailingSpace = nullptr;
+    return starts;
+}
+
+void test_IrSender_timing_table_spec_values(void) {
+    const IrProtocolTiming& nec = irProtocolTiming(NEC);
+    TEST_ASSERT_EQUAL(108, nec.framePeriodMs);
+    TEST_ASSERT_TRUE(nec.repeatStyle == IrRepeatStyle::RepeatBurst);
+    TEST_ASSERT_EQUAL(9000, nec.burstHeaderMarkUs);
+    TEST_ASSERT_EQUAL(2250, nec.burstHeaderSpaceUs);
+    TEST_ASSERT_EQUAL(560, nec.burstStopMarkUs);
+    TEST_ASSERT_TRUE(nec.sendPadsFrame);
+    TEST_ASSERT_EQUAL(45, irProtocolTiming(SONY).framePeriodMs);
+    TEST_ASSERT_TRUE(irProtocolTiming(SAMSUNG).repeatStyle == IrRepeatStyle::FullFrame);
+    // Unlisted protocols keep the plain frame gap
+    const IrProtocolTiming& other = irProtocolTiming(PANASONIC);
+    TEST_ASSERT_EQUAL(0, other.framePeriodMs);
+    TEST_ASSERT_EQUAL(IrSender::kFrameGapMs, other.minGapMs);
+    TEST_ASSERT_FALSE(other.sendPadsFrame);
+    TEST_ASSERT_TRUE(other.repeatStyle == IrRepeatStyle::FullFrame);
+}
+
+// A held NEC button: one full frame, then repeat codes on a 108 ms cadence.
+// IRsend pads the full frame to 108 ms, so the first repeat follows it at
+// once rather than after a further gap.
+void test_IrSender_nec_repeat_timeline(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+
+    sender.queue(NEC, 0x20DF40BF, 32, 4);
+    std::vector<unsigned long> starts = runTimeline(sender, mockIr, 68);
+
+    TEST_ASSERT_EQUAL(4, (int)starts.size());
+    for (size_t i = 1; i < starts.size(); i++) {
+        TEST_ASSERT_EQUAL(108, starts[i] - starts[i - 1]);
+    }
+    TEST_ASSERT_EQUAL(1, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(3, mockIr.rawFrames);
+    TEST_ASSERT_EQUAL(kIrRepeatBurstCarrierHz, mockIr.carrierHz);
+    TEST_ASSERT_EQUAL(9, (int)mockIr.raw.size());
+    uint32_t burstUs = 0;
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(9000, mockIr.raw[i * 3]);
+        TEST_ASSERT_EQUAL(2250, mockIr.raw[i * 3 + 1]);
+        TEST_ASSERT_EQUAL(560, mockIr.raw[i * 3 + 2]);
+    }
+    for (int i = 0; i < 3; i++) burstUs += mockIr.raw[i];
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "NEC repeat airtime: %u us per repeat code vs ~67500 us per full frame",
+             (unsigned)burstUs);
+    TEST_MESSAGE(msg);
+}
+
+// Full-frame protocols resend the code; IRsend's minimum gap after a long
+// frame pushes the next one past the frame period, with nothing added.
+void test_IrSender_min_gap_extends_frame_period(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+
+    sender.queue(SONY, 0xA90, 12, 3);
+    std::vector<unsigned long> starts = runTimeline(sender, mockIr, 20);
+    TEST_ASSERT_EQUAL(3, (int)starts.size());
+    TEST_ASSERT_EQUAL(45, starts[1] - starts[0]);
+    TEST_ASSERT_EQUAL(45, starts[2] - starts[1]);
+    TEST_ASSERT_EQUAL(3, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(0, mockIr.rawFrames);
+
+    sender.queue(SONY, 0xA90, 12, 2);
+    starts = runTimeline(sender, mockIr, 40);
+    TEST_ASSERT_EQUAL(2, (int)starts.size());
+    TEST_ASSERT_EQUAL(40 + 10, starts[1] - starts[0]);
+}
+
+// The next job waits for the previous frame's timing, not its own.
+void test_IrSender_next_job_follows_previous_frame_timing(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+
+    sender.queue(NEC, 0x1, 32, 1);
+    sender.queue(SONY, 0xA90, 12, 2);
+    std::vector<unsigned long> starts = runTimeline(sender, mockIr, 30);
+    TEST_ASSERT_EQUAL(3, (int)starts.size());
+    TEST_ASSERT_EQUAL(108, starts[1] - starts[0]);
+    TEST_ASSERT_EQUAL(45, starts[2] - starts[1]);
+}
+
+// Same cadence from the transmit task, measured on the real clock.
+void test_IrSender_task_mode_nec_repeat_timeline(void) {
+    using clock = std::chrono::steady_clock;
+    IRsend mockIr;
+    IrSender sender(mockIr);
+    std::vector<clock::time_point> starts;
+    std::atomic<int> frames(0);
+    mockIr.onSend = [&]() {
+        starts.push_back(clock::now());
+        frames++;
+    };
+
+    TEST_ASSERT_TRUE(sender.startTask());
+    sender.queue(NEC, 0x20DF40BF, 32, 4);
+    auto begin = clock::now();
+    while (frames.load() < 4 && clock::now() - begin < std::chrono::seconds(2)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    sender.stopTask();
+
+    TEST_ASSERT_EQUAL(4, (int)starts.size());
+    for (size_t i = 1; i < starts.size(); i++) {
+        // Frame times are taken on a 1 ms clock
+        long ms = (long)std::chrono::duration_cast<std::chrono::milliseconds>(starts[i] - starts[i - 1]).count();
+        TEST_ASSERT_TRUE(ms >= 108 - 1);
+        TEST_ASSERT_TRUE(ms < 108 + 20);
+    }
+    TEST_ASSERT_EQUAL(3, mockIr.rawFrames);
+}
+
+// A sequence runs its steps back to back: per-protocol timing inside a step,
+// and the step's post-delay before the next one.
+void test_IrSender_sequence_timeline(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+    const IrSender::SequenceStep steps[] = {
+        {NEC, 0x20DF10EF, 32, 2, 500},
+        {SONY, 0xA90, 12, 1, 0},
+        {SAMSUNG, 0xE0E040BF, 32, 1, 0},
+    };
+
+    TEST_ASSERT_TRUE(sender.queueSequence(steps, 3));
+    TEST_ASSERT_EQUAL(1, sender.pendingJobs());
+    std::vector<unsigned long> starts = runTimeline(sender, mockIr, 20);
+
+    TEST_ASSERT_EQUAL(4, (int)starts.size());
+    TEST_ASSERT_EQUAL(108, starts[1] - starts[0]);       // NEC repeat code
+    TEST_ASSERT_EQUAL(20 + 500, starts[2] - starts[1]);  // post-delay after the burst
+    TEST_ASSERT_EQUAL(45, starts[3] - starts[2]);        // Sony frame period
+    TEST_ASSERT_EQUAL(1, mockIr.rawFrames);
+    TEST_ASSERT_EQUAL(3, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(0x20DF10EF, mockIr.history[0]);
+    TEST_ASSERT_EQUAL(0xA90, mockIr.history[1]);
+    TEST_ASSERT_EQUAL(0xE0E040BF, mockIr.history[2]);
+    TEST_ASSERT_EQUAL(SAMSUNG, mockIr.lastType);
+}
+
+// Jobs queued while a sequence runs wait for the whole sequence.
+void test_IrSender_sequence_is_not_interleaved(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+    const IrSender::SequenceStep steps[] = {
+        {SONY, 0x1, 12, 1, 100},
+        {SONY, 0x2, 12, 1, 100},
+    };
+
+    TEST_ASSERT_TRUE(sender.queueSequence(steps, 2));
+    sender.loop();
+    TEST_ASSERT_TRUE(sender.queue(SONY, 0x3, 12, 1));
+    runTimeline(sender, mockIr, 10);
+    TEST_ASSERT_EQUAL(3, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(0x1, mockIr.history[0]);
+    TEST_ASSERT_EQUAL(0x2, mockIr.history[1]);
+    TEST_ASSERT_EQUAL(0x3, mockIr.history[2]);
+}
+
+void test_IrSender_sequence_rejects_invalid(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+    IrSender::SequenceStep steps[IrSender::kMaxSequenceSteps + 1];
+    for (auto& step : steps) step = {NEC, 0x1, 32, 1, 0};
+
+    TEST_ASSERT_FALSE(sender.queueSequence(steps, 0));
+    TEST_ASSERT_FALSE(sender.queueSequence(nullptr, 1));
+    TEST_ASSERT_FALSE(sender.queueSequence(steps, IrSender::kMaxSequenceSteps + 1));
+    TEST_ASSERT_TRUE(sender.queueSequence(steps, IrSender::kMaxSequenceSteps));
+    steps[1].repeat = 0;
+    TEST_ASSERT_FALSE(sender.queueSequence(steps, 2));
+    steps[1].repeat = 1;
+    steps[1].postDelayMs = IrSender::kMaxPostDelayMs + 1;
+    TEST_ASSERT_FALSE(sender.queueSequence(steps, 2));
+    TEST_ASSERT_EQUAL(1, sender.pendingJobs());
+}
+
+// Sequence slots are limited and come back once a sequence finishes.
+void test_IrSender_sequence_slots_are_recycled(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+    const IrSender::SequenceStep step = {SONY, 0xA90, 12, 1, 0};
+
+    for (size_t i = 0; i < IrSender::kSequenceSlots; i++) {
+        TEST_ASSERT_TRUE(sender.queueSequence(&step, 1));
+    }
+    TEST_ASSERT_FALSE(sender.queueSequence(&step, 1));
+    runTimeline(sender, mockIr, 10);
+    TEST_ASSERT_EQUAL((int)IrSender::kSequenceSlots, mockIr.sendCount);
+    TEST_ASSERT_TRUE(sender.queueSequence(&step, 1));
+}
+
+// A sequence evicted under DropOldest gives its slot back.
+void test_IrSender_sequence_evicted_releases_slot(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr, 1, IrSender::OverflowPolicy::DropOldest);
+    const IrSender::SequenceStep step = {SONY, 0xA90, 12, 1, 0};
+
+    TEST_ASSERT_TRUE(sender.queueSequence(&step, 1));
+    TEST_ASSERT_TRUE(sender.queue(SONY, 0x1, 12, 1));
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(sender.queueSequence(&step, 1));
+    }
+    TEST_ASSERT_EQUAL(1, sender.pendingJobs());
+}
+
+// Stopping the task in the middle of a sequence frees its slot.
+void test_IrSender_task_mode_sequence_and_stop(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+    std::atomic<int> frames(0);
+    mockIr.onSend = [&]() { frames++; };
+    const IrSender::SequenceStep steps[] = {
+        {SONY, 0x1, 12, 1, 30},
+        {SONY, 0x2, 12, 1, 30},
+        {SONY, 0x3, 12, 1, 2000},
+        {SONY, 0x4, 12, 1, 0},
+    };
+
+    TEST_ASSERT_TRUE(sender.startTask());
+    TEST_ASSERT_TRUE(sender.queueSequence(steps, 4));
+    auto begin = std::chrono::steady_clock::now();
+    while (frames.load() < 3 && std::chrono::steady_clock::now() - begin < std::chrono::seconds(2)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    // stopTask() cuts the 2 s post-delay short
+    auto stopBegin = std::chrono::steady_clock::now();
+    sender.stopTask();
+    TEST_ASSERT_TRUE(std::chrono::steady_clock::now() - stopBegin < std::chrono::milliseconds(500));
+
+    TEST_ASSERT_EQUAL(3, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(0x3, mockIr.history[2]);
+    TEST_ASSERT_FALSE(sender.isActive());
+    for (size_t i = 0; i < IrSender::kSequenceSlots; i++) {
+        TEST_ASSERT_TRUE(sender.queueSequence(steps, 1));
+    }
+}
+
+void test_IrSender_coalesce_into_pending(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr, 4);
+
+    TEST_ASSERT_TRUE(sender.queue(0xA, 32, 2));
+    TEST_ASSERT_TRUE(sender.queue(0xA, 32, 3));
+    TEST_ASSERT_EQUAL(1, sender.pendingJobs());
+    // Only the newest job absorbs a resubmission: order is kept
+    TEST_ASSERT_TRUE(sender.queue(0xB, 32, 1));
+    TEST_ASSERT_TRUE(sender.queue(0xA, 32, 1));
+    TEST_ASSERT_EQUAL(3, sender.pendingJobs());
+    TEST_ASSERT_EQUAL(3, sender.freshJobs());
+    TEST_ASSERT_EQUAL(1, sender.coalescedJobs());
+
+    std::vector<unsigned long> starts = runTimeline(sender, mockIr, 20);
+    TEST_ASSERT_EQUAL(7, (int)starts.size());
+    TEST_ASSERT_EQUAL(3, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(4, mockIr.rawFrames);
+    TEST_ASSERT_EQUAL(0xA, mockIr.history[0]);
+    TEST_ASSERT_EQUAL(0xB, mockIr.history[1]);
+    TEST_ASSERT_EQUAL(0xA, mockIr.history[2]);
+}
+
+// A code resent while it is transmitting continues as repeat frames on the
+// same cadence instead of restarting with a full frame.
+void test_IrSender_coalesce_into_active_is_continuous(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+
+    TEST_ASSERT_TRUE(sender.queue(0xA, 32, 1));
+    sender.loop();
+    TEST_ASSERT_EQUAL(1, mockIr.sendCount);
+
+    // Arrives after the last frame but before the next frame slot
+    mock_millis += kNecPeriodMs - 1;
+    sender.loop();
+    TEST_ASSERT_TRUE(sender.queue(0xA, 32, 2));
+    TEST_ASSERT_EQUAL(0, sender.pendingJobs());
+
+    std::vector<unsigned long> starts = runTimeline(sender, mockIr, 20);
+    TEST_ASSERT_EQUAL(2, (int)starts.size());
+    TEST_ASSERT_EQUAL(kNecPeriodMs, starts[1] - starts[0]);
+    TEST_ASSERT_EQUAL(1, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(2, mockIr.rawFrames);
+    TEST_ASSERT_EQUAL(1, sender.freshJobs());
+    TEST_ASSERT_EQUAL(1, sender.coalescedJobs());
+
+    // Once the job has closed the code starts a fresh job
+    TEST_ASSERT_FALSE(sender.isActive());
+    TEST_ASSERT_TRUE(sender.queue(0xA, 32, 1));
+    runTimeline(sender, mockIr, 20);
+    TEST_ASSERT_EQUAL(2, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(2, sender.freshJobs());
+}
+
+void test_IrSender_coalesce_is_capped(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr, 4, IrSender::OverflowPolicy::Reject, 5);
+
+    TEST_ASSERT_TRUE(sender.queue(0xA, 32, 3));
+    TEST_ASSERT_TRUE(sender.queue(0xA, 32, 4));
+    TEST_ASSERT_TRUE(sender.queue(0xA, 32, 1));
+    TEST_ASSERT_EQUAL(1, sender.pendingJobs());
+    TEST_ASSERT_EQUAL(2, sender.coalescedJobs());
+
+    runTimeline(sender, mockIr, 20);
+    TEST_ASSERT_EQUAL(5, framesSent(mockIr));
+
+    // A limit of 0 turns coalescing off
+    IRsend plainIr;
+    IrSender plain(plainIr, 4, IrSender::OverflowPolicy::Reject, 0);
+    TEST_ASSERT_TRUE(plain.queue(0xA, 32, 1));
+    TEST_ASSERT_TRUE(plain.queue(0xA, 32, 1));
+    TEST_ASSERT_EQUAL(2, plain.pendingJobs());
+    TEST_ASSERT_EQUAL(0, plain.coalescedJobs());
+    runTimeline(plain, plainIr, 20);
+    TEST_ASSERT_EQUAL(2, plainIr.sendCount);
+    TEST_ASSERT_EQUAL(0, plainIr.rawFrames);
+}
+
+// Timings pre-encoded by the saved-code table must match what IRsend itself
+// emits for the same code.
+void test_IrSender_job_ids_and_admission(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr, 2, IrSender::OverflowPolicy::ReplaceSameCode);
+
+    IrSender::Submission a = sender.queue(NEC, 0x1, 32, 1);
+    TEST_ASSERT_EQUAL(IrSender::Admission::Accepted, a.admission);
+    TEST_ASSERT_EQUAL_UINT32(1, a.jobId);
+    IrSender::Submission b = sender.queue(NEC, 0x2, 32, 1);
+    TEST_ASSERT_EQUAL_UINT32(2, b.jobId);
+    TEST_ASSERT_EQUAL_UINT32(2, sender.lastJobId());
+
+    // Merged into the newest job, or replaced in an older one: that job's id
+    IrSender::Submission c = sender.queue(NEC, 0x2, 32, 1);
+    TEST_ASSERT_EQUAL(IrSender::Admission::Coalesced, c.admission);
+    TEST_ASSERT_EQUAL_UINT32(b.jobId, c.jobId);
+    IrSender::Submission d = sender.queue(NEC, 0x1, 32, 2);
+    TEST_ASSERT_EQUAL(IrSender::Admission::Replaced, d.admission);
+    TEST_ASSERT_EQUAL_UINT32(a.jobId, d.jobId);
+
+    IrSender::Submission full = sender.queue(NEC, 0x3, 32, 1);
+    TEST_ASSERT_EQUAL(IrSender::Admission::RejectedFull, full.admission);
+    TEST_ASSERT_EQUAL_UINT32(0, full.jobId);
+    TEST_ASSERT_FALSE(full);
+    IrSender::Submission bad = sender.queue(NEC, 0x3, 32, 0);
+    TEST_ASSERT_EQUAL(IrSender::Admission::RejectedInvalid, bad.admission);
+    TEST_ASSERT_FALSE(bad);
+    TEST_ASSERT_EQUAL_UINT32(2, sender.lastJobId());
+
+    for (int i = 0; i < 10; i++) {
+        sender.loop();
+        mock_millis += kNecPeriodMs;
+    }
+    TEST_ASSERT_FALSE(sender.isActive());
+
+    // Coalescing into the transmitting job reports it too
+    IrSender::Submission e = sender.queue(NEC, 0x5, 32, 1);
+    TEST_ASSERT_EQUAL(IrSender::Admission::Accepted, e.admission);
+    TEST_ASSERT_EQUAL_UINT32(3, e.jobId);
+    sender.loop();
+    TEST_ASSERT_TRUE(sender.isActive());
+    IrSender::Submission f = sender.queue(NEC, 0x5, 32, 1);
+    TEST_ASSERT_EQUAL(IrSender::Admission::Coalesced, f.admission);
+    TEST_ASSERT_EQUAL_UINT32(e.jobId, f.jobId);
+}
+
+void test_IrSender_job_status_lifecycle(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr, 2, IrSender::OverflowPolicy::DropOldest);
+    IrSender::JobStatus status;
+
+    TEST_ASSERT_FALSE(sender.jobStatus(1, status));
+    TEST_ASSERT_EQUAL(IrSender::JobState::Unknown, status.state);
+
+    mock_millis = 100;
+    uint32_t first = sender.queue(NEC, 0x1, 32, 2).jobId;
+    uint32_t unsendable = sender.queue(DAIKIN, 0x2, 32, 1).jobId;
+    TEST_ASSERT_TRUE(sender.jobStatus(first, status));
+    TEST_ASSERT_EQUAL(IrSender::JobState::Queued, status.state);
+    TEST_ASSERT_EQUAL_UINT32(100, status.queuedMs);
+    TEST_ASSERT_EQUAL_UINT32(0, status.startedMs);
+
+    mock_millis = 150;
+    uint32_t version = sender.statusVersion();
+    sender.loop();
+    TEST_ASSERT_NOT_EQUAL(version, sender.statusVersion());
+    TEST_ASSERT_TRUE(sender.jobStatus(first, status));
+    TEST_ASSERT_EQUAL(IrSender::JobState::Transmitting, status.state);
+    TEST_ASSERT_EQUAL_UINT32(150, status.startedMs);
+
+    for (int i = 0; i < 4; i++) {
+        mock_millis += kNecPeriodMs;
+        sender.loop();
+    }
+    TEST_ASSERT_TRUE(sender.jobStatus(first, status));
+    TEST_ASSERT_EQUAL(IrSender::JobState::Done, status.state);
+    TEST_ASSERT_TRUE(status.finishedMs >= status.startedMs + kNecPeriodMs);
+    // A job that never got a frame out is dropped, not done
+    TEST_ASSERT_TRUE(sender.jobStatus(unsendable, status));
+    TEST_ASSERT_EQUAL(IrSender::JobState::Dropped, status.state);
+    TEST_ASSERT_EQUAL_UINT32(0, status.startedMs);
+
+    // Evicted by DropOldest
+    uint32_t evicted = sender.queue(NEC, 0x3, 32, 1).jobId;
+    sender.queue(NEC, 0x4, 32, 1);
+    sender.queue(NEC, 0x5, 32, 1);
+    TEST_ASSERT_TRUE(sender.jobStatus(evicted, status));
+    TEST_ASSERT_EQUAL(IrSender::JobState::Dropped, status.state);
+
+    // Old records are recycled
+    for (size_t i = 0; i < IrSender::kStatusSlots; i++) {
+        sender.queue(NEC, 0x10 + i, 32, 1);
+    }
+    TEST_ASSERT_FALSE(sender.jobStatus(first, status));
+    TEST_ASSERT_TRUE(sender.jobStatus(sender.lastJobId(), status));
+    TEST_ASSERT_EQUAL_STRING("queued", IrSender::jobStateName(status.state));
+    TEST_ASSERT_EQUAL_STRING("rejected-full", IrSender::admissionName(IrSender::Admission::RejectedFull));
+}
+
+void test_IrSender_pre_encoded_matches_irsend(void) {
+    struct Code { decode_type_t protocol; const char* hex; uint64_t value; };
+    const Code codes[] = {
+        {NEC, "FF827D", 0xFF827D},
+        {NEC, "20DF10EF", 0x20DF10EF},
+        {NEC, "0", 0},
+        {NEC, "FFFFFFFF", 0xFFFFFFFF},
+        {SAMSUNG, "E0E040BF", 0xE0E040BF},
+    };
+    SavedCodeTable table;
+    table.setPreEncode(true);
+    for (const Code& c : codes) table.append("", "", c.protocol, c.hex, 32, 0);
+
+    for (size_t i = 0; i < sizeof(codes) / sizeof(codes[0]); i++) {
+        IRsend mockIr;
+        IrSender sender(mockIr);
+        TEST_ASSERT_TRUE(sender.queue(codes[i].protocol, codes[i].value, 32, 1));
+        runTimeline(sender, mockIr, 70);
+        TEST_ASSERT_EQUAL(2 + 2 * 32 + 1, (int)mockIr.encoded.size());
+
+        TEST_ASSERT_TRUE(table.hasTimings(i));
+        const SavedCodeTable::Entry& e = table.at(i);
+        TEST_ASSERT_TRUE(sender.queueRaw(codes[i].protocol, table.timings(i), e.timingsCount, e.carrierKHz, 1));
+        runTimeline(sender, mockIr, 70);
+        TEST_ASSERT_EQUAL(1, mockIr.rawSends);
+        TEST_ASSERT_EQUAL(38, mockIr.lastRawHz);
+        TEST_ASSERT_EQUAL(mockIr.encoded.size(), mockIr.lastRaw.size());
+        TEST_ASSERT_EQUAL_UINT16_ARRAY(mockIr.encoded.data(), mockIr.lastRaw.data(), mockIr.encoded.size());
+    }
+}
+
+void test_IrSender_raw_jobs(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+    const uint16_t nec[] = {8960, 4480, 560, 1680, 560};
+    const uint16_t captured[] = {3500, 1750, 450};
+
+    // A raw NEC frame repeats with NEC repeat codes on the NEC cadence
+    TEST_ASSERT_TRUE(sender.queueRaw(NEC, nec, 5, 38, 3));
+    std::vector<unsigned long> starts = runTimeline(sender, mockIr, 60);
+    TEST_ASSERT_EQUAL(3, (int)starts.size());
+    TEST_ASSERT_EQUAL(kNecPeriodMs, starts[1] - starts[0]);
+    TEST_ASSERT_EQUAL(1, mockIr.rawSends);
+    TEST_ASSERT_EQUAL(2, mockIr.rawFrames);
+
+    // Captured timings of an unknown protocol resend the frame with the default gap
+    TEST_ASSERT_TRUE(sender.queueRaw(UNKNOWN, captured, 3, 36, 2));
+    starts = runTimeline(sender, mockIr, 20);
+    TEST_ASSERT_EQUAL(2, (int)starts.size());
+    TEST_ASSERT_EQUAL(20 + IrSender::kFrameGapMs, starts[1] - starts[0]);
+    TEST_ASSERT_EQUAL(3, mockIr.rawSends);
+    TEST_ASSERT_EQUAL(36, mockIr.lastRawHz);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(captured, mockIr.lastRaw.data(), 3);
+
+    TEST_ASSERT_FALSE(sender.queueRaw(NEC, nec, 0, 38, 1));
+    TEST_ASSERT_FALSE(sender.queueRaw(NEC, nec, IrSender::kMaxRawTimings + 1, 38, 1));
+    TEST_ASSERT_FALSE(sender.queueRaw(NEC, nec, 5, 38, 0));
+
+    // Slots are held until the job is done
+    for (size_t i = 0; i < IrSender::kRawSlots; i++) TEST_ASSERT_TRUE(sender.queueRaw(NEC, nec, 5, 38, 1));
+    TEST_ASSERT_FALSE(sender.queueRaw(NEC, nec, 5, 38, 1));
+    runTimeline(sender, mockIr, 60);
+    TEST_ASSERT_TRUE(sender.queueRaw(NEC, nec, 5, 38, 1));
+}
+
+// Several producer threads hammer queue() while this thread drains via loop().
+// Codes are (producer << 16 | n); each producer's codes must come out in order,
+// with nothing lost or duplicated.
+static void runStress(IrSender::OverflowPolicy policy, bool retryUntilAccepted) {
+    IRsend mockIr;
+    IrSender sender(mockIr, 8, policy);
+
+    const int producers = 4;
+    const int perProducer = 2000;
+    std::atomic<int> accepted(0);
+    std::atomic<int> finished(0);
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p]() {
+            for (int n = 1; n <= perProducer; n++) {
+                uint32_t code = ((uint32_t)p << 16) | (uint32_t)n;
+                for (;;) {
+                    if (sender.queue(code, 32, 1)) {
+                        accepted++;
+                        break;
+                    }
+                    if (!retryUntilAccepted) break;
+                    std::this_thread::yield();
+                }
+            }
+            finished++;
+        });
+    }
+
+    while (finished.load() < producers || sender.isActive() || sender.isJobPending()) {
+        sender.loop();
+        mock_millis += kNecPeriodMs;
+    }
+    for (auto& t : threads) t.join();
+
+    if (policy == IrSender::OverflowPolicy::DropOldest) {
+        // Accepted jobs may later be evicted by newer ones
+        TEST_ASSERT_TRUE(mockIr.sendCount > 0);
+        TEST_ASSERT_TRUE(mockIr.sendCount <= accepted.load());
+    } else {
+        TEST_ASSERT_EQUAL(accepted.load(), mockIr.sendCount);
+    }
+    uint32_t lastSeen[producers] = {0};
+    for (uint32_t code : mockIr.history) {
+        uint32_t p = code >> 16;
+        uint32_t n = code & 0xFFFF;
+        TEST_ASSERT_TRUE(p < (uint32_t)producers);
+        TEST_ASSERT_TRUE(n > lastSeen[p]);
+        lastSeen[p] = n;
+    }
+    if (retryUntilAccepted) {
+        TEST_ASSERT_EQUAL(producers * perProducer, accepted.load());
+    }
+    TEST_ASSERT_FALSE(sender.isJobPending());
+}
+
+void test_IrSender_stress_mpsc_reject(void) {
+    runStress(IrSender::OverflowPolicy::Reject, true);
+}
+
+void test_IrSender_stress_mpsc_drop_oldest(void) {
+    runStress(IrSender::OverflowPolicy::DropOldest, false);
+}
+
+void test_IrSender_stress_mpsc_replace_same_code(void) {
+    runStress(IrSender::OverflowPolicy::ReplaceSameCode, true);
+}
+
+// Producers resend one code (a held button) while this thread drains: every
+// submission ends up as exactly one frame, and each fresh job as one full frame.
+void test_IrSender_stress_mpsc_coalesce(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr, 8, IrSender::OverflowPolicy::Reject, 60000);
+
+    const int producers = 4;
+    const int perProducer = 2000;
+    std::atomic<int> finished(0);
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&]() {
+            for (int n = 0; n < perProducer; n++) {
+                while (!sender.queue(0xA, 32, 1)) std::this_thread::yield();
+            }
+            finished++;
+        });
+    }
+
+    while (finished.load() < producers || sender.isActive() || sender.isJobPending()) {
+        sender.loop();
+        mock_millis += kNecPeriodMs;
+    }
+    for (auto& t : threads) t.join();
+
+    TEST_ASSERT_EQUAL(producers * perProducer, sender.freshJobs() + sender.coalescedJobs());
+    TEST_ASSERT_EQUAL(producers * perProducer, framesSent(mockIr));
+    TEST_ASSERT_EQUAL(sender.freshJobs(), mockIr.sendCount);
+}
+
+void test_IrSender_task_mode_sends_in_order(void) {
+    IRsend mockIr;
+    IrSender sender(mockIr);
+    std::atomic<int> frames(0);
+    mockIr.onSend = [&]() { frames++; };
+
+    TEST_ASSERT_TRUE(sender.startTask());
+    TEST_ASSERT_TRUE(sender.isTaskMode());
+    auto start = std::chrono::steady_clock::now();
+    uint32_t first = sender.queue(NEC, 0x1, 32, 2).jobId;
+    sender.queue(NEC, 0x2, 32, 1);
+
+    while (frames.load() < 3 && std::chrono::steady_clock::now() - start < std::chrono::seconds(2)) {
+        sender.loop();  // no-op in task mode
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    sender.stopTask();
+    TEST_ASSERT_FALSE(sender.isTaskMode());
+
+    TEST_ASSERT_EQUAL(2, mockIr.sendCount);
+    TEST_ASSERT_EQUAL(1, mockIr.rawFrames);
+    TEST_ASSERT_EQUAL(0x1, mockIr.history[0]);
+    TEST_ASSERT_EQUAL(0x2, mockIr.history[1]);
+    IrSender::JobStatus status;
+    TEST_ASSERT_TRUE(sender.jobStatus(first, status));
+    TEST_ASSERT_EQUAL(IrSender::JobState::Done, status.state);
+    // Two frame periods were honoured with delayUntil (1 ms task clock)
+    TEST_ASSERT_TRUE(elapsed >= std::chrono::milliseconds(2 * (kNecPeriodMs - 1)));
+}
+
+// Queue-to-emit latency with the main loop also doing 0-12 ms of other work
+// per iteration (heartbeat, IR decode, BLE), in loop() mode vs task mode.
+static void measureLatency(bool taskMode, double& meanUs, double& stddevUs, double& maxUs) {
+    using clock = std::chrono::steady_clock;
+    IRsend mockIr;
+    IrSender sender(mockIr);
+    const int samples = 20;
+    clock::time_point queuedAt[samples];
+    std::vector<double> latencies;
+    std::atomic<int> sent(0);
+    std::atomic<bool> stop(false);
+
+    mockIr.onSend = [&]() {
+        int n = sent.load();
+        if (n < samples) latencies.push_back(
+            std::chrono::duration<double, std::micro>(clock::now() - queuedAt[n]).count());
+        sent++;
+    };
+
+    std::thread mainLoop;
+    if (taskMode) {
+        TEST_ASSERT_TRUE(sender.startTask());
+    } else {
+        mainLoop = std::thread([&]() {
+            const auto epoch = clock::now();
+            unsigned int work = 7;
+            while (!stop.load()) {
+                work = work * 1103515245u + 12345u;
+                std::this_thread::sleep_for(std::chrono::microseconds((work >> 8) % 12000));
+                mock_millis = (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+                    clock::now() - epoch).count();
+                sender.loop();
+            }
+        });
+    }
+
+    for (int i = 0; i < samples; i++) {
+        queuedAt[i] = clock::now();
+        sender.queue(NEC, (uint64_t)i, 32, 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(kNecPeriodMs + 10));
+    }
+    stop = true;
+    if (mainLoop.joinable()) mainLoop.join();
+    sender.stopTask();
+
+    TEST_ASSERT_EQUAL(samples, (int)latencies.size());
+    double sum = 0, sq = 0;
+    maxUs = 0;
+    for (double l : latencies) {
+        sum += l;
+        if (l > maxUs) maxUs = l;
+    }
+    meanUs = sum / latencies.size();
+    for (double l : latencies) sq += (l - meanUs) * (l - meanUs);
+    stddevUs = std::sqrt(sq / latencies.size());
+}
+
+void test_IrSender_latency_jitter_loop_vs_task(void) {
+    double loopMean, loopStd, loopMax, taskMean, taskStd, taskMax;
+    measureLatency(false, loopMean, loopStd, loopMax);
+    measureLatency(true, taskMean, taskStd, taskMax);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "queue->emit latency loop(): mean %.0f us, jitter %.0f us, max %.0f us",
+             loopMean, loopStd, loopMax);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "queue->emit latency task:   mean %.0f us, jitter %.0f us, max %.0f us",
+             taskMean, taskStd, taskMax);
+    TEST_MESSAGE(msg);
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_IrSender_isActive_basic);
-    RUN_TEST(test_IrSender_interruption);
+    RUN_TEST(test_IrSender_fifo_no_interruption);
+    RUN_TEST(test_IrSender_back_to_back_jobs_keep_frame_gap);
+    RUN_TEST(test_IrSender_overflow_reject);
+    RUN_TEST(test_IrSender_overflow_drop_oldest);
+    RUN_TEST(test_IrSender_overflow_replace_same_code);
+    RUN_TEST(test_IrSender_depth_is_clamped);
+    RUN_TEST(test_IrSender_bursty_throughput);
+    RUN_TEST(test_IrSender_dispatches_by_protocol);
+    RUN_TEST(test_IrSender_unsendable_protocol_abandons_job);
+    RUN_TEST(test_IrSender_replace_same_code_matches_protocol);
+    RUN_TEST(test_IrSender_timing_table_spec_values);
+    RUN_TEST(test_IrSender_nec_repeat_timeline);
+    RUN_TEST(test_IrSender_min_gap_extends_frame_period);
+    RUN_TEST(test_IrSender_next_job_follows_previous_frame_timing);
+    RUN_TEST(test_IrSender_sequence_timeline);
+    RUN_TEST(test_IrSender_sequence_is_not_interleaved);
+    RUN_TEST(test_IrSender_sequence_rejects_invalid);
+    RUN_TEST(test_IrSender_sequence_slots_are_recycled);
+    RUN_TEST(test_IrSender_sequence_evicted_releases_slot);
+    RUN_TEST(test_IrSender_coalesce_into_pending);
+    RUN_TEST(test_IrSender_coalesce_into_active_is_continuous);
+    RUN_TEST(test_IrSender_coalesce_is_capped);
+    RUN_TEST(test_IrSender_job_ids_and_admission);
+    RUN_TEST(test_IrSender_job_status_lifecycle);
+    RUN_TEST(test_IrSender_pre_encoded_matches_irsend);
+    RUN_TEST(test_IrSender_raw_jobs);
+    RUN_TEST(test_IrSender_task_mode_sends_in_order);
+    RUN_TEST(test_IrSender_task_mode_nec_repeat_timeline);
+    RUN_TEST(test_IrSender_task_mode_sequence_and_stop);
+    RUN_TEST(test_IrSender_latency_jitter_loop_vs_task);
+    RUN_TEST(test_IrSender_stress_mpsc_reject);
+    RUN_TEST(test_IrSender_stress_mpsc_drop_oldest);
+    RUN_TEST(test_IrSender_stress_mpsc_replace_same_code);
+    RUN_TEST(test_IrSender_stress_mpsc_coalesce);
     RUN_TEST(test_IrSender_queue_invalid_repeat);
     RUN_TEST(test_IrSender_isJobPending);
     return UNITY_END();
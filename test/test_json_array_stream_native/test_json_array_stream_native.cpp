@@ -0,0 +1,120 @@
+#include <unity.h>
+#include "Arduino.h"
+#include <string>
+#include <vector>
+#include "json_array_stream.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Elements seen so far; "<oversized>" marks a null text
+static std::vector<std::string> g_elements;
+
+static void collect(size_t index, const char* json, size_t len) {
+    TEST_ASSERT_EQUAL(g_elements.size(), index);
+    g_elements.push_back(json ? std::string(json, len) : std::string("<oversized>"));
+}
+
+static JsonArrayStream::Status feedAll(JsonArrayStream& s, const std::string& text, size_t chunk) {
+    g_elements.clear();
+    JsonArrayStream::Status st = JsonArrayStream::Status::More;
+    for (size_t i = 0; i < text.size(); i += chunk) {
+        size_t n = text.size() - i < chunk ? text.size() - i : chunk;
+        st = s.feed(text.data() + i, n, collect);
+    }
+    return st;
+}
+
+void test_splits_elements(void) {
+    JsonArrayStream s(128);
+    std::string text = " [ {\"name\":\"Power\",\"value\":\"20DF10EF\"} ,\n\"text\", 12 ,[1,[2]],{}]\n";
+    TEST_ASSERT_EQUAL(JsonArrayStream::Status::Done, feedAll(s, text, text.size()));
+    TEST_ASSERT_EQUAL(5, g_elements.size());
+    TEST_ASSERT_EQUAL_STRING("{\"name\":\"Power\",\"value\":\"20DF10EF\"}", g_elements[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("\"text\"", g_elements[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("12", g_elements[2].c_str());
+    TEST_ASSERT_EQUAL_STRING("[1,[2]]", g_elements[3].c_str());
+    TEST_ASSERT_EQUAL_STRING("{}", g_elements[4].c_str());
+    TEST_ASSERT_EQUAL(5, s.elements());
+}
+
+void test_brackets_and_escapes_in_strings(void) {
+    JsonArrayStream s(128);
+    std::string text = "[{\"name\":\"a ] } , [ \\\" {\"},\"\\\\\",\"x\\\"]\"]";
+    TEST_ASSERT_EQUAL(JsonArrayStream::Status::Done, feedAll(s, text, text.size()));
+    TEST_ASSERT_EQUAL(3, g_elements.size());
+    TEST_ASSERT_EQUAL_STRING("{\"name\":\"a ] } , [ \\\" {\"}", g_elements[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("\"\\\\\"", g_elements[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("\"x\\\"]\"", g_elements[2].c_str());
+}
+
+void test_every_chunk_size_gives_same_elements(void) {
+    std::string text = "[{\"name\":\"Vol \\\"+\\\"\",\"protocol\":\"NEC\",\"value\":\"20DF40BF\",\"bits\":32},"
+                       " {\"name\":\"[x]\",\"raw\":[9000,4500]} , \"s\" ]  ";
+    JsonArrayStream whole(256);
+    TEST_ASSERT_EQUAL(JsonArrayStream::Status::Done, feedAll(whole, text, text.size()));
+    std::vector<std::string> expected = g_elements;
+    TEST_ASSERT_EQUAL(3, expected.size());
+    for (size_t chunk = 1; chunk < text.size(); chunk++) {
+        JsonArrayStream s(256);
+        TEST_ASSERT_EQUAL(JsonArrayStream::Status::Done, feedAll(s, text, chunk));
+        TEST_ASSERT_EQUAL(expected.size(), g_elements.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            TEST_ASSERT_EQUAL_STRING(expected[i].c_str(), g_elements[i].c_str());
+        }
+    }
+}
+
+void test_oversized_element_is_reported_and_skipped(void) {
+    JsonArrayStream s(16);
+    std::string big = "{\"name\":\"" + std::string(100, 'x') + "\"}";
+    std::string text = "[{\"a\":1}," + big + ",{\"b\":2}]";
+    TEST_ASSERT_EQUAL(JsonArrayStream::Status::Done, feedAll(s, text, 7));
+    TEST_ASSERT_EQUAL(3, g_elements.size());
+    TEST_ASSERT_EQUAL_STRING("{\"a\":1}", g_elements[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("<oversized>", g_elements[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("{\"b\":2}", g_elements[2].c_str());
+}
+
+void test_empty_array(void) {
+    JsonArrayStream s(16);
+    TEST_ASSERT_EQUAL(JsonArrayStream::Status::Done, feedAll(s, " [ ] ", 2));
+    TEST_ASSERT_EQUAL(0, g_elements.size());
+}
+
+void test_rejects_malformed(void) {
+    const char* bad[] = {
+        "{\"name\":\"Power\"}",  // not an array
+        "not json",
+        "[1,]",                  // trailing comma
+        "[,1]",
+        "[1,,2]",
+        "[{\"a\":1}}]",          // unbalanced
+        "[1] x",                 // trailing garbage
+    };
+    for (const char* text : bad) {
+        JsonArrayStream s(64);
+        TEST_ASSERT_EQUAL_MESSAGE(JsonArrayStream::Status::Error, feedAll(s, text, 3), text);
+        TEST_ASSERT_NOT_NULL(s.error());
+    }
+    JsonArrayStream s(64);
+    TEST_ASSERT_EQUAL_STRING("Expected JSON array", (feedAll(s, "{}", 2), s.error()));
+}
+
+void test_truncated_body_is_not_done(void) {
+    JsonArrayStream s(64);
+    TEST_ASSERT_EQUAL(JsonArrayStream::Status::More, feedAll(s, "[{\"a\":1},{\"b\":", 4));
+    TEST_ASSERT_EQUAL(1, g_elements.size());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_splits_elements);
+    RUN_TEST(test_brackets_and_escapes_in_strings);
+    RUN_TEST(test_every_chunk_size_gives_same_elements);
+    RUN_TEST(test_oversized_element_is_reported_and_skipped);
+    RUN_TEST(test_empty_array);
+    RUN_TEST(test_rejects_malformed);
+    RUN_TEST(test_truncated_body_is_not_done);
+    return UNITY_END();
+}
@@ -0,0 +1,254 @@
+#include <unity.h>
+#include "Arduino.h"
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "saved_backup.h"
+#include "saved_code_table.h"
+#include "saved_sequence_table.h"
+
+typedef SavedSequenceTable::Step Step;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void appendCodes(SavedCodeTable& t, int count) {
+    for (int i = 0; i < count; i++) {
+        char name[32], value[16];
+        snprintf(name, sizeof(name), "Button %d", i);
+        snprintf(value, sizeof(value), "20DF%04X", i & 0xFFFF);
+        t.append(name, "NEC", NEC, value, 32, 0);
+    }
+}
+
+static std::vector<uint8_t> imageOf(const SavedCodeTable& codes, const SavedSequenceTable& sequences,
+                                    size_t chunk = 4096) {
+    SavedBackupWriter writer(codes, sequences);
+    std::vector<uint8_t> image;
+    std::vector<uint8_t> buf(chunk);
+    size_t n;
+    while ((n = writer.read(buf.data(), chunk)) > 0) image.insert(image.end(), buf.begin(), buf.begin() + n);
+    TEST_ASSERT_EQUAL(writer.size(), image.size());
+    return image;
+}
+
+static SavedBackupReader::Status restore(const std::vector<uint8_t>& image, SavedCodeTable& codes,
+                                         SavedSequenceTable& sequences, size_t chunk) {
+    SavedBackupReader reader(codes, sequences);
+    SavedBackupReader::Status st = SavedBackupReader::Status::More;
+    for (size_t pos = 0; pos < image.size() && st == SavedBackupReader::Status::More; pos += chunk) {
+        size_t n = image.size() - pos < chunk ? image.size() - pos : chunk;
+        st = reader.feed(&image[pos], n);
+    }
+    return st;
+}
+
+static std::vector<uint8_t> blobOf(const SavedCodeTable& t) {
+    std::vector<uint8_t> blob;
+    t.toBlob(blob);
+    return blob;
+}
+
+static void assertSameSequences(const SavedSequenceTable& a, const SavedSequenceTable& b) {
+    TEST_ASSERT_EQUAL(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        TEST_ASSERT_EQUAL_STRING(a.name(i), b.name(i));
+        TEST_ASSERT_EQUAL(a.stepCount(i), b.stepCount(i));
+        for (size_t j = 0; j < a.stepCount(i); j++) {
+            const Step& x = a.step(i, j);
+            const Step& y = b.step(i, j);
+            TEST_ASSERT_EQUAL(x.codeId, y.codeId);
+            TEST_ASSERT_EQUAL(x.protocol, y.protocol);
+            TEST_ASSERT_EQUAL_UINT64(x.value, y.value);
+            TEST_ASSERT_EQUAL(x.bits, y.bits);
+            TEST_ASSERT_EQUAL(x.repeat, y.repeat);
+            TEST_ASSERT_EQUAL(x.postDelayMs, y.postDelayMs);
+        }
+    }
+}
+
+void test_crc32_matches_zlib(void) {
+    const char* check = "123456789";
+    TEST_ASSERT_EQUAL_UINT32(0xCBF43926, savedBackupCrc32((const uint8_t*)check, 9));
+    // Continues across calls
+    uint32_t crc = savedBackupCrc32((const uint8_t*)check, 4);
+    TEST_ASSERT_EQUAL_UINT32(0xCBF43926, savedBackupCrc32((const uint8_t*)check + 4, 5, crc));
+}
+
+void test_roundtrip_codes_and_sequences(void) {
+    SavedCodeTable codes;
+    appendCodes(codes, 300);  // several code elements
+    const uint16_t raw[] = {9000, 4500, 560, 1690, 560, 560, 560};
+    codes.append("Captured", "RC6", UNKNOWN, "", 0, 0, raw, 7, 36);
+    codes.append("Repeat", "SAMSUNG", SAMSUNG, "E0E0D12E", 32, 3);
+    codes.remove(5);  // ids no longer 1..n
+    codes.move(0, 10);
+    SavedSequenceTable sequences;
+    const Step steps[] = {
+        {3, 0, 0, 0, 0, 500},
+        {SavedSequenceTable::kRawCode, NEC, 0x20DF40BF, 32, 2, 0},
+        {codes.at(codes.size() - 1).id, 0, 0, 0, 1, 10000},
+    };
+    TEST_ASSERT_TRUE(sequences.add("Movie mode", steps, 3));
+    TEST_ASSERT_TRUE(sequences.add("", nullptr, 0));
+
+    std::vector<uint8_t> image = imageOf(codes, sequences, 1460);
+    TEST_ASSERT_TRUE(image == imageOf(codes, sequences, 1));
+    const size_t chunks[] = {1, 7, 1460, image.size()};
+    for (size_t chunk : chunks) {
+        SavedCodeTable c;
+        SavedSequenceTable s;
+        TEST_ASSERT_TRUE(restore(image, c, s, chunk) == SavedBackupReader::Status::Done);
+        TEST_ASSERT_TRUE(blobOf(codes) == blobOf(c));
+        assertSameSequences(sequences, s);
+        // Same next id: a code added afterwards gets the id it would have had
+        c.append("New", "NEC", NEC, "1", 32, 0);
+        SavedCodeTable d = codes;
+        d.append("New", "NEC", NEC, "1", 32, 0);
+        TEST_ASSERT_EQUAL(d.at(d.size() - 1).id, c.at(c.size() - 1).id);
+    }
+}
+
+void test_empty_roundtrip(void) {
+    SavedCodeTable codes;
+    SavedSequenceTable sequences;
+    std::vector<uint8_t> image = imageOf(codes, sequences);
+    TEST_ASSERT_EQUAL(kSavedBackupHeaderBytes, image.size());
+    SavedCodeTable c;
+    SavedSequenceTable s;
+    TEST_ASSERT_TRUE(restore(image, c, s, 16) == SavedBackupReader::Status::Done);
+    TEST_ASSERT_EQUAL(0, c.size());
+    TEST_ASSERT_EQUAL(0, s.size());
+}
+
+void test_rejects_damaged_images(void) {
+    SavedCodeTable codes;
+    appendCodes(codes, 40);
+    SavedSequenceTable sequences;
+    const Step step = {2, 0, 0, 0, 0, 0};
+    sequences.add("Seq", &step, 1);
+    const std::vector<uint8_t> image = imageOf(codes, sequences);
+
+    // Any flipped bit in the body is caught (by the CRC if nothing else)
+    for (size_t pos = kSavedBackupHeaderBytes; pos < image.size(); pos += 37) {
+        std::vector<uint8_t> bad = image;
+        bad[pos] ^= 0x10;
+        SavedCodeTable c;
+        SavedSequenceTable s;
+        TEST_ASSERT_TRUE(restore(bad, c, s, 64) == SavedBackupReader::Status::Error);
+    }
+    std::vector<uint8_t> bad = image;
+    bad[8] ^= 1;  // CRC
+    SavedCodeTable c;
+    SavedSequenceTable s;
+    SavedBackupReader reader(c, s);
+    TEST_ASSERT_TRUE(reader.feed(bad.data(), bad.size()) == SavedBackupReader::Status::Error);
+    TEST_ASSERT_EQUAL_STRING("CRC mismatch", reader.error());
+
+    // Truncated: still waiting for more
+    SavedCodeTable c2;
+    SavedSequenceTable s2;
+    SavedBackupReader truncated(c2, s2);
+    TEST_ASSERT_TRUE(truncated.feed(image.data(), image.size() - 1) == SavedBackupReader::Status::More);
+    TEST_ASSERT_EQUAL(image.size(), truncated.imageBytes());
+
+    // Trailing bytes, in the same chunk or a later one
+    bad = image;
+    bad.push_back(0);
+    SavedCodeTable c3;
+    SavedSequenceTable s3;
+    TEST_ASSERT_TRUE(restore(bad, c3, s3, bad.size()) == SavedBackupReader::Status::Error);
+    SavedCodeTable c4;
+    SavedSequenceTable s4;
+    SavedBackupReader later(c4, s4);
+    TEST_ASSERT_TRUE(later.feed(image.data(), image.size()) == SavedBackupReader::Status::Done);
+    TEST_ASSERT_TRUE(later.feed(image.data(), 1) == SavedBackupReader::Status::Error);
+
+    // Not an image, or a version this firmware does not know
+    bad = image;
+    bad[0] = '[';
+    SavedCodeTable c5;
+    SavedSequenceTable s5;
+    SavedBackupReader notImage(c5, s5);
+    TEST_ASSERT_TRUE(notImage.feed(bad.data(), bad.size()) == SavedBackupReader::Status::Error);
+    TEST_ASSERT_EQUAL_STRING("Not a backup image", notImage.error());
+    bad = image;
+    bad[3] = kSavedBackupVersion + 1;
+    SavedCodeTable c6;
+    SavedSequenceTable s6;
+    TEST_ASSERT_TRUE(restore(bad, c6, s6, bad.size()) == SavedBackupReader::Status::Error);
+}
+
+void test_take_replaces_table(void) {
+    SavedCodeTable live;
+    appendCodes(live, 3);
+    SavedCodeTable staged;
+    appendCodes(staged, 5);
+    staged.remove(0);
+    std::vector<uint8_t> expected = blobOf(staged);
+    uint32_t g = live.generation();
+    live.take(staged);
+    TEST_ASSERT_TRUE(blobOf(live) == expected);
+    TEST_ASSERT_TRUE(live.generation() != g);
+    TEST_ASSERT_EQUAL(0, staged.size());
+    TEST_ASSERT_EQUAL(-1, live.indexOfName("Button 0"));
+    TEST_ASSERT_EQUAL(0, live.indexOfName("button 1"));
+    TEST_ASSERT_EQUAL(2, live.at(0).id);
+}
+
+// What provisioning a device moves over the network: the binary image vs the
+// /saved JSON body (and the same array posted to /saved/import), and how long
+// each takes to produce and apply on the host.
+void test_benchmark_image_vs_json(void) {
+    const int sizes[] = {50, 200, 500};
+    for (int codesCount : sizes) {
+        SavedCodeTable codes;
+        appendCodes(codes, codesCount);
+        SavedSequenceTable sequences;
+        Step steps[4];
+        for (int j = 0; j < 4; j++) steps[j] = {(uint16_t)(j + 1), 0, 0, 0, 0, 300};
+        for (int k = 0; k < 4; k++) sequences.add("Scene", steps, 4);
+
+        std::string json = "[";
+        char buf[160];
+        for (size_t i = 0; i < codes.size(); i++) {
+            snprintf(buf, sizeof(buf), "%s{\"index\":%u,\"id\":%u,\"name\":\"%s\",\"protocol\":\"%s\",\"value\":\"%s\",\"bits\":%u}",
+                     i ? "," : "", (unsigned)i, (unsigned)codes.at(i).id, codes.name(i), codes.protocolName(i),
+                     codes.valueText(i), (unsigned)codes.at(i).bits);
+            json += buf;
+        }
+        json += "]";
+
+        const int rounds = 20;
+        std::vector<uint8_t> image;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) image = imageOf(codes, sequences, 1460);
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            SavedCodeTable c;
+            SavedSequenceTable s;
+            TEST_ASSERT_TRUE(restore(image, c, s, 1460) == SavedBackupReader::Status::Done);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        double writeUs = std::chrono::duration<double, std::micro>(t1 - t0).count() / rounds;
+        double readUs = std::chrono::duration<double, std::micro>(t2 - t1).count() / rounds;
+        char msg[160];
+        snprintf(msg, sizeof(msg), "%d codes + 4 sequences: image %u B (write %.0f us, restore %.0f us), /saved JSON %u B codes only (%.1fx)",
+                 codesCount, (unsigned)image.size(), writeUs, readUs, (unsigned)json.size(),
+                 (double)json.size() / image.size());
+        TEST_MESSAGE(msg);
+        TEST_ASSERT_TRUE(image.size() < json.size());
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc32_matches_zlib);
+    RUN_TEST(test_roundtrip_codes_and_sequences);
+    RUN_TEST(test_empty_roundtrip);
+    RUN_TEST(test_rejects_damaged_images);
+    RUN_TEST(test_take_replaces_table);
+    RUN_TEST(test_benchmark_image_vs_json);
+    return UNITY_END();
+}
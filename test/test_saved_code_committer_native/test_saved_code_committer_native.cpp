@@ -0,0 +1,92 @@
+#include <unity.h>
+#include <stdint.h>
+#include "saved_code_committer.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const uint32_t kIdle = SavedCodeCommitter::kIdle;
+
+void test_idle_until_changed(void) {
+    SavedCodeCommitter c(1000, 5000, 10000);
+    TEST_ASSERT_EQUAL(kIdle, c.dueInMs(0, true));
+    c.changed(100);
+    TEST_ASSERT_EQUAL(1000, c.dueInMs(100, true));
+    TEST_ASSERT_EQUAL(400, c.dueInMs(700, true));
+    TEST_ASSERT_EQUAL(0, c.dueInMs(1100, true));
+    TEST_ASSERT_EQUAL(0, c.dueInMs(9000, true));
+    TEST_ASSERT_EQUAL(kIdle, c.dueInMs(1100, false));  // the store does not want it yet
+    TEST_ASSERT_EQUAL(1000, c.oldestMs(1100));
+}
+
+void test_burst_is_debounced_up_to_max_delay(void) {
+    SavedCodeCommitter c(1000, 5000, 10000);
+    // A change every 500 ms keeps pushing the quiet deadline out...
+    uint32_t now = 0;
+    for (; now < 4500; now += 500) {
+        c.changed(now);
+        TEST_ASSERT_TRUE(c.dueInMs(now, true) > 0);
+    }
+    // ...but not past 5 s after the first one
+    c.changed(now);
+    TEST_ASSERT_EQUAL(500, c.dueInMs(now, true));
+    TEST_ASSERT_EQUAL(0, c.dueInMs(5000, true));
+}
+
+void test_commit_clears_or_keeps_pending(void) {
+    SavedCodeCommitter c(1000, 5000, 10000);
+    c.changed(0);
+    c.changed(200);
+    c.committed(1200, 1250, true, false);
+    TEST_ASSERT_EQUAL(kIdle, c.dueInMs(1300, true));
+    TEST_ASSERT_EQUAL(0, c.oldestMs(1300));
+    TEST_ASSERT_EQUAL(1, c.commits());
+    TEST_ASSERT_EQUAL(50, c.lastCommitMs());
+    TEST_ASSERT_EQUAL(1250, c.lastLatencyMs());
+
+    // Changes made while a commit was written are committed next
+    c.changed(2000);
+    c.changed(3200);
+    c.committed(3000, 3400, true, true);
+    TEST_ASSERT_EQUAL(400, c.maxCommitMs());
+    TEST_ASSERT_EQUAL(800, c.dueInMs(3400, true));
+    TEST_ASSERT_EQUAL(400, c.oldestMs(3400));
+    c.clear();
+    TEST_ASSERT_EQUAL(kIdle, c.dueInMs(3400, true));
+}
+
+void test_failed_commit_is_retried_later(void) {
+    SavedCodeCommitter c(1000, 5000, 10000);
+    c.changed(0);
+    c.committed(1000, 1100, false, true);
+    TEST_ASSERT_EQUAL(1, c.failures());
+    TEST_ASSERT_EQUAL(0, c.commits());
+    TEST_ASSERT_EQUAL(10000, c.dueInMs(1100, true));
+    c.changed(2000);  // new changes do not bring the retry forward
+    TEST_ASSERT_EQUAL(9100, c.dueInMs(2000, true));
+    TEST_ASSERT_EQUAL(0, c.dueInMs(11100, true));
+    c.committed(11100, 11200, true, false);
+    TEST_ASSERT_EQUAL(11200, c.lastLatencyMs());
+    c.changed(12000);
+    TEST_ASSERT_EQUAL(1000, c.dueInMs(12000, true));
+}
+
+void test_clock_wraps(void) {
+    SavedCodeCommitter c(1000, 5000, 10000);
+    uint32_t start = UINT32_MAX - 300;
+    c.changed(start);
+    TEST_ASSERT_EQUAL(1000, c.dueInMs(start, true));
+    TEST_ASSERT_EQUAL(300, c.dueInMs(start + 700, true));
+    TEST_ASSERT_EQUAL(0, c.dueInMs(start + 1000, true));
+    TEST_ASSERT_EQUAL(1200, c.oldestMs(start + 1200));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_idle_until_changed);
+    RUN_TEST(test_burst_is_debounced_up_to_max_delay);
+    RUN_TEST(test_commit_clears_or_keeps_pending);
+    RUN_TEST(test_failed_commit_is_retried_later);
+    RUN_TEST(test_clock_wraps);
+    return UNITY_END();
+}
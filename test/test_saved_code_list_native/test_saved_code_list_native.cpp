@@ -0,0 +1,175 @@
+#include <unity.h>
+#include "Arduino.h"
+#include <ArduinoJson.h>
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "saved_code_list.h"
+#include "saved_code_table.h"
+
+typedef SavedCodeListWriter::Format Format;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const char* protocolName(decode_type_t type) {
+    switch (type) {
+    case NEC: return "NEC";
+    case SAMSUNG: return "SAMSUNG";
+    case SONY: return "SONY";
+    default: return "UNKNOWN";
+    }
+}
+
+// GET /saved as the firmware built it before streaming: one ArduinoJson document
+static std::string referenceJson(const SavedCodeTable& t) {
+    JsonDocument doc;
+    JsonArray arr = doc.to<JsonArray>();
+    for (size_t i = 0; i < t.size(); i++) {
+        JsonObject obj = arr.add<JsonObject>();
+        obj["index"] = (int)i;
+        obj["id"] = t.at(i).id;
+        obj["name"] = t.name(i);
+        obj["protocol"] = t.protocolName(i);
+        obj["value"] = t.valueText(i);
+        obj["bits"] = t.at(i).bits;
+    }
+    std::string out;
+    serializeJson(doc, out);
+    return out;
+}
+
+// GET /dump as the firmware built it before streaming: one String, line by line
+static std::string referenceDump(const SavedCodeTable& t) {
+    int n = (int)t.size();
+    std::string out = "// Saved IR codes — paste into firmware\n";
+    char buf[256];
+    snprintf(buf, sizeof(buf), "// Count: %d\n\n", n);
+    out += buf;
+    for (int i = 0; i < n; i++) {
+        const char* name = t.name(i);
+        const char* protocol = *t.protocolName(i) ? t.protocolName(i) : "UNKNOWN";
+        const char* valueHex = *t.valueText(i) ? t.valueText(i) : "0";
+        uint16_t bits = t.at(i).bits;
+        snprintf(buf, sizeof(buf), "// %d %s %s 0x%s %ub\n", i, name, protocol, valueHex, bits);
+        out += buf;
+        decode_type_t type = (decode_type_t)t.at(i).protocol;
+        if (type == decode_type_t::NEC) {
+            snprintf(buf, sizeof(buf), "irsend.sendNEC(0x%su, %u);  // %s\n", valueHex, bits, name);
+        } else if (type != decode_type_t::UNKNOWN) {
+            snprintf(buf, sizeof(buf), "irsend.send(%s, 0x%sULL, %u);  // %s\n", protocolName(type), valueHex, bits,
+                     name);
+        } else {
+            snprintf(buf, sizeof(buf), "// irsend.send... (unsupported protocol); value=0x%s %s\n", valueHex, name);
+        }
+        out += buf;
+    }
+    return out;
+}
+
+static std::string streamed(const SavedCodeTable& t, Format format, size_t chunk) {
+    SavedCodeListWriter writer(t, format, protocolName);
+    std::string out;
+    std::vector<uint8_t> buf(chunk);
+    for (size_t n; (n = writer.read(buf.data(), chunk)) > 0;) out.append((const char*)buf.data(), n);
+    TEST_ASSERT_EQUAL(0, writer.read(buf.data(), chunk));
+    return out;
+}
+
+static SavedCodeTable makeCodes() {
+    SavedCodeTable t;
+    t.append("Power", "NEC", NEC, "20DF10EF", 32, 0);
+    t.append("HDMI \"2\"", "SAMSUNG", SAMSUNG, "E0E0D12E", 32, 3);
+    t.append("Back\\slash\ttab\nline\r\b\f", "nec", NEC, "FF", 32, 0);
+    t.append("Utf8 \xC3\xA9t\xC3\xA9 \xE2\x9C\x93", "SONY", SONY, "490", 12, 0);
+    t.append("", "", UNKNOWN, "", 0, 0);
+    const uint16_t raw[] = {9000, 4500, 560};
+    t.append("Captured", "DAIKIN", UNKNOWN, "", 0, 0, raw, 3, 38);
+    t.append(std::string(300, 'x').c_str(), "NEC", NEC, "1", 32, 0);  // longer than a /dump line
+    t.remove(1);
+    t.append("HDMI \"2\"", "SAMSUNG", SAMSUNG, "E0E0D12E", 32, 3);  // ids out of order
+    return t;
+}
+
+void test_json_matches_arduinojson(void) {
+    SavedCodeTable t = makeCodes();
+    std::string expected = referenceJson(t);
+    const size_t chunks[] = {1, 7, 64, 1460};
+    for (size_t chunk : chunks) TEST_ASSERT_TRUE(streamed(t, Format::Json, chunk) == expected);
+    TEST_ASSERT_EQUAL(expected.size(), SavedCodeListWriter(t, Format::Json).size());
+
+    SavedCodeTable empty;
+    TEST_ASSERT_EQUAL_STRING("[]", streamed(empty, Format::Json, 1).c_str());
+    TEST_ASSERT_TRUE(referenceJson(empty) == "[]");
+}
+
+void test_dump_matches_string_build(void) {
+    SavedCodeTable t = makeCodes();
+    std::string expected = referenceDump(t);
+    const size_t chunks[] = {1, 7, 64, 1460};
+    for (size_t chunk : chunks) TEST_ASSERT_TRUE(streamed(t, Format::Dump, chunk) == expected);
+    TEST_ASSERT_EQUAL(expected.size(), SavedCodeListWriter(t, Format::Dump, protocolName).size());
+
+    SavedCodeTable empty;
+    TEST_ASSERT_TRUE(streamed(empty, Format::Dump, 5) == referenceDump(empty));
+}
+
+void test_size_keeps_read_position(void) {
+    SavedCodeTable t = makeCodes();
+    SavedCodeListWriter writer(t, Format::Json);
+    uint8_t buf[10];
+    TEST_ASSERT_EQUAL(10, writer.read(buf, sizeof(buf)));
+    std::string rest((const char*)buf, 10);
+    size_t total = writer.size();
+    for (size_t n; (n = writer.read(buf, sizeof(buf))) > 0;) rest.append((const char*)buf, n);
+    TEST_ASSERT_EQUAL(total, rest.size());
+    TEST_ASSERT_TRUE(rest == referenceJson(t));
+}
+
+// Peak memory per response: the String the firmware used to build vs what
+// the writer holds, for growing libraries, and the time per listing.
+void test_benchmark_streaming_memory(void) {
+    const int sizes[] = {50, 200, 1000};
+    for (int codes : sizes) {
+        SavedCodeTable t;
+        for (int i = 0; i < codes; i++) {
+            char name[32], value[16];
+            snprintf(name, sizeof(name), "Button %d", i);
+            snprintf(value, sizeof(value), "20DF%04X", i);
+            t.append(name, "NEC", NEC, value, 32, 0);
+        }
+        const int rounds = 20;
+        size_t built = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) built = referenceJson(t).size();
+        auto t1 = std::chrono::steady_clock::now();
+        size_t held = 0, sent = 0;
+        for (int r = 0; r < rounds; r++) {
+            SavedCodeListWriter writer(t, Format::Json);
+            uint8_t buf[1460];  // about one TCP segment, as the web server asks for
+            sent = 0;
+            for (size_t n; (n = writer.read(buf, sizeof(buf))) > 0;) sent += n;
+            held = writer.bufferBytes() + sizeof(buf);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        TEST_ASSERT_EQUAL(built, sent);
+        TEST_ASSERT_TRUE(held < 2048);
+
+        double buildUs = std::chrono::duration<double, std::micro>(t1 - t0).count() / rounds;
+        double streamUs = std::chrono::duration<double, std::micro>(t2 - t1).count() / rounds;
+        char msg[160];
+        snprintf(msg, sizeof(msg), "/saved %d codes: built %u B in one block (%.0f us), streamed through %u B (%.0f us)",
+                 codes, (unsigned)built, buildUs, (unsigned)held, streamUs);
+        TEST_MESSAGE(msg);
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_json_matches_arduinojson);
+    RUN_TEST(test_dump_matches_string_build);
+    RUN_TEST(test_size_keeps_read_position);
+    RUN_TEST(test_benchmark_streaming_memory);
+    return UNITY_END();
+}
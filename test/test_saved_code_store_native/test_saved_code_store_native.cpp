@@ -0,0 +1,421 @@
+#include <unity.h>
+#include "Arduino.h"
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "saved_code_store.h"
+#include "saved_code_store_fs.h"
+#include "saved_code_table.h"
+#include "saved_sequence_table.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void appendCode(SavedCodeTable& t, int i) {
+    char name[32], value[16];
+    snprintf(name, sizeof(name), "Button %d", i);
+    snprintf(value, sizeof(value), "20DF%04X", i & 0xFFFF);
+    t.append(name, "NEC", NEC, value, 32, 0);
+}
+
+// Tests of the codes alone keep no sequences
+static SavedSequenceTable noSequences;
+
+// Both tables as blobs, end to end
+static std::vector<uint8_t> blobOf(const SavedCodeTable& t, const SavedSequenceTable& s = SavedSequenceTable()) {
+    std::vector<uint8_t> blob, sequences;
+    t.toBlob(blob);
+    s.toBlob(sequences);
+    blob.insert(blob.end(), sequences.begin(), sequences.end());
+    return blob;
+}
+
+// What the store holds, read back through a fresh instance
+template <typename Store>
+static std::vector<uint8_t> reload(Store& store, bool expectStored = true) {
+    SavedCodeTable t;
+    SavedSequenceTable s;
+    TEST_ASSERT_EQUAL(expectStored, store.load(t, s));
+    return blobOf(t, s);
+}
+
+void test_memory_store(void) {
+    SavedCodeStoreMemory store(200);
+    SavedCodeTable t;
+    TEST_ASSERT_FALSE(store.load(t, noSequences));
+    appendCode(t, 1);
+    TEST_ASSERT_TRUE(store.appended(t, noSequences));
+    TEST_ASSERT_TRUE(blobOf(t) == reload(store));
+    for (int i = 2; i < 10; i++) appendCode(t, i);
+    TEST_ASSERT_FALSE(store.save(t, noSequences));  // over capacity: the old contents stay
+    SavedCodeTable u;
+    TEST_ASSERT_TRUE(store.load(u, noSequences));
+    TEST_ASSERT_EQUAL(1, u.size());
+}
+
+void test_fs_store_replays_changes(void) {
+    fs::FS disk;
+    SavedCodeStoreFs store(disk, "/saved");
+    SavedCodeTable t;
+    TEST_ASSERT_FALSE(store.load(t, noSequences));
+    for (int i = 0; i < 5; i++) {
+        appendCode(t, i);
+        TEST_ASSERT_TRUE(store.appended(t, noSequences));
+    }
+    TEST_ASSERT_TRUE(disk.exists("/saved/codes.bin"));
+    t.rename(1, "Renamed");
+    TEST_ASSERT_TRUE(store.renamed(t, noSequences, 1));
+    uint16_t id = t.at(2).id;
+    t.remove(2);
+    TEST_ASSERT_TRUE(store.removed(t, noSequences, id));
+    t.move(3, 0);
+    TEST_ASSERT_TRUE(store.moved(t, noSequences, 0));
+    appendCode(t, 99);
+    TEST_ASSERT_TRUE(store.appended(t, noSequences));
+    TEST_ASSERT_TRUE(store.journalBytes() > 0);
+    TEST_ASSERT_EQUAL(8, store.pendingChanges());  // the first append wrote the snapshot
+
+    SavedCodeStoreFs again(disk, "/saved");
+    SavedCodeTable u;
+    TEST_ASSERT_TRUE(again.load(u, noSequences));
+    TEST_ASSERT_TRUE(blobOf(t) == blobOf(u));
+    TEST_ASSERT_EQUAL(8, again.pendingChanges());
+    TEST_ASSERT_EQUAL_STRING("Renamed", u.name(u.indexOfId(t.at(2).id)));
+    TEST_ASSERT_EQUAL(t.at(4).id, u.at(4).id);
+    // Ids keep counting after a reload
+    appendCode(t, 100);
+    appendCode(u, 100);
+    TEST_ASSERT_EQUAL(7, t.at(5).id);
+    TEST_ASSERT_EQUAL(7, u.at(5).id);
+}
+
+// Commit the way the commit task does, with nothing happening in between
+static void commit(SavedCodeStore& store, const SavedCodeTable& t, const SavedSequenceTable& s = noSequences) {
+    SavedCodeStore::Commit c;
+    TEST_ASSERT_TRUE(store.beginCommit(t, s, c));
+    TEST_ASSERT_TRUE(store.writeCommit(c));
+    TEST_ASSERT_TRUE(store.endCommit(c));
+}
+
+void test_fs_store_commits_when_journal_outgrows_snapshot(void) {
+    fs::FS disk;
+    SavedCodeStoreFs store(disk, "/saved");
+    SavedCodeTable t;
+    for (int i = 0; i < 20; i++) {
+        appendCode(t, i);
+        TEST_ASSERT_TRUE(store.appended(t, noSequences));
+    }
+    TEST_ASSERT_FALSE(store.commitDue());
+    size_t maxJournal = 0, commits = 0;
+    for (int i = 0; i < 500; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Name %d", i);
+        t.rename(i % 20, name);
+        TEST_ASSERT_TRUE(store.renamed(t, noSequences, i % 20));
+        if (store.journalBytes() > maxJournal) maxJournal = store.journalBytes();
+        if (store.commitDue()) {
+            commit(store, t);
+            commits++;
+            TEST_ASSERT_EQUAL(0, store.pendingChanges());
+            TEST_ASSERT_FALSE(disk.exists("/saved/codes.log"));
+        }
+    }
+    TEST_ASSERT_TRUE(commits > 0);
+    TEST_ASSERT_TRUE(maxJournal <= SavedCodeStoreFs::kCommitMinBytes + 64);
+    TEST_ASSERT_TRUE(blobOf(t) == reload(store));
+}
+
+void test_commit_keeps_changes_made_while_writing(void) {
+    SavedCodeStoreMemory store;
+    SavedCodeTable t;
+    for (int i = 0; i < 4; i++) {
+        appendCode(t, i);
+        TEST_ASSERT_TRUE(store.appended(t, noSequences));
+    }
+    SavedCodeStore::Commit c;
+    TEST_ASSERT_TRUE(store.beginCommit(t, noSequences, c));
+    TEST_ASSERT_EQUAL(3, c.changes);
+    // The table is unlocked while the snapshot is written
+    t.rename(0, "During");
+    TEST_ASSERT_TRUE(store.renamed(t, noSequences, 0));
+    appendCode(t, 50);
+    TEST_ASSERT_TRUE(store.appended(t, noSequences));
+    TEST_ASSERT_TRUE(store.writeCommit(c));
+    TEST_ASSERT_TRUE(store.endCommit(c));
+    TEST_ASSERT_EQUAL(2, store.pendingChanges());
+    TEST_ASSERT_TRUE(blobOf(t) == reload(store));
+    TEST_ASSERT_EQUAL(2, store.pendingChanges());
+    commit(store, t);
+    TEST_ASSERT_EQUAL(0, store.pendingChanges());
+    TEST_ASSERT_EQUAL(0, store.journalBytes());
+    TEST_ASSERT_FALSE(store.beginCommit(t, noSequences, c));  // nothing to commit
+    TEST_ASSERT_TRUE(blobOf(t) == reload(store));
+}
+
+// Power lost at each step of a commit: every change survives
+void test_commit_cut_short_loses_nothing(void) {
+    for (int step = 0; step < 3; step++) {
+        fs::FS disk;
+        SavedCodeStoreFs store(disk, "/saved");
+        SavedCodeTable t;
+        for (int i = 0; i < 3; i++) {
+            appendCode(t, i);
+            TEST_ASSERT_TRUE(store.appended(t, noSequences));
+        }
+        t.remove(1);
+        TEST_ASSERT_TRUE(store.removed(t, noSequences, 2));
+        SavedCodeStore::Commit c;
+        TEST_ASSERT_TRUE(store.beginCommit(t, noSequences, c));
+        if (step >= 1) TEST_ASSERT_TRUE(store.writeCommit(c));
+        t.rename(0, "After");
+        TEST_ASSERT_TRUE(store.renamed(t, noSequences, 0));
+        if (step >= 2) TEST_ASSERT_TRUE(store.endCommit(c));
+
+        SavedCodeStoreFs rebooted(disk, "/saved");
+        TEST_ASSERT_TRUE(blobOf(t) == reload(rebooted));
+        TEST_ASSERT_EQUAL(step == 0 ? 4 : 1, rebooted.pendingChanges());
+        t.rename(1, "Later");
+        TEST_ASSERT_TRUE(rebooted.renamed(t, noSequences, 1));
+        commit(rebooted, t);
+        TEST_ASSERT_TRUE(blobOf(t) == reload(store));
+    }
+}
+
+void test_failed_commit_keeps_journal(void) {
+    fs::FS disk;
+    SavedCodeStoreFs store(disk, "/saved");
+    SavedCodeTable t;
+    for (int i = 0; i < 3; i++) {
+        appendCode(t, i);
+        TEST_ASSERT_TRUE(store.appended(t, noSequences));
+    }
+    std::vector<uint8_t> snapshot(disk.files["/saved/codes.bin"]->begin(), disk.files["/saved/codes.bin"]->end());
+    SavedCodeStore::Commit c;
+    TEST_ASSERT_TRUE(store.beginCommit(t, noSequences, c));
+    disk.writeBudget = 10;  // filesystem full
+    TEST_ASSERT_FALSE(store.writeCommit(c));
+    disk.writeBudget = -1;
+    TEST_ASSERT_FALSE(disk.exists("/saved/codes.tmp"));
+    TEST_ASSERT_TRUE(snapshot == std::vector<uint8_t>(disk.files["/saved/codes.bin"]->begin(),
+                                                      disk.files["/saved/codes.bin"]->end()));
+    TEST_ASSERT_EQUAL(2, store.pendingChanges());
+    TEST_ASSERT_TRUE(blobOf(t) == reload(store));
+    commit(store, t);  // a retry goes through
+    TEST_ASSERT_TRUE(blobOf(t) == reload(store));
+    TEST_ASSERT_EQUAL(0, store.pendingChanges());
+}
+
+void test_fs_store_torn_write_keeps_earlier_changes(void) {
+    fs::FS disk;
+    SavedCodeStoreFs store(disk, "/saved");
+    SavedCodeTable t;
+    for (int i = 0; i < 3; i++) {
+        appendCode(t, i);
+        TEST_ASSERT_TRUE(store.appended(t, noSequences));
+    }
+    std::vector<uint8_t> before = blobOf(t);
+
+    // Power lost a few bytes into the next record
+    disk.writeBudget = 5;
+    t.rename(0, "Lost");
+    TEST_ASSERT_FALSE(store.renamed(t, noSequences, 0));
+    disk.writeBudget = -1;
+
+    SavedCodeStoreFs rebooted(disk, "/saved");
+    SavedCodeTable u;
+    TEST_ASSERT_TRUE(rebooted.load(u, noSequences));
+    TEST_ASSERT_TRUE(before == blobOf(u));
+    TEST_ASSERT_EQUAL(2, rebooted.pendingChanges());
+    // The next change replaces the torn tail
+    appendCode(u, 7);
+    TEST_ASSERT_TRUE(rebooted.appended(u, noSequences));
+    TEST_ASSERT_EQUAL(rebooted.journalBytes(), disk.files["/saved/codes.log"]->size());
+    TEST_ASSERT_TRUE(blobOf(u) == reload(rebooted));
+    TEST_ASSERT_EQUAL(3, rebooted.pendingChanges());
+}
+
+void test_fs_store_ignores_stale_log(void) {
+    fs::FS disk;
+    SavedCodeStoreFs store(disk, "/saved");
+    SavedCodeTable t;
+    appendCode(t, 0);
+    TEST_ASSERT_TRUE(store.appended(t, noSequences));
+    appendCode(t, 1);
+    TEST_ASSERT_TRUE(store.appended(t, noSequences));
+    std::string log = *disk.files["/saved/codes.log"];
+
+    // A new snapshot whose old log was not removed (power lost in between)
+    t.remove(0);
+    TEST_ASSERT_TRUE(store.save(t, noSequences));
+    disk.files["/saved/codes.log"] = std::make_shared<std::string>(log);
+    TEST_ASSERT_TRUE(blobOf(t) == reload(store));
+    TEST_ASSERT_FALSE(disk.exists("/saved/codes.log"));
+}
+
+void test_fs_store_rejects_corrupt_snapshot(void) {
+    fs::FS disk;
+    SavedCodeStoreFs store(disk, "/saved");
+    SavedCodeTable t;
+    appendCode(t, 0);
+    TEST_ASSERT_TRUE(store.save(t, noSequences));
+    (*disk.files["/saved/codes.bin"])[0] = 'X';
+    SavedCodeTable u;
+    TEST_ASSERT_FALSE(store.load(u, noSequences));
+    TEST_ASSERT_EQUAL(0, u.size());
+}
+
+static void addSequence(SavedSequenceTable& s, const char* name, uint16_t codeId) {
+    SavedSequenceTable::Step steps[2] = {
+        {codeId, 0, 0, 0, 0, 300},
+        {SavedSequenceTable::kRawCode, (int16_t)NEC, 0x20DF10EFull, 32, 2, 0},
+    };
+    TEST_ASSERT_TRUE(s.add(name, steps, 2));
+}
+
+void test_store_keeps_sequences(void) {
+    fs::FS disk;
+    SavedCodeStoreFs store(disk, "/saved");
+    SavedCodeTable t;
+    SavedSequenceTable s;
+    TEST_ASSERT_FALSE(store.load(t, s));
+    addSequence(s, "Before codes", SavedSequenceTable::kRawCode);
+    TEST_ASSERT_TRUE(store.sequenceAdded(t, s));  // the first change writes the snapshot
+    for (int i = 0; i < 3; i++) {
+        appendCode(t, i);
+        TEST_ASSERT_TRUE(store.appended(t, s));
+    }
+    addSequence(s, "Movie", t.at(1).id);
+    TEST_ASSERT_TRUE(store.sequenceAdded(t, s));
+    addSequence(s, "Off", t.at(2).id);
+    TEST_ASSERT_TRUE(store.sequenceAdded(t, s));
+    s.remove(0);
+    TEST_ASSERT_TRUE(store.sequenceRemoved(t, s, 0));
+    TEST_ASSERT_EQUAL(6, store.pendingChanges());
+
+    SavedCodeStoreFs again(disk, "/saved");
+    SavedCodeTable u;
+    SavedSequenceTable v;
+    TEST_ASSERT_TRUE(again.load(u, v));
+    TEST_ASSERT_TRUE(blobOf(t, s) == blobOf(u, v));
+    TEST_ASSERT_EQUAL(2, v.size());
+    TEST_ASSERT_EQUAL_STRING("Movie", v.name(0));
+    TEST_ASSERT_EQUAL(t.at(1).id, v.step(0, 0).codeId);
+    TEST_ASSERT_EQUAL(300, v.step(0, 0).postDelayMs);
+
+    commit(store, t, s);
+    TEST_ASSERT_FALSE(disk.exists("/saved/codes.log"));
+    TEST_ASSERT_TRUE(blobOf(t, s) == reload(store));
+
+    // With no sequences left the snapshot is the codes' blob alone
+    s.remove(1);
+    TEST_ASSERT_TRUE(store.sequenceRemoved(t, s, 1));
+    s.remove(0);
+    TEST_ASSERT_TRUE(store.sequenceRemoved(t, s, 0));
+    commit(store, t, s);
+    std::vector<uint8_t> codes;
+    t.toBlob(codes);
+    TEST_ASSERT_TRUE(codes == std::vector<uint8_t>(disk.files["/saved/codes.bin"]->begin(),
+                                                   disk.files["/saved/codes.bin"]->end()));
+    TEST_ASSERT_TRUE(blobOf(t, s) == reload(store));
+}
+
+void test_store_rejects_corrupt_sequences(void) {
+    fs::FS disk;
+    SavedCodeStoreFs store(disk, "/saved");
+    SavedCodeTable t;
+    SavedSequenceTable s;
+    appendCode(t, 0);
+    addSequence(s, "Movie", t.at(0).id);
+    TEST_ASSERT_TRUE(store.save(t, s));
+
+    // Removing a sequence that is not there ends the replay
+    TEST_ASSERT_TRUE(store.sequenceRemoved(t, s, 5));
+    TEST_ASSERT_TRUE(blobOf(t, s) == reload(store));
+    TEST_ASSERT_EQUAL(0, store.pendingChanges());
+
+    // A torn sequences blob makes the snapshot unreadable
+    disk.files["/saved/codes.bin"]->pop_back();
+    SavedCodeTable u;
+    SavedSequenceTable v;
+    TEST_ASSERT_FALSE(store.load(u, v));
+    TEST_ASSERT_EQUAL(0, u.size());
+    TEST_ASSERT_EQUAL(0, v.size());
+}
+
+// Bytes written and time spent with the table locked per change, with 1000
+// and 3000 codes: rewriting the whole table on every change (as before the
+// journal) vs journaling it and committing every 20 changes, as a debounced
+// burst of edits would. The commit's snapshot write runs unlocked.
+void test_benchmark_backends(void) {
+    const int sizes[] = {1000, 3000};
+    const int changes = 60, burst = 20;
+    for (int codes : sizes) {
+        SavedCodeTable base;
+        for (int i = 0; i < codes; i++) appendCode(base, i);
+
+        SavedCodeStoreMemory rewrite, journal;
+        fs::FS disk;
+        SavedCodeStoreFs file(disk, "/saved");
+        SavedCodeStore* stores[] = {&rewrite, &journal, &file};
+        size_t bytes[3];
+        double lockedUs[3], commitUs[3] = {0, 0, 0};
+        for (int s = 0; s < 3; s++) {
+            SavedCodeTable t = base;
+            TEST_ASSERT_TRUE(stores[s]->save(t, noSequences));
+            size_t start = s < 2 ? (s == 0 ? rewrite : journal).bytesWritten() : disk.bytesWritten;
+            double locked = 0, unlocked = 0;
+            for (int i = 0; i < changes; i++) {
+                char name[32];
+                snprintf(name, sizeof(name), "Renamed %d", i);
+                size_t index = (size_t)(i * 7) % t.size();
+                t.rename(index, name);
+                auto t0 = std::chrono::steady_clock::now();
+                TEST_ASSERT_TRUE(s == 0 ? stores[s]->save(t, noSequences) : stores[s]->renamed(t, noSequences, index));
+                auto t1 = std::chrono::steady_clock::now();
+                locked += std::chrono::duration<double, std::micro>(t1 - t0).count();
+                if (s == 0 || (i + 1) % burst != 0 || (s == 2 && !stores[s]->commitDue())) continue;
+                SavedCodeStore::Commit c;
+                auto c0 = std::chrono::steady_clock::now();
+                TEST_ASSERT_TRUE(stores[s]->beginCommit(t, noSequences, c));
+                auto c1 = std::chrono::steady_clock::now();
+                TEST_ASSERT_TRUE(stores[s]->writeCommit(c));
+                auto c2 = std::chrono::steady_clock::now();
+                TEST_ASSERT_TRUE(stores[s]->endCommit(c));
+                auto c3 = std::chrono::steady_clock::now();
+                locked += std::chrono::duration<double, std::micro>((c1 - c0) + (c3 - c2)).count();
+                unlocked += std::chrono::duration<double, std::micro>(c2 - c1).count();
+            }
+            bytes[s] = (s < 2 ? (s == 0 ? rewrite : journal).bytesWritten() : disk.bytesWritten) - start;
+            lockedUs[s] = locked / changes;
+            commitUs[s] = unlocked / changes;
+            TEST_ASSERT_TRUE(blobOf(t) == reload(*stores[s]));
+        }
+        char msg[256];
+        snprintf(msg, sizeof(msg),
+                 "%d codes, per change: rewrite %u B %.1f us locked; journal+commit %u B %.1f us locked "
+                 "+ %.1f us unlocked; %s journal %u B %.1f us locked",
+                 codes, (unsigned)(bytes[0] / changes), lockedUs[0], (unsigned)(bytes[1] / changes), lockedUs[1],
+                 commitUs[1], file.name(), (unsigned)(bytes[2] / changes), lockedUs[2]);
+        TEST_MESSAGE(msg);
+        TEST_ASSERT_TRUE(bytes[1] * 10 < bytes[0]);
+        TEST_ASSERT_TRUE(bytes[2] * 10 < bytes[0]);
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_memory_store);
+    RUN_TEST(test_fs_store_replays_changes);
+    RUN_TEST(test_fs_store_commits_when_journal_outgrows_snapshot);
+    RUN_TEST(test_commit_keeps_changes_made_while_writing);
+    RUN_TEST(test_commit_cut_short_loses_nothing);
+    RUN_TEST(test_failed_commit_keeps_journal);
+    RUN_TEST(test_fs_store_torn_write_keeps_earlier_changes);
+    RUN_TEST(test_fs_store_ignores_stale_log);
+    RUN_TEST(test_fs_store_rejects_corrupt_snapshot);
+    RUN_TEST(test_store_keeps_sequences);
+    RUN_TEST(test_store_rejects_corrupt_sequences);
+    RUN_TEST(test_benchmark_backends);
+    return UNITY_END();
+}
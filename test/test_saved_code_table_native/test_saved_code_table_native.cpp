@@ -0,0 +1,699 @@
+#include <unity.h>
+#include "Arduino.h"
+#include <ArduinoJson.h>
+#include <chrono>
+#include <stdio.h>
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+#include <vector>
+#include "hex_utils.h"
+#include "saved_code_table.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_append_parses_fields(void) {
+    SavedCodeTable t;
+    t.append("Power", "NEC", NEC, "FF827D", 32, 0);
+    t.append("Wide", "PANASONIC", PANASONIC, "40040100BCBD", 48, 3);
+
+    TEST_ASSERT_EQUAL(2, t.size());
+    TEST_ASSERT_EQUAL_STRING("Power", t.name(0));
+    TEST_ASSERT_EQUAL_STRING("NEC", t.protocolName(0));
+    TEST_ASSERT_EQUAL_STRING("FF827D", t.valueText(0));
+    TEST_ASSERT_EQUAL(NEC, t.at(0).protocol);
+    TEST_ASSERT_EQUAL_UINT64(0xFF827D, t.at(0).value);
+    TEST_ASSERT_EQUAL(32, t.at(0).bits);
+    TEST_ASSERT_EQUAL(0, t.at(0).repeat);
+    TEST_ASSERT_TRUE(t.isSendable(0));
+
+    TEST_ASSERT_EQUAL_UINT64(0x40040100BCBDULL, t.at(1).value);
+    TEST_ASSERT_EQUAL(48, t.at(1).bits);
+    TEST_ASSERT_EQUAL(3, t.at(1).repeat);
+}
+
+void test_unsendable_entries_keep_their_text(void) {
+    SavedCodeTable t;
+    t.append("AC", "DAIKIN", UNKNOWN, "1234", 280, 0);
+    t.append("Bad", "NEC", NEC, "not-hex", 32, 0);
+
+    TEST_ASSERT_FALSE(t.isSendable(0));
+    TEST_ASSERT_EQUAL_STRING("DAIKIN", t.protocolName(0));
+    TEST_ASSERT_FALSE(t.isSendable(1));
+    TEST_ASSERT_EQUAL_STRING("not-hex", t.valueText(1));
+}
+
+void test_rename_and_remove(void) {
+    SavedCodeTable t;
+    t.append("A", "NEC", NEC, "1", 32, 0);
+    t.append("B", "NEC", NEC, "2", 32, 0);
+    t.append("C", "NEC", NEC, "3", 32, 0);
+
+    t.rename(1, "Bee");
+    TEST_ASSERT_EQUAL_STRING("Bee", t.name(1));
+    TEST_ASSERT_EQUAL_STRING("2", t.valueText(1));
+
+    t.remove(0);
+    TEST_ASSERT_EQUAL(2, t.size());
+    TEST_ASSERT_EQUAL_STRING("Bee", t.name(0));
+    TEST_ASSERT_EQUAL_STRING("C", t.name(1));
+    TEST_ASSERT_EQUAL_UINT64(3, t.at(1).value);
+}
+
+void test_compact_reclaims_pool(void) {
+    SavedCodeTable t;
+    for (int i = 0; i < 10; i++) t.append("name", "NEC", NEC, "FF", 32, 0);
+    size_t before = t.poolBytes();
+    for (int i = 0; i < 3; i++) t.rename(i, "a much longer replacement name");
+    TEST_ASSERT_TRUE(t.garbageBytes() > 0);
+
+    t.compact();
+    TEST_ASSERT_EQUAL(0, t.garbageBytes());
+    TEST_ASSERT_EQUAL(before + 3 * (strlen("a much longer replacement name") - strlen("name")), t.poolBytes());
+    TEST_ASSERT_EQUAL_STRING("a much longer replacement name", t.name(2));
+    TEST_ASSERT_EQUAL_STRING("name", t.name(3));
+}
+
+void test_captured_timings_survive_remove(void) {
+    const uint16_t ac[] = {3500, 1750, 450, 1300, 450, 420, 450};
+    SavedCodeTable t;
+    t.append("Fan", "NEC", NEC, "FF", 32, 0);
+    t.append("AC", "DAIKIN", UNKNOWN, "", 0, 0, ac, 7, 36);
+
+    // Pre-encoding is off by default; captured timings are always kept
+    TEST_ASSERT_FALSE(t.hasTimings(0));
+    TEST_ASSERT_TRUE(t.hasTimings(1));
+    TEST_ASSERT_FALSE(t.isSendable(1));
+    TEST_ASSERT_EQUAL(SavedCodeTable::kTimingsCaptured, t.at(1).flags & SavedCodeTable::kTimingsCaptured);
+    TEST_ASSERT_EQUAL(36, t.at(1).carrierKHz);
+
+    t.remove(0);
+    t.compact();
+    TEST_ASSERT_EQUAL(7, t.at(0).timingsCount);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(ac, t.timings(0), 7);
+    TEST_ASSERT_EQUAL(7 * sizeof(uint16_t), t.timingsBytes());
+}
+
+void test_pre_encode_on_append(void) {
+    SavedCodeTable t;
+    t.setPreEncode(true);
+    t.append("Power", "NEC", NEC, "FF827D", 32, 0);
+    t.append("Sony", "SONY", SONY, "A90", 12, 0);
+    // 128 bits: the value is too wide for `value`, but the timings carry all of it
+    t.append("Long", "NEC", NEC, "80000000000000000000000000000001", 128, 0);
+
+    TEST_ASSERT_TRUE(t.hasTimings(0));
+    TEST_ASSERT_EQUAL(SavedCodeTable::kTimingsEncoded, t.at(0).flags & SavedCodeTable::kTimingsEncoded);
+    TEST_ASSERT_EQUAL(2 + 2 * 32 + 1, t.at(0).timingsCount);
+    TEST_ASSERT_EQUAL(38, t.at(0).carrierKHz);
+    TEST_ASSERT_FALSE(t.hasTimings(1));
+
+    TEST_ASSERT_FALSE(t.isSendable(2));
+    TEST_ASSERT_EQUAL(2 + 2 * 128 + 1, t.at(2).timingsCount);
+    const uint16_t* timings = t.timings(2);
+    TEST_ASSERT_EQUAL(1680, timings[3]);            // first bit: 1
+    TEST_ASSERT_EQUAL(560, timings[5]);             // second bit: 0
+    TEST_ASSERT_EQUAL(1680, timings[2 + 2 * 127 + 1]);  // last bit: 1
+}
+
+void test_blob_roundtrip(void) {
+    const uint16_t ac[] = {3500, 1750, 450, 1300, 450, 420, 450};
+    SavedCodeTable t;
+    t.append("Power", "NEC", NEC, "FF827D", 32, 0);
+    t.append("Wide", "PANASONIC", PANASONIC, "40040100BCBD", 48, 3);
+    t.append("AC", "DAIKIN", UNKNOWN, "", 0, 0, ac, 7, 36);
+    t.append("", "NEC", NEC, "not-hex", 32, 0);
+    t.rename(0, "Power toggle");
+
+    std::vector<uint8_t> blob;
+    t.toBlob(blob);
+    TEST_ASSERT_EQUAL(t.blobBytes(), blob.size());
+    TEST_ASSERT_EQUAL_UINT8(SavedCodeTable::kBlobVersion, blob[3]);
+
+    SavedCodeTable u;
+    u.setPreEncode(true);
+    TEST_ASSERT_TRUE(u.loadBlob(blob.data(), blob.size()));
+    TEST_ASSERT_EQUAL(4, u.size());
+    for (size_t i = 0; i < t.size(); i++) {
+        TEST_ASSERT_EQUAL_STRING(t.name(i), u.name(i));
+        TEST_ASSERT_EQUAL_STRING(t.protocolName(i), u.protocolName(i));
+        TEST_ASSERT_EQUAL_STRING(t.valueText(i), u.valueText(i));
+        TEST_ASSERT_EQUAL_UINT64(t.at(i).value, u.at(i).value);
+        TEST_ASSERT_EQUAL(t.at(i).protocol, u.at(i).protocol);
+        TEST_ASSERT_EQUAL(t.at(i).bits, u.at(i).bits);
+        TEST_ASSERT_EQUAL(t.at(i).repeat, u.at(i).repeat);
+        TEST_ASSERT_EQUAL(t.isSendable(i), u.isSendable(i));
+    }
+    TEST_ASSERT_EQUAL(0, u.garbageBytes());
+    TEST_ASSERT_EQUAL(36, u.at(2).carrierKHz);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(ac, u.timings(2), 7);
+    // Pre-encoded timings are rebuilt rather than stored
+    TEST_ASSERT_TRUE(u.hasTimings(0));
+    TEST_ASSERT_EQUAL(SavedCodeTable::kTimingsEncoded, u.at(0).flags & SavedCodeTable::kTimingsEncoded);
+    std::vector<uint8_t> again;
+    u.toBlob(again);
+    TEST_ASSERT_TRUE(blob == again);
+
+    SavedCodeTable empty;
+    empty.toBlob(blob);
+    TEST_ASSERT_EQUAL(SavedCodeTable::kBlobHeaderBytes, blob.size());
+    TEST_ASSERT_TRUE(u.loadBlob(blob.data(), blob.size()));
+    TEST_ASSERT_EQUAL(0, u.size());
+}
+
+void test_stable_ids(void) {
+    SavedCodeTable t;
+    t.append("A", "NEC", NEC, "1", 32, 0);
+    t.append("B", "NEC", NEC, "2", 32, 0);
+    t.append("C", "NEC", NEC, "3", 32, 0);
+    TEST_ASSERT_EQUAL(1, t.at(0).id);
+    TEST_ASSERT_EQUAL(3, t.at(2).id);
+
+    // Ids follow their codes through removes and moves, and are not reused
+    t.remove(0);
+    t.append("D", "NEC", NEC, "4", 32, 0);
+    TEST_ASSERT_EQUAL(4, t.at(2).id);
+    t.move(2, 0);
+    TEST_ASSERT_EQUAL_STRING("D", t.name(0));
+    TEST_ASSERT_EQUAL_STRING("B", t.name(1));
+    TEST_ASSERT_EQUAL_STRING("C", t.name(2));
+    TEST_ASSERT_EQUAL(0, t.indexOfId(4));
+    TEST_ASSERT_EQUAL(2, t.indexOfId(3));
+    TEST_ASSERT_EQUAL(-1, t.indexOfId(1));
+    t.move(0, 2);
+    TEST_ASSERT_EQUAL(2, t.indexOfId(4));
+    TEST_ASSERT_EQUAL_UINT64(4, t.at(2).value);
+
+    // The next id survives a save/load, even after the newest code is removed
+    t.remove(2);
+    std::vector<uint8_t> blob;
+    t.toBlob(blob);
+    SavedCodeTable u;
+    TEST_ASSERT_TRUE(u.loadBlob(blob.data(), blob.size()));
+    TEST_ASSERT_EQUAL(1, u.indexOfId(3));
+    u.append("E", "NEC", NEC, "5", 32, 0);
+    TEST_ASSERT_EQUAL(5, u.at(2).id);
+}
+
+void test_blob_rejects_corrupt(void) {
+    const uint16_t ac[] = {3500, 1750, 450};
+    SavedCodeTable t;
+    t.append("Power", "NEC", NEC, "FF827D", 32, 0);
+    t.append("AC", "DAIKIN", UNKNOWN, "", 0, 0, ac, 3, 38);
+    std::vector<uint8_t> blob;
+    t.toBlob(blob);
+
+    SavedCodeTable u;
+    TEST_ASSERT_FALSE(u.loadBlob(blob.data(), blob.size() - 1));
+    TEST_ASSERT_EQUAL(0, u.size());
+    TEST_ASSERT_FALSE(u.loadBlob(nullptr, 0));
+
+    std::vector<uint8_t> bad = blob;
+    bad[3] = SavedCodeTable::kBlobVersion + 1;
+    TEST_ASSERT_FALSE(u.loadBlob(bad.data(), bad.size()));
+
+    // A string running into the next record's fields
+    bad = blob;
+    bad[SavedCodeTable::kBlobHeaderBytes + 2 * SavedCodeTable::kBlobRecordBytes + 5] = 'x';
+    TEST_ASSERT_FALSE(u.loadBlob(bad.data(), bad.size()));
+
+    // Timings claimed by a record without the captured flag
+    bad = blob;
+    bad[SavedCodeTable::kBlobHeaderBytes + SavedCodeTable::kBlobRecordBytes + 13] = 0;
+    TEST_ASSERT_FALSE(u.loadBlob(bad.data(), bad.size()));
+
+    TEST_ASSERT_TRUE(u.loadBlob(blob.data(), blob.size()));
+    TEST_ASSERT_EQUAL(2, u.size());
+}
+
+void test_blob_rejects_duplicate_ids(void) {
+    SavedCodeTable t;
+    t.append("A", "NEC", NEC, "1", 32, 0);
+    t.append("B", "NEC", NEC, "2", 32, 0);
+    std::vector<uint8_t> blob;
+    t.toBlob(blob);
+
+    // Both records claiming id 1
+    std::vector<uint8_t> bad = blob;
+    bad[SavedCodeTable::kBlobHeaderBytes + SavedCodeTable::kBlobRecordBytes + 18] = 1;
+    SavedCodeTable u;
+    TEST_ASSERT_FALSE(u.loadBlob(bad.data(), bad.size()));
+    TEST_ASSERT_EQUAL(0, u.size());
+
+    // An appended code whose id is already in the table
+    TEST_ASSERT_TRUE(u.loadBlob(blob.data(), blob.size()));
+    std::vector<uint8_t> one;
+    t.toBlob(one, 1, 1);
+    TEST_ASSERT_FALSE(u.appendBlob(one.data(), one.size()));
+    TEST_ASSERT_EQUAL(2, u.size());
+    TEST_ASSERT_EQUAL(1, u.indexOfId(2));
+
+    // Next id 0 is never written
+    bad = blob;
+    bad[6] = bad[7] = 0;
+    TEST_ASSERT_FALSE(u.loadBlob(bad.data(), bad.size()));
+}
+
+// Cache load at boot: the per-key layout read n JSON strings and parsed each
+// one; the blob is one read plus a walk over fixed-size records. NVS read
+// time is not modelled (the per-key layout also pays n lookups there).
+void test_benchmark_blob_load(void) {
+    const int sizes[] = {50, 200, 500};
+    for (int codes : sizes) {
+        std::vector<std::string> raws;
+        SavedCodeTable source;
+        for (int i = 0; i < codes; i++) {
+            char name[32], value[16], raw[128];
+            snprintf(name, sizeof(name), "Button %d", i);
+            snprintf(value, sizeof(value), "FF%04X", i);
+            snprintf(raw, sizeof(raw), "{\"name\":\"%s\",\"protocol\":\"NEC\",\"value\":\"%s\",\"bits\":32}",
+                     name, value);
+            raws.push_back(raw);
+            source.append(name, "NEC", NEC, value, 32, 0);
+        }
+        std::vector<uint8_t> blob;
+        source.toBlob(blob);
+        size_t jsonBytes = 0;
+        for (const std::string& raw : raws) jsonBytes += raw.size();
+
+        const int rounds = 20;
+        SavedCodeTable table;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            table.clear();
+            table.reserve(codes, codes * 32);
+            for (const std::string& raw : raws) {
+                JsonDocument entry;
+                deserializeJson(entry, raw.c_str());
+                int repeat = entry["repeat"] | 0;
+                table.append(entry["name"] | "", entry["protocol"] | "", NEC, entry["value"] | "",
+                             entry["bits"] | 32, (uint8_t)repeat);
+            }
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            TEST_ASSERT_TRUE(table.loadBlob(blob.data(), blob.size()));
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        TEST_ASSERT_EQUAL(codes, table.size());
+
+        double jsonUs = std::chrono::duration<double, std::micro>(t1 - t0).count() / rounds;
+        double blobUs = std::chrono::duration<double, std::micro>(t2 - t1).count() / rounds;
+        char msg[160];
+        snprintf(msg, sizeof(msg), "load %d codes: per-key JSON %.0f us (%u B), blob %.0f us (%u B) (%.1fx)",
+                 codes, jsonUs, (unsigned)jsonBytes, blobUs, (unsigned)blob.size(), jsonUs / blobUs);
+        TEST_MESSAGE(msg);
+        TEST_ASSERT_TRUE(blobUs < jsonUs);
+        TEST_ASSERT_TRUE(blob.size() < jsonBytes);
+    }
+}
+
+// Reference for indexOfName(): the linear scan it replaces.
+static int scanName(const SavedCodeTable& t, const char* name) {
+    for (size_t i = 0; i < t.size(); i++) {
+        if (strcasecmp(t.name(i), name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+void test_name_index(void) {
+    SavedCodeTable t;
+    t.append("Power", "NEC", NEC, "20DF10EF", 32, 0);
+    t.append("vol+", "NEC", NEC, "20DF40BF", 32, 0);
+    t.append("POWER", "SONY", SONY, "A90", 12, 0);
+    TEST_ASSERT_EQUAL(0, t.indexOfName("power"));
+    TEST_ASSERT_EQUAL(1, t.indexOfName("VOL+"));
+    TEST_ASSERT_EQUAL(-1, t.indexOfName("Vol-"));
+    TEST_ASSERT_EQUAL(-1, t.indexOfName(""));
+
+    t.remove(0);  // the duplicate now answers, at its shifted index
+    TEST_ASSERT_EQUAL(1, t.indexOfName("Power"));
+    t.rename(1, "TV Power");
+    TEST_ASSERT_EQUAL(-1, t.indexOfName("power"));
+    TEST_ASSERT_EQUAL(1, t.indexOfName("tv power"));
+    t.move(1, 0);
+    TEST_ASSERT_EQUAL(0, t.indexOfName("TV POWER"));
+    TEST_ASSERT_EQUAL(1, t.indexOfName("Vol+"));
+
+    std::vector<uint8_t> blob;
+    t.toBlob(blob);
+    SavedCodeTable loaded;
+    TEST_ASSERT_TRUE(loaded.loadBlob(blob.data(), blob.size()));
+    TEST_ASSERT_EQUAL(0, loaded.indexOfName("tv power"));
+    TEST_ASSERT_EQUAL(1, loaded.indexOfName("VOL+"));
+}
+
+void test_code_index(void) {
+    SavedCodeTable t;
+    t.append("Power", "NEC", NEC, "20DF10EF", 32, 0);
+    t.append("Power (16)", "nec", NEC, "20DF10EF", 16, 0);
+    t.append("Sony", "SONY", SONY, "A90", 12, 0);
+    t.append("Bad", "NEC", NEC, "zz", 32, 0);
+    bool exact;
+    TEST_ASSERT_EQUAL(1, t.indexOfCode("NEC", 0x20DF10EF, 16, exact));
+    TEST_ASSERT_TRUE(exact);
+    TEST_ASSERT_EQUAL(0, t.indexOfCode("Nec", 0x20DF10EF, 32, exact));
+    TEST_ASSERT_TRUE(exact);
+    TEST_ASSERT_EQUAL(0, t.indexOfCode("NEC", 0x20DF10EF, 24, exact));  // first likely
+    TEST_ASSERT_FALSE(exact);
+    TEST_ASSERT_EQUAL(2, t.indexOfCode("SONY", 0xA90, 12, exact));
+    TEST_ASSERT_EQUAL(-1, t.indexOfCode("SAMSUNG", 0xA90, 12, exact));
+    TEST_ASSERT_EQUAL(-1, t.indexOfCode("NEC", 0, 32, exact));  // invalid values are not indexed
+    TEST_ASSERT_FALSE(exact);
+
+    t.remove(0);
+    TEST_ASSERT_EQUAL(0, t.indexOfCode("NEC", 0x20DF10EF, 32, exact));
+    TEST_ASSERT_FALSE(exact);
+    t.move(0, 2);
+    TEST_ASSERT_EQUAL(2, t.indexOfCode("NEC", 0x20DF10EF, 16, exact));
+    TEST_ASSERT_TRUE(exact);
+}
+
+// Reference for indexOfCode(): the browser's former matchSaved() scan.
+static int scanCode(const SavedCodeTable& t, const char* protocol, uint64_t value, uint16_t bits, bool& exact) {
+    int likely = -1;
+    exact = false;
+    for (size_t i = 0; i < t.size(); i++) {
+        const SavedCodeTable::Entry& e = t.at(i);
+        if (!(e.flags & SavedCodeTable::kValueValid) || e.value != value) continue;
+        if (strcasecmp(t.protocolName(i), protocol) != 0) continue;
+        if (e.bits == bits) {
+            exact = true;
+            return (int)i;
+        }
+        if (likely < 0) likely = (int)i;
+    }
+    return likely;
+}
+
+// Random appends, renames, removes and moves with few distinct names and
+// codes (many duplicates and collisions) must keep the indexes in step with
+// a scan.
+void test_indexes_match_scan(void) {
+    SavedCodeTable t;
+    uint32_t rng = 12345;
+    auto next = [&rng](uint32_t n) {
+        rng = rng * 1103515245u + 12345u;
+        return (rng >> 8) % n;
+    };
+    char name[16];
+    for (int op = 0; op < 3000; op++) {
+        snprintf(name, sizeof(name), next(2) ? "Key %u" : "KEY %u", (unsigned)next(40));
+        uint32_t kind = next(10);
+        if (kind < 5 || t.size() < 2) {
+            char value[16];
+            snprintf(value, sizeof(value), "%X", (unsigned)next(8));
+            t.append(name, next(2) ? "NEC" : "Sony", NEC, value, next(2) ? 32 : 12, 0);
+        } else if (kind < 7) {
+            t.rename(next(t.size()), name);
+        } else if (kind < 9) {
+            t.remove(next(t.size()));
+        } else {
+            t.move(next(t.size()), next(t.size()));
+        }
+        for (unsigned k = 0; k < 40; k += 7) {
+            snprintf(name, sizeof(name), "key %u", k);
+            TEST_ASSERT_EQUAL(scanName(t, name), t.indexOfName(name));
+        }
+        for (size_t i = 0; i < t.size(); i += 5) TEST_ASSERT_EQUAL((int)i, t.indexOfId(t.at(i).id));
+        for (uint64_t value = 0; value < 8; value += 3) {
+            bool exact, scanExact;
+            TEST_ASSERT_EQUAL(scanCode(t, "nec", value, 32, scanExact), t.indexOfCode("nec", value, 32, exact));
+            TEST_ASSERT_EQUAL(scanExact, exact);
+        }
+    }
+}
+
+// RAM per saved code, for a typical library (short names, 32-bit NEC
+// values) loaded from its blob: the table's arrays after shrinkToFit(),
+// without and with pre-encoded timings. The arrays are the only heap
+// blocks, however many codes there are.
+void test_memory_per_code(void) {
+    const int sizes[] = {50, 200, 500};
+    for (int codes : sizes) {
+        SavedCodeTable source;
+        for (int i = 0; i < codes; i++) {
+            char name[32], value[16];
+            snprintf(name, sizeof(name), "Button %d", i);
+            snprintf(value, sizeof(value), "20DF%04X", i);
+            source.append(name, "NEC", NEC, value, 32, 0);
+        }
+        size_t grown = source.memoryBytes();
+        source.shrinkToFit();
+        TEST_ASSERT_TRUE(source.memoryBytes() <= grown);
+        std::vector<uint8_t> blob;
+        source.toBlob(blob);
+
+        double perCode[2];
+        for (int encode = 0; encode < 2; encode++) {
+            SavedCodeTable table;
+            table.setPreEncode(encode != 0);
+            TEST_ASSERT_TRUE(table.loadBlob(blob.data(), blob.size()));
+            table.shrinkToFit();
+            perCode[encode] = (double)table.memoryBytes() / codes;
+        }
+        char msg[160];
+        snprintf(msg, sizeof(msg), "RAM %d codes: %.0f B/code (%u B entry), %.0f B/code pre-encoded; "
+                 "appended without shrink %.0f B/code", codes, perCode[0], (unsigned)sizeof(SavedCodeTable::Entry),
+                 perCode[1], (double)grown / codes);
+        TEST_MESSAGE(msg);
+        TEST_ASSERT_TRUE(perCode[0] < 100);
+        TEST_ASSERT_TRUE(perCode[1] < perCode[0] + 150);
+    }
+}
+
+void test_shrink_keeps_contents(void) {
+    SavedCodeTable t;
+    for (int i = 0; i < 40; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "Code %d", i);
+        t.append(name, "NEC", NEC, "20DF10EF", 32, 0);
+    }
+    for (int i = 0; i < 30; i++) t.remove(0);
+    t.rename(0, "First");
+    t.shrinkToFit();
+    TEST_ASSERT_EQUAL(10, t.size());
+    TEST_ASSERT_EQUAL(0, t.garbageBytes());
+    TEST_ASSERT_EQUAL_STRING("First", t.name(0));
+    TEST_ASSERT_EQUAL_STRING("Code 39", t.name(9));
+    TEST_ASSERT_EQUAL(9, t.indexOfName("code 39"));
+    t.append("Late", "SONY", SONY, "A90", 12, 0);
+    TEST_ASSERT_EQUAL(10, t.indexOfName("late"));
+}
+
+// Name lookup in a 1000-code list: linear strcasecmp scan vs the hash index.
+void test_benchmark_name_lookup(void) {
+    const int codes = 1000;
+    const int iterations = 20000;
+    SavedCodeTable table;
+    std::vector<std::string> names;
+    for (int i = 0; i < codes; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Living Room Button %d", i);
+        names.push_back(name);
+        table.append(name, "NEC", NEC, "20DF10EF", 32, 0);
+    }
+    // Look up in another case so the comparison has to fold
+    for (std::string& n : names) {
+        for (char& c : n) c = (char)toupper((unsigned char)c);
+    }
+
+    volatile long sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int n = 0; n < iterations; n++) sink += scanName(table, names[(n * 7919) % codes].c_str());
+    auto t1 = std::chrono::steady_clock::now();
+    for (int n = 0; n < iterations; n++) sink += table.indexOfName(names[(n * 7919) % codes].c_str());
+    auto t2 = std::chrono::steady_clock::now();
+    for (int i = 0; i < codes; i += 97) TEST_ASSERT_EQUAL(i, table.indexOfName(names[i].c_str()));
+
+    double scanNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    double indexNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "name lookup %d codes: scan %.0f ns, hash index %.0f ns (%.1fx)",
+             codes, scanNs, indexNs, scanNs / indexNs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(indexNs < scanNs);
+}
+
+// Per-send cost of turning a cached saved code into (protocol, value, bits):
+// the old path reparsed the stored JSON and compared protocol strings on every
+// send; the table path copies one fixed-size entry.
+void test_benchmark_send_lookup(void) {
+    const int codes = 50;
+    const int iterations = 20000;
+    std::vector<std::string> raws;
+    SavedCodeTable table;
+    for (int i = 0; i < codes; i++) {
+        char name[32], value[16], raw[128];
+        snprintf(name, sizeof(name), "Button %d", i);
+        snprintf(value, sizeof(value), "FF%04X", i);
+        snprintf(raw, sizeof(raw), "{\"name\":\"%s\",\"protocol\":\"NEC\",\"value\":\"%s\",\"bits\":32}", name, value);
+        raws.push_back(raw);
+        table.append(name, "NEC", NEC, value, 32, 0);
+    }
+
+    volatile uint64_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int n = 0; n < iterations; n++) {
+        std::string raw = raws[n % codes];
+        JsonDocument entry;
+        if (deserializeJson(entry, raw.c_str())) continue;
+        String outName = entry["name"] | "";
+        const char *protocol = entry["protocol"] | "";
+        const char *valueHex = entry["value"] | "";
+        uint16_t bits = entry["bits"] | 32;
+        uint32_t value;
+        if (String(protocol).equalsIgnoreCase("NEC") && parseHex32(valueHex, value)) {
+            sink += value + bits + outName.length();
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int n = 0; n < iterations; n++) {
+        size_t i = n % codes;
+        SavedCodeTable::Entry code = table.at(i);
+        String outName = table.name(i);
+        if (table.isSendable(i)) {
+            sink += code.value + code.bits + outName.length();
+        }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double jsonNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    double tableNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "per-send lookup: JSON reparse %.0f ns, pre-parsed table %.0f ns (%.1fx)",
+             jsonNs, tableNs, jsonNs / tableNs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(tableNs < jsonNs);
+}
+
+void test_generation_counts_changes(void) {
+    SavedCodeTable t;
+    uint32_t g = t.generation();
+    t.append("A", "NEC", NEC, "20DF10EF", 32, 0);
+    TEST_ASSERT_TRUE(t.generation() != g);
+    t.append("B", "NEC", NEC, "20DF20DF", 32, 0);
+    uint32_t unchanged = t.generation();
+    // Lookups, serializing and compaction leave it alone
+    bool exact;
+    t.indexOfName("a");
+    t.indexOfCode("NEC", 0x20DF10EF, 32, exact);
+    std::vector<uint8_t> blob;
+    t.toBlob(blob);
+    t.shrinkToFit();
+    TEST_ASSERT_EQUAL(unchanged, t.generation());
+
+    uint32_t seen[6];
+    int k = 0;
+    t.rename(0, "C");
+    seen[k++] = t.generation();
+    t.move(0, 1);
+    seen[k++] = t.generation();
+    t.remove(0);
+    seen[k++] = t.generation();
+    // Another table's code, with an id not in this one
+    SavedCodeTable other;
+    for (const char* name : {"D", "E", "F"}) other.append(name, "NEC", NEC, "1", 32, 0);
+    std::vector<uint8_t> more;
+    other.toBlob(more, 2, 1);
+    TEST_ASSERT_TRUE(t.appendBlob(more.data(), more.size()));
+    seen[k++] = t.generation();
+    TEST_ASSERT_TRUE(t.loadBlob(blob.data(), blob.size()));
+    seen[k++] = t.generation();
+    t.clear();
+    seen[k++] = t.generation();
+    uint32_t last = unchanged;
+    for (int i = 0; i < k; i++) {
+        TEST_ASSERT_TRUE(seen[i] != last);
+        last = seen[i];
+    }
+    // A failed load is still a change: the table was emptied
+    t.append("D", "NEC", NEC, "1", 32, 0);
+    g = t.generation();
+    TEST_ASSERT_FALSE(t.loadBlob(blob.data(), 4));
+    TEST_ASSERT_TRUE(t.generation() != g);
+}
+
+// Serving the saved-code list (GET /saved) to a polling client: rebuilding
+// the JSON body from the table on every request vs copying a body cached
+// until the table's generation moves on.
+void test_benchmark_list_body_cache(void) {
+    const int codes = 100;
+    const int iterations = 500;
+    SavedCodeTable table;
+    for (int i = 0; i < codes; i++) {
+        char name[32], value[16];
+        snprintf(name, sizeof(name), "Button %d", i);
+        snprintf(value, sizeof(value), "20DF%04X", i);
+        table.append(name, "NEC", NEC, value, 32, 0);
+    }
+    // Same fields as the firmware's ArduinoJson body (names need no escaping here)
+    auto build = [&]() {
+        std::string out = "[";
+        char buf[160];
+        for (size_t i = 0; i < table.size(); i++) {
+            snprintf(buf, sizeof(buf), "%s{\"index\":%u,\"id\":%u,\"name\":\"%s\",\"protocol\":\"%s\",\"value\":\"%s\",\"bits\":%u}",
+                     i ? "," : "", (unsigned)i, (unsigned)table.at(i).id, table.name(i), table.protocolName(i),
+                     table.valueText(i), (unsigned)table.at(i).bits);
+            out += buf;
+        }
+        return out + "]";
+    };
+
+    volatile size_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int n = 0; n < iterations; n++) sink += build().size();
+    auto t1 = std::chrono::steady_clock::now();
+    std::string cached;
+    uint32_t generation = 0;
+    bool valid = false;
+    int misses = 0;
+    for (int n = 0; n < iterations; n++) {
+        if (!valid || generation != table.generation()) {
+            cached = build();
+            generation = table.generation();
+            valid = true;
+            misses++;
+        }
+        std::string body = cached;
+        sink += body.size();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    TEST_ASSERT_EQUAL(1, misses);
+    TEST_ASSERT_TRUE(cached == build());
+
+    double buildUs = std::chrono::duration<double, std::micro>(t1 - t0).count() / iterations;
+    double cachedUs = std::chrono::duration<double, std::micro>(t2 - t1).count() / iterations;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "/saved body %d codes (%u B): rebuild %.1f us, cached copy %.2f us (%.0fx)", codes,
+             (unsigned)cached.size(), buildUs, cachedUs, buildUs / cachedUs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(cachedUs < buildUs);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_append_parses_fields);
+    RUN_TEST(test_unsendable_entries_keep_their_text);
+    RUN_TEST(test_rename_and_remove);
+    RUN_TEST(test_compact_reclaims_pool);
+    RUN_TEST(test_captured_timings_survive_remove);
+    RUN_TEST(test_pre_encode_on_append);
+    RUN_TEST(test_blob_roundtrip);
+    RUN_TEST(test_blob_rejects_corrupt);
+    RUN_TEST(test_stable_ids);
+    RUN_TEST(test_blob_rejects_duplicate_ids);
+    RUN_TEST(test_name_index);
+    RUN_TEST(test_code_index);
+    RUN_TEST(test_indexes_match_scan);
+    RUN_TEST(test_shrink_keeps_contents);
+    RUN_TEST(test_memory_per_code);
+    RUN_TEST(test_generation_counts_changes);
+    RUN_TEST(test_benchmark_send_lookup);
+    RUN_TEST(test_benchmark_name_lookup);
+    RUN_TEST(test_benchmark_blob_load);
+    RUN_TEST(test_benchmark_list_body_cache);
+    return UNITY_END();
+}
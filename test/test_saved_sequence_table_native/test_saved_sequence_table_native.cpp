@@ -0,0 +1,185 @@
+#include <unity.h>
+#include "Arduino.h"
+#include <algorithm>
+#include <vector>
+#include "saved_code_table.h"
+#include "saved_sequence_table.h"
+
+typedef SavedSequenceTable::Step Step;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Ids 1-4
+static SavedCodeTable makeCodes() {
+    SavedCodeTable codes;
+    codes.append("Power", "NEC", NEC, "20DF10EF", 32, 0);
+    codes.append("HDMI", "SAMSUNG", SAMSUNG, "E0E0D12E", 32, 3);
+    codes.append("AC", "DAIKIN", UNKNOWN, "1234", 280, 0);
+    codes.append("Vol+", "SONY", SONY, "490", 12, 0);
+    return codes;
+}
+
+void test_add_and_lookup(void) {
+    SavedSequenceTable t;
+    const Step steps[] = {
+        {1, 0, 0, 0, 0, 500},
+        {SavedSequenceTable::kRawCode, NEC, 0x20DF40BF, 32, 2, 0},
+    };
+    TEST_ASSERT_TRUE(t.add("Movie mode", steps, 2));
+    TEST_ASSERT_EQUAL(1, t.size());
+    TEST_ASSERT_EQUAL_STRING("Movie mode", t.name(0));
+    TEST_ASSERT_EQUAL(2, t.stepCount(0));
+    TEST_ASSERT_EQUAL(500, t.step(0, 0).postDelayMs);
+    TEST_ASSERT_EQUAL(0, t.indexOf("movie MODE"));
+    TEST_ASSERT_EQUAL(-1, t.indexOf("Other"));
+    TEST_ASSERT_EQUAL(-1, t.indexOf(""));
+}
+
+void test_add_rejects_invalid(void) {
+    SavedSequenceTable t;
+    Step steps[IrSender::kMaxSequenceSteps + 1];
+    for (auto& s : steps) s = {1, 0, 0, 0, 0, 0};
+
+    TEST_ASSERT_FALSE(t.add("Long", steps, IrSender::kMaxSequenceSteps + 1));
+    steps[0].postDelayMs = IrSender::kMaxPostDelayMs + 1;
+    TEST_ASSERT_FALSE(t.add("Delay", steps, 1));
+    steps[0].postDelayMs = 0;
+    for (size_t i = 0; i < SavedSequenceTable::kMaxSequences; i++) {
+        TEST_ASSERT_TRUE(t.add("S", steps, 1));
+    }
+    TEST_ASSERT_FALSE(t.add("Full", steps, 1));
+}
+
+void test_resolve_uses_saved_codes_and_repeats(void) {
+    SavedCodeTable codes = makeCodes();
+    SavedSequenceTable t;
+    const Step steps[] = {
+        {1, 0, 0, 0, 0, 100},                                    // saved, default repeat
+        {2, 0, 0, 0, 0, 0},                                      // saved repeat 3
+        {2, 0, 0, 0, 1, 0},                                      // step overrides
+        {SavedSequenceTable::kRawCode, SONY, 0xA90, 12, 2, 50},  // raw code
+    };
+    TEST_ASSERT_TRUE(t.add("Mix", steps, 4));
+
+    IrSender::SequenceStep out[IrSender::kMaxSequenceSteps];
+    TEST_ASSERT_EQUAL(4, t.resolve(0, codes, 2, out));
+    TEST_ASSERT_EQUAL(NEC, out[0].protocol);
+    TEST_ASSERT_EQUAL_UINT64(0x20DF10EF, out[0].value);
+    TEST_ASSERT_EQUAL(2, out[0].repeat);
+    TEST_ASSERT_EQUAL(100, out[0].postDelayMs);
+    TEST_ASSERT_EQUAL(SAMSUNG, out[1].protocol);
+    TEST_ASSERT_EQUAL(3, out[1].repeat);
+    TEST_ASSERT_EQUAL(1, out[2].repeat);
+    TEST_ASSERT_EQUAL(SONY, out[3].protocol);
+    TEST_ASSERT_EQUAL_UINT64(0xA90, out[3].value);
+    TEST_ASSERT_EQUAL(12, out[3].bits);
+    TEST_ASSERT_EQUAL(50, out[3].postDelayMs);
+}
+
+void test_resolve_skips_unsendable_steps(void) {
+    SavedCodeTable codes = makeCodes();
+    SavedSequenceTable t;
+    const Step steps[] = {
+        {3, 0, 0, 0, 0, 0},   // DAIKIN: not sendable
+        {9, 0, 0, 0, 0, 0},   // no such id
+        {4, 0, 0, 0, 0, 0},
+    };
+    TEST_ASSERT_TRUE(t.add("Skip", steps, 3));
+
+    IrSender::SequenceStep out[IrSender::kMaxSequenceSteps];
+    TEST_ASSERT_EQUAL(1, t.resolve(0, codes, 1, out));
+    TEST_ASSERT_EQUAL(SONY, out[0].protocol);
+}
+
+// Steps name codes by id, so deleting or moving codes changes nothing in
+// the sequences; a deleted code's step is skipped when sent.
+void test_steps_follow_codes_by_id(void) {
+    SavedCodeTable codes = makeCodes();
+    SavedSequenceTable t;
+    const Step a[] = {{1, 0, 0, 0, 0, 0}, {4, 0, 0, 0, 0, 0}, {2, 0, 0, 0, 0, 0}};
+    TEST_ASSERT_TRUE(t.add("A", a, 3));
+    uint32_t generation = t.generation();
+
+    codes.move(3, 0);    // Vol+ first
+    codes.remove(1);     // Power
+    IrSender::SequenceStep out[IrSender::kMaxSequenceSteps];
+    TEST_ASSERT_EQUAL(2, t.resolve(0, codes, 1, out));
+    TEST_ASSERT_EQUAL(SONY, out[0].protocol);
+    TEST_ASSERT_EQUAL(SAMSUNG, out[1].protocol);
+    TEST_ASSERT_EQUAL(3, t.stepCount(0));
+    TEST_ASSERT_EQUAL(1, t.step(0, 0).codeId);
+    TEST_ASSERT_EQUAL(generation, t.generation());
+
+    // A sequence may be empty
+    TEST_ASSERT_TRUE(t.add("Empty", nullptr, 0));
+}
+
+void test_remove(void) {
+    SavedSequenceTable t;
+    const Step s[] = {{1, 0, 0, 0, 0, 0}};
+    t.add("A", s, 1);
+    t.add("B", s, 1);
+    t.remove(0);
+    TEST_ASSERT_EQUAL(1, t.size());
+    TEST_ASSERT_EQUAL_STRING("B", t.name(0));
+}
+
+void test_blob_roundtrip(void) {
+    SavedSequenceTable t;
+    const Step steps[] = {
+        {3, 0, 0, 0, 0, 500},
+        {SavedSequenceTable::kRawCode, NEC, 0x20DF40BF, 32, 2, 0},
+        {SavedSequenceTable::kRawCode, (int16_t)UNKNOWN, 0xFFFFFFFFFFFFFFFFull, 64, 0, IrSender::kMaxPostDelayMs},
+    };
+    TEST_ASSERT_TRUE(t.add("Movie mode", steps, 3));
+    TEST_ASSERT_TRUE(t.add("", nullptr, 0));
+    std::vector<uint8_t> blob;
+    t.toBlob(blob);
+    SavedSequenceTable u;
+    TEST_ASSERT_TRUE(u.loadBlob(blob.data(), blob.size()));
+    TEST_ASSERT_EQUAL(2, u.size());
+    TEST_ASSERT_EQUAL_STRING("Movie mode", u.name(0));
+    TEST_ASSERT_EQUAL(0, u.stepCount(1));
+    for (size_t j = 0; j < 3; j++) {
+        TEST_ASSERT_EQUAL(steps[j].codeId, u.step(0, j).codeId);
+        TEST_ASSERT_EQUAL(steps[j].protocol, u.step(0, j).protocol);
+        TEST_ASSERT_TRUE(steps[j].value == u.step(0, j).value);
+        TEST_ASSERT_EQUAL(steps[j].bits, u.step(0, j).bits);
+        TEST_ASSERT_EQUAL(steps[j].repeat, u.step(0, j).repeat);
+        TEST_ASSERT_EQUAL(steps[j].postDelayMs, u.step(0, j).postDelayMs);
+    }
+    std::vector<uint8_t> again;
+    u.toBlob(again);
+    TEST_ASSERT_TRUE(blob == again);
+
+    // One record is what the table's blob holds for it
+    std::vector<uint8_t> record(t.recordBytes(0));
+    t.toRecord(0, record.data());
+    TEST_ASSERT_TRUE(std::equal(record.begin(), record.end(), blob.begin() + SavedSequenceTable::kBlobHeaderBytes + 2));
+    TEST_ASSERT_TRUE(u.addRecord(record.data(), record.size()));
+    TEST_ASSERT_EQUAL(3, u.size());
+    TEST_ASSERT_FALSE(u.addRecord(record.data(), record.size() - 1));
+
+    // Truncated, padded or of another version: rejected, table left empty
+    TEST_ASSERT_FALSE(u.loadBlob(blob.data(), blob.size() - 1));
+    TEST_ASSERT_EQUAL(0, u.size());
+    blob.push_back(0);
+    TEST_ASSERT_FALSE(u.loadBlob(blob.data(), blob.size()));
+    blob.pop_back();
+    blob[3]++;
+    TEST_ASSERT_FALSE(u.loadBlob(blob.data(), blob.size()));
+    TEST_ASSERT_EQUAL(0, u.size());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_add_and_lookup);
+    RUN_TEST(test_add_rejects_invalid);
+    RUN_TEST(test_resolve_uses_saved_codes_and_repeats);
+    RUN_TEST(test_resolve_skips_unsendable_steps);
+    RUN_TEST(test_steps_follow_codes_by_id);
+    RUN_TEST(test_remove);
+    RUN_TEST(test_blob_roundtrip);
+    return UNITY_END();
+}
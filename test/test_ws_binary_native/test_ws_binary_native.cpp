@@ -0,0 +1,179 @@
+#include <unity.h>
+#include "Arduino.h"
+#include <ArduinoJson.h>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <IRremoteESP8266.h>
+#include "hex_utils.h"
+#include "ws_binary.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_send_roundtrip(void) {
+    WsSendFrame in = {0xBEEF, NEC, 32, 3, 0x20DF10EFull};
+    uint8_t buf[kWsSendBytes];
+    TEST_ASSERT_EQUAL(kWsSendBytes, wsEncodeSend(in, buf));
+    TEST_ASSERT_EQUAL((uint8_t)WsFrameType::Send, wsFrameType(buf, sizeof(buf)));
+    // Little-endian on the wire, whatever the host
+    TEST_ASSERT_EQUAL_HEX8(0xEF, buf[1]);
+    TEST_ASSERT_EQUAL_HEX8(0xBE, buf[2]);
+    TEST_ASSERT_EQUAL_HEX8(0xEF, buf[8]);
+    TEST_ASSERT_EQUAL_HEX8(0x20, buf[11]);
+    WsSendFrame out;
+    TEST_ASSERT_TRUE(wsDecodeSend(buf, sizeof(buf), out));
+    TEST_ASSERT_EQUAL(in.request, out.request);
+    TEST_ASSERT_EQUAL(in.protocol, out.protocol);
+    TEST_ASSERT_EQUAL(in.bits, out.bits);
+    TEST_ASSERT_EQUAL(in.repeat, out.repeat);
+    TEST_ASSERT_EQUAL_UINT64(in.value, out.value);
+
+    in.protocol = UNKNOWN;  // negative ids survive
+    in.value = 0xFFFFFFFFFFFFFFFFull;
+    wsEncodeSend(in, buf);
+    TEST_ASSERT_TRUE(wsDecodeSend(buf, sizeof(buf), out));
+    TEST_ASSERT_EQUAL(UNKNOWN, out.protocol);
+    TEST_ASSERT_EQUAL_UINT64(in.value, out.value);
+}
+
+void test_ack_and_event_roundtrip(void) {
+    WsAckFrame ack = {7, WsSendStatus::QueueFull, 3, 0xA1B2C3D4};
+    uint8_t buf[kWsIrEventBytes];
+    TEST_ASSERT_EQUAL(kWsAckBytes, wsEncodeAck(ack, buf));
+    WsAckFrame ackOut;
+    TEST_ASSERT_TRUE(wsDecodeAck(buf, kWsAckBytes, ackOut));
+    TEST_ASSERT_EQUAL(7, ackOut.request);
+    TEST_ASSERT_TRUE(ackOut.status == WsSendStatus::QueueFull);
+    TEST_ASSERT_EQUAL(3, ackOut.admission);
+    TEST_ASSERT_EQUAL_HEX32(0xA1B2C3D4, ackOut.job);
+
+    WsIrEventFrame ev = {123456, SAMSUNG, 32, 0xE0E040BFull, 2, 65535, 7};
+    TEST_ASSERT_EQUAL(kWsIrEventBytes, wsEncodeIrEvent(ev, buf));
+    WsIrEventFrame evOut;
+    TEST_ASSERT_TRUE(wsDecodeIrEvent(buf, kWsIrEventBytes, evOut));
+    TEST_ASSERT_EQUAL(ev.seq, evOut.seq);
+    TEST_ASSERT_EQUAL(ev.protocol, evOut.protocol);
+    TEST_ASSERT_EQUAL(ev.bits, evOut.bits);
+    TEST_ASSERT_EQUAL_UINT64(ev.value, evOut.value);
+    TEST_ASSERT_EQUAL(2, evOut.match);
+    TEST_ASSERT_EQUAL(65535, evOut.savedId);
+    TEST_ASSERT_EQUAL(7, evOut.repeat);
+
+    uint8_t version = 0;
+    TEST_ASSERT_EQUAL(kWsHelloBytes, wsEncodeHello(buf));
+    TEST_ASSERT_TRUE(wsDecodeHello(buf, kWsHelloBytes, version));
+    TEST_ASSERT_EQUAL(kWsBinaryVersion, version);
+}
+
+void test_rejects_wrong_frames(void) {
+    uint8_t buf[32] = {0};
+    WsSendFrame frame = {1, NEC, 32, 1, 1};
+    wsEncodeSend(frame, buf);
+    WsSendFrame out;
+    TEST_ASSERT_FALSE(wsDecodeSend(buf, kWsSendBytes - 1, out));
+    TEST_ASSERT_FALSE(wsDecodeSend(buf, kWsSendBytes + 1, out));
+    TEST_ASSERT_FALSE(wsDecodeSend(buf, 0, out));
+    WsAckFrame ack;
+    TEST_ASSERT_FALSE(wsDecodeAck(buf, kWsAckBytes, ack));  // a Send, not an Ack
+    uint8_t version;
+    TEST_ASSERT_FALSE(wsDecodeHello(buf, kWsHelloBytes, version));
+    TEST_ASSERT_EQUAL(0, wsFrameType(buf, 0));
+}
+
+void test_status_text_matches_json_errors(void) {
+    TEST_ASSERT_EQUAL_STRING("Invalid repeat (1-20)", wsSendStatusText(WsSendStatus::InvalidRepeat));
+    TEST_ASSERT_EQUAL_STRING("Unsupported type", wsSendStatusText(WsSendStatus::UnsupportedType));
+    TEST_ASSERT_EQUAL_STRING("Invalid data or length", wsSendStatusText(WsSendStatus::InvalidLength));
+    TEST_ASSERT_EQUAL_STRING("IR queue full", wsSendStatusText(WsSendStatus::QueueFull));
+}
+
+// What the device does per message on each path, minus the send itself:
+// decode a send command and encode its ack, and encode one IR event.
+void test_benchmark_binary_vs_json(void) {
+    const int rounds = 20000;
+    const char* jsonSend = "{\"cmd\":\"send\",\"type\":\"nec\",\"data\":\"20DF10EF\",\"length\":32,\"repeat\":1}";
+    size_t jsonSendLen = strlen(jsonSend);
+    size_t jsonAckLen = 0, jsonEventLen = 0;
+    volatile uint64_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        JsonDocument req;
+        TEST_ASSERT_FALSE(deserializeJson(req, jsonSend, jsonSendLen));
+        const char* data = req["data"] | "";
+        int length = req["length"] | 32;
+        int repeat = req["repeat"] | 1;
+        uint64_t value = 0;
+        parseHex64(data, value);
+        sink = sink + value + length + repeat;
+        JsonDocument ack;
+        ack["ok"] = true;
+        ack["msg"] = "Sent NEC 20DF10EF";
+        ack["job"] = (uint32_t)r;
+        ack["admission"] = "accepted";
+        std::string out;
+        serializeJson(ack, out);
+        jsonAckLen = out.size();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        uint8_t in[kWsSendBytes];
+        WsSendFrame frame = {(uint16_t)r, NEC, 32, 1, 0x20DF10EFull};
+        wsEncodeSend(frame, in);  // stands in for the client
+        WsSendFrame got;
+        TEST_ASSERT_TRUE(wsDecodeSend(in, sizeof(in), got));
+        sink = sink + got.value + got.bits + got.repeat;
+        uint8_t out[kWsAckBytes];
+        WsAckFrame ack = {got.request, WsSendStatus::Ok, 0, (uint32_t)r};
+        wsEncodeAck(ack, out);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        String hex = uint64ToHexBits(0x20DF10EFull, 32);
+        JsonDocument doc;
+        doc["event"] = "ir";
+        doc["seq"] = (uint32_t)r;
+        doc["protocol"] = "NEC";
+        doc["value"] = hex.c_str();
+        doc["bits"] = 32;
+        doc["match"] = "exact";
+        std::string out;
+        serializeJson(doc, out);
+        jsonEventLen = out.size();
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        uint8_t out[kWsIrEventBytes];
+        WsIrEventFrame ev = {(uint32_t)r, NEC, 32, 0x20DF10EFull, 2, 1, 1};
+        wsEncodeIrEvent(ev, out);
+        sink = sink + out[1];
+    }
+    auto t4 = std::chrono::steady_clock::now();
+    (void)sink;
+
+    auto ns = [&](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+        return std::chrono::duration<double, std::nano>(b - a).count() / rounds;
+    };
+    char msg[200];
+    snprintf(msg, sizeof(msg), "send+ack: JSON %u+%u B %.0f ns, binary %u+%u B %.0f ns",
+             (unsigned)jsonSendLen, (unsigned)jsonAckLen, ns(t0, t1), (unsigned)kWsSendBytes,
+             (unsigned)kWsAckBytes, ns(t1, t2));
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "ir event: JSON %u B %.0f ns, binary %u B %.0f ns", (unsigned)jsonEventLen,
+             ns(t2, t3), (unsigned)kWsIrEventBytes, ns(t3, t4));
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(kWsSendBytes + kWsAckBytes < jsonSendLen + jsonAckLen);
+    TEST_ASSERT_TRUE(kWsIrEventBytes < jsonEventLen);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_send_roundtrip);
+    RUN_TEST(test_ack_and_event_roundtrip);
+    RUN_TEST(test_rejects_wrong_frames);
+    RUN_TEST(test_status_text_matches_json_errors);
+    RUN_TEST(test_benchmark_binary_vs_json);
+    return UNITY_END();
+}
@@ -0,0 +1,184 @@
+#include <unity.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "ws_event_limiter.h"
+
+typedef WsEventLimiter::Action Action;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// One pass over a single client
+static WsEventLimiter::Decision pass(WsEventLimiter& l, uint32_t now, uint32_t id = 1, bool ready = true) {
+    l.beginPass(now);
+    WsEventLimiter::Decision d = l.next(id, ready);
+    l.endPass();
+    return d;
+}
+
+void test_first_event_goes_out_at_once(void) {
+    WsEventLimiter l(200, 10000);
+    TEST_ASSERT_FALSE(l.waiting());
+    pass(l, 0);  // the client is known before the code comes in
+    l.capture(3, 0x20DF10EF, 32);
+    TEST_ASSERT_TRUE(l.waiting());
+    WsEventLimiter::Decision d = pass(l, 5);
+    TEST_ASSERT_TRUE(d.action == Action::Send);
+    TEST_ASSERT_EQUAL(1, d.repeat);
+    TEST_ASSERT_FALSE(l.waiting());
+    TEST_ASSERT_TRUE(pass(l, 6).action == Action::None);
+    TEST_ASSERT_EQUAL(1, l.sent());
+}
+
+void test_new_client_gets_captures_since_last_pass(void) {
+    WsEventLimiter l(200, 10000);
+    l.capture(3, 1, 32);
+    TEST_ASSERT_TRUE(pass(l, 0, 7).action == Action::Send);
+    TEST_ASSERT_TRUE(pass(l, 1, 8).action == Action::None);  // connected after it went out
+}
+
+void test_held_button_folds_into_repeat(void) {
+    WsEventLimiter l(200, 10000);
+    pass(l, 0);
+    l.capture(3, 0xFF, 32);
+    TEST_ASSERT_EQUAL(1, pass(l, 0).repeat);
+    // Four more frames of the same code inside the interval
+    for (uint32_t t = 40; t <= 160; t += 40) {
+        l.capture(3, 0xFF, 32);
+        TEST_ASSERT_TRUE(pass(l, t).action == Action::None);
+    }
+    TEST_ASSERT_TRUE(l.waiting());
+    TEST_ASSERT_TRUE(pass(l, 199).action == Action::None);
+    WsEventLimiter::Decision d = pass(l, 200);
+    TEST_ASSERT_TRUE(d.action == Action::Send);
+    TEST_ASSERT_EQUAL(4, d.repeat);
+    TEST_ASSERT_EQUAL(3, l.coalesced());
+    TEST_ASSERT_EQUAL(0, l.dropped());
+}
+
+void test_different_code_replaces_waiting_one(void) {
+    WsEventLimiter l(200, 10000);
+    pass(l, 0);
+    l.capture(3, 0xFF, 32);
+    pass(l, 0);
+    l.capture(3, 0xFF, 32);
+    pass(l, 50);
+    l.capture(3, 0xFF, 32);
+    pass(l, 60);  // waiting with repeat 2
+    l.capture(3, 0xFF, 16);  // same value, other bits: another code
+    WsEventLimiter::Decision d = pass(l, 250);
+    TEST_ASSERT_EQUAL(1, d.repeat);
+    TEST_ASSERT_EQUAL(2, l.dropped());
+    TEST_ASSERT_EQUAL(1, l.coalesced());
+
+    // Captures that never met a pass are lost as well
+    l.capture(3, 0xFF, 16);
+    l.capture(3, 0xFF, 16);
+    d = pass(l, 500);
+    TEST_ASSERT_EQUAL(1, d.repeat);
+    TEST_ASSERT_EQUAL(3, l.dropped());
+}
+
+void test_backed_up_client_is_skipped_then_closed(void) {
+    WsEventLimiter l(200, 1000);
+    l.beginPass(0);
+    l.next(1, true);
+    l.next(2, true);
+    l.endPass();
+    l.capture(3, 0xFF, 32);
+    l.beginPass(10);
+    TEST_ASSERT_TRUE(l.next(1, false).action == Action::None);
+    TEST_ASSERT_TRUE(l.next(2, true).action == Action::Send);
+    l.endPass();
+    TEST_ASSERT_EQUAL(1, l.deferred());
+    // Still waiting, and still folding, while its queue stays full
+    l.capture(3, 0xFF, 32);
+    l.beginPass(500);
+    TEST_ASSERT_TRUE(l.next(1, false).action == Action::None);
+    TEST_ASSERT_TRUE(l.next(2, true).action == Action::Send);
+    l.endPass();
+    TEST_ASSERT_EQUAL(1, l.deferred());  // counted once per stall
+    // The queue drains: both captures go out as one event
+    l.beginPass(600);
+    WsEventLimiter::Decision d = l.next(1, true);
+    l.next(2, true);
+    l.endPass();
+    TEST_ASSERT_TRUE(d.action == Action::Send);
+    TEST_ASSERT_EQUAL(2, d.repeat);
+
+    l.capture(3, 0xFF, 32);
+    TEST_ASSERT_TRUE(pass(l, 900, 1, false).action == Action::None);
+    TEST_ASSERT_TRUE(pass(l, 1899, 1, false).action == Action::None);
+    TEST_ASSERT_TRUE(pass(l, 1900, 1, false).action == Action::Close);
+    TEST_ASSERT_EQUAL(1, l.closed());
+    TEST_ASSERT_EQUAL(1, l.dropped());
+    TEST_ASSERT_FALSE(l.waiting());
+}
+
+void test_missing_client_is_forgotten(void) {
+    WsEventLimiter l(200, 10000);
+    l.beginPass(0);
+    for (uint32_t id = 1; id <= WsEventLimiter::kClients; id++) l.next(id, true);
+    l.endPass();
+    l.capture(3, 0xFF, 32);
+    l.beginPass(10);
+    for (uint32_t id = 1; id <= WsEventLimiter::kClients; id++) l.next(id, false);
+    l.endPass();
+    pass(l, 20, 1, false);  // the others have gone with their events
+    TEST_ASSERT_EQUAL(WsEventLimiter::kClients - 1, l.dropped());
+    // A full table still takes a new client in place of one not seen this pass
+    l.beginPass(30);
+    for (uint32_t id = 100; id < 100 + WsEventLimiter::kClients; id++) l.next(id, true);
+    TEST_ASSERT_TRUE(l.next(200, true).action == Action::None);
+    l.endPass();
+    TEST_ASSERT_EQUAL(WsEventLimiter::kClients, l.dropped());
+}
+
+// A button held for 5 s with a frame every 45 ms (SONY-like), four clients,
+// one of them slow. Every capture is either delivered in a repeat count,
+// still waiting, or counted as dropped; events per client stay within the rate.
+void test_benchmark_held_button_burst(void) {
+    const uint32_t interval = 200, frameMs = 45, heldMs = 5000;
+    const uint32_t clients = 4;
+    WsEventLimiter l(interval, 10000);
+    uint32_t events[clients] = {0}, repeats[clients] = {0}, captures = 0;
+    for (uint32_t now = 0; now <= heldMs + interval; now++) {
+        if (now % frameMs == 0 && now <= heldMs) {
+            l.capture(5, 0x490, 12);
+            captures++;
+        }
+        if (!l.waiting()) continue;
+        l.beginPass(now);
+        for (uint32_t id = 1; id <= clients; id++) {
+            // Client 4 backs up every other second while the button is held
+            bool ready = id != 4 || now > heldMs || (now / 1000) % 2 == 0;
+            WsEventLimiter::Decision d = l.next(id, ready);
+            if (d.action != Action::Send) continue;
+            events[id - 1]++;
+            repeats[id - 1] += d.repeat;
+        }
+        l.endPass();
+    }
+    char msg[160];
+    for (uint32_t i = 0; i < clients; i++) {
+        TEST_ASSERT_TRUE(events[i] <= heldMs / interval + 2);
+        TEST_ASSERT_EQUAL(captures, repeats[i]);
+        snprintf(msg, sizeof(msg), "client %u: %u captures in %u events", (unsigned)(i + 1), (unsigned)captures,
+                 (unsigned)events[i]);
+        TEST_MESSAGE(msg);
+    }
+    TEST_ASSERT_EQUAL(0, l.dropped());
+    TEST_ASSERT_EQUAL(l.sent() + l.coalesced(), captures * clients);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_event_goes_out_at_once);
+    RUN_TEST(test_new_client_gets_captures_since_last_pass);
+    RUN_TEST(test_held_button_folds_into_repeat);
+    RUN_TEST(test_different_code_replaces_waiting_one);
+    RUN_TEST(test_backed_up_client_is_skipped_then_closed);
+    RUN_TEST(test_missing_client_is_forgotten);
+    RUN_TEST(test_benchmark_held_button_burst);
+    return UNITY_END();
+}